@@ -26,6 +26,9 @@ $(info >>> Makefile.plugins.mk: PWD is [$(CURDIR)]) # Current working dir for ma
 #      while "lv2_sep" target has dsp and ui in separate binaries.
 #      use of this target must match the definition of `DISTRHO_PLUGIN_WANT_DIRECT_ACCESS`
 
+# NOTE the "bench" target is not a plugin format, but a headless program that benchmarks the plugin DSP.
+#      run it with `--help` for a list of options, results are written as JSON.
+
 # ---------------------------------------------------------------------------------------------------------------------
 # Try to figure out where DPF is located
 
@@ -152,12 +155,6 @@ JACK_LIBS  += $(ALSA_LIBS)
 endif
 endif
 
-ifeq ($(HAVE_RTAUDIO),true)
-ifneq ($(HAIKU),true)
-JACK_LIBS  += -lpthread
-endif
-endif
-
 ifeq ($(HAVE_SDL2),true)
 JACK_FLAGS += $(SDL2_FLAGS)
 JACK_LIBS  += $(SDL2_LIBS)
@@ -165,6 +162,13 @@ endif
 
 endif
 
+# threads are used by the native audio fallback and for offline rendering
+ifneq ($(WASM),true)
+ifneq ($(HAIKU),true)
+JACK_LIBS  += -lpthread
+endif
+endif
+
 # ---------------------------------------------------------------------------------------------------------------------
 # Set files to build
 
@@ -323,6 +327,8 @@ else
 jack       = $(TARGET_DIR)/$(NAME)$(APP_EXT)
 endif
 
+bench      = $(TARGET_DIR)/$(NAME)-bench$(APP_EXT)
+
 ladspa_dsp = $(TARGET_DIR)/$(NAME)-ladspa$(LIB_EXT)
 dssi_dsp   = $(TARGET_DIR)/$(NAME)-dssi$(LIB_EXT)
 dssi_ui    = $(TARGET_DIR)/$(NAME)-dssi/$(NAME)_ui$(APP_EXT)
@@ -527,6 +533,22 @@ endif
 	@echo "Creating JACK standalone for $(NAME)"
 	$(SILENT)$(CXX) $^ $(BUILD_CXX_FLAGS) $(LINK_FLAGS) $(EXTRA_LIBS) $(EXTRA_DSP_LIBS) $(EXTRA_UI_LIBS) $(DGL_LIBS) $(JACK_LIBS) -o $@
 
+# ---------------------------------------------------------------------------------------------------------------------
+# Benchmark
+
+ifneq ($(HAIKU),true)
+ifneq ($(WASM),true)
+BENCH_LIBS = -lpthread
+endif
+endif
+
+bench: $(bench)
+
+$(bench): $(OBJS_DSP) $(BUILD_DIR)/DistrhoPluginMain_BENCH.cpp.o
+	-@mkdir -p $(shell dirname $@)
+	@echo "Creating benchmark runner for $(NAME)"
+	$(SILENT)$(CXX) $^ $(BUILD_CXX_FLAGS) $(LINK_FLAGS) $(EXTRA_LIBS) $(EXTRA_DSP_LIBS) $(BENCH_LIBS) -o $@
+
 # ---------------------------------------------------------------------------------------------------------------------
 # LADSPA
 
@@ -813,6 +835,7 @@ ifneq ($(UI_TYPE),)
 endif
 
 -include $(BUILD_DIR)/DistrhoPluginMain_JACK.cpp.d
+-include $(BUILD_DIR)/DistrhoPluginMain_BENCH.cpp.d
 -include $(BUILD_DIR)/DistrhoPluginMain_LADSPA.cpp.d
 -include $(BUILD_DIR)/DistrhoPluginMain_DSSI.cpp.d
 -include $(BUILD_DIR)/DistrhoPluginMain_LV2.cpp.d
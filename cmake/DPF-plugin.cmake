@@ -73,6 +73,7 @@ include(CMakeParseArguments)
 #   `TARGETS` <tgt1>...<tgtN>
 #       a list of one of more of the following target types:
 #       `jack`, `ladspa`, `dssi`, `lv2`, `vst2`, `vst3`, `clap`
+#       `bench` is also accepted, building a headless benchmark runner for the DSP
 #
 #   `UI_TYPE` <type>
 #       the user interface type: `opengl` (default), `cairo`, `external`
@@ -180,6 +181,8 @@ function(dpf_add_plugin NAME)
   foreach(_target ${_dpf_plugin_TARGETS})
     if(_target STREQUAL "jack")
       dpf__build_jack("${NAME}" "${_dgl_has_ui}")
+    elseif(_target STREQUAL "bench")
+      dpf__build_bench("${NAME}")
     elseif(_target STREQUAL "ladspa")
       dpf__build_ladspa("${NAME}")
     elseif(_target STREQUAL "dssi")
@@ -244,6 +247,7 @@ function(dpf__build_jack NAME HAS_UI)
     target_compile_definitions("${NAME}" PUBLIC "HAVE_RTAUDIO")
   else()
     find_package(Threads)
+    target_link_libraries("${NAME}-jack" PRIVATE ${CMAKE_THREAD_LIBS_INIT})
     pkg_check_modules(ALSA "alsa")
     pkg_check_modules(PULSEAUDIO "libpulse-simple")
     if(ALSA_FOUND)
@@ -280,6 +284,27 @@ function(dpf__build_jack NAME HAS_UI)
   endif()
 endfunction()
 
+# dpf__build_bench
+# ------------------------------------------------------------------------------
+#
+# Add build rules for a headless benchmark program, running only the DSP.
+#
+function(dpf__build_bench NAME)
+  dpf__create_dummy_source_list(_no_srcs)
+
+  dpf__add_executable("${NAME}-bench" ${_no_srcs})
+  dpf__add_plugin_main("${NAME}-bench" "bench")
+  target_link_libraries("${NAME}-bench" PRIVATE "${NAME}-dsp")
+  set_target_properties("${NAME}-bench" PROPERTIES
+    RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/bin/$<0:>"
+    OUTPUT_NAME "${NAME}-bench")
+
+  if((NOT WIN32) AND (NOT HAIKU))
+    find_package(Threads)
+    target_link_libraries("${NAME}-bench" PRIVATE ${CMAKE_THREAD_LIBS_INIT})
+  endif()
+endfunction()
+
 # dpf__build_ladspa
 # ------------------------------------------------------------------------------
 #
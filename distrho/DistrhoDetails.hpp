@@ -144,6 +144,16 @@ static constexpr const uint32_t kParameterIsTrigger = 0x20 | kParameterIsBoolean
  */
 static constexpr const uint32_t kParameterIsHidden = 0x40;
 
+/**
+   Parameter value changes should be smoothed.@n
+   DPF will ramp towards each new value over Parameter::smoothingTime,
+   with the per-frame values available during run() via Plugin::getSmoothedParameterBuffer().
+
+   The plugin still receives the target value through Plugin::setParameterValue() as usual.@n
+   Cannot be used for output or trigger parameters.
+ */
+static constexpr const uint32_t kParameterIsSmoothed = 0x80;
+
 /** @} */
 
 /* --------------------------------------------------------------------------------------------------------------------
@@ -266,6 +276,14 @@ enum PredefinedPortGroupsIds {
     kPortGroupStereo = (uint32_t)-3
 };
 
+/**
+   Special tail length value, for plugins whose output never decays to silence on its own.@n
+   Hosts are told the tail is infinite, and DPF never skips processing on silent input.
+
+   @see Plugin::setTailLength(uint32_t)
+ */
+static constexpr const uint32_t kTailLengthInfinite = (uint32_t)-1;
+
 /**
    Audio Port.
 
@@ -653,6 +671,13 @@ struct Parameter {
     */
     uint32_t groupId;
 
+   /**
+      Time in seconds it takes for a smoothed parameter to reach a new value.@n
+      Only used when the parameter has the kParameterIsSmoothed hint, a value of 0 disables smoothing.
+      The default is 20ms.
+    */
+    float smoothingTime;
+
    /**
       Default constructor for a null parameter.
     */
@@ -667,7 +692,8 @@ struct Parameter {
           enumValues(),
           designation(kParameterDesignationNull),
           midiCC(0),
-          groupId(kPortGroupNone) {}
+          groupId(kPortGroupNone),
+          smoothingTime(0.02f) {}
 
    /**
       Constructor using custom values.
@@ -683,7 +709,8 @@ struct Parameter {
           enumValues(),
           designation(kParameterDesignationNull),
           midiCC(0),
-          groupId(kPortGroupNone) {}
+          groupId(kPortGroupNone),
+          smoothingTime(0.02f) {}
 
 #ifdef DISTRHO_PROPER_CPP11_SUPPORT
    /**
@@ -702,7 +729,8 @@ struct Parameter {
           enumValues(evcount, true, ev),
           designation(kParameterDesignationNull),
           midiCC(0),
-          groupId(kPortGroupNone) {}
+          groupId(kPortGroupNone),
+          smoothingTime(0.02f) {}
 #endif
 
    /**
@@ -1051,6 +1079,70 @@ struct TimePosition {
     }
 };
 
+/**
+   Processing statistics.@n
+   Load values are the time spent processing a block divided by the duration of that block in real-time,
+   so 1.0 means the whole real-time budget was used.
+
+   Percentiles are taken from a histogram with a resolution of 1% load, counting all blocks since activation.
+   @see Plugin::getProcessingStats()
+ */
+struct ProcessingStats {
+   /**
+      Number of blocks processed since the last activation.
+    */
+    uint32_t blockCount;
+
+   /**
+      Number of blocks that took longer to process than their duration in real-time.
+    */
+    uint32_t overrunCount;
+
+   /**
+      Load of the most recent block.
+    */
+    float lastLoad;
+
+   /**
+      Median load.
+    */
+    float p50Load;
+
+   /**
+      99th percentile load, only 1% of blocks took longer than this.
+    */
+    float p99Load;
+
+   /**
+      Highest load seen.
+    */
+    float maxLoad;
+
+   /**
+      Default constructor for empty statistics.
+    */
+    ProcessingStats() noexcept
+        : blockCount(0),
+          overrunCount(0),
+          lastLoad(0.0f),
+          p50Load(0.0f),
+          p99Load(0.0f),
+          maxLoad(0.0f) {}
+};
+
+/**
+   Base class for data loaded in the background from a state value, such as a decoded sample or impulse response.@n
+   Objects are created by Plugin::loadStateObject() and owned by DPF from then on,
+   which deletes them outside of run() once they are no longer in use.
+   @see Plugin::requestStateLoad(uint32_t, const char*)
+ */
+struct StateObject {
+   /**
+      Destructor, always called from a non-realtime thread.
+    */
+    virtual ~StateObject() {}
+};
+
 /** @} */
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -32,7 +32,9 @@ START_NAMESPACE_DISTRHO
    The framework facilitates exporting various different plugin formats from the same code-base.
 
    DPF can build for LADSPA, DSSI, LV2, VST2, VST3 and CLAP formats.@n
-   A JACK/Standalone mode is also available, allowing you to quickly test plugins.
+   A JACK/Standalone mode is also available, allowing you to quickly test plugins.@n
+   The standalone executable can also render audio files offline, using
+   <tt>render input.wav output.wav [--midi file.mid] [--state preset] [--block N] [--rate R]</tt>.
 
    @section Macros
    You start by creating a "DistrhoPluginInfo.h" file describing the plugin via macros, see @ref PluginMacros.@n
@@ -553,18 +555,48 @@ START_NAMESPACE_DISTRHO
  */
 #define DISTRHO_PLUGIN_WANT_LATENCY 1
 
+/**
+   Whether the plugin can process audio in double precision.@n
+   When enabled, the plugin must implement the double variant of Plugin::run(),
+   which is used instead of the float one when the host provides 64-bit audio buffers.@n
+   Only the VST2, VST3 and CLAP formats support this, others always use single precision.
+ */
+#define DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION 1
+
 /**
    Whether the plugin wants MIDI input.@n
    This is automatically enabled if @ref DISTRHO_PLUGIN_IS_SYNTH is true.
  */
 #define DISTRHO_PLUGIN_WANT_MIDI_INPUT 1
 
+/**
+   Minimum amount of incoming MIDI events that can be received per audio block.@n
+   Storage is allocated on activation, for at least one event per frame of the maximum buffer size.@n
+   If a host sends more events than fit, the extra events are dropped and counted,
+   and the storage is doubled on the next activation.
+   @see Plugin::getDroppedMidiEventCount()
+ */
+#define DISTRHO_PLUGIN_MIDI_INPUT_EVENT_CAPACITY 512
+
+/**
+   Amount of bytes reserved per audio block for incoming MIDI messages larger than MidiEvent::kDataSize, such as SysEx.@n
+   These are copied into storage owned by DPF and exposed through MidiEvent::dataExt, valid until run() returns.
+ */
+#define DISTRHO_PLUGIN_MIDI_INPUT_SYSEX_CAPACITY 16384
+
 /**
    Whether the plugin wants MIDI output.
    @see Plugin::writeMidiEvent(const MidiEvent&)
+   @see Plugin::scheduleMidiEvent(uint64_t, const MidiEvent&)
  */
 #define DISTRHO_PLUGIN_WANT_MIDI_OUTPUT 1
 
+/**
+   Maximum amount of outgoing MIDI events that can wait in the queue used by Plugin::scheduleMidiEvent().@n
+   The queue is allocated once per plugin instance, only used if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT is enabled.
+ */
+#define DISTRHO_PLUGIN_MIDI_OUTPUT_SCHEDULER_CAPACITY 512
+
 /**
    Whether the plugin wants to change its own parameter inputs.@n
    Not all hosts or plugin formats support this,
@@ -573,6 +605,35 @@ START_NAMESPACE_DISTRHO
  */
 #define DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST 1
 
+/**
+   Whether the plugin wants to load some of its states in the background.@n
+   When enabled, Plugin::setState() can hand slow work such as reading samples from a file path
+   over to a loader thread owned by DPF, which creates a StateObject for run() to pick up.@n
+   Requires DISTRHO_PLUGIN_WANT_STATE.
+   @see Plugin::requestStateLoad(uint32_t, const char*)
+   @see Plugin::getStateObject(uint32_t)
+ */
+#define DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING 1
+
+/**
+   Whether the plugin wants to split its processing across multiple threads.@n
+   When enabled, Plugin::parallelFor() runs tasks on the host thread pool if available (CLAP only),
+   or otherwise on a pool of realtime worker threads owned by DPF, spawned when the plugin is first activated.@n
+   Requires C++11 support and is not available on wasm, where tasks run serially instead.
+   @see Plugin::parallelFor(uint32_t, ParallelTaskFunc, void*)
+ */
+#define DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING 1
+
+/**
+   Whether the plugin wants to measure its own DSP load.@n
+   When enabled, each run() call is timed against the real-time duration of its block,
+   which costs two clock reads per block.@n
+   Results are available through Plugin::getProcessingStats(),
+   and printed on every deactivation if the `DPF_STATS` environment variable is set.
+   @see Plugin::getProcessingStats()
+ */
+#define DISTRHO_PLUGIN_WANT_PROCESSING_STATS 1
+
 /**
    Whether the plugin provides its own internal programs.
    @see Plugin::initProgramName(uint32_t, String&)
@@ -603,6 +664,24 @@ START_NAMESPACE_DISTRHO
  */
 #define DISTRHO_PLUGIN_WANT_TIMEPOS 1
 
+/**
+   Whether the plugin wants sample-accurate parameter changes.@n
+   When enabled, DPF splits each host block at the frames where input parameters change,
+   calling Plugin::run() once per segment with the new values already set.@n
+   MIDI event frames are rebased to the start of each segment, so plugin code does not need to change.
+   @see DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE
+ */
+#define DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS 1
+
+/**
+   Smallest number of frames DPF will pass to Plugin::run() when splitting blocks for sample-accurate parameters.@n
+   Parameter changes closer than this to the start of a segment are applied at the start of that segment,
+   changes closer than this to the end of the block are applied at the start of the last segment.@n
+   Defaults to 16 if unset.
+   @see DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+ */
+#define DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE 16
+
 /**
    Whether the %UI uses a custom toolkit implementation based on OpenGL.@n
    When enabled, the macros @ref DISTRHO_UI_CUSTOM_INCLUDE_PATH and @ref DISTRHO_UI_CUSTOM_WIDGET_TYPE are required.
@@ -868,6 +947,11 @@ START_NAMESPACE_DISTRHO
    Useful to enable as part of CI, can safely be skipped.@n
    Under DPF makefiles this can be enabled by using `make DPF_RUNTIME_TESTING=true`.
 
+   On Linux, running the JACK/Standalone executable with "selftest" also checks run() for real-time safety.@n
+   Memory allocation, mutex locking, file and console I/O and sleeping done from within run() are reported
+   at the end of the test with a backtrace of each offending call site.@n
+   Set `DPF_RUNTIME_TESTING_ABORT=1` in the environment to abort on the first violation instead.
+
    @note Some checks are only available with the GCC compiler,
          for detecting if a virtual function has been reimplemented.
  */
@@ -90,6 +90,17 @@ public:
     */
     double getSampleRate() const noexcept;
 
+   /**
+      Check if the host is rendering offline (bouncing or exporting) instead of in real-time.@n
+      When true, run() is not bound by real-time deadlines, so plugins can use more expensive processing
+      such as larger FFT sizes, higher oversampling or non real-time safe code paths.@n
+      This value will remain constant between activate and deactivate.
+      @note Only VST3, CLAP and JACK (freewheel mode or the "render" command) report offline rendering,
+            other formats always return false.
+      @see renderModeChanged(bool)
+    */
+    bool isOfflineRendering() const noexcept;
+
    /**
       Get the bundle path where the plugin resides.
       Can return null if the plugin is not available in a bundle (if it is a single binary).
@@ -126,6 +137,46 @@ public:
     const TimePosition& getTimePosition() const noexcept;
 #endif
 
+   /**
+      Get the smoothed values of a parameter for the current run() call, one value per frame.@n
+      Returns null if the parameter does not have the kParameterIsSmoothed hint.
+      The buffer holds getBufferSize() values; if the host runs a larger block the parameter jumps to its target
+      and is reported as constant for that block.
+      @note This function must only be called during run().
+      @see isSmoothedParameterConstant(uint32_t)
+    */
+    const float* getSmoothedParameterBuffer(uint32_t index) const noexcept;
+
+   /**
+      Check if a smoothed parameter stays at the same value during the current run() call.@n
+      When true, every value in the smoothed buffer is the same and can be read once instead of per frame.
+      @note This function must only be called during run().
+    */
+    bool isSmoothedParameterConstant(uint32_t index) const noexcept;
+
+   /**
+      Get the current plugin tail length, in frames.
+      @see setTailLength(uint32_t)
+    */
+    uint32_t getTailLength() const noexcept;
+
+   /**
+      Change the plugin tail length to @a frames.@n
+      The tail is how long the plugin keeps producing sound after its audio inputs become silent,
+      for example the decay time of a reverb or delay.
+
+      The tail length is reported to hosts that support it (VST2, VST3 and CLAP).@n
+      Once a tail length is set, DPF will also skip calling run() when the audio inputs have been silent
+      for longer than the tail plus the latency, clearing the outputs instead.@n
+      This is never done for plugins without audio inputs or with MIDI input, as those can sound from silent input.@n
+      Other plugins that can produce sound from silent input (e.g. oscillators) should not set a finite tail,
+      or use kTailLengthInfinite to explicitly opt out of this behaviour.
+
+      The default is an unset tail of 0 frames, which never skips processing.@n
+      This function should only be called in the constructor, activate() and run().
+    */
+    void setTailLength(uint32_t frames) noexcept;
+
 #if DISTRHO_PLUGIN_WANT_LATENCY
    /**
       Change the plugin audio output latency to @a frames.@n
@@ -135,6 +186,16 @@ public:
     void setLatency(uint32_t frames) noexcept;
 #endif
 
+#if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+   /**
+      Get the amount of incoming MIDI events dropped since the last activation,
+      because more events were received in a single block than could be stored.@n
+      Storage grows on the next activation when this happens.
+      @see DISTRHO_PLUGIN_MIDI_INPUT_EVENT_CAPACITY
+    */
+    uint32_t getDroppedMidiEventCount() const noexcept;
+#endif
+
 #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
    /**
       Write a MIDI output event.@n
@@ -142,6 +203,95 @@ public:
       Returns false when the host buffer is full, in which case do not call this again until the next run().
     */
     bool writeMidiEvent(const MidiEvent& midiEvent) noexcept;
+
+   /**
+      Get the absolute frame of the first frame in the current run() call.@n
+      This is a running count of all frames processed by the plugin, independent of the host transport,
+      and serves as the timeline for scheduleMidiEvent().
+    */
+    uint64_t getRunFrame() const noexcept;
+
+   /**
+      Schedule a MIDI output event to be written at @a absoluteFrame, which may lie beyond the current block.@n
+      DPF keeps the event in a preallocated queue and writes it during the block that contains its frame,
+      interleaved in order with events written through writeMidiEvent().
+      Events on the same frame are written in the order they were scheduled,
+      and events whose frame has already passed are written as soon as possible.@n
+      When the host buffer is full, remaining events spill over to the start of the next block.
+
+      The @a midiEvent frame is ignored, and events larger than MidiEvent::kDataSize are not supported.@n
+      Returns false if the queue is full.@n
+      This function must only be called during activate() and run().
+      @see DISTRHO_PLUGIN_MIDI_OUTPUT_SCHEDULER_CAPACITY
+    */
+    bool scheduleMidiEvent(uint64_t absoluteFrame, const MidiEvent& midiEvent) noexcept;
+
+   /**
+      Get the amount of scheduled MIDI events that have not been written yet.
+    */
+    uint32_t getScheduledMidiEventCount() const noexcept;
+
+   /**
+      Discard all scheduled MIDI events that have not been written yet.@n
+      This function must only be called during activate() and run().
+    */
+    void cancelScheduledMidiEvents() noexcept;
+
+   /**
+      Write all scheduled MIDI events right away, regardless of their frame, keeping their order.@n
+      When called during run() the events are written at @a frame within the current block,
+      otherwise at the start of the next one.
+      This is typically used on transport stop so that pending note-offs are not lost.@n
+      This function must only be called during activate() and run().
+    */
+    void flushScheduledMidiEvents(uint32_t frame = 0) noexcept;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+   /**
+      Task callback for parallelFor(), receiving the user pointer and the index of the task to run.
+    */
+    typedef void (*ParallelTaskFunc)(void* ptr, uint32_t taskIndex);
+
+   /**
+      Run @a taskFunc for every task index from 0 to @a taskCount - 1, potentially in parallel.@n
+      The calling thread takes part in the work, and this function only returns once all tasks are complete.
+
+      Under CLAP the host thread pool is used when available,
+      otherwise the tasks are spread across realtime worker threads owned by DPF.@n
+      Tasks run serially when called outside of run() or before the first activation.
+
+      This function is meant to be called during run(), and must not be called from within one of its own tasks.@n
+      Tasks must not block or allocate memory, and they can run in any order.
+      @note This function is only available if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING is enabled.
+    */
+    void parallelFor(uint32_t taskCount, ParallelTaskFunc taskFunc, void* ptr) noexcept;
+
+   #ifdef DISTRHO_PROPER_CPP11_SUPPORT
+   /**
+      Convenience variant of parallelFor() for lambdas and other callable objects taking a task index.
+      @code
+      parallelFor(kNumVoices, [this](const uint32_t voice) { fVoices[voice].render(frames); });
+      @endcode
+    */
+    template<typename Callback>
+    void parallelFor(const uint32_t taskCount, const Callback& callback) noexcept
+    {
+        parallelFor(taskCount, [](void* const ptr, const uint32_t taskIndex) {
+            (*static_cast<const Callback*>(ptr))(taskIndex);
+        }, const_cast<void*>(static_cast<const void*>(&callback)));
+    }
+   #endif
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+   /**
+      Get statistics about how long run() takes compared to the real-time duration of each block.@n
+      Statistics are reset on every activation.@n
+      This function can be called from any thread, including from the UI when using direct access.
+      @note This function is only available if DISTRHO_PLUGIN_WANT_PROCESSING_STATS is enabled.
+    */
+    ProcessingStats getProcessingStats() const noexcept;
 #endif
 
 #if DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST
@@ -175,6 +325,37 @@ public:
     bool updateStateValue(const char* key, const char* value) noexcept;
 #endif
 
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+   /**
+      Load the state at @a index in the background instead of blocking the calling thread.@n
+      Call this from setState() for states that are slow to load, like samples or impulse responses from a file path.
+      loadStateObject() is then called with @a value from a loader thread owned by DPF,
+      and the resulting object becomes available to run() through getStateObject().@n
+      A newer request for the same state replaces an older one that has not started loading yet.
+
+      Hosts and UIs are notified once loading finishes, where the plugin format allows it.@n
+      On wasm, or without C++11 support, the state is loaded right away within this call instead.@n
+      This function must not be called from the plugin constructor or during run().
+      @note This function is only available if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING is enabled.
+    */
+    bool requestStateLoad(uint32_t index, const char* value);
+
+   /**
+      Check if the state at @a index has a background load that has not finished yet.
+      @note This function is only available if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING is enabled.
+    */
+    bool isStateLoading(uint32_t index) const noexcept;
+
+   /**
+      Get the most recent object loaded for the state at @a index, or null if nothing has been loaded yet.@n
+      Newly loaded objects are handed over on activation and at the start of each run() call,
+      so the returned pointer stays valid until the end of the current run().@n
+      This function is wait-free and must only be called during activate() and run().
+      @note This function is only available if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING is enabled.
+    */
+    StateObject* getStateObject(uint32_t index) const noexcept;
+#endif
+
 protected:
    /* --------------------------------------------------------------------------------------------------------
     * Information */
@@ -326,6 +507,16 @@ protected:
     virtual void setState(const char* key, const char* value);
 #endif
 
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+   /**
+      Load the state at @a index from @a value, as requested by requestStateLoad().@n
+      Called from a loader thread owned by DPF, this is where files should be read and decoded.@n
+      Return a new object to replace the current one, or null if loading failed.
+      @note This function is only available if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING is enabled.
+    */
+    virtual StateObject* loadStateObject(uint32_t index, const char* value);
+#endif
+
    /* --------------------------------------------------------------------------------------------------------
     * Audio/MIDI Processing */
 
@@ -341,7 +532,8 @@ protected:
 
 #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
    /**
-      Run/process function for plugins with MIDI input.
+      Run/process function for plugins with MIDI input.@n
+      MIDI events are always sorted by frame, regardless of the order in which the host delivered them.
       @note Some parameters might be null if there are no audio inputs/outputs or MIDI events.
     */
     virtual void run(const float** inputs, float** outputs, uint32_t frames,
@@ -354,6 +546,27 @@ protected:
     virtual void run(const float** inputs, float** outputs, uint32_t frames) = 0;
 #endif
 
+#if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+# if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+   /**
+      Double precision run/process function for plugins with MIDI input.@n
+      Called instead of the single precision variant when the host provides 64-bit audio buffers.
+      @note Some parameters might be null if there are no audio inputs/outputs or MIDI events.
+      @see DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+    */
+    virtual void run(const double** inputs, double** outputs, uint32_t frames,
+                     const MidiEvent* midiEvents, uint32_t midiEventCount) = 0;
+# else
+   /**
+      Double precision run/process function for plugins without MIDI input.@n
+      Called instead of the single precision variant when the host provides 64-bit audio buffers.
+      @note Some parameters might be null if there are no audio inputs or outputs.
+      @see DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+    */
+    virtual void run(const double** inputs, double** outputs, uint32_t frames) = 0;
+# endif
+#endif
+
    /* --------------------------------------------------------------------------------------------------------
     * Callbacks (optional) */
 
@@ -373,6 +586,13 @@ protected:
     */
     virtual void sampleRateChanged(double newSampleRate);
 
+   /**
+      Optional callback to inform the plugin about a change between real-time and offline rendering.@n
+      This function will only be called when the plugin is deactivated.
+      @see isOfflineRendering()
+    */
+    virtual void renderModeChanged(bool offline);
+
    /**
       Optional callback to inform the plugin about audio port IO changes.@n
       This function will only be called when the plugin is deactivated.@n
@@ -0,0 +1,282 @@
+/*
+ * DISTRHO Plugin Framework (DPF)
+ * Copyright (C) 2012-2024 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef DISTRHO_ATOMIC_SWAP_HPP_INCLUDED
+#define DISTRHO_ATOMIC_SWAP_HPP_INCLUDED
+
+#include "../DistrhoUtils.hpp"
+
+#ifndef DISTRHO_PROPER_CPP11_SUPPORT
+# error AtomicSwap requires C++11 atomics
+#endif
+
+#include <atomic>
+
+START_NAMESPACE_DISTRHO
+
+// -------------------------------------------------------------------------------------------------------------------
+// AtomicSwap class
+
+/**
+   Atomic object exchange slot for DPF, in the style of read-copy-update.
+
+   Holds a pointer to a heap-allocated object (wavetable, filter kernel, lookup table and so on)
+   that one or more real-time readers use while a single non real-time writer replaces it.
+   The writer builds a complete new object and publish()es it,
+   readers pick up the new object the next time they call acquire().
+
+   Replaced objects are never deleted by publish(), they are placed in a reclaim queue instead.
+   Calling collect() deletes every queued object that no reader can still be holding,
+   so it is meant to be called periodically from an idle callback or worker thread.
+
+   Each reader is identified by an index lower than the reader count given in the constructor.
+   A reader must not be used from more than one thread at a time, and must release() before acquiring again.
+   acquire() and release() are wait-free: they never lock, allocate or loop.
+
+   publish(), collect() and getCurrent() must be called from the same thread, or otherwise be serialized by the caller.
+
+   Example usage:
+   @code
+   AtomicSwap<Wavetable> table;
+
+   // UI or worker thread
+   table.publish(new Wavetable(fileName));
+   table.collect();
+
+   // audio thread
+   const AtomicSwap<Wavetable>::ScopedReader reader(table);
+   if (const Wavetable* const wt = reader.get())
+       wt->render(outputs[0], frames);
+   @endcode
+ */
+template<class T>
+class AtomicSwap
+{
+public:
+   /*
+    * Constructor.
+    * @a numReaders is the amount of threads that can acquire the object at the same time.
+    */
+    explicit AtomicSwap(const uint32_t numReaders = 1, T* const initial = nullptr) noexcept
+        : fCurrent(initial),
+          fEpoch(1),
+          fReaders(new ReaderSlot[numReaders > 0 ? numReaders : 1]),
+          fNumReaders(numReaders > 0 ? numReaders : 1),
+          fRetired(nullptr)
+    {
+        for (uint32_t i=0; i < fNumReaders; ++i)
+            fReaders[i].epoch.store(0, std::memory_order_relaxed);
+    }
+
+   /*
+    * Destructor.
+    * Deletes the current object and everything still in the reclaim queue.
+    * No reader may be holding an object at this point.
+    */
+    ~AtomicSwap() noexcept
+    {
+        delete fCurrent.load(std::memory_order_acquire);
+
+        for (RetiredNode* node = fRetired; node != nullptr;)
+        {
+            RetiredNode* const next = node->next;
+            delete node->object;
+            delete node;
+            node = next;
+        }
+
+        delete[] fReaders;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------
+    // writer side, non real-time
+
+   /*
+    * Make @a object the current one, taking ownership of it.
+    * The previous object is queued for deletion in a later collect() call.
+    * Passing null is allowed, readers then acquire null until something else is published.
+    */
+    void publish(T* const object)
+    {
+        T* const old = fCurrent.exchange(object, std::memory_order_seq_cst);
+
+        // readers that announced an epoch before this point may still be holding the old object
+        const uint64_t epoch = fEpoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+        if (old == nullptr)
+            return;
+
+        RetiredNode* const node = new RetiredNode;
+        node->object = old;
+        node->epoch = epoch;
+        node->next = fRetired;
+        fRetired = node;
+    }
+
+   /*
+    * Delete all replaced objects that are no longer reachable by any reader.
+    * Returns the number of objects deleted.
+    */
+    uint32_t collect()
+    {
+        if (fRetired == nullptr)
+            return 0;
+
+        // find the oldest epoch a reader is currently working on
+        uint64_t minEpoch = UINT64_MAX;
+
+        for (uint32_t i=0; i < fNumReaders; ++i)
+        {
+            const uint64_t readerEpoch = fReaders[i].epoch.load(std::memory_order_seq_cst);
+
+            if (readerEpoch != 0 && readerEpoch < minEpoch)
+                minEpoch = readerEpoch;
+        }
+
+        // an object retired at epoch E can only be held by readers that started before E
+        uint32_t numDeleted = 0;
+
+        for (RetiredNode** link = &fRetired; *link != nullptr;)
+        {
+            RetiredNode* const node = *link;
+
+            if (node->epoch <= minEpoch)
+            {
+                *link = node->next;
+                delete node->object;
+                delete node;
+                ++numDeleted;
+            }
+            else
+            {
+                link = &node->next;
+            }
+        }
+
+        return numDeleted;
+    }
+
+   /*
+    * Check if there are replaced objects waiting to be deleted.
+    */
+    bool hasPendingReclaim() const noexcept
+    {
+        return fRetired != nullptr;
+    }
+
+   /*
+    * Get the current object from the writer thread.
+    * The object stays valid until the next publish() call.
+    */
+    T* getCurrent() const noexcept
+    {
+        return fCurrent.load(std::memory_order_acquire);
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------
+    // reader side, real-time safe
+
+   /*
+    * Get the current object for reading.
+    * The returned object stays valid until the matching release() call, even if a new one is published meanwhile.
+    * Wait-free.
+    */
+    T* acquire(const uint32_t readerIndex = 0) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(readerIndex < fNumReaders, nullptr);
+
+        // announce which epoch we are reading from before loading the pointer,
+        // so that collect() either sees us or we see the newly published object
+        fReaders[readerIndex].epoch.store(fEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+
+        return fCurrent.load(std::memory_order_seq_cst);
+    }
+
+   /*
+    * Stop using the object returned by the previous acquire() call.
+    * Wait-free.
+    */
+    void release(const uint32_t readerIndex = 0) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(readerIndex < fNumReaders,);
+
+        fReaders[readerIndex].epoch.store(0, std::memory_order_release);
+    }
+
+   /*
+    * Helper class to acquire and release the current object within a scope.
+    */
+    class ScopedReader
+    {
+    public:
+        ScopedReader(AtomicSwap& swap, const uint32_t readerIndex = 0) noexcept
+            : fSwap(swap),
+              fReaderIndex(readerIndex),
+              fObject(swap.acquire(readerIndex)) {}
+
+        ~ScopedReader() noexcept
+        {
+            fSwap.release(fReaderIndex);
+        }
+
+        T* get() const noexcept
+        {
+            return fObject;
+        }
+
+        T* operator->() const noexcept
+        {
+            return fObject;
+        }
+
+    private:
+        AtomicSwap& fSwap;
+        const uint32_t fReaderIndex;
+        T* const fObject;
+
+        DISTRHO_DECLARE_NON_COPYABLE(ScopedReader)
+        DISTRHO_PREVENT_HEAP_ALLOCATION
+    };
+
+private:
+    struct ReaderSlot {
+        std::atomic<uint64_t> epoch;
+        // keep each reader on its own cache line
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    struct RetiredNode {
+        T* object;
+        uint64_t epoch;
+        RetiredNode* next;
+    };
+
+    std::atomic<T*> fCurrent;
+    std::atomic<uint64_t> fEpoch;
+    ReaderSlot* const fReaders;
+    const uint32_t fNumReaders;
+
+    // only touched by the writer thread
+    RetiredNode* fRetired;
+
+    DISTRHO_DECLARE_NON_COPYABLE(AtomicSwap)
+};
+
+// -------------------------------------------------------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif // DISTRHO_ATOMIC_SWAP_HPP_INCLUDED
@@ -0,0 +1,1182 @@
+/*
+ * DISTRHO Plugin Framework (DPF)
+ * Copyright (C) 2012-2024 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef DISTRHO_BUFFER_OPS_HPP_INCLUDED
+#define DISTRHO_BUFFER_OPS_HPP_INCLUDED
+
+#include "../DistrhoUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// --------------------------------------------------------------------------------------------------------------------
+// Instruction set selection
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define DISTRHO_BUFFER_OPS_SSE2 1
+# include <emmintrin.h>
+// AVX2 and AVX-512 kernels are built with per-function target attributes and only used if the CPU supports them
+# if defined(__EMSCRIPTEN__)
+  // SSE2 is emulated on top of wasm SIMD, there is nothing wider to dispatch to
+# elif defined(_MSC_VER) && !defined(__clang__)
+#  if _MSC_VER >= 1910
+#   define DISTRHO_BUFFER_OPS_AVX2 1
+#  endif
+#  if _MSC_VER >= 1920
+#   define DISTRHO_BUFFER_OPS_AVX512 1
+#  endif
+#  define DISTRHO_BUFFER_OPS_TARGET(isa)
+# elif defined(__clang__)
+#  if __clang_major__ >= 8
+#   define DISTRHO_BUFFER_OPS_AVX2 1
+#   define DISTRHO_BUFFER_OPS_AVX512 1
+#  endif
+#  define DISTRHO_BUFFER_OPS_TARGET(isa) __attribute__((target(isa)))
+# elif defined(__GNUC__)
+#  if __GNUC__ >= 5
+#   define DISTRHO_BUFFER_OPS_AVX2 1
+#  endif
+#  if __GNUC__ >= 7
+#   define DISTRHO_BUFFER_OPS_AVX512 1
+#  endif
+#  define DISTRHO_BUFFER_OPS_TARGET(isa) __attribute__((target(isa)))
+# endif
+# ifdef DISTRHO_BUFFER_OPS_AVX2
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#   include <intrin.h>
+#  endif
+# endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__) || defined(_M_ARM64)
+# define DISTRHO_BUFFER_OPS_NEON 1
+# include <arm_neon.h>
+#endif
+
+START_NAMESPACE_DISTRHO
+
+// --------------------------------------------------------------------------------------------------------------------
+// BufferOps class definition
+
+/**
+   Vectorized operations on audio buffers.
+
+   All functions take non-interleaved float buffers unless stated otherwise, do not require any alignment
+   and are real-time safe.@n
+   The best available implementation (SSE2, AVX2 or AVX-512 on x86, NEON on ARM) is selected once,
+   the first time any of these functions is called, based on the running CPU.
+
+   Source and destination buffers must either be the same or not overlap at all.
+ */
+struct BufferOps {
+   /**
+      Set @a frames samples of @a dst to 0.
+    */
+    static inline void clear(float* dst, uint32_t frames) noexcept;
+
+   /**
+      Set @a frames samples of @a dst to 0 (double precision variant).
+    */
+    static inline void clear(double* dst, uint32_t frames) noexcept;
+
+   /**
+      Copy @a frames samples from @a src into @a dst.
+    */
+    static inline void copy(float* dst, const float* src, uint32_t frames) noexcept;
+
+   /**
+      Multiply @a src by a constant @a gain and store the result in @a dst.
+      @a dst can be the same as @a src for in-place processing.
+    */
+    static inline void gain(float* dst, const float* src, float gain, uint32_t frames) noexcept;
+
+   /**
+      Multiply @a src by a gain that linearly moves from @a startGain to @a endGain over @a frames.
+      The first sample uses @a startGain, @a endGain is reached right after the last sample,
+      so consecutive blocks can be chained without discontinuities.
+    */
+    static inline void gainRamp(float* dst, const float* src, float startGain, float endGain, uint32_t frames) noexcept;
+
+   /**
+      Add @a src multiplied by @a gain to @a dst.
+    */
+    static inline void mixAdd(float* dst, const float* src, float gain, uint32_t frames) noexcept;
+
+   /**
+      Get the peak absolute value of @a src.
+    */
+    static inline float peak(const float* src, uint32_t frames) noexcept;
+
+   /**
+      Get the root mean square value of @a src.
+    */
+    static inline float rms(const float* src, uint32_t frames) noexcept;
+
+   /**
+      Interleave @a channels buffers from @a src into @a dst.
+      @a dst must have space for @a channels * @a frames samples.
+    */
+    static inline void interleave(float* dst, const float* const* src, uint32_t channels, uint32_t frames) noexcept;
+
+   /**
+      Deinterleave @a src into @a channels buffers in @a dst.
+    */
+    static inline void deinterleave(float* const* dst, const float* src, uint32_t channels, uint32_t frames) noexcept;
+
+   /**
+      Convert 16-bit integer samples into floats in the [-1, 1) range.
+    */
+    static inline void int16ToFloat(float* dst, const int16_t* src, uint32_t frames) noexcept;
+
+   /**
+      Convert floats into 16-bit integer samples, clipping values outside the [-1, 1] range.
+    */
+    static inline void floatToInt16(int16_t* dst, const float* src, uint32_t frames) noexcept;
+
+   /**
+      Convert 32-bit integer samples into floats in the [-1, 1) range.
+    */
+    static inline void int32ToFloat(float* dst, const int32_t* src, uint32_t frames) noexcept;
+
+   /**
+      Convert floats into 32-bit integer samples, clipping values outside the [-1, 1] range.
+    */
+    static inline void floatToInt32(int32_t* dst, const float* src, uint32_t frames) noexcept;
+
+   /**
+      Get the name of the instruction set in use, "Scalar", "SSE2", "AVX2", "AVX-512" or "NEON".
+    */
+    static inline const char* getInstructionSetName() noexcept;
+
+private:
+    struct Kernels {
+        const char* name;
+        void (*gain)(float*, const float*, float, uint32_t);
+        void (*gainRamp)(float*, const float*, float, float, uint32_t);
+        void (*mixAdd)(float*, const float*, float, uint32_t);
+        float (*peak)(const float*, uint32_t);
+        float (*sumOfSquares)(const float*, uint32_t);
+        void (*interleave2)(float*, const float*, const float*, uint32_t);
+        void (*deinterleave2)(float*, float*, const float*, uint32_t);
+        void (*int16ToFloat)(float*, const int16_t*, uint32_t);
+        void (*floatToInt16)(int16_t*, const float*, uint32_t);
+        void (*int32ToFloat)(float*, const int32_t*, uint32_t);
+        void (*floatToInt32)(int32_t*, const float*, uint32_t);
+    };
+
+    static inline const Kernels& getKernels() noexcept;
+    static inline Kernels detectKernels() noexcept;
+
+    struct Scalar;
+   #ifdef DISTRHO_BUFFER_OPS_SSE2
+    struct SSE2;
+   #endif
+   #ifdef DISTRHO_BUFFER_OPS_AVX2
+    struct AVX2;
+   #endif
+   #ifdef DISTRHO_BUFFER_OPS_AVX512
+    struct AVX512;
+   #endif
+   #ifdef DISTRHO_BUFFER_OPS_NEON
+    struct NEON;
+   #endif
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Scalar kernels, also used for the remaining samples of vectorized loops
+
+struct BufferOps::Scalar {
+    static void gain(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = src[i] * gain;
+    }
+
+    static void gainRamp(float* const dst, const float* const src,
+                         const float startGain, const float endGain, const uint32_t frames)
+    {
+        const float step = (endGain - startGain) / static_cast<float>(frames);
+
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = src[i] * (startGain + step * static_cast<float>(i));
+    }
+
+    static void mixAdd(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] += src[i] * gain;
+    }
+
+    static float peak(const float* const src, const uint32_t frames)
+    {
+        float value = 0.f;
+
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            const float tmp = std::fabs(src[i]);
+
+            if (tmp > value)
+                value = tmp;
+        }
+
+        return value;
+    }
+
+    static float sumOfSquares(const float* const src, const uint32_t frames)
+    {
+        float sum = 0.f;
+
+        for (uint32_t i = 0; i < frames; ++i)
+            sum += src[i] * src[i];
+
+        return sum;
+    }
+
+    static void interleave2(float* const dst, const float* const srcL, const float* const srcR, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            dst[i * 2]     = srcL[i];
+            dst[i * 2 + 1] = srcR[i];
+        }
+    }
+
+    static void deinterleave2(float* const dstL, float* const dstR, const float* const src, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            dstL[i] = src[i * 2];
+            dstR[i] = src[i * 2 + 1];
+        }
+    }
+
+    static void int16ToFloat(float* const dst, const int16_t* const src, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = static_cast<float>(src[i]) * (1.f / 32768.f);
+    }
+
+    static void floatToInt16(int16_t* const dst, const float* const src, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            const float value = src[i] * 32767.f;
+
+            if (value >= 32767.f)
+                dst[i] = 32767;
+            else if (value <= -32767.f)
+                dst[i] = -32767;
+            else
+                dst[i] = static_cast<int16_t>(value < 0.f ? value - 0.5f : value + 0.5f);
+        }
+    }
+
+    static void int32ToFloat(float* const dst, const int32_t* const src, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = static_cast<float>(src[i]) * (1.f / 2147483648.f);
+    }
+
+    static void floatToInt32(int32_t* const dst, const float* const src, const uint32_t frames)
+    {
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            // 2147483647 is not representable as float, clip to the largest value below it
+            const float value = src[i] * 2147483648.f;
+
+            if (value >= 2147483520.f)
+                dst[i] = 2147483520;
+            else if (value <= -2147483520.f)
+                dst[i] = -2147483520;
+            else
+                dst[i] = static_cast<int32_t>(value < 0.f ? value - 0.5f : value + 0.5f);
+        }
+    }
+};
+
+#ifdef DISTRHO_BUFFER_OPS_SSE2
+// --------------------------------------------------------------------------------------------------------------------
+// SSE2 kernels
+
+struct BufferOps::SSE2 {
+    static void gain(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        const __m128 g = _mm_set1_ps(gain);
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+
+        Scalar::gain(dst + i, src + i, gain, frames - i);
+    }
+
+    static void gainRamp(float* const dst, const float* const src,
+                         const float startGain, const float endGain, const uint32_t frames)
+    {
+        const float step = (endGain - startGain) / static_cast<float>(frames);
+        const __m128 step4 = _mm_set1_ps(step * 4.f);
+        __m128 g = _mm_add_ps(_mm_set1_ps(startGain), _mm_mul_ps(_mm_set1_ps(step), _mm_set_ps(3.f, 2.f, 1.f, 0.f)));
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+            g = _mm_add_ps(g, step4);
+        }
+
+        for (; i < frames; ++i)
+            dst[i] = src[i] * (startGain + step * static_cast<float>(i));
+    }
+
+    static void mixAdd(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        const __m128 g = _mm_set1_ps(gain);
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+
+        Scalar::mixAdd(dst + i, src + i, gain, frames - i);
+    }
+
+    static float peak(const float* const src, const uint32_t frames)
+    {
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 m = _mm_setzero_ps();
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+            m = _mm_max_ps(m, _mm_and_ps(_mm_loadu_ps(src + i), absMask));
+
+        m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        return std::max(_mm_cvtss_f32(m), Scalar::peak(src + i, frames - i));
+    }
+
+    static float sumOfSquares(const float* const src, const uint32_t frames)
+    {
+        __m128 sum = _mm_setzero_ps();
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 v = _mm_loadu_ps(src + i);
+            sum = _mm_add_ps(sum, _mm_mul_ps(v, v));
+        }
+
+        sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        return _mm_cvtss_f32(sum) + Scalar::sumOfSquares(src + i, frames - i);
+    }
+
+    static void interleave2(float* const dst, const float* const srcL, const float* const srcR, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 l = _mm_loadu_ps(srcL + i);
+            const __m128 r = _mm_loadu_ps(srcR + i);
+            _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+        }
+
+        Scalar::interleave2(dst + i * 2, srcL + i, srcR + i, frames - i);
+    }
+
+    static void deinterleave2(float* const dstL, float* const dstR, const float* const src, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(src + i * 2);
+            const __m128 b = _mm_loadu_ps(src + i * 2 + 4);
+            _mm_storeu_ps(dstL + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(dstR + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+
+        Scalar::deinterleave2(dstL + i, dstR + i, src + i * 2, frames - i);
+    }
+
+    static void int16ToFloat(float* const dst, const int16_t* const src, const uint32_t frames)
+    {
+        const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            // sign-extend by placing the samples in the upper half and shifting them down
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+
+        Scalar::int16ToFloat(dst + i, src + i, frames - i);
+    }
+
+    static void floatToInt16(int16_t* const dst, const float* const src, const uint32_t frames)
+    {
+        const __m128 scale = _mm_set1_ps(32767.f);
+        const __m128 maxv = _mm_set1_ps(32767.f);
+        const __m128 minv = _mm_set1_ps(-32767.f);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), minv), maxv);
+            const __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), minv), maxv);
+            const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+        }
+
+        Scalar::floatToInt16(dst + i, src + i, frames - i);
+    }
+
+    static void int32ToFloat(float* const dst, const int32_t* const src, const uint32_t frames)
+    {
+        const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+
+        Scalar::int32ToFloat(dst + i, src + i, frames - i);
+    }
+
+    static void floatToInt32(int32_t* const dst, const float* const src, const uint32_t frames)
+    {
+        const __m128 scale = _mm_set1_ps(2147483648.f);
+        const __m128 maxv = _mm_set1_ps(2147483520.f);
+        const __m128 minv = _mm_set1_ps(-2147483520.f);
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), minv), maxv);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_cvtps_epi32(v));
+        }
+
+        Scalar::floatToInt32(dst + i, src + i, frames - i);
+    }
+};
+#endif // DISTRHO_BUFFER_OPS_SSE2
+
+#ifdef DISTRHO_BUFFER_OPS_AVX2
+// --------------------------------------------------------------------------------------------------------------------
+// AVX2 kernels
+
+struct BufferOps::AVX2 {
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void gain(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        const __m256 g = _mm256_set1_ps(gain);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+
+        Scalar::gain(dst + i, src + i, gain, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void gainRamp(float* const dst, const float* const src,
+                         const float startGain, const float endGain, const uint32_t frames)
+    {
+        const float step = (endGain - startGain) / static_cast<float>(frames);
+        const __m256 step8 = _mm256_set1_ps(step * 8.f);
+        __m256 g = _mm256_add_ps(_mm256_set1_ps(startGain),
+                                 _mm256_mul_ps(_mm256_set1_ps(step),
+                                               _mm256_set_ps(7.f, 6.f, 5.f, 4.f, 3.f, 2.f, 1.f, 0.f)));
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+            g = _mm256_add_ps(g, step8);
+        }
+
+        for (; i < frames; ++i)
+            dst[i] = src[i] * (startGain + step * static_cast<float>(i));
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void mixAdd(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        const __m256 g = _mm256_set1_ps(gain);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i),
+                                                    _mm256_mul_ps(_mm256_loadu_ps(src + i), g)));
+
+        Scalar::mixAdd(dst + i, src + i, gain, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static float peak(const float* const src, const uint32_t frames)
+    {
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        __m256 m = _mm256_setzero_ps();
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+            m = _mm256_max_ps(m, _mm256_and_ps(_mm256_loadu_ps(src + i), absMask));
+
+        __m128 m4 = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+        m4 = _mm_max_ps(m4, _mm_shuffle_ps(m4, m4, _MM_SHUFFLE(1, 0, 3, 2)));
+        m4 = _mm_max_ps(m4, _mm_shuffle_ps(m4, m4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        return std::max(_mm_cvtss_f32(m4), Scalar::peak(src + i, frames - i));
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static float sumOfSquares(const float* const src, const uint32_t frames)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m256 v = _mm256_loadu_ps(src + i);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(v, v));
+        }
+
+        __m128 s4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        s4 = _mm_add_ps(s4, _mm_shuffle_ps(s4, s4, _MM_SHUFFLE(1, 0, 3, 2)));
+        s4 = _mm_add_ps(s4, _mm_shuffle_ps(s4, s4, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        return _mm_cvtss_f32(s4) + Scalar::sumOfSquares(src + i, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void interleave2(float* const dst, const float* const srcL, const float* const srcR, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m256 l = _mm256_loadu_ps(srcL + i);
+            const __m256 r = _mm256_loadu_ps(srcR + i);
+            // unpack works per 128-bit lane, permute the lanes back into order afterwards
+            const __m256 lo = _mm256_unpacklo_ps(l, r);
+            const __m256 hi = _mm256_unpackhi_ps(l, r);
+            _mm256_storeu_ps(dst + i * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(dst + i * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+
+        Scalar::interleave2(dst + i * 2, srcL + i, srcR + i, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void deinterleave2(float* const dstL, float* const dstR, const float* const src, const uint32_t frames)
+    {
+        const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m256 a = _mm256_loadu_ps(src + i * 2);
+            const __m256 b = _mm256_loadu_ps(src + i * 2 + 8);
+            const __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm256_storeu_ps(dstL + i, _mm256_permutevar8x32_ps(l, order));
+            _mm256_storeu_ps(dstR + i, _mm256_permutevar8x32_ps(r, order));
+        }
+
+        Scalar::deinterleave2(dstL + i, dstR + i, src + i * 2, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void int16ToFloat(float* const dst, const int16_t* const src, const uint32_t frames)
+    {
+        const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), scale));
+        }
+
+        Scalar::int16ToFloat(dst + i, src + i, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void floatToInt16(int16_t* const dst, const float* const src, const uint32_t frames)
+    {
+        const __m256 scale = _mm256_set1_ps(32767.f);
+        const __m256 maxv = _mm256_set1_ps(32767.f);
+        const __m256 minv = _mm256_set1_ps(-32767.f);
+        uint32_t i = 0;
+
+        for (; i + 16 <= frames; i += 16)
+        {
+            const __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), minv), maxv);
+            const __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale), minv), maxv);
+            // pack works per 128-bit lane, reorder the 64-bit quarters afterwards
+            const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                                _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+
+        Scalar::floatToInt16(dst + i, src + i, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void int32ToFloat(float* const dst, const int32_t* const src, const uint32_t frames)
+    {
+        const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+
+        Scalar::int32ToFloat(dst + i, src + i, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx2")
+    static void floatToInt32(int32_t* const dst, const float* const src, const uint32_t frames)
+    {
+        const __m256 scale = _mm256_set1_ps(2147483648.f);
+        const __m256 maxv = _mm256_set1_ps(2147483520.f);
+        const __m256 minv = _mm256_set1_ps(-2147483520.f);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), minv), maxv);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtps_epi32(v));
+        }
+
+        Scalar::floatToInt32(dst + i, src + i, frames - i);
+    }
+};
+#endif // DISTRHO_BUFFER_OPS_AVX2
+
+#ifdef DISTRHO_BUFFER_OPS_AVX512
+// --------------------------------------------------------------------------------------------------------------------
+// AVX-512 kernels, for the operations that benefit from wider registers (the rest use AVX2)
+
+struct BufferOps::AVX512 {
+    DISTRHO_BUFFER_OPS_TARGET("avx512f")
+    static void gain(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        const __m512 g = _mm512_set1_ps(gain);
+        uint32_t i = 0;
+
+        for (; i + 16 <= frames; i += 16)
+            _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(src + i), g));
+
+        Scalar::gain(dst + i, src + i, gain, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx512f")
+    static void gainRamp(float* const dst, const float* const src,
+                         const float startGain, const float endGain, const uint32_t frames)
+    {
+        const float step = (endGain - startGain) / static_cast<float>(frames);
+        const __m512 step16 = _mm512_set1_ps(step * 16.f);
+        __m512 g = _mm512_add_ps(_mm512_set1_ps(startGain),
+                                 _mm512_mul_ps(_mm512_set1_ps(step),
+                                               _mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f,
+                                                              8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f)));
+        uint32_t i = 0;
+
+        for (; i + 16 <= frames; i += 16)
+        {
+            _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(src + i), g));
+            g = _mm512_add_ps(g, step16);
+        }
+
+        for (; i < frames; ++i)
+            dst[i] = src[i] * (startGain + step * static_cast<float>(i));
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx512f")
+    static void mixAdd(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        const __m512 g = _mm512_set1_ps(gain);
+        uint32_t i = 0;
+
+        for (; i + 16 <= frames; i += 16)
+            _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i),
+                                                    _mm512_mul_ps(_mm512_loadu_ps(src + i), g)));
+
+        Scalar::mixAdd(dst + i, src + i, gain, frames - i);
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx512f")
+    static float peak(const float* const src, const uint32_t frames)
+    {
+        __m512 m = _mm512_setzero_ps();
+        uint32_t i = 0;
+
+        // NOTE the masked variants avoid GCC warnings about undefined values inside its own headers
+        for (; i + 16 <= frames; i += 16)
+            m = _mm512_mask_max_ps(m, 0xffff, m, _mm512_abs_ps(_mm512_loadu_ps(src + i)));
+
+        float lanes[16];
+        _mm512_storeu_ps(lanes, m);
+
+        return std::max(Scalar::peak(lanes, 16), Scalar::peak(src + i, frames - i));
+    }
+
+    DISTRHO_BUFFER_OPS_TARGET("avx512f")
+    static float sumOfSquares(const float* const src, const uint32_t frames)
+    {
+        __m512 sum = _mm512_setzero_ps();
+        uint32_t i = 0;
+
+        for (; i + 16 <= frames; i += 16)
+        {
+            const __m512 v = _mm512_loadu_ps(src + i);
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(v, v));
+        }
+
+        float lanes[16];
+        _mm512_storeu_ps(lanes, sum);
+
+        float total = 0.f;
+        for (uint32_t j = 0; j < 16; ++j)
+            total += lanes[j];
+
+        return total + Scalar::sumOfSquares(src + i, frames - i);
+    }
+};
+#endif // DISTRHO_BUFFER_OPS_AVX512
+
+#ifdef DISTRHO_BUFFER_OPS_NEON
+// --------------------------------------------------------------------------------------------------------------------
+// NEON kernels
+
+struct BufferOps::NEON {
+    static void gain(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+            vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(src + i), gain));
+
+        Scalar::gain(dst + i, src + i, gain, frames - i);
+    }
+
+    static void gainRamp(float* const dst, const float* const src,
+                         const float startGain, const float endGain, const uint32_t frames)
+    {
+        const float step = (endGain - startGain) / static_cast<float>(frames);
+        const float32x4_t step4 = vdupq_n_f32(step * 4.f);
+        const float offsets[4] = { 0.f, step, step * 2.f, step * 3.f };
+        float32x4_t g = vaddq_f32(vdupq_n_f32(startGain), vld1q_f32(offsets));
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            vst1q_f32(dst + i, vmulq_f32(vld1q_f32(src + i), g));
+            g = vaddq_f32(g, step4);
+        }
+
+        for (; i < frames; ++i)
+            dst[i] = src[i] * (startGain + step * static_cast<float>(i));
+    }
+
+    static void mixAdd(float* const dst, const float* const src, const float gain, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+            vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+
+        Scalar::mixAdd(dst + i, src + i, gain, frames - i);
+    }
+
+    static float peak(const float* const src, const uint32_t frames)
+    {
+        float32x4_t m = vdupq_n_f32(0.f);
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+            m = vmaxq_f32(m, vabsq_f32(vld1q_f32(src + i)));
+
+        float32x2_t m2 = vmax_f32(vget_low_f32(m), vget_high_f32(m));
+        m2 = vpmax_f32(m2, m2);
+
+        return std::max(vget_lane_f32(m2, 0), Scalar::peak(src + i, frames - i));
+    }
+
+    static float sumOfSquares(const float* const src, const uint32_t frames)
+    {
+        float32x4_t sum = vdupq_n_f32(0.f);
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            const float32x4_t v = vld1q_f32(src + i);
+            sum = vmlaq_f32(sum, v, v);
+        }
+
+        float32x2_t s2 = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+        s2 = vpadd_f32(s2, s2);
+
+        return vget_lane_f32(s2, 0) + Scalar::sumOfSquares(src + i, frames - i);
+    }
+
+    static void interleave2(float* const dst, const float* const srcL, const float* const srcR, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            float32x4x2_t v;
+            v.val[0] = vld1q_f32(srcL + i);
+            v.val[1] = vld1q_f32(srcR + i);
+            vst2q_f32(dst + i * 2, v);
+        }
+
+        Scalar::interleave2(dst + i * 2, srcL + i, srcR + i, frames - i);
+    }
+
+    static void deinterleave2(float* const dstL, float* const dstR, const float* const src, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            const float32x4x2_t v = vld2q_f32(src + i * 2);
+            vst1q_f32(dstL + i, v.val[0]);
+            vst1q_f32(dstR + i, v.val[1]);
+        }
+
+        Scalar::deinterleave2(dstL + i, dstR + i, src + i * 2, frames - i);
+    }
+
+    static void int16ToFloat(float* const dst, const int16_t* const src, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            const int16x8_t v = vld1q_s16(src + i);
+            vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.f / 32768.f));
+            vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.f / 32768.f));
+        }
+
+        Scalar::int16ToFloat(dst + i, src + i, frames - i);
+    }
+
+    static void floatToInt16(int16_t* const dst, const float* const src, const uint32_t frames)
+    {
+        const float32x4_t maxv = vdupq_n_f32(32767.f);
+        const float32x4_t minv = vdupq_n_f32(-32767.f);
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        uint32_t i = 0;
+
+        for (; i + 8 <= frames; i += 8)
+        {
+            float32x4_t a = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i), 32767.f), minv), maxv);
+            float32x4_t b = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i + 4), 32767.f), minv), maxv);
+            // vcvtq truncates, round to nearest by adding 0.5 with the sign of the value
+            a = vaddq_f32(a, vbslq_f32(vdupq_n_u32(0x80000000), a, half));
+            b = vaddq_f32(b, vbslq_f32(vdupq_n_u32(0x80000000), b, half));
+            vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)), vqmovn_s32(vcvtq_s32_f32(b))));
+        }
+
+        Scalar::floatToInt16(dst + i, src + i, frames - i);
+    }
+
+    static void int32ToFloat(float* const dst, const int32_t* const src, const uint32_t frames)
+    {
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+            vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), 1.f / 2147483648.f));
+
+        Scalar::int32ToFloat(dst + i, src + i, frames - i);
+    }
+
+    static void floatToInt32(int32_t* const dst, const float* const src, const uint32_t frames)
+    {
+        const float32x4_t maxv = vdupq_n_f32(2147483520.f);
+        const float32x4_t minv = vdupq_n_f32(-2147483520.f);
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        uint32_t i = 0;
+
+        for (; i + 4 <= frames; i += 4)
+        {
+            float32x4_t v = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(src + i), 2147483648.f), minv), maxv);
+            v = vaddq_f32(v, vbslq_f32(vdupq_n_u32(0x80000000), v, half));
+            vst1q_s32(dst + i, vcvtq_s32_f32(v));
+        }
+
+        Scalar::floatToInt32(dst + i, src + i, frames - i);
+    }
+};
+#endif // DISTRHO_BUFFER_OPS_NEON
+
+// --------------------------------------------------------------------------------------------------------------------
+// Runtime dispatch
+
+inline BufferOps::Kernels BufferOps::detectKernels() noexcept
+{
+    Kernels k;
+
+   #if defined(DISTRHO_BUFFER_OPS_NEON)
+    k.name          = "NEON";
+    k.gain          = NEON::gain;
+    k.gainRamp      = NEON::gainRamp;
+    k.mixAdd        = NEON::mixAdd;
+    k.peak          = NEON::peak;
+    k.sumOfSquares  = NEON::sumOfSquares;
+    k.interleave2   = NEON::interleave2;
+    k.deinterleave2 = NEON::deinterleave2;
+    k.int16ToFloat  = NEON::int16ToFloat;
+    k.floatToInt16  = NEON::floatToInt16;
+    k.int32ToFloat  = NEON::int32ToFloat;
+    k.floatToInt32  = NEON::floatToInt32;
+   #elif defined(DISTRHO_BUFFER_OPS_SSE2)
+    k.name          = "SSE2";
+    k.gain          = SSE2::gain;
+    k.gainRamp      = SSE2::gainRamp;
+    k.mixAdd        = SSE2::mixAdd;
+    k.peak          = SSE2::peak;
+    k.sumOfSquares  = SSE2::sumOfSquares;
+    k.interleave2   = SSE2::interleave2;
+    k.deinterleave2 = SSE2::deinterleave2;
+    k.int16ToFloat  = SSE2::int16ToFloat;
+    k.floatToInt16  = SSE2::floatToInt16;
+    k.int32ToFloat  = SSE2::int32ToFloat;
+    k.floatToInt32  = SSE2::floatToInt32;
+
+   #ifdef DISTRHO_BUFFER_OPS_AVX2
+   #ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    const int maxLeaf = regs[0];
+    __cpuid(regs, 1);
+    // the OS must save the AVX (and AVX-512) registers on context switches
+    const bool osxsave = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    int features = 0;
+    if (maxLeaf >= 7 && (xcr0 & 0x06) == 0x06)
+    {
+        __cpuidex(regs, 7, 0);
+        features = regs[1];
+        if ((xcr0 & 0xe0) != 0xe0)
+            features &= ~(1 << 16);
+    }
+    const bool hasAVX2 = (features & (1 << 5)) != 0;
+   #else
+    __builtin_cpu_init();
+    const bool hasAVX2 = __builtin_cpu_supports("avx2");
+   #endif
+
+    if (hasAVX2)
+    {
+        k.name          = "AVX2";
+        k.gain          = AVX2::gain;
+        k.gainRamp      = AVX2::gainRamp;
+        k.mixAdd        = AVX2::mixAdd;
+        k.peak          = AVX2::peak;
+        k.sumOfSquares  = AVX2::sumOfSquares;
+        k.interleave2   = AVX2::interleave2;
+        k.deinterleave2 = AVX2::deinterleave2;
+        k.int16ToFloat  = AVX2::int16ToFloat;
+        k.floatToInt16  = AVX2::floatToInt16;
+        k.int32ToFloat  = AVX2::int32ToFloat;
+        k.floatToInt32  = AVX2::floatToInt32;
+
+       #ifdef DISTRHO_BUFFER_OPS_AVX512
+       #ifdef _MSC_VER
+        const bool hasAVX512 = (features & (1 << 16)) != 0;
+       #else
+        const bool hasAVX512 = __builtin_cpu_supports("avx512f");
+       #endif
+
+        if (hasAVX512)
+        {
+            k.name         = "AVX-512";
+            k.gain         = AVX512::gain;
+            k.gainRamp     = AVX512::gainRamp;
+            k.mixAdd       = AVX512::mixAdd;
+            k.peak         = AVX512::peak;
+            k.sumOfSquares = AVX512::sumOfSquares;
+        }
+       #endif
+    }
+   #endif
+   #else
+    k.name          = "Scalar";
+    k.gain          = Scalar::gain;
+    k.gainRamp      = Scalar::gainRamp;
+    k.mixAdd        = Scalar::mixAdd;
+    k.peak          = Scalar::peak;
+    k.sumOfSquares  = Scalar::sumOfSquares;
+    k.interleave2   = Scalar::interleave2;
+    k.deinterleave2 = Scalar::deinterleave2;
+    k.int16ToFloat  = Scalar::int16ToFloat;
+    k.floatToInt16  = Scalar::floatToInt16;
+    k.int32ToFloat  = Scalar::int32ToFloat;
+    k.floatToInt32  = Scalar::floatToInt32;
+   #endif
+
+    return k;
+}
+
+inline const BufferOps::Kernels& BufferOps::getKernels() noexcept
+{
+    static const Kernels kernels(detectKernels());
+    return kernels;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// BufferOps class implementation
+
+inline void BufferOps::clear(float* const dst, const uint32_t frames) noexcept
+{
+    // the C library already provides vectorized implementations for clear and copy
+    std::memset(dst, 0, sizeof(float) * frames);
+}
+
+inline void BufferOps::clear(double* const dst, const uint32_t frames) noexcept
+{
+    std::memset(dst, 0, sizeof(double) * frames);
+}
+
+inline void BufferOps::copy(float* const dst, const float* const src, const uint32_t frames) noexcept
+{
+    if (dst != src)
+        std::memcpy(dst, src, sizeof(float) * frames);
+}
+
+inline void BufferOps::gain(float* const dst, const float* const src, const float gain, const uint32_t frames) noexcept
+{
+    getKernels().gain(dst, src, gain, frames);
+}
+
+inline void BufferOps::gainRamp(float* const dst, const float* const src,
+                                const float startGain, const float endGain, const uint32_t frames) noexcept
+{
+    if (frames == 0)
+        return;
+
+    getKernels().gainRamp(dst, src, startGain, endGain, frames);
+}
+
+inline void BufferOps::mixAdd(float* const dst, const float* const src, const float gain, const uint32_t frames) noexcept
+{
+    getKernels().mixAdd(dst, src, gain, frames);
+}
+
+inline float BufferOps::peak(const float* const src, const uint32_t frames) noexcept
+{
+    return getKernels().peak(src, frames);
+}
+
+inline float BufferOps::rms(const float* const src, const uint32_t frames) noexcept
+{
+    if (frames == 0)
+        return 0.f;
+
+    return std::sqrt(getKernels().sumOfSquares(src, frames) / static_cast<float>(frames));
+}
+
+inline void BufferOps::interleave(float* const dst, const float* const* const src,
+                                  const uint32_t channels, const uint32_t frames) noexcept
+{
+    switch (channels)
+    {
+    case 0:
+        return;
+    case 1:
+        copy(dst, src[0], frames);
+        return;
+    case 2:
+        getKernels().interleave2(dst, src[0], src[1], frames);
+        return;
+    }
+
+    for (uint32_t c = 0; c < channels; ++c)
+    {
+        const float* const s = src[c];
+
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i * channels + c] = s[i];
+    }
+}
+
+inline void BufferOps::deinterleave(float* const* const dst, const float* const src,
+                                    const uint32_t channels, const uint32_t frames) noexcept
+{
+    switch (channels)
+    {
+    case 0:
+        return;
+    case 1:
+        copy(dst[0], src, frames);
+        return;
+    case 2:
+        getKernels().deinterleave2(dst[0], dst[1], src, frames);
+        return;
+    }
+
+    for (uint32_t c = 0; c < channels; ++c)
+    {
+        float* const d = dst[c];
+
+        for (uint32_t i = 0; i < frames; ++i)
+            d[i] = src[i * channels + c];
+    }
+}
+
+inline void BufferOps::int16ToFloat(float* const dst, const int16_t* const src, const uint32_t frames) noexcept
+{
+    getKernels().int16ToFloat(dst, src, frames);
+}
+
+inline void BufferOps::floatToInt16(int16_t* const dst, const float* const src, const uint32_t frames) noexcept
+{
+    getKernels().floatToInt16(dst, src, frames);
+}
+
+inline void BufferOps::int32ToFloat(float* const dst, const int32_t* const src, const uint32_t frames) noexcept
+{
+    getKernels().int32ToFloat(dst, src, frames);
+}
+
+inline void BufferOps::floatToInt32(int32_t* const dst, const float* const src, const uint32_t frames) noexcept
+{
+    getKernels().floatToInt32(dst, src, frames);
+}
+
+inline const char* BufferOps::getInstructionSetName() noexcept
+{
+    return getKernels().name;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif // DISTRHO_BUFFER_OPS_HPP_INCLUDED
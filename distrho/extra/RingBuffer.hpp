@@ -1,6 +1,6 @@
 /*
  * DISTRHO Plugin Framework (DPF)
- * Copyright (C) 2012-2021 Filipe Coelho <falktx@falktx.com>
+ * Copyright (C) 2012-2024 Filipe Coelho <falktx@falktx.com>
  *
  * Permission to use, copy, modify, and/or distribute this software for any purpose with
  * or without fee is hereby granted, provided that the above copyright notice and this
@@ -19,6 +19,10 @@
 
 #include "../DistrhoUtils.hpp"
 
+#if defined(_MSC_VER) && !defined(__clang__)
+# include <intrin.h>
+#endif
+
 START_NAMESPACE_DISTRHO
 
 // -----------------------------------------------------------------------
@@ -40,6 +44,10 @@ START_NAMESPACE_DISTRHO
    One can create/place the Buffer struct in shared memory, and point RingBufferControl to it,
    thus avoiding the pitfalls of sharing access to a non trivially-copyable/POD C++ class.
 
+   The head and tail positions are accessed with acquire/release ordering by RingBufferControl,
+   the reading side only ever writes to tail and the writing side only ever writes to head and wrtn.
+   They are plain integers (and not C++11 atomics) so that the struct remains trivially-copyable.
+
    Unlike other ring buffers, an extra variable is used to track pending writes.
    This is so we can write a few bytes at a time and later mark the whole operation as complete,
    thus avoiding the issue of reading data too early from the other side.
@@ -119,6 +127,28 @@ struct HugeStackBuffer {
     uint8_t  buf[size];
 };
 
+/**
+   Up to two contiguous memory regions of a ring buffer, as returned by RingBufferControl::getWriteRegions().
+   The second region is only used when the available space wraps around the end of the buffer.
+*/
+struct RingBufferWriteRegions {
+    uint8_t* data1;
+    uint32_t size1;
+    uint8_t* data2;
+    uint32_t size2;
+};
+
+/**
+   Up to two contiguous memory regions of a ring buffer, as returned by RingBufferControl::getReadRegions().
+   The second region is only used when the available data wraps around the end of the buffer.
+*/
+struct RingBufferReadRegions {
+    const uint8_t* data1;
+    uint32_t size1;
+    const uint8_t* data2;
+    uint32_t size2;
+};
+
 #ifdef DISTRHO_PROPER_CPP11_SUPPORT
 # define HeapBuffer_INIT  {0, 0, 0, 0, false, nullptr}
 # define StackBuffer_INIT {0, 0, 0, false, {0}}
@@ -161,6 +191,31 @@ struct HugeStackBuffer {
    }
    ```
 
+   Audio and other bulk data can be written and read in place, without copying through an intermediate buffer:
+   ```
+   // writing side
+   RingBufferWriteRegions regions;
+   if (myHeapBuffer.getWriteRegions(regions) >= numBytes)
+   {
+       const uint32_t size1 = std::min(numBytes, regions.size1);
+       std::memcpy(regions.data1, audio, size1);
+       std::memcpy(regions.data2, audio + size1, numBytes - size1);
+       myHeapBuffer.commitWrite(numBytes);
+   }
+
+   // reading side
+   RingBufferReadRegions regions;
+   if (const uint32_t numBytes = myHeapBuffer.getReadRegions(regions))
+   {
+       analyze(regions.data1, regions.size1);
+       analyze(regions.data2, regions.size2);
+       myHeapBuffer.consume(numBytes);
+   }
+   ```
+
+   Buffer sizes that are a power of 2 (which is always the case for HeapRingBuffer and the stack buffers)
+   use bit masking instead of branching for position wrap-around.
+
    @see HeapBuffer
  */
 template <class BufferStruct>
@@ -197,7 +252,7 @@ public:
     {
         DISTRHO_SAFE_ASSERT_RETURN(buffer != nullptr, false);
 
-        return (buffer->buf == nullptr || buffer->head == buffer->tail);
+        return (buffer->buf == nullptr || loadAcquire(buffer->head) == loadAcquire(buffer->tail));
     }
 
     /*
@@ -215,9 +270,7 @@ public:
     {
         DISTRHO_SAFE_ASSERT_RETURN(buffer != nullptr, 0);
 
-        const uint32_t wrap = buffer->head >= buffer->tail ? 0 : buffer->size;
-
-        return wrap + buffer->head - buffer->tail;
+        return getDistance(loadAcquire(buffer->tail), loadAcquire(buffer->head));
     }
 
     /*
@@ -227,9 +280,7 @@ public:
     {
         DISTRHO_SAFE_ASSERT_RETURN(buffer != nullptr, 0);
 
-        const uint32_t wrap = buffer->tail > buffer->wrtn ? 0 : buffer->size;
-
-        return wrap + buffer->tail - buffer->wrtn - 1;
+        return getFreeSpace(loadAcquire(buffer->tail), buffer->wrtn);
     }
 
     // -------------------------------------------------------------------
@@ -560,11 +611,155 @@ public:
         DISTRHO_SAFE_ASSERT_RETURN(buffer->head != buffer->wrtn, false);
 
         // all ok
-        buffer->head = buffer->wrtn;
+        storeRelease(buffer->head, buffer->wrtn);
         errorWriting = false;
         return true;
     }
 
+    // -------------------------------------------------------------------
+    // zero-copy operations
+
+    /*!
+     * Get the free space of the ring buffer as up to two contiguous memory regions, starting after any pending writes.
+     * Data can be written directly into these regions, followed by a commitWrite(size) call to make it readable.
+     * Returns the total number of bytes available for writing, that is, the sum of both region sizes.
+     */
+    uint32_t getWriteRegions(RingBufferWriteRegions& regions) const noexcept
+    {
+        regions.data1 = regions.data2 = nullptr;
+        regions.size1 = regions.size2 = 0;
+
+        DISTRHO_SAFE_ASSERT_RETURN(buffer != nullptr, 0);
+       #if defined(__clang__)
+        #pragma clang diagnostic push
+        #pragma clang diagnostic ignored "-Wtautological-pointer-compare"
+       #endif
+        DISTRHO_SAFE_ASSERT_RETURN(buffer->buf != nullptr, 0);
+       #if defined(__clang__)
+        #pragma clang diagnostic pop
+       #endif
+
+        const uint32_t wrtn = buffer->wrtn;
+        const uint32_t space = getFreeSpace(loadAcquire(buffer->tail), wrtn);
+        const uint32_t untilEnd = buffer->size - wrtn;
+
+        regions.data1 = buffer->buf + wrtn;
+
+        if (space <= untilEnd)
+        {
+            regions.size1 = space;
+        }
+        else
+        {
+            regions.size1 = untilEnd;
+            regions.data2 = buffer->buf;
+            regions.size2 = space - untilEnd;
+        }
+
+        return space;
+    }
+
+    /*!
+     * Commit @a size bytes previously written through getWriteRegions(), together with all previous write operations.
+     * If a write operation has previously failed, this will reset/invalidate the previous write attempts.
+     */
+    bool commitWrite(const uint32_t size) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(buffer != nullptr, false);
+
+        if (buffer->invalidateCommit)
+            return commitWrite();
+
+        const uint32_t wrtn = buffer->wrtn;
+
+        if (size == 0)
+        {
+            // nothing to commit?
+            if (buffer->head == wrtn)
+                return false;
+        }
+        else if (size > getFreeSpace(loadAcquire(buffer->tail), wrtn))
+        {
+            if (! errorWriting)
+            {
+                errorWriting = true;
+                d_stderr2("RingBuffer::commitWrite(%lu): failed, not enough space", (ulong)size);
+            }
+            buffer->invalidateCommit = true;
+        }
+        else
+        {
+            buffer->wrtn = wrapPosition(wrtn + size);
+        }
+
+        return commitWrite();
+    }
+
+    /*!
+     * Get the data available for reading as up to two contiguous memory regions.
+     * Data can be read directly from these regions, followed by a consume(size) call to release the space.
+     * Returns the total number of bytes available for reading, that is, the sum of both region sizes.
+     */
+    uint32_t getReadRegions(RingBufferReadRegions& regions) const noexcept
+    {
+        regions.data1 = regions.data2 = nullptr;
+        regions.size1 = regions.size2 = 0;
+
+        DISTRHO_SAFE_ASSERT_RETURN(buffer != nullptr, 0);
+       #if defined(__clang__)
+        #pragma clang diagnostic push
+        #pragma clang diagnostic ignored "-Wtautological-pointer-compare"
+       #endif
+        DISTRHO_SAFE_ASSERT_RETURN(buffer->buf != nullptr, 0);
+       #if defined(__clang__)
+        #pragma clang diagnostic pop
+       #endif
+
+        const uint32_t tail = buffer->tail;
+        const uint32_t size = getDistance(tail, loadAcquire(buffer->head));
+        const uint32_t untilEnd = buffer->size - tail;
+
+        regions.data1 = buffer->buf + tail;
+
+        if (size <= untilEnd)
+        {
+            regions.size1 = size;
+        }
+        else
+        {
+            regions.size1 = untilEnd;
+            regions.data2 = buffer->buf;
+            regions.size2 = size - untilEnd;
+        }
+
+        return size;
+    }
+
+    /*!
+     * Mark @a size bytes as read, making their space available for writing again.
+     * Meant to be used after reading data through getReadRegions().
+     */
+    bool consume(const uint32_t size) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(buffer != nullptr, false);
+
+        const uint32_t tail = buffer->tail;
+
+        if (size > getDistance(tail, loadAcquire(buffer->head)))
+        {
+            if (! errorReading)
+            {
+                errorReading = true;
+                d_stderr2("RingBuffer::consume(%lu): failed, not enough data", (ulong)size);
+            }
+            return false;
+        }
+
+        storeRelease(buffer->tail, wrapPosition(tail + size));
+        errorReading = false;
+        return true;
+    }
+
     // -------------------------------------------------------------------
 
     /*
@@ -599,17 +794,14 @@ protected:
         DISTRHO_SAFE_ASSERT_RETURN(size > 0, false);
         DISTRHO_SAFE_ASSERT_RETURN(size < buffer->size, false);
 
+        const uint32_t head = loadAcquire(buffer->head);
+        const uint32_t tail = buffer->tail;
+
         // empty
-        if (buffer->head == buffer->tail)
+        if (head == tail)
             return false;
 
-        uint8_t* const bytebuf = static_cast<uint8_t*>(buf);
-
-        const uint32_t head = buffer->head;
-        const uint32_t tail = buffer->tail;
-        const uint32_t wrap = head > tail ? 0 : buffer->size;
-
-        if (size > wrap + head - tail)
+        if (size > getDistance(tail, head))
         {
             if (! errorReading)
             {
@@ -619,32 +811,10 @@ protected:
             return false;
         }
 
-        uint32_t readto = tail + size;
+        copyFromBuffer(static_cast<uint8_t*>(buf), tail, size);
 
-        if (readto > buffer->size)
-        {
-            readto -= buffer->size;
-
-            if (size == 1)
-            {
-                std::memcpy(bytebuf, buffer->buf + tail, 1);
-            }
-            else
-            {
-                const uint32_t firstpart = buffer->size - tail;
-                std::memcpy(bytebuf, buffer->buf + tail, firstpart);
-                std::memcpy(bytebuf + firstpart, buffer->buf, readto);
-            }
-        }
-        else
-        {
-            std::memcpy(bytebuf, buffer->buf + tail, size);
-
-            if (readto == buffer->size)
-                readto = 0;
-        }
-
-        buffer->tail = readto;
+        // data has been copied out, make its space available to the writing side
+        storeRelease(buffer->tail, wrapPosition(tail + size));
         errorReading = false;
         return true;
     }
@@ -665,44 +835,17 @@ protected:
         DISTRHO_SAFE_ASSERT_RETURN(size > 0, false);
         DISTRHO_SAFE_ASSERT_RETURN(size < buffer->size, false);
 
-        // empty
-        if (buffer->head == buffer->tail)
-            return false;
-
-        uint8_t* const bytebuf = static_cast<uint8_t*>(buf);
-
-        const uint32_t head = buffer->head;
+        const uint32_t head = loadAcquire(buffer->head);
         const uint32_t tail = buffer->tail;
-        const uint32_t wrap = head > tail ? 0 : buffer->size;
 
-        if (size > wrap + head - tail)
+        // empty
+        if (head == tail)
             return false;
 
-        uint32_t readto = tail + size;
-
-        if (readto > buffer->size)
-        {
-            readto -= buffer->size;
-
-            if (size == 1)
-            {
-                std::memcpy(bytebuf, buffer->buf + tail, 1);
-            }
-            else
-            {
-                const uint32_t firstpart = buffer->size - tail;
-                std::memcpy(bytebuf, buffer->buf + tail, firstpart);
-                std::memcpy(bytebuf + firstpart, buffer->buf, readto);
-            }
-        }
-        else
-        {
-            std::memcpy(bytebuf, buffer->buf + tail, size);
-
-            if (readto == buffer->size)
-                readto = 0;
-        }
+        if (size > getDistance(tail, head))
+            return false;
 
+        copyFromBuffer(static_cast<uint8_t*>(buf), tail, size);
         return true;
     }
 
@@ -716,11 +859,9 @@ protected:
 
         const uint8_t* const bytebuf = static_cast<const uint8_t*>(buf);
 
-        const uint32_t tail = buffer->tail;
         const uint32_t wrtn = buffer->wrtn;
-        const uint32_t wrap = tail > wrtn ? 0 : buffer->size;
 
-        if (size >= wrap + tail - wrtn)
+        if (size > getFreeSpace(loadAcquire(buffer->tail), wrtn))
         {
             if (! errorWriting)
             {
@@ -731,36 +872,97 @@ protected:
             return false;
         }
 
-        uint32_t writeto = wrtn + size;
+        const uint32_t untilEnd = buffer->size - wrtn;
 
-        if (writeto > buffer->size)
+        if (size > untilEnd)
         {
-            writeto -= buffer->size;
-
-            if (size == 1)
-            {
-                std::memcpy(buffer->buf, bytebuf, 1);
-            }
-            else
-            {
-                const uint32_t firstpart = buffer->size - wrtn;
-                std::memcpy(buffer->buf + wrtn, bytebuf, firstpart);
-                std::memcpy(buffer->buf, bytebuf + firstpart, writeto);
-            }
+            std::memcpy(buffer->buf + wrtn, bytebuf, untilEnd);
+            std::memcpy(buffer->buf, bytebuf + untilEnd, size - untilEnd);
         }
         else
         {
             std::memcpy(buffer->buf + wrtn, bytebuf, size);
-
-            if (writeto == buffer->size)
-                writeto = 0;
         }
 
-        buffer->wrtn = writeto;
+        // only made visible to the reading side on commitWrite()
+        buffer->wrtn = wrapPosition(wrtn + size);
         return true;
     }
 
 private:
+    /** @internal copy @a size bytes starting at position @a tail into @a bytebuf, size must be known to be readable. */
+    void copyFromBuffer(uint8_t* const bytebuf, const uint32_t tail, const uint32_t size) const noexcept
+    {
+        const uint32_t untilEnd = buffer->size - tail;
+
+        if (size > untilEnd)
+        {
+            std::memcpy(bytebuf, buffer->buf + tail, untilEnd);
+            std::memcpy(bytebuf + untilEnd, buffer->buf, size - untilEnd);
+        }
+        else
+        {
+            std::memcpy(bytebuf, buffer->buf + tail, size);
+        }
+    }
+
+    /** @internal whether the buffer size allows to wrap positions with a bit mask. */
+    bool isPowerOf2Size() const noexcept
+    {
+        return (buffer->size & (buffer->size - 1)) == 0;
+    }
+
+    /** @internal wrap a position that is at most 2 * size - 1 back into the buffer range. */
+    uint32_t wrapPosition(const uint32_t pos) const noexcept
+    {
+        if (isPowerOf2Size())
+            return pos & (buffer->size - 1);
+
+        return pos >= buffer->size ? pos - buffer->size : pos;
+    }
+
+    /** @internal amount of bytes between 2 positions, that is, readable data when going from tail to head. */
+    uint32_t getDistance(const uint32_t from, const uint32_t to) const noexcept
+    {
+        if (isPowerOf2Size())
+            return (to - from) & (buffer->size - 1);
+
+        return to >= from ? to - from : buffer->size + to - from;
+    }
+
+    /** @internal amount of bytes that can be written, keeping 1 byte free so that a full buffer is not seen as empty. */
+    uint32_t getFreeSpace(const uint32_t tail, const uint32_t wrtn) const noexcept
+    {
+        if (isPowerOf2Size())
+            return (tail - wrtn - 1) & (buffer->size - 1);
+
+        return tail > wrtn ? tail - wrtn - 1 : buffer->size + tail - wrtn - 1;
+    }
+
+    /** @internal load a position written by the other side, synchronizing with its data. */
+    static uint32_t loadAcquire(const uint32_t& pos) noexcept
+    {
+       #if defined(_MSC_VER) && !defined(__clang__)
+        // MSVC volatile accesses have acquire/release semantics on x86 and x64
+        const uint32_t value = *static_cast<const volatile uint32_t*>(&pos);
+        _ReadWriteBarrier();
+        return value;
+       #else
+        return __atomic_load_n(&pos, __ATOMIC_ACQUIRE);
+       #endif
+    }
+
+    /** @internal store a position read by the other side, publishing the data written or read before it. */
+    static void storeRelease(uint32_t& pos, const uint32_t value) noexcept
+    {
+       #if defined(_MSC_VER) && !defined(__clang__)
+        _ReadWriteBarrier();
+        *static_cast<volatile uint32_t*>(&pos) = value;
+       #else
+        __atomic_store_n(&pos, value, __ATOMIC_RELEASE);
+       #endif
+    }
+
     /** Buffer struct pointer. */
     BufferStruct* buffer;
 
@@ -777,13 +979,13 @@ private:
 template <class BufferStruct>
 inline bool RingBufferControl<BufferStruct>::isDataAvailableForReading() const noexcept
 {
-    return (buffer != nullptr && buffer->head != buffer->tail);
+    return (buffer != nullptr && loadAcquire(buffer->head) != loadAcquire(buffer->tail));
 }
 
 template <>
 inline bool RingBufferControl<HeapBuffer>::isDataAvailableForReading() const noexcept
 {
-    return (buffer != nullptr && buffer->buf != nullptr && buffer->head != buffer->tail);
+    return (buffer != nullptr && buffer->buf != nullptr && loadAcquire(buffer->head) != loadAcquire(buffer->tail));
 }
 
 // -----------------------------------------------------------------------
@@ -0,0 +1,359 @@
+/*
+ * DISTRHO Plugin Framework (DPF)
+ * Copyright (C) 2012-2024 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef DISTRHO_THREAD_POOL_HPP_INCLUDED
+#define DISTRHO_THREAD_POOL_HPP_INCLUDED
+
+#include "Thread.hpp"
+
+#ifndef DISTRHO_PROPER_CPP11_SUPPORT
+# error ThreadPool requires C++11 atomics
+#endif
+
+#include <atomic>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+#endif
+
+START_NAMESPACE_DISTRHO
+
+// -------------------------------------------------------------------------------------------------------------------
+// ThreadPool class
+
+/**
+   Thread pool class for DPF.
+
+   A fixed set of worker threads that is spawned once and then reused for every parallelFor() call.
+   The thread that calls parallelFor() takes part in the work, so a pool with N workers runs up to N+1 tasks at once.
+
+   Tasks are claimed one at a time from a single atomic counter,
+   so idle threads keep picking up remaining work until the whole task range is done.
+   Workers busy-wait for a short while after each job before going to sleep,
+   which keeps wake-up latency low when jobs arrive once per audio block.
+
+   parallelFor() does not allocate memory or take locks on its fast path, making it usable from within the audio thread.
+   It must not be called concurrently from more than one thread, nor from within one of its own tasks.
+ */
+class ThreadPool
+{
+public:
+   /**
+      Task callback, receiving the user pointer and the index of the task to run.
+    */
+    typedef void (*TaskFunc)(void* ptr, uint32_t taskIndex);
+
+   /*
+    * Constructor.
+    */
+    ThreadPool() noexcept
+        : fWorkers(nullptr),
+          fNumWorkers(0),
+          fTaskFunc(nullptr),
+          fTaskPtr(nullptr),
+          fTaskCount(0),
+          fState(0),
+          fPendingTasks(0),
+          fCallerWaiting(false),
+          fCallerSignal() {}
+
+   /*
+    * Destructor.
+    */
+    ~ThreadPool() noexcept
+    {
+        stop();
+    }
+
+   /*
+    * Get a sensible amount of workers for the current system.
+    * This leaves one core for the calling thread, which also runs tasks.
+    */
+    static uint32_t getDefaultNumWorkers() noexcept
+    {
+        const uint32_t numCPUs = std::thread::hardware_concurrency();
+
+        if (numCPUs <= 1)
+            return 0;
+
+        return numCPUs - 1 < kMaxWorkers ? numCPUs - 1 : kMaxWorkers;
+    }
+
+   /*
+    * Check if the pool has running workers.
+    */
+    bool isRunning() const noexcept
+    {
+        return fNumWorkers != 0;
+    }
+
+   /*
+    * Get the number of worker threads, not counting the caller of parallelFor().
+    */
+    uint32_t getNumWorkers() const noexcept
+    {
+        return fNumWorkers;
+    }
+
+   /*
+    * Spawn the worker threads.
+    * Does nothing if the pool is already running.
+    */
+    bool start(const uint32_t numWorkers, const bool withRealtimePriority = true) noexcept
+    {
+        if (fNumWorkers != 0)
+            return true;
+        if (numWorkers == 0)
+            return false;
+
+        fWorkers = new Worker*[numWorkers];
+
+        for (uint32_t i=0; i < numWorkers; ++i)
+        {
+            fWorkers[i] = new Worker(this);
+
+            if (! fWorkers[i]->startThread(withRealtimePriority))
+            {
+                delete fWorkers[i];
+                break;
+            }
+
+            ++fNumWorkers;
+        }
+
+        if (fNumWorkers == 0)
+        {
+            delete[] fWorkers;
+            fWorkers = nullptr;
+            return false;
+        }
+
+        return true;
+    }
+
+   /*
+    * Stop and delete all worker threads.
+    * Must not be called while a parallelFor() call is in progress.
+    */
+    void stop() noexcept
+    {
+        if (fWorkers == nullptr)
+            return;
+
+        for (uint32_t i=0; i < fNumWorkers; ++i)
+        {
+            fWorkers[i]->signalThreadShouldExit();
+            fWorkers[i]->wake();
+        }
+
+        for (uint32_t i=0; i < fNumWorkers; ++i)
+        {
+            fWorkers[i]->stopThread(-1);
+            delete fWorkers[i];
+        }
+
+        delete[] fWorkers;
+        fWorkers = nullptr;
+        fNumWorkers = 0;
+    }
+
+   /*
+    * Run @a taskFunc for every task index from 0 to @a taskCount - 1, spread across the pool.
+    * Returns once all tasks are complete.
+    */
+    void parallelFor(const uint32_t taskCount, const TaskFunc taskFunc, void* const ptr) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(taskFunc != nullptr,);
+
+        if (fNumWorkers == 0 || taskCount <= 1)
+        {
+            for (uint32_t i=0; i < taskCount; ++i)
+                taskFunc(ptr, i);
+            return;
+        }
+
+        // publish the job, the generation in the upper half of the state invalidates claims from older jobs
+        const uint32_t generation = static_cast<uint32_t>(fState.load(std::memory_order_relaxed) >> 32) + 1;
+
+        fTaskFunc = taskFunc;
+        fTaskPtr = ptr;
+        fTaskCount.store(taskCount, std::memory_order_relaxed);
+        fPendingTasks.store(taskCount, std::memory_order_relaxed);
+        fState.store(static_cast<uint64_t>(generation) << 32, std::memory_order_seq_cst);
+
+        // only sleeping workers need a signal, spinning ones pick up the new generation by themselves
+        const uint32_t numWorkersToWake = std::min(fNumWorkers, taskCount - 1);
+
+        for (uint32_t i=0; i < numWorkersToWake; ++i)
+            fWorkers[i]->wakeIfSleeping();
+
+        runTasks(generation);
+
+        // join, spin first as other threads are most likely finishing their last task
+        for (uint32_t i=0; i < kSpinIterations; ++i)
+        {
+            if (fPendingTasks.load(std::memory_order_acquire) == 0)
+                return;
+
+            spinPause();
+        }
+
+        fCallerWaiting.store(true, std::memory_order_seq_cst);
+
+        if (fPendingTasks.load(std::memory_order_seq_cst) == 0)
+        {
+            // the last task finished in the meantime, if it also took the flag a signal is on its way
+            if (fCallerWaiting.exchange(false, std::memory_order_acq_rel))
+                return;
+        }
+
+        fCallerSignal.wait();
+    }
+
+private:
+    static const uint32_t kMaxWorkers = 16;
+    static const uint32_t kSpinIterations = 4096;
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(ThreadPool* const p) noexcept
+            : Thread("DPF ThreadPool"),
+              pool(p),
+              signal(),
+              sleeping(false) {}
+
+        void wake() noexcept
+        {
+            sleeping.store(false, std::memory_order_relaxed);
+            signal.signal();
+        }
+
+        void wakeIfSleeping() noexcept
+        {
+            if (sleeping.exchange(false, std::memory_order_seq_cst))
+                signal.signal();
+        }
+
+    protected:
+        void run() override
+        {
+            uint32_t generation = pool->getGeneration();
+
+            while (! shouldThreadExit())
+            {
+                uint32_t newGeneration = generation;
+
+                for (uint32_t i=0; i < kSpinIterations && newGeneration == generation; ++i)
+                {
+                    spinPause();
+                    newGeneration = pool->getGeneration();
+                }
+
+                if (newGeneration == generation)
+                {
+                    sleeping.store(true, std::memory_order_seq_cst);
+
+                    // check again after announcing sleep, so that a job published in between is not missed
+                    if (pool->getGeneration() == generation && ! shouldThreadExit())
+                        signal.wait();
+
+                    sleeping.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+
+                generation = newGeneration;
+                pool->runTasks(generation);
+            }
+        }
+
+    private:
+        ThreadPool* const pool;
+        Signal signal;
+        std::atomic<bool> sleeping;
+    };
+
+    Worker** fWorkers;
+    uint32_t fNumWorkers;
+
+    // current job
+    TaskFunc fTaskFunc;
+    void* fTaskPtr;
+    std::atomic<uint32_t> fTaskCount;
+
+    // generation << 32 | next task index
+    std::atomic<uint64_t> fState;
+    std::atomic<uint32_t> fPendingTasks;
+
+    std::atomic<bool> fCallerWaiting;
+    Signal fCallerSignal;
+
+    uint32_t getGeneration() const noexcept
+    {
+        return static_cast<uint32_t>(fState.load(std::memory_order_seq_cst) >> 32);
+    }
+
+    void runTasks(const uint32_t generation) noexcept
+    {
+        for (;;)
+        {
+            uint64_t state = fState.load(std::memory_order_acquire);
+            uint32_t taskIndex;
+
+            // claim the next task, giving up once the job is exhausted or replaced by a newer one
+            for (;;)
+            {
+                if (static_cast<uint32_t>(state >> 32) != generation)
+                    return;
+
+                taskIndex = static_cast<uint32_t>(state);
+
+                if (taskIndex >= fTaskCount.load(std::memory_order_relaxed))
+                    return;
+
+                if (fState.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                    break;
+            }
+
+            // a claimed task keeps the job alive, so the function and pointer are valid here
+            fTaskFunc(fTaskPtr, taskIndex);
+
+            if (fPendingTasks.fetch_sub(1, std::memory_order_seq_cst) == 1)
+            {
+                if (fCallerWaiting.exchange(false, std::memory_order_seq_cst))
+                    fCallerSignal.signal();
+            }
+        }
+    }
+
+    static inline void spinPause() noexcept
+    {
+       #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        _mm_pause();
+       #elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+        __asm__ __volatile__("yield");
+       #endif
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(ThreadPool)
+};
+
+// -------------------------------------------------------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif // DISTRHO_THREAD_POOL_HPP_INCLUDED
@@ -102,6 +102,11 @@ double Plugin::getSampleRate() const noexcept
     return pData->sampleRate;
 }
 
+bool Plugin::isOfflineRendering() const noexcept
+{
+    return pData->isOfflineRendering;
+}
+
 const char* Plugin::getBundlePath() const noexcept
 {
     return pData->bundlePath;
@@ -124,6 +129,37 @@ const TimePosition& Plugin::getTimePosition() const noexcept
 }
 #endif
 
+const float* Plugin::getSmoothedParameterBuffer(const uint32_t index) const noexcept
+{
+    DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < pData->parameterCount, index, pData->parameterCount, nullptr);
+
+    if (pData->smoothedParameterSlots == nullptr || pData->smoothedParameterSlots[index] == kNoSmoothedParameterSlot)
+        return nullptr;
+
+    return pData->smoothedParameters[pData->smoothedParameterSlots[index]].buffer;
+}
+
+bool Plugin::isSmoothedParameterConstant(const uint32_t index) const noexcept
+{
+    DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < pData->parameterCount, index, pData->parameterCount, true);
+
+    if (pData->smoothedParameterSlots == nullptr || pData->smoothedParameterSlots[index] == kNoSmoothedParameterSlot)
+        return true;
+
+    return pData->smoothedParameters[pData->smoothedParameterSlots[index]].constant;
+}
+
+uint32_t Plugin::getTailLength() const noexcept
+{
+    return pData->tailLength;
+}
+
+void Plugin::setTailLength(const uint32_t frames) noexcept
+{
+    pData->tailLength = frames;
+    pData->hasTailLength = true;
+}
+
 #if DISTRHO_PLUGIN_WANT_LATENCY
 void Plugin::setLatency(const uint32_t frames) noexcept
 {
@@ -131,11 +167,59 @@ void Plugin::setLatency(const uint32_t frames) noexcept
 }
 #endif
 
+#if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+uint32_t Plugin::getDroppedMidiEventCount() const noexcept
+{
+    return pData->midiInputEvents.getOverflowCount();
+}
+#endif
+
 #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
 bool Plugin::writeMidiEvent(const MidiEvent& midiEvent) noexcept
 {
     return pData->writeMidiCallback(midiEvent);
 }
+
+uint64_t Plugin::getRunFrame() const noexcept
+{
+    return pData->getRunFrame();
+}
+
+bool Plugin::scheduleMidiEvent(const uint64_t absoluteFrame, const MidiEvent& midiEvent) noexcept
+{
+    DISTRHO_SAFE_ASSERT_RETURN(midiEvent.size != 0 && midiEvent.size <= MidiEvent::kDataSize, false);
+
+    return pData->midiOutputScheduler.push(absoluteFrame, midiEvent);
+}
+
+uint32_t Plugin::getScheduledMidiEventCount() const noexcept
+{
+    return pData->midiOutputScheduler.getCount();
+}
+
+void Plugin::cancelScheduledMidiEvents() noexcept
+{
+    pData->midiOutputScheduler.clear();
+}
+
+void Plugin::flushScheduledMidiEvents(const uint32_t frame) noexcept
+{
+    pData->flushScheduledMidiEvents(frame);
+}
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+void Plugin::parallelFor(const uint32_t taskCount, const ParallelTaskFunc taskFunc, void* const ptr) noexcept
+{
+    pData->parallelFor(taskCount, taskFunc, ptr);
+}
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+ProcessingStats Plugin::getProcessingStats() const noexcept
+{
+    return pData->processingStats.get();
+}
 #endif
 
 #if DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST
@@ -157,6 +241,23 @@ bool Plugin::updateStateValue(const char* const key, const char* const value) no
 }
 #endif
 
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+bool Plugin::requestStateLoad(const uint32_t index, const char* const value)
+{
+    return pData->stateLoader.request(index, value);
+}
+
+bool Plugin::isStateLoading(const uint32_t index) const noexcept
+{
+    return pData->stateLoader.isLoading(index);
+}
+
+StateObject* Plugin::getStateObject(const uint32_t index) const noexcept
+{
+    return pData->stateLoader.getObject(index);
+}
+#endif
+
 /* ------------------------------------------------------------------------------------------------------------
  * Init */
 
@@ -241,11 +342,16 @@ String Plugin::getState(const char*) const { return String(); }
 void Plugin::setState(const char*, const char*) {}
 #endif
 
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+StateObject* Plugin::loadStateObject(uint32_t, const char*) { return nullptr; }
+#endif
+
 /* ------------------------------------------------------------------------------------------------------------
  * Callbacks (optional) */
 
 void Plugin::bufferSizeChanged(uint32_t) {}
 void Plugin::sampleRateChanged(double) {}
+void Plugin::renderModeChanged(bool) {}
 void Plugin::ioChanged(uint16_t, uint16_t) {}
 
 // -----------------------------------------------------------------------------------------------------------
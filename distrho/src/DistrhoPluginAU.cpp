@@ -331,7 +331,7 @@ public:
           fLastParameterValues(nullptr),
           fBypassParameterIndex(UINT32_MAX)
        #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        , fMidiEventCount(0)
+        , fMidiEvents(fPlugin.getMidiInputEvents())
        #endif
        #if DISTRHO_PLUGIN_WANT_PROGRAMS
         , fCurrentProgram(-1)
@@ -363,9 +363,6 @@ public:
         fInputRenderCallback.inputProcRefCon = nullptr;
        #endif
 
-       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        std::memset(&fMidiEvents, 0, sizeof(fMidiEvents));
-       #endif
 
        #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
         std::memset(&fMidiOutput, 0, sizeof(fMidiOutput));
@@ -446,7 +443,7 @@ public:
        #endif
 
        #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        fMidiEventCount = 0;
+        fMidiEvents.clear();
        #endif
        #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
         fMidiOutputPackets.numPackets = 0;
@@ -1778,7 +1775,7 @@ public:
         }
 
        #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        fMidiEventCount = 0;
+        fMidiEvents.clear();
        #endif
        #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
         fMidiOutputPackets.numPackets = 0;
@@ -2000,11 +1997,12 @@ public:
                          const UInt32 inData2,
                          const UInt32 inOffsetSampleFrame)
     {
-        if (fMidiEventCount >= kMaxMidiEvents)
+        MidiEvent* const midiEventPtr = fMidiEvents.append(inOffsetSampleFrame);
+
+        if (midiEventPtr == nullptr)
             return noErr;
 
-        MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-        midiEvent.frame   = inOffsetSampleFrame;
+        MidiEvent& midiEvent(*midiEventPtr);
         midiEvent.data[0] = inStatus;
         midiEvent.data[1] = inData1;
         midiEvent.data[2] = inData2;
@@ -2038,23 +2036,11 @@ public:
 
     OSStatus auSysEx(const UInt8* const inData, const UInt32 inLength)
     {
-        if (fMidiEventCount >= kMaxMidiEvents)
+        if (inData == nullptr || inLength == 0)
             return noErr;
 
-        MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-        midiEvent.frame = fMidiEventCount != 1 ? fMidiEvents[fMidiEventCount - 1].frame : 0;
-        midiEvent.size  = inLength;
-
-        // FIXME who owns inData ??
-        if (inLength > MidiEvent::kDataSize)
-        {
-            std::memset(midiEvent.data, 0, MidiEvent::kDataSize);
-            midiEvent.dataExt = inData;
-        }
-        else
-        {
-            std::memcpy(midiEvent.data, inData, inLength);
-        }
+        // the host owns inData, so keep a copy until the next render
+        fMidiEvents.append(fMidiEvents.getLastFrame(), inData, inLength);
 
        #if DISTRHO_PLUGIN_NUM_INPUTS + DISTRHO_PLUGIN_NUM_OUTPUTS == 0
         // handle case of plugin having no working audio, simulate audio-side processing
@@ -2103,8 +2089,7 @@ private:
     uint32_t fBypassParameterIndex;
 
    #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-    uint32_t fMidiEventCount;
-    MidiEvent fMidiEvents[kMaxMidiEvents];
+    MidiEventArena& fMidiEvents;
     SmallStackRingBuffer fNotesRingBuffer;
    #endif
 
@@ -2163,23 +2148,17 @@ private:
     void run(const float** inputs, float** outputs, const uint32_t frames, const AudioTimeStamp* const inTimeStamp)
     {
        #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        if (fMidiEventCount != kMaxMidiEvents && fNotesRingBuffer.isDataAvailableForReading())
+        if (fNotesRingBuffer.isDataAvailableForReading())
         {
             uint8_t midiData[3];
-            const uint32_t frame = fMidiEventCount != 0 ? fMidiEvents[fMidiEventCount - 1].frame : 0;
+            const uint32_t frame = fMidiEvents.getLastFrame();
 
             while (fNotesRingBuffer.isDataAvailableForReading())
             {
                 if (! fNotesRingBuffer.readCustomData(midiData, 3))
                     break;
 
-                MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-                midiEvent.frame = frame;
-                midiEvent.size  = 3;
-                std::memcpy(midiEvent.data, midiData, 3);
-
-                if (fMidiEventCount == kMaxMidiEvents)
-                    break;
+                fMidiEvents.append(frame, midiData, 3);
             }
         }
        #endif
@@ -2255,8 +2234,8 @@ private:
        #endif
 
        #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        fPlugin.run(inputs, outputs, frames, fMidiEvents, fMidiEventCount);
-        fMidiEventCount = 0;
+        fPlugin.run(inputs, outputs, frames, fMidiEvents.getSortedEvents(), fMidiEvents.getCount());
+        fMidiEvents.clear();
        #else
         fPlugin.run(inputs, outputs, frames);
        #endif
@@ -2434,90 +2413,50 @@ private:
             }
            #endif
 
+            // program is stored separately above, as AU hosts care about it
+            StateChunkWriter writer;
+
            #if DISTRHO_PLUGIN_WANT_STATE
-            if (const CFMutableArrayRef statesRef = CFArrayCreateMutable(nullptr,
-                                                                         fStateCount,
-                                                                         &kCFTypeArrayCallBacks))
+            for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
             {
-                for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
-                {
-                    const String& key(cit->first);
-                    const String& value(cit->second);
+                const String& key(cit->first);
 
-                   #if DISTRHO_PLUGIN_WANT_DIRECT_ACCESS && ! DISTRHO_PLUGIN_HAS_UI
-                    bool wantStateKey = true;
+               #if DISTRHO_PLUGIN_WANT_DIRECT_ACCESS && ! DISTRHO_PLUGIN_HAS_UI
+                bool wantStateKey = true;
 
-                    for (uint32_t i=0; i<fStateCount; ++i)
+                for (uint32_t i=0; i<fStateCount; ++i)
+                {
+                    if (fPlugin.getStateKey(i) == key)
                     {
-                        if (fPlugin.getStateKey(i) == key)
-                        {
-                            if (fPlugin.getStateHints(i) & kStateIsOnlyForUI)
-                                wantStateKey = false;
-
-                            break;
-                        }
-                    }
-
-                    if (! wantStateKey)
-                        continue;
-                   #endif
-
-                    CFStringRef keyRef = CFStringCreateWithCString(nullptr, key, kCFStringEncodingASCII);
-                    CFStringRef valueRef = CFStringCreateWithCString(nullptr, value, kCFStringEncodingUTF8);
+                        if (fPlugin.getStateHints(i) & kStateIsOnlyForUI)
+                            wantStateKey = false;
 
-                    if (CFDictionaryRef dictRef = CFDictionaryCreate(nullptr,
-                                                                     reinterpret_cast<const void**>(&keyRef),
-                                                                     reinterpret_cast<const void**>(&valueRef),
-                                                                     1,
-                                                                     &kCFTypeDictionaryKeyCallBacks,
-                                                                     &kCFTypeDictionaryValueCallBacks))
-                    {
-                        CFArrayAppendValue(statesRef, dictRef);
-                        CFRelease(dictRef);
+                        break;
                     }
-
-                    CFRelease(keyRef);
-                    CFRelease(valueRef);
                 }
 
-                CFDictionarySetValue(data, CFSTR("states"), statesRef);
-                CFRelease(statesRef);
+                if (! wantStateKey)
+                    continue;
+               #endif
+
+                writer.addState(key, cit->second);
             }
            #endif
 
-            if (const CFMutableArrayRef paramsRef = CFArrayCreateMutable(nullptr,
-                                                                         fParameterCount,
-                                                                         &kCFTypeArrayCallBacks))
+            for (uint32_t i=0; i<fParameterCount; ++i)
             {
-                for (uint32_t i=0; i<fParameterCount; ++i)
-                {
-                    if (fPlugin.isParameterOutputOrTrigger(i))
-                        continue;
-
-                    const float value = fPlugin.getParameterValue(i);
-
-                    CFStringRef keyRef = CFStringCreateWithCString(nullptr,
-                                                                   fPlugin.getParameterSymbol(i),
-                                                                   kCFStringEncodingASCII);
-                    CFNumberRef valueRef = CFNumberCreate(nullptr, kCFNumberFloat32Type, &value);
+                if (fPlugin.isParameterOutputOrTrigger(i))
+                    continue;
 
-                    if (CFDictionaryRef dictRef = CFDictionaryCreate(nullptr,
-                                                                     reinterpret_cast<const void**>(&keyRef),
-                                                                     reinterpret_cast<const void**>(&valueRef),
-                                                                     1,
-                                                                     &kCFTypeDictionaryKeyCallBacks,
-                                                                     &kCFTypeDictionaryValueCallBacks))
-                    {
-                        CFArrayAppendValue(paramsRef, dictRef);
-                        CFRelease(dictRef);
-                    }
+                writer.addParameter(fPlugin.getParameterSymbol(i), fPlugin.getParameterValue(i));
+            }
 
-                    CFRelease(keyRef);
-                    CFRelease(valueRef);
-                }
+            const std::vector<uint8_t>& chunk(writer.finish());
 
-                CFDictionarySetValue(data, CFSTR("params"), paramsRef);
-                CFRelease(paramsRef);
+            if (const CFDataRef chunkRef = CFDataCreate(nullptr, chunk.data(), static_cast<CFIndex>(chunk.size())))
+            {
+                CFDictionarySetValue(data, CFSTR("chunk"), chunkRef);
+                CFRelease(chunkRef);
             }
 
             CFDictionarySetValue(clsInfo, CFSTR(kAUPresetDataKey), data);
@@ -2557,6 +2496,31 @@ private:
         }
        #endif
 
+        CFDataRef chunkRef = nullptr;
+        if (CFDictionaryGetValueIfPresent(data, CFSTR("chunk"), reinterpret_cast<const void**>(&chunkRef))
+            && CFGetTypeID(chunkRef) == CFDataGetTypeID())
+        {
+            StateChunkReader chunk(CFDataGetBytePtr(chunkRef), static_cast<std::size_t>(CFDataGetLength(chunkRef)));
+            DISTRHO_SAFE_ASSERT_RETURN(chunk.isValid(),);
+
+           #if DISTRHO_PLUGIN_WANT_STATE
+            for (const char *key, *value; chunk.readNextState(key, value);)
+            {
+                if (fPlugin.wantStateKey(key))
+                    restoreStateValue(key, value);
+            }
+           #endif
+
+            uint32_t symbolHash, index;
+            for (float value; chunk.readNextParameter(symbolHash, value);)
+            {
+                if (fPlugin.findParameterBySymbolHash(symbolHash, index))
+                    restoreParameterValue(index, value);
+            }
+
+            return;
+        }
+
        #if DISTRHO_PLUGIN_WANT_STATE
         CFArrayRef statesRef = nullptr;
         if (CFDictionaryGetValueIfPresent(data, CFSTR("states"), reinterpret_cast<const void**>(&statesRef))
@@ -2601,20 +2565,7 @@ private:
                 }
                 DISTRHO_SAFE_ASSERT_BREAK(CFStringGetCString(valueRef, value, valueLen + 1, kCFStringEncodingUTF8));
 
-                const String dkey(key);
-                fStateMap[dkey] = value;
-                fPlugin.setState(key, value);
-
-                for (uint32_t j=0; j<fStateCount; ++j)
-                {
-                    if (fPlugin.getStateKey(j) == key)
-                    {
-                        if ((fPlugin.getStateHints(i) & kStateIsOnlyForDSP) == 0x0)
-                            notifyPropertyListeners('DPFs', kAudioUnitScope_Global, j);
-
-                        break;
-                    }
-                }
+                restoreStateValue(key, value);
             }
 
             std::free(key);
@@ -2662,13 +2613,7 @@ private:
                     if (fPlugin.getParameterSymbol(j) != symbol)
                         continue;
 
-                    fLastParameterValues[j] = value;
-                    fPlugin.setParameterValue(j, value);
-                    notifyPropertyListeners('DPFp', kAudioUnitScope_Global, j);
-
-                    if (fBypassParameterIndex == j)
-                        notifyPropertyListeners(kAudioUnitProperty_BypassEffect, kAudioUnitScope_Global, 0);
-
+                    restoreParameterValue(j, value);
                     break;
                 }
             }
@@ -2677,6 +2622,36 @@ private:
         }
     }
 
+   #if DISTRHO_PLUGIN_WANT_STATE
+    void restoreStateValue(const char* const key, const char* const value)
+    {
+        const String dkey(key);
+        fStateMap[dkey] = value;
+        fPlugin.setState(key, value);
+
+        for (uint32_t i=0; i<fStateCount; ++i)
+        {
+            if (fPlugin.getStateKey(i) == key)
+            {
+                if ((fPlugin.getStateHints(i) & kStateIsOnlyForDSP) == 0x0)
+                    notifyPropertyListeners('DPFs', kAudioUnitScope_Global, i);
+
+                break;
+            }
+        }
+    }
+   #endif
+
+    void restoreParameterValue(const uint32_t index, const float value)
+    {
+        fLastParameterValues[index] = value;
+        fPlugin.setParameterValue(index, value);
+        notifyPropertyListeners('DPFp', kAudioUnitScope_Global, index);
+
+        if (fBypassParameterIndex == index)
+            notifyPropertyListeners(kAudioUnitProperty_BypassEffect, kAudioUnitScope_Global, 0);
+    }
+
     // ----------------------------------------------------------------------------------------------------------------
     // DPF callbacks
 
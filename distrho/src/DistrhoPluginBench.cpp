@@ -0,0 +1,460 @@
+/*
+ * DISTRHO Plugin Framework (DPF)
+ * Copyright (C) 2012-2024 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "DistrhoPluginInternal.hpp"
+#include "../extra/Time.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef DISTRHO_OS_WINDOWS
+# include <io.h>
+# define dup _dup
+# define dup2 _dup2
+# define fdopen _fdopen
+# define fileno _fileno
+#else
+# include <unistd.h>
+#endif
+
+USE_NAMESPACE_DISTRHO
+
+// --------------------------------------------------------------------------------------------------------------------
+// Benchmark configuration
+
+static const uint32_t kDefaultBufferSizes[] = { 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+static const double   kDefaultSampleRates[] = { 44100.0, 48000.0, 96000.0 };
+
+// parameter changes and MIDI notes happen at fixed intervals of audio time,
+// so that the workload is comparable across buffer sizes
+static const uint32_t kAutomationInterval = 256;
+static const uint32_t kMaxBenchMidiEvents = 128;
+
+// angular rate of the parameter automation sine, a full cycle every 2 seconds
+static const double kAutomationRate = 3.14159265358979323846;
+
+struct BenchConfig {
+    std::vector<uint32_t> bufferSizes;
+    std::vector<double> sampleRates;
+    double seconds;
+    const char* outputFilename;
+
+    BenchConfig()
+        : bufferSizes(kDefaultBufferSizes, kDefaultBufferSizes + ARRAY_SIZE(kDefaultBufferSizes)),
+          sampleRates(kDefaultSampleRates, kDefaultSampleRates + ARRAY_SIZE(kDefaultSampleRates)),
+          seconds(2.0),
+          outputFilename(nullptr) {}
+};
+
+struct BenchResult {
+    double sampleRate;
+    uint32_t bufferSize;
+    uint32_t calls;
+    double nsPerSample;
+    double realtimeFactor;
+    double instancesPerCore;
+    uint64_t minNs, p50Ns, p90Ns, p99Ns, maxNs;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Deterministic input generation
+
+// xorshift32, same seed for every run so that results are reproducible
+struct BenchRandom {
+    uint32_t state;
+
+    BenchRandom() noexcept
+        : state(0x12345678) {}
+
+    uint32_t next() noexcept
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    float nextNoise() noexcept
+    {
+        // uniform noise in [-0.5, 0.5), keeps headroom for plugins that sum inputs
+        return static_cast<float>(next() >> 8) / 16777216.f - 0.5f;
+    }
+};
+
+#if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+static bool writeMidiCallback(void*, const MidiEvent&)
+{
+    return true;
+}
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+// Run a single benchmark configuration
+
+static uint64_t getPercentile(const std::vector<uint64_t>& sorted, const double percentile)
+{
+    const std::size_t index = static_cast<std::size_t>(std::ceil(percentile * sorted.size())) - 1;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static BenchResult runBenchmark(const double sampleRate, const uint32_t bufferSize, const double seconds)
+{
+    d_nextBufferSize = bufferSize;
+    d_nextSampleRate = sampleRate;
+   #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+    PluginExporter plugin(nullptr, writeMidiCallback, nullptr, nullptr);
+   #else
+    PluginExporter plugin(nullptr, nullptr, nullptr, nullptr);
+   #endif
+    d_nextBufferSize = 0;
+    d_nextSampleRate = 0.0;
+
+    BenchRandom random;
+
+    std::vector<float> buffers((DISTRHO_PLUGIN_NUM_INPUTS + DISTRHO_PLUGIN_NUM_OUTPUTS + 1) * bufferSize);
+    float* inputBuffers[DISTRHO_PLUGIN_NUM_INPUTS > 0 ? DISTRHO_PLUGIN_NUM_INPUTS : 1] = {};
+    const float* inputs[DISTRHO_PLUGIN_NUM_INPUTS > 0 ? DISTRHO_PLUGIN_NUM_INPUTS : 1] = {};
+    float* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS > 0 ? DISTRHO_PLUGIN_NUM_OUTPUTS : 1] = {};
+    for (uint32_t i=0; i<DISTRHO_PLUGIN_NUM_INPUTS; ++i)
+        inputs[i] = inputBuffers[i] = &buffers[i * bufferSize];
+    for (uint32_t i=0; i<DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
+        outputs[i] = &buffers[(DISTRHO_PLUGIN_NUM_INPUTS + i) * bufferSize];
+
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    MidiEvent midiEvents[kMaxBenchMidiEvents];
+    uint8_t lastNote = 0;
+    // 16 notes per second, each one releasing the previous
+    const uint32_t midiInterval = static_cast<uint32_t>(sampleRate / 16);
+   #endif
+
+    const uint32_t parameterCount = plugin.getParameterCount();
+    const uint32_t warmupCalls = std::max<uint32_t>(16, static_cast<uint32_t>(0.25 * sampleRate / bufferSize));
+    const uint32_t calls = std::max<uint32_t>(64, static_cast<uint32_t>(seconds * sampleRate / bufferSize));
+
+    std::vector<uint64_t> timings;
+    timings.reserve(calls);
+
+    plugin.activate();
+
+    uint64_t frame = 0;
+    uint64_t totalNs = 0;
+
+    for (uint32_t c = 0; c < warmupCalls + calls; ++c, frame += bufferSize)
+    {
+        for (uint32_t i=0; i<DISTRHO_PLUGIN_NUM_INPUTS; ++i)
+            for (uint32_t j=0; j<bufferSize; ++j)
+                inputBuffers[i][j] = random.nextNoise();
+
+        // parameter automation, a slow sine per parameter with different phases
+        for (uint64_t next = (frame + kAutomationInterval - 1) / kAutomationInterval * kAutomationInterval;
+             next < frame + bufferSize; next += kAutomationInterval)
+        {
+            const double time = static_cast<double>(next) / sampleRate;
+
+            for (uint32_t i=0; i<parameterCount; ++i)
+            {
+                if (plugin.isParameterOutput(i))
+                    continue;
+                if (plugin.getParameterDesignation(i) == kParameterDesignationBypass)
+                    continue;
+
+                const ParameterRanges& ranges(plugin.getParameterRanges(i));
+                const float normalized = static_cast<float>(0.5 + 0.5 * std::sin(kAutomationRate * time + i));
+                float value = ranges.getUnnormalizedValue(normalized);
+
+                if (plugin.isParameterInteger(i))
+                    value = std::floor(value + 0.5f);
+
+               #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+                const uint32_t offset = static_cast<uint32_t>(next - frame);
+                if (offset != 0 && plugin.addParameterChange(offset, i, value))
+                    continue;
+               #endif
+                plugin.setParameterValue(i, value);
+            }
+        }
+
+       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        uint32_t midiEventCount = 0;
+
+        for (uint64_t next = (frame + midiInterval - 1) / midiInterval * midiInterval;
+             next < frame + bufferSize && midiEventCount + 2 <= kMaxBenchMidiEvents; next += midiInterval)
+        {
+            const uint32_t offset = static_cast<uint32_t>(next - frame);
+
+            if (lastNote != 0)
+            {
+                MidiEvent& noteOff(midiEvents[midiEventCount++]);
+                noteOff.frame = offset;
+                noteOff.size = 3;
+                noteOff.data[0] = 0x80;
+                noteOff.data[1] = lastNote;
+                noteOff.data[2] = 0;
+                noteOff.dataExt = nullptr;
+            }
+
+            lastNote = static_cast<uint8_t>(36 + random.next() % 61);
+
+            MidiEvent& noteOn(midiEvents[midiEventCount++]);
+            noteOn.frame = offset;
+            noteOn.size = 3;
+            noteOn.data[0] = 0x90;
+            noteOn.data[1] = lastNote;
+            noteOn.data[2] = static_cast<uint8_t>(1 + random.next() % 127);
+            noteOn.dataExt = nullptr;
+        }
+       #endif
+
+        const uint64_t startTime = d_gettime_ns();
+       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        plugin.run(inputs, outputs, bufferSize, midiEvents, midiEventCount);
+       #else
+        plugin.run(inputs, outputs, bufferSize);
+       #endif
+        const uint64_t elapsed = d_gettime_ns() - startTime;
+
+        if (c < warmupCalls)
+            continue;
+
+        timings.push_back(elapsed);
+        totalNs += elapsed;
+    }
+
+    plugin.deactivate();
+
+    std::sort(timings.begin(), timings.end());
+
+    const double audioNs = 1e9 * calls * bufferSize / sampleRate;
+    const double budgetNs = 1e9 * bufferSize / sampleRate;
+
+    BenchResult result;
+    result.sampleRate = sampleRate;
+    result.bufferSize = bufferSize;
+    result.calls = calls;
+    result.nsPerSample = static_cast<double>(totalNs) / (static_cast<double>(calls) * bufferSize);
+    result.realtimeFactor = totalNs != 0 ? audioNs / totalNs : 0.0;
+    result.minNs = timings.front();
+    result.p50Ns = getPercentile(timings, 0.50);
+    result.p90Ns = getPercentile(timings, 0.90);
+    result.p99Ns = getPercentile(timings, 0.99);
+    result.maxNs = timings.back();
+    // how many instances fit on one core while still meeting the deadline for 99% of the calls
+    result.instancesPerCore = result.p99Ns != 0 ? budgetNs / result.p99Ns : 0.0;
+    return result;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// JSON output
+
+static void writeJsonString(std::FILE* const file, const char* str)
+{
+    std::fputc('"', file);
+
+    for (; *str != '\0'; ++str)
+    {
+        const unsigned char c = static_cast<unsigned char>(*str);
+
+        if (c == '"' || c == '\\')
+            std::fprintf(file, "\\%c", c);
+        else if (c < 0x20)
+            std::fprintf(file, "\\u%04x", c);
+        else
+            std::fputc(c, file);
+    }
+
+    std::fputc('"', file);
+}
+
+static void writeJson(std::FILE* const file, const BenchConfig& config, const std::vector<BenchResult>& results)
+{
+    d_nextBufferSize = config.bufferSizes.front();
+    d_nextSampleRate = config.sampleRates.front();
+    const PluginExporter plugin(nullptr, nullptr, nullptr, nullptr);
+    d_nextBufferSize = 0;
+    d_nextSampleRate = 0.0;
+
+    const uint32_t version = plugin.getVersion();
+
+    std::fprintf(file, "{\n  \"plugin\": {\n    \"name\": ");
+    writeJsonString(file, plugin.getName());
+    std::fprintf(file, ",\n    \"label\": ");
+    writeJsonString(file, plugin.getLabel());
+    std::fprintf(file, ",\n    \"maker\": ");
+    writeJsonString(file, plugin.getMaker());
+    std::fprintf(file, ",\n    \"version\": \"%u.%u.%u\",\n",
+                 (version & 0xFF0000) >> 16, (version & 0x00FF00) >> 8, version & 0x0000FF);
+    std::fprintf(file, "    \"inputs\": %d,\n    \"outputs\": %d,\n    \"parameters\": %u,\n",
+                 DISTRHO_PLUGIN_NUM_INPUTS, DISTRHO_PLUGIN_NUM_OUTPUTS, plugin.getParameterCount());
+    std::fprintf(file, "    \"midiInput\": %s\n  },\n",
+                 DISTRHO_PLUGIN_WANT_MIDI_INPUT ? "true" : "false");
+    std::fprintf(file, "  \"seconds\": %g,\n  \"results\": [", config.seconds);
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& r(results[i]);
+        std::fprintf(file, "%s\n    {\n", i != 0 ? "," : "");
+        std::fprintf(file, "      \"sampleRate\": %g,\n", r.sampleRate);
+        std::fprintf(file, "      \"bufferSize\": %u,\n", r.bufferSize);
+        std::fprintf(file, "      \"calls\": %u,\n", r.calls);
+        std::fprintf(file, "      \"nsPerSample\": %.3f,\n", r.nsPerSample);
+        std::fprintf(file, "      \"realtimeFactor\": %.3f,\n", r.realtimeFactor);
+        std::fprintf(file, "      \"instancesPerCore\": %.3f,\n", r.instancesPerCore);
+        std::fprintf(file, "      \"callNs\": { \"min\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu }\n",
+                     static_cast<unsigned long long>(r.minNs),
+                     static_cast<unsigned long long>(r.p50Ns),
+                     static_cast<unsigned long long>(r.p90Ns),
+                     static_cast<unsigned long long>(r.p99Ns),
+                     static_cast<unsigned long long>(r.maxNs));
+        std::fprintf(file, "    }");
+    }
+
+    std::fprintf(file, "\n  ]\n}\n");
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// Command-line handling
+
+template <typename T>
+static bool parseList(const char* str, std::vector<T>& list)
+{
+    list.clear();
+
+    while (*str != '\0')
+    {
+        char* end;
+        const double value = std::strtod(str, &end);
+
+        if (end == str || value <= 0.0)
+            return false;
+
+        list.push_back(static_cast<T>(value));
+
+        if (*end == ',')
+            ++end;
+        else if (*end != '\0')
+            return false;
+
+        str = end;
+    }
+
+    return !list.empty();
+}
+
+static void printHelp(const char* const name)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "Benchmark the DSP of " DISTRHO_PLUGIN_NAME " without a host, results are written as JSON.\n\n"
+                 "Options:\n"
+                 "  --buffer-sizes <list>   comma-separated buffer sizes (default: 32,64,...,8192)\n"
+                 "  --sample-rates <list>   comma-separated sample rates (default: 44100,48000,96000)\n"
+                 "  --seconds <value>       seconds of audio to process per configuration (default: 2)\n"
+                 "  --output <file>         write JSON to a file instead of stdout\n",
+                 name);
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--buffer-sizes") == 0 && hasValue)
+        {
+            if (! parseList(argv[++i], config.bufferSizes))
+            {
+                d_stderr2("Invalid buffer sizes '%s'", argv[i]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--sample-rates") == 0 && hasValue)
+        {
+            if (! parseList(argv[++i], config.sampleRates))
+            {
+                d_stderr2("Invalid sample rates '%s'", argv[i]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+        {
+            config.seconds = std::atof(argv[++i]);
+
+            if (config.seconds <= 0.0)
+            {
+                d_stderr2("Invalid duration '%s'", argv[i]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue)
+        {
+            config.outputFilename = argv[++i];
+        }
+        else
+        {
+            printHelp(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    // plugins commonly print to stdout, send that to stderr so the JSON output stays valid
+    std::FILE* file = nullptr;
+
+    if (config.outputFilename == nullptr)
+    {
+        std::fflush(stdout);
+        file = fdopen(dup(fileno(stdout)), "w");
+        dup2(fileno(stderr), fileno(stdout));
+    }
+    else
+    {
+        file = std::fopen(config.outputFilename, "w");
+    }
+
+    if (file == nullptr)
+    {
+        d_stderr2("Failed to open '%s' for writing", config.outputFilename != nullptr ? config.outputFilename : "stdout");
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+
+    for (std::size_t s = 0; s < config.sampleRates.size(); ++s)
+    {
+        for (std::size_t b = 0; b < config.bufferSizes.size(); ++b)
+        {
+            const BenchResult result = runBenchmark(config.sampleRates[s], config.bufferSizes[b], config.seconds);
+            results.push_back(result);
+
+            std::fprintf(stderr, "%6g Hz %5u frames: %8.3f ns/sample, %9.2fx realtime, p99 %llu ns\n",
+                         result.sampleRate, result.bufferSize, result.nsPerSample, result.realtimeFactor,
+                         static_cast<unsigned long long>(result.p99Ns));
+        }
+    }
+
+    std::fflush(stdout);
+    writeJson(file, config, results);
+    std::fclose(file);
+
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
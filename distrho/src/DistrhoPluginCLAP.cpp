@@ -53,8 +53,11 @@
 #include "clap/ext/gui.h"
 #include "clap/ext/note-ports.h"
 #include "clap/ext/params.h"
+#include "clap/ext/render.h"
 #include "clap/ext/state.h"
+#include "clap/ext/tail.h"
 #include "clap/ext/thread-check.h"
+#include "clap/ext/thread-pool.h"
 #include "clap/ext/timer-support.h"
 
 #if (defined(DISTRHO_OS_MAC) || defined(DISTRHO_OS_WINDOWS)) && ! DISTRHO_PLUGIN_HAS_EXTERNAL_UI
@@ -139,36 +142,6 @@ struct ClapEventQueue
    #endif
   #endif
 
-    struct CachedParameters {
-        uint numParams;
-        bool* changed;
-        float* values;
-
-        CachedParameters()
-            : numParams(0),
-              changed(nullptr),
-              values(nullptr) {}
-
-        ~CachedParameters()
-        {
-            delete[] changed;
-            delete[] values;
-        }
-
-        void setup(const uint numParameters)
-        {
-            if (numParameters == 0)
-                return;
-
-            numParams = numParameters;
-            changed = new bool[numParameters];
-            values = new float[numParameters];
-
-            std::memset(changed, 0, sizeof(bool)*numParameters);
-            std::memset(values, 0, sizeof(float)*numParameters);
-        }
-    } fCachedParameters;
-
     ClapEventQueue()
        #if DISTRHO_PLUGIN_HAS_UI && DISTRHO_PLUGIN_WANT_MIDI_INPUT
         : fNotesBuffer(StackBuffer_INIT)
@@ -215,7 +188,7 @@ public:
           fPluginEventQueue(eventQueue),
          #endif
           fEventQueue(eventQueue->fEventQueue),
-          fCachedParameters(eventQueue->fCachedParameters),
+          fParameterStore(plugin.getParameterStore()),
          #if DISTRHO_PLUGIN_WANT_PROGRAMS
           fCurrentProgram(eventQueue->fCurrentProgram),
          #endif
@@ -496,12 +469,14 @@ public:
             ui->idleFromNativeIdle();
            #endif
 
-            for (uint i=0; i<fCachedParameters.numParams; ++i)
+            ParameterBitset& changes(fParameterStore.getChanges());
+
+            for (uint32_t w=0, count=changes.getWordCount(); w<count; ++w)
             {
-                if (fCachedParameters.changed[i])
+                for (uint32_t bits = changes.takeWord(w); bits != 0;)
                 {
-                    fCachedParameters.changed[i] = false;
-                    ui->parameterChanged(i, fCachedParameters.values[i]);
+                    const uint32_t i = w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits);
+                    ui->parameterChanged(i, fParameterStore.getValue(i));
                 }
             }
         }
@@ -540,7 +515,7 @@ private:
     ClapEventQueue* const fPluginEventQueue;
    #endif
     ClapEventQueue::Queue& fEventQueue;
-    ClapEventQueue::CachedParameters& fCachedParameters;
+    ParameterStore& fParameterStore;
    #if DISTRHO_PLUGIN_WANT_PROGRAMS
     uint32_t& fCurrentProgram;
    #endif
@@ -613,10 +588,12 @@ private:
         }
        #endif
 
-        for (uint32_t i=0; i<fCachedParameters.numParams; ++i)
+        fParameterStore.getChanges().clear();
+
+        for (uint32_t i=0, count=fParameterStore.getCount(); i<count; ++i)
         {
-            const float value = fCachedParameters.values[i] = fPlugin.getParameterValue(i);
-            fCachedParameters.changed[i] = false;
+            const float value = fPlugin.getParameterValue(i);
+            fParameterStore.setValue(i, value, false);
             fUI->parameterChanged(i, value);
         }
 
@@ -761,13 +738,17 @@ public:
           fLatencyChanged(false),
           fLastKnownLatency(0),
          #endif
+          fLastKnownTail(0),
+          fOfflineRenderingRequested(false),
          #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-          fMidiEventCount(0),
+          fMidiEvents(fPlugin.getMidiInputEvents()),
+         #endif
+         #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+          fParallelTaskFunc(nullptr),
+          fParallelTaskPtr(nullptr),
          #endif
           fHostExtensions(host)
     {
-        fCachedParameters.setup(fPlugin.getParameterCount());
-
        #if DISTRHO_PLUGIN_HAS_UI && DISTRHO_PLUGIN_WANT_MIDI_INPUT
         fNotesRingBuffer.setRingBuffer(&fNotesBuffer, true);
        #endif
@@ -805,7 +786,19 @@ public:
         if (!clap_version_is_compatible(fHost->clap_version))
             return false;
 
-        return fHostExtensions.init();
+        if (! fHostExtensions.init())
+            return false;
+
+       #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+        if (fHostExtensions.threadPool != nullptr)
+            fPlugin.setParallelForCallback(parallelForCallback);
+       #endif
+
+       #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+        fPlugin.setStateLoadedCallback(stateLoadedCallback);
+       #endif
+
+        return true;
     }
 
     void activate(const double sampleRate, const uint32_t maxFramesCount)
@@ -818,6 +811,11 @@ public:
     void deactivate()
     {
         fPlugin.deactivate();
+
+        // render mode changed while active, we asked the host for a restart to apply it
+        if (fOfflineRenderingRequested != fPlugin.isOfflineRendering())
+            fPlugin.setOfflineRendering(fOfflineRenderingRequested, true);
+
        #if DISTRHO_PLUGIN_WANT_LATENCY
         checkForLatencyChanges(false, true);
         reportLatencyChangeIfNeeded();
@@ -827,7 +825,7 @@ public:
     bool process(const clap_process_t* const process)
     {
        #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        fMidiEventCount = 0;
+        fMidiEvents.clear();
        #endif
 
        #if DISTRHO_PLUGIN_HAS_UI
@@ -978,7 +976,8 @@ public:
                         DISTRHO_SAFE_ASSERT_UINT2_BREAK(event->size == sizeof(clap_event_param_value_t),
                                                         event->size, sizeof(clap_event_param_value_t));
                         if (event->space_id == 0)
-                            setParameterValueFromEvent(reinterpret_cast<const clap_event_param_value_t*>(event));
+                            setParameterValueFromEvent(reinterpret_cast<const clap_event_param_value_t*>(event),
+                                                       event->time < process->frames_count ? event->time : 0);
                         break;
                     case CLAP_EVENT_PARAM_MOD:
                     case CLAP_EVENT_PARAM_GESTURE_BEGIN:
@@ -993,6 +992,12 @@ public:
                        #endif
                         break;
                     case CLAP_EVENT_MIDI_SYSEX:
+                        DISTRHO_SAFE_ASSERT_UINT2_BREAK(event->size == sizeof(clap_event_midi_sysex_t),
+                                                        event->size, sizeof(clap_event_midi_sysex_t));
+                       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+                        addSysexEvent(reinterpret_cast<const clap_event_midi_sysex_t*>(event));
+                       #endif
+                        break;
                     case CLAP_EVENT_MIDI2:
                         break;
                     }
@@ -1001,89 +1006,85 @@ public:
         }
 
        #if DISTRHO_PLUGIN_HAS_UI && DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        if (fMidiEventCount != kMaxMidiEvents && fNotesRingBuffer.isDataAvailableForReading())
+        if (fNotesRingBuffer.isDataAvailableForReading())
         {
             uint8_t midiData[3];
-            const uint32_t frame = fMidiEventCount != 0 ? fMidiEvents[fMidiEventCount-1].frame : 0;
+            const uint32_t frame = fMidiEvents.getLastFrame();
 
             while (fNotesRingBuffer.isDataAvailableForReading())
             {
                 if (! fNotesRingBuffer.readCustomData(midiData, 3))
                     break;
 
-                MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-                midiEvent.frame = frame;
-                midiEvent.size  = 3;
-                std::memcpy(midiEvent.data, midiData, 3);
-
-                if (fMidiEventCount == kMaxMidiEvents)
-                    break;
+                fMidiEvents.append(frame, midiData, 3);
             }
         }
        #endif
 
         if (const uint32_t frames = process->frames_count)
         {
-           #if DISTRHO_PLUGIN_NUM_INPUTS != 0
-            const float** const audioInputs = fAudioInputs;
+            fOutputEvents = process->out_events;
 
-            uint32_t in=0;
-            for (uint32_t i=0; i<process->audio_inputs_count; ++i)
+           #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+            if (isUsingDoublePrecision(process))
             {
-                const clap_audio_buffer_t& inputs(process->audio_inputs[i]);
-                DISTRHO_SAFE_ASSERT_CONTINUE(inputs.channel_count != 0);
-
-                for (uint32_t j=0; j<inputs.channel_count; ++j, ++in)
-                    audioInputs[in] = const_cast<const float*>(inputs.data32[j]);
-            }
+               #if DISTRHO_PLUGIN_NUM_INPUTS != 0
+                const double** const audioInputs = fAudioInputs64;
+               #else
+                constexpr const double** const audioInputs = nullptr;
+               #endif
+               #if DISTRHO_PLUGIN_NUM_OUTPUTS != 0
+                double** const audioOutputs = fAudioOutputs64;
+               #else
+                constexpr double** const audioOutputs = nullptr;
+               #endif
+
+                if (! setupAudioBuffers(process, audioInputs, audioOutputs))
+                {
+                    fOutputEvents = nullptr;
+                    return false;
+                }
 
-            if (fUsingCV)
-            {
-                for (; in<DISTRHO_PLUGIN_NUM_INPUTS; ++in)
-                    audioInputs[in] = nullptr;
+               #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+                fPlugin.run(audioInputs, audioOutputs, frames, fMidiEvents.getSortedEvents(), fMidiEvents.getCount());
+               #else
+                fPlugin.run(audioInputs, audioOutputs, frames);
+               #endif
             }
             else
-            {
-                DISTRHO_SAFE_ASSERT_UINT2_RETURN(in == DISTRHO_PLUGIN_NUM_INPUTS,
-                                                 in, process->audio_inputs_count, false);
-            }
-           #else
-            constexpr const float** const audioInputs = nullptr;
            #endif
-
-           #if DISTRHO_PLUGIN_NUM_OUTPUTS != 0
-            float** const audioOutputs = fAudioOutputs;
-
-            uint32_t out=0;
-            for (uint32_t i=0; i<process->audio_outputs_count; ++i)
             {
-                const clap_audio_buffer_t& outputs(process->audio_outputs[i]);
-                DISTRHO_SAFE_ASSERT_CONTINUE(outputs.channel_count != 0);
-
-                for (uint32_t j=0; j<outputs.channel_count; ++j, ++out)
-                    audioOutputs[out] = outputs.data32[j];
-            }
+               #if DISTRHO_PLUGIN_NUM_INPUTS != 0
+                const float** const audioInputs = fAudioInputs;
+               #else
+                constexpr const float** const audioInputs = nullptr;
+               #endif
+               #if DISTRHO_PLUGIN_NUM_OUTPUTS != 0
+                float** const audioOutputs = fAudioOutputs;
+               #else
+                constexpr float** const audioOutputs = nullptr;
+               #endif
+
+                if (! setupAudioBuffers(process, audioInputs, audioOutputs))
+                {
+                    fOutputEvents = nullptr;
+                    return false;
+                }
 
-            if (fUsingCV)
-            {
-                for (; out<DISTRHO_PLUGIN_NUM_OUTPUTS; ++out)
-                    audioOutputs[out] = nullptr;
+               #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+                fPlugin.run(audioInputs, audioOutputs, frames, fMidiEvents.getSortedEvents(), fMidiEvents.getCount());
+               #else
+                fPlugin.run(audioInputs, audioOutputs, frames);
+               #endif
             }
-            else
-            {
-                DISTRHO_SAFE_ASSERT_UINT2_RETURN(out == DISTRHO_PLUGIN_NUM_OUTPUTS,
-                                                 out, DISTRHO_PLUGIN_NUM_OUTPUTS, false);
-            }
-           #else
-            constexpr float** const audioOutputs = nullptr;
-           #endif
 
-            fOutputEvents = process->out_events;
+           #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+            // let the host know our outputs are silent, it can skip processing them further
+            // always written, hosts may reuse the output structs between blocks
+            const uint64_t constantMask = fPlugin.areOutputsSilent() ? ~static_cast<uint64_t>(0) : 0;
 
-           #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-            fPlugin.run(audioInputs, audioOutputs, frames, fMidiEvents, fMidiEventCount);
-           #else
-            fPlugin.run(audioInputs, audioOutputs, frames);
+            for (uint32_t i=0; i<process->audio_outputs_count; ++i)
+                process->audio_outputs[i].constant_mask = constantMask;
            #endif
 
             flushParameters(nullptr, process->out_events, frames - 1);
@@ -1095,16 +1096,164 @@ public:
         checkForLatencyChanges(true, false);
        #endif
 
+        // tail changes can be reported directly from the audio thread
+        if (fLastKnownTail != fPlugin.getTailLength())
+        {
+            fLastKnownTail = fPlugin.getTailLength();
+
+            if (fHostExtensions.tail != nullptr)
+                fHostExtensions.tail->changed(fHost);
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // audio buffers, shared between single and double precision processing
+
+    static float** getChannelBuffers(const clap_audio_buffer_t& buffer, const float*) noexcept
+    {
+        return buffer.data32;
+    }
+
+    static double** getChannelBuffers(const clap_audio_buffer_t& buffer, const double*) noexcept
+    {
+        return buffer.data64;
+    }
+
+   #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+    static bool isUsingDoublePrecision(const clap_process_t* const process) noexcept
+    {
+        if (process->audio_outputs_count != 0)
+            return process->audio_outputs[0].data32 == nullptr && process->audio_outputs[0].data64 != nullptr;
+        if (process->audio_inputs_count != 0)
+            return process->audio_inputs[0].data32 == nullptr && process->audio_inputs[0].data64 != nullptr;
+        return false;
+    }
+   #endif
+
+    template<typename T>
+    bool setupAudioBuffers(const clap_process_t* const process, const T** const audioInputs, T** const audioOutputs)
+    {
+       #if DISTRHO_PLUGIN_NUM_INPUTS != 0
+        uint32_t in=0;
+        for (uint32_t i=0; i<process->audio_inputs_count; ++i)
+        {
+            const clap_audio_buffer_t& inputs(process->audio_inputs[i]);
+            DISTRHO_SAFE_ASSERT_CONTINUE(inputs.channel_count != 0);
+
+            T** const channels = getChannelBuffers(inputs, static_cast<const T*>(nullptr));
+            DISTRHO_SAFE_ASSERT_CONTINUE(channels != nullptr);
+
+            for (uint32_t j=0; j<inputs.channel_count; ++j, ++in)
+                audioInputs[in] = const_cast<const T*>(channels[j]);
+        }
+
+        if (fUsingCV)
+        {
+            for (; in<DISTRHO_PLUGIN_NUM_INPUTS; ++in)
+                audioInputs[in] = nullptr;
+        }
+        else
+        {
+            DISTRHO_SAFE_ASSERT_UINT2_RETURN(in == DISTRHO_PLUGIN_NUM_INPUTS,
+                                             in, process->audio_inputs_count, false);
+        }
+       #else
+        // unused
+        (void)audioInputs;
+       #endif
+
+       #if DISTRHO_PLUGIN_NUM_OUTPUTS != 0
+        uint32_t out=0;
+        for (uint32_t i=0; i<process->audio_outputs_count; ++i)
+        {
+            const clap_audio_buffer_t& outputs(process->audio_outputs[i]);
+            DISTRHO_SAFE_ASSERT_CONTINUE(outputs.channel_count != 0);
+
+            T** const channels = getChannelBuffers(outputs, static_cast<const T*>(nullptr));
+            DISTRHO_SAFE_ASSERT_CONTINUE(channels != nullptr);
+
+            for (uint32_t j=0; j<outputs.channel_count; ++j, ++out)
+                audioOutputs[out] = channels[j];
+        }
+
+        if (fUsingCV)
+        {
+            for (; out<DISTRHO_PLUGIN_NUM_OUTPUTS; ++out)
+                audioOutputs[out] = nullptr;
+        }
+        else
+        {
+            DISTRHO_SAFE_ASSERT_UINT2_RETURN(out == DISTRHO_PLUGIN_NUM_OUTPUTS,
+                                             out, DISTRHO_PLUGIN_NUM_OUTPUTS, false);
+        }
+       #else
+        // unused
+        (void)audioOutputs;
+       #endif
+
+       #if DISTRHO_PLUGIN_NUM_INPUTS == 0 && DISTRHO_PLUGIN_NUM_OUTPUTS == 0
+        // unused
+        (void)process;
+       #endif
+
         return true;
     }
 
     void onMainThread()
     {
+       #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+        handleLoadedStates();
+       #endif
+
        #if DISTRHO_PLUGIN_WANT_LATENCY
         reportLatencyChangeIfNeeded();
        #endif
     }
 
+   #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+    void handleLoadedStates()
+    {
+       #if DISTRHO_PLUGIN_HAS_UI
+        ClapUI* const ui = fUI.get();
+       #endif
+        ParameterBitset& loaded(fPlugin.getLoadedStates());
+        bool anyLoaded = false;
+
+        for (uint32_t w=0, count=loaded.getWordCount(); w<count; ++w)
+        {
+            for (uint32_t bits = loaded.takeWord(w); bits != 0;)
+            {
+                const uint32_t i = w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits);
+                anyLoaded = true;
+
+               #if DISTRHO_PLUGIN_HAS_UI
+                // let the UI know the data behind the current value is now in use
+                if (ui == nullptr || (fPlugin.getStateHints(i) & kStateIsOnlyForDSP) != 0x0)
+                    continue;
+
+                const String& key(fPlugin.getStateKey(i));
+                const StringMap::const_iterator cit = fStateMap.find(key);
+
+                if (cit != fStateMap.end())
+                    ui->setStateFromPlugin(key, cit->second);
+               #else
+                (void)i;
+               #endif
+            }
+        }
+
+       #if DISTRHO_PLUGIN_WANT_LATENCY
+        // loaded data such as impulse responses may change the latency
+        if (anyLoaded)
+            checkForLatencyChanges(fPlugin.isActive(), true);
+       #else
+        (void)anyLoaded;
+       #endif
+    }
+   #endif
+
     // ----------------------------------------------------------------------------------------------------------------
     // parameters
 
@@ -1254,19 +1403,23 @@ public:
                 0, nullptr, 0, 0, 0, 0, 0.0
             };
 
+            ParameterStore& store(fPlugin.getParameterStore());
+            const ParameterIndexList* const lists[2] = {
+                &fPlugin.getOutputParameterIndexList(),
+                &fPlugin.getTriggerParameterIndexList(),
+            };
+
             float value;
-            for (uint i=0; i<fCachedParameters.numParams; ++i)
+            for (uint l=0; l<2; ++l)
             {
-                if (fPlugin.isParameterOutputOrTrigger(i))
+                for (uint k=0; k<lists[l]->count; ++k)
                 {
+                    const uint32_t i = lists[l]->indices[k];
                     value = fPlugin.getParameterValue(i);
 
-                    if (d_isEqual(fCachedParameters.values[i], value))
+                    if (! store.updateValue(i, value, true))
                         continue;
 
-                    fCachedParameters.values[i] = value;
-                    fCachedParameters.changed[i] = true;
-
                     clapEvent.param_id = i;
                     clapEvent.value = value;
                     out->try_push(out, &clapEvent.header);
@@ -1287,36 +1440,48 @@ public:
     {
         DISTRHO_SAFE_ASSERT_UINT_RETURN(event->port_index == 0, event->port_index,);
 
-        if (fMidiEventCount == kMaxMidiEvents)
+        MidiEvent* const midiEvent = fMidiEvents.append(event->header.time);
+
+        if (midiEvent == nullptr)
             return;
 
-        MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-        midiEvent.frame = event->header.time;
-        midiEvent.size  = 3;
-        midiEvent.data[0] = (isOn ? 0x90 : 0x80) | (event->channel & 0x0F);
-        midiEvent.data[1] = std::max(0, std::min(127, static_cast<int>(event->key)));
-        midiEvent.data[2] = std::max(0, std::min(127, static_cast<int>(event->velocity * 127 + 0.5)));
+        midiEvent->size  = 3;
+        midiEvent->data[0] = (isOn ? 0x90 : 0x80) | (event->channel & 0x0F);
+        midiEvent->data[1] = std::max(0, std::min(127, static_cast<int>(event->key)));
+        midiEvent->data[2] = std::max(0, std::min(127, static_cast<int>(event->velocity * 127 + 0.5)));
     }
 
     void addMidiEvent(const clap_event_midi_t* const event) noexcept
     {
         DISTRHO_SAFE_ASSERT_UINT_RETURN(event->port_index == 0, event->port_index,);
 
-        if (fMidiEventCount == kMaxMidiEvents)
-            return;
+        fMidiEvents.append(event->header.time, event->data, 3);
+    }
+
+    void addSysexEvent(const clap_event_midi_sysex_t* const event) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_UINT_RETURN(event->port_index == 0, event->port_index,);
 
-        MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-        midiEvent.frame = event->header.time;
-        midiEvent.size  = 3;
-        std::memcpy(midiEvent.data, event->data, 3);
+        if (event->buffer != nullptr && event->size != 0)
+            fMidiEvents.append(event->header.time, event->buffer, event->size);
     }
    #endif
 
-    void setParameterValueFromEvent(const clap_event_param_value_t* const event)
+    void setParameterValueFromEvent(const clap_event_param_value_t* const event, const uint32_t frame = 0)
     {
-        fCachedParameters.values[event->param_id] = event->value;
-        fCachedParameters.changed[event->param_id] = true;
-        fPlugin.setParameterValue(event->param_id, event->value);
+       #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+        if (frame != 0 && fPlugin.addParameterChange(frame, event->param_id, event->value))
+        {
+            // the plugin gets the value during run(), the store is updated now
+            fPlugin.getParameterStore().setValue(event->param_id, event->value, true);
+            return;
+        }
+       #else
+        // unused
+        (void)frame;
+       #endif
+
+        fPlugin.setParameterValue(event->param_id, event->value, true);
     }
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -1341,6 +1506,9 @@ public:
         d_strncpy(info->name, busInfo.name, CLAP_NAME_SIZE);
 
         info->flags = busInfo.isMain ? CLAP_AUDIO_PORT_IS_MAIN : 0x0;
+       #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+        info->flags |= CLAP_AUDIO_PORT_SUPPORTS_64BITS;
+       #endif
         info->channel_count = busInfo.numChannels;
 
         switch (busInfo.groupId)
@@ -1361,6 +1529,43 @@ public:
     }
    #endif
 
+    // ----------------------------------------------------------------------------------------------------------------
+    // render
+
+    bool setRenderMode(const clap_plugin_render_mode mode)
+    {
+        fOfflineRenderingRequested = mode == CLAP_RENDER_OFFLINE;
+
+        // if not active we can apply it right away, otherwise on deactivate as part of a host restart
+        if (! fPlugin.isActive())
+            fPlugin.setOfflineRendering(fOfflineRenderingRequested, true);
+        else if (fOfflineRenderingRequested != fPlugin.isOfflineRendering())
+            fHost->request_restart(fHost);
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // tail
+
+    uint32_t getTailLength() const noexcept
+    {
+        // CLAP treats anything equal or above INT32_MAX as infinite
+        return std::min<uint32_t>(fPlugin.getTailLength(), INT32_MAX);
+    }
+
+   #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+    // ----------------------------------------------------------------------------------------------------------------
+    // thread pool
+
+    void execParallelTask(const uint32_t taskIndex)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fParallelTaskFunc != nullptr,);
+
+        fParallelTaskFunc(fParallelTaskPtr, taskIndex);
+    }
+   #endif
+
     // ----------------------------------------------------------------------------------------------------------------
     // latency
 
@@ -1420,19 +1625,6 @@ public:
 
     bool stateSave(const clap_ostream_t* const stream)
     {
-        const uint32_t paramCount = fPlugin.getParameterCount();
-       #if DISTRHO_PLUGIN_WANT_STATE
-        const uint32_t stateCount = fPlugin.getStateCount();
-       #else
-        const uint32_t stateCount = 0;
-       #endif
-
-        if (stateCount == 0 && paramCount == 0)
-        {
-            char buffer = '\0';
-            return stream->write(stream, &buffer, 1) == 1;
-        }
-
        #if DISTRHO_PLUGIN_WANT_FULL_STATE
         // Update current state
         for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
@@ -1442,269 +1634,105 @@ public:
         }
        #endif
 
-        String state;
-
        #if DISTRHO_PLUGIN_WANT_PROGRAMS
-        {
-            String tmpStr("__dpf_program__\xff");
-            tmpStr += String(fCurrentProgram);
-            tmpStr += "\xff";
-
-            state += tmpStr;
-        }
+        StateChunkWriter writer(static_cast<int32_t>(fCurrentProgram));
+       #else
+        StateChunkWriter writer;
        #endif
 
        #if DISTRHO_PLUGIN_WANT_STATE
-        if (stateCount != 0)
-        {
-            state += "__dpf_state_begin__\xff";
-
-            for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
-            {
-                const String& key(cit->first);
-                const String& value(cit->second);
-
-                // join key and value
-                String tmpStr;
-                tmpStr  = key;
-                tmpStr += "\xff";
-                tmpStr += value;
-                tmpStr += "\xff";
-
-                state += tmpStr;
-            }
-
-            state += "__dpf_state_end__\xff";
-        }
+        for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
+            writer.addState(cit->first, cit->second);
        #endif
 
-        if (paramCount != 0)
+        for (uint32_t i=0, count=fPlugin.getParameterCount(); i<count; ++i)
         {
-            state += "__dpf_parameters_begin__\xff";
-
-            for (uint32_t i=0; i<paramCount; ++i)
-            {
-                if (fPlugin.isParameterOutputOrTrigger(i))
-                    continue;
+            if (fPlugin.isParameterOutputOrTrigger(i))
+                continue;
 
-                // join key and value
-                String tmpStr;
-                tmpStr  = fPlugin.getParameterSymbol(i);
-                tmpStr += "\xff";
-                if (fPlugin.getParameterHints(i) & kParameterIsInteger)
-                    tmpStr += String(static_cast<int>(std::round(fPlugin.getParameterValue(i))));
-                else
-                    tmpStr += String(fPlugin.getParameterValue(i));
-                tmpStr += "\xff";
-
-                state += tmpStr;
-            }
-
-            state += "__dpf_parameters_end__\xff";
+            writer.addParameter(fPlugin.getParameterSymbol(i), fPlugin.getParameterValue(i));
         }
 
-        // terminator
-        state += "\xfe";
-
-        state.replace('\xff', '\0');
+        const std::vector<uint8_t>& state(writer.finish());
 
         // now saving state, carefully until host written bytes matches full state size
-        const char* buffer = state.buffer();
-        const int32_t size = static_cast<int32_t>(state.length())+1;
+        const uint8_t* const buffer = state.data();
+        const int64_t size = static_cast<int64_t>(state.size());
 
-        for (int32_t wrtntotal = 0, wrtn; wrtntotal < size; wrtntotal += wrtn)
+        for (int64_t wrtntotal = 0, wrtn; wrtntotal < size; wrtntotal += wrtn)
         {
-            wrtn = stream->write(stream, buffer + wrtntotal, size - wrtntotal);
-            DISTRHO_SAFE_ASSERT_INT_RETURN(wrtn > 0, wrtn, false);
+            wrtn = stream->write(stream, buffer + wrtntotal, static_cast<uint64_t>(size - wrtntotal));
+            DISTRHO_SAFE_ASSERT_INT_RETURN(wrtn > 0, static_cast<int>(wrtn), false);
         }
 
         return true;
     }
 
+    struct StreamReader {
+        const clap_istream_t* const stream;
+
+        int32_t operator()(void* const buffer, const int32_t size) const
+        {
+            return static_cast<int32_t>(stream->read(stream, buffer, static_cast<uint64_t>(size)));
+        }
+    };
+
     bool stateLoad(const clap_istream_t* const stream)
     {
        #if DISTRHO_PLUGIN_HAS_UI
         ClapUI* const ui = fUI.get();
        #endif
-        String key, value;
-        bool empty = true;
-        bool hasValue = false;
-        bool fillingKey = true; // if filling key or value
-        char queryingType = 'i'; // can be 'n', 's' or 'p' (none, states, parameters)
 
-        char buffer[512], orig;
-        buffer[sizeof(buffer)-1] = '\xff';
+        std::vector<uint8_t> data;
+        StreamReader reader = { stream };
 
-        for (int32_t terminated = 0; terminated == 0;)
-        {
-            const int32_t read = stream->read(stream, buffer, sizeof(buffer)-1);
-            DISTRHO_SAFE_ASSERT_INT_RETURN(read >= 0, read, false);
-
-            if (read == 0)
-                return !empty;
-
-            empty = false;
-            for (int32_t i = 0; i < read; ++i)
-            {
-                // found terminator, stop here
-                if (buffer[i] == '\xfe')
-                {
-                    terminated = 1;
-                    break;
-                }
-
-                // store character at read position
-                orig = buffer[read];
-
-                // place null character to create valid string
-                buffer[read] = '\0';
-
-                // append to temporary vars
-                if (fillingKey)
-                {
-                    key += buffer + i;
-                }
-                else
-                {
-                    value += buffer + i;
-                    hasValue = true;
-                }
-
-                // increase buffer offset by length of string
-                i += std::strlen(buffer + i);
-
-                // restore read character
-                buffer[read] = orig;
-
-                // if buffer offset points to null, we found the end of a string, lets check
-                if (buffer[i] == '\0')
-                {
-                    // special keys
-                    if (key == "__dpf_state_begin__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'i' || queryingType == 'n',
-                                                       queryingType, false);
-                        queryingType = 's';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-                    if (key == "__dpf_state_end__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 's', queryingType, false);
-                        queryingType = 'n';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-                    if (key == "__dpf_parameters_begin__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'i' || queryingType == 'n',
-                                                       queryingType, false);
-                        queryingType = 'p';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-                    if (key == "__dpf_parameters_end__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'p', queryingType, false);
-                        queryingType = 'x';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-
-                    // no special key, swap between reading real key and value
-                    fillingKey = !fillingKey;
-
-                    // if there is no value yet keep reading until we have one
-                    if (! hasValue)
-                        continue;
-
-                    if (key == "__dpf_program__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'i', queryingType, false);
-                        queryingType = 'n';
-
-                        d_debug("found program '%s'", value.buffer());
-
-                      #if DISTRHO_PLUGIN_WANT_PROGRAMS
-                        const int program = std::atoi(value.buffer());
-                        DISTRHO_SAFE_ASSERT_CONTINUE(program >= 0);
+        if (! d_readStateChunk(reader, data))
+            return false;
 
-                        fCurrentProgram = static_cast<uint32_t>(program);
-                        fPlugin.loadProgram(fCurrentProgram);
+        StateChunkReader chunk(data.data(), data.size());
+        DISTRHO_SAFE_ASSERT_RETURN(chunk.isValid(), false);
 
-                       #if DISTRHO_PLUGIN_HAS_UI
-                        if (ui != nullptr)
-                            ui->setProgramFromPlugin(fCurrentProgram);
-                       #endif
-                      #endif
-                    }
-                    else if (queryingType == 's')
-                    {
-                        d_debug("found state '%s' '%s'", key.buffer(), value.buffer());
+       #if DISTRHO_PLUGIN_WANT_PROGRAMS
+        if (chunk.getProgram() >= 0 && static_cast<uint32_t>(chunk.getProgram()) < fPlugin.getProgramCount())
+        {
+            d_debug("found program '%d'", chunk.getProgram());
 
-                       #if DISTRHO_PLUGIN_WANT_STATE
-                        if (fPlugin.wantStateKey(key))
-                        {
-                            fStateMap[key] = value;
-                            fPlugin.setState(key, value);
+            fCurrentProgram = static_cast<uint32_t>(chunk.getProgram());
+            fPlugin.loadProgram(fCurrentProgram);
 
-                           #if DISTRHO_PLUGIN_HAS_UI
-                            if (ui != nullptr)
-                                ui->setStateFromPlugin(key, value);
-                           #endif
-                        }
-                       #endif
-                    }
-                    else if (queryingType == 'p')
-                    {
-                        d_debug("found parameter '%s' '%s'", key.buffer(), value.buffer());
-                        float fvalue;
+           #if DISTRHO_PLUGIN_HAS_UI
+            if (ui != nullptr)
+                ui->setProgramFromPlugin(fCurrentProgram);
+           #endif
+        }
+       #endif
 
-                        // find parameter with this symbol, and set its value
-                        for (uint32_t j=0; j<fCachedParameters.numParams; ++j)
-                        {
-                            if (fPlugin.isParameterOutputOrTrigger(j))
-                                continue;
-                            if (fPlugin.getParameterSymbol(j) != key)
-                                continue;
-
-                            if (fPlugin.getParameterHints(j) & kParameterIsInteger)
-                            {
-                                fvalue = std::atoi(value.buffer());
-                            }
-                            else
-                            {
-                                const ScopedSafeLocale ssl;
-                                fvalue = std::atof(value.buffer());
-                            }
-
-                            fCachedParameters.values[j] = fvalue;
-                           #if DISTRHO_PLUGIN_HAS_UI
-                            if (ui != nullptr)
-                            {
-                                // UI parameter updates are handled outside the read loop (after host param restart)
-                                fCachedParameters.changed[j] = true;
-                            }
-                           #endif
-                            fPlugin.setParameterValue(j, fvalue);
-                            break;
-                        }
-                    }
+       #if DISTRHO_PLUGIN_WANT_STATE
+        for (const char *key, *value; chunk.readNextState(key, value);)
+        {
+            d_debug("found state '%s' '%s'", key, value);
 
-                    key.clear();
-                    value.clear();
-                    hasValue = false;
-                }
+            if (fPlugin.wantStateKey(key))
+            {
+                const String dkey(key);
+                fStateMap[dkey] = value;
+                fPlugin.setState(key, value);
+
+               #if DISTRHO_PLUGIN_HAS_UI
+                if (ui != nullptr)
+                    ui->setStateFromPlugin(key, value);
+               #endif
             }
         }
+       #endif
+
+        uint32_t symbolHash, index;
+        for (float fvalue; chunk.readNextParameter(symbolHash, fvalue);)
+        {
+            // UI parameter updates are handled outside the read loop (after host param restart)
+            if (fPlugin.findParameterBySymbolHash(symbolHash, index))
+                fPlugin.setParameterValue(index, fvalue);
+        }
 
         if (fHostExtensions.params != nullptr)
             fHostExtensions.params->rescan(fHost, CLAP_PARAM_RESCAN_VALUES|CLAP_PARAM_RESCAN_TEXT);
@@ -1717,12 +1745,14 @@ public:
        #if DISTRHO_PLUGIN_HAS_UI
         if (ui != nullptr)
         {
-            for (uint32_t i=0; i<fCachedParameters.numParams; ++i)
+            ParameterStore& store(fPlugin.getParameterStore());
+
+            for (uint32_t i=0, count=store.getCount(); i<count; ++i)
             {
                 if (fPlugin.isParameterOutputOrTrigger(i))
                     continue;
-                fCachedParameters.changed[i] = false;
-                ui->setParameterValueFromPlugin(i, fCachedParameters.values[i]);
+                store.getChanges().take(i);
+                ui->setParameterValueFromPlugin(i, store.getValue(i));
             }
         }
        #endif
@@ -1795,6 +1825,14 @@ private:
    #if DISTRHO_PLUGIN_NUM_OUTPUTS != 0
     float* fAudioOutputs[DISTRHO_PLUGIN_NUM_OUTPUTS];
    #endif
+   #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+   #if DISTRHO_PLUGIN_NUM_INPUTS != 0
+    const double* fAudioInputs64[DISTRHO_PLUGIN_NUM_INPUTS];
+   #endif
+   #if DISTRHO_PLUGIN_NUM_OUTPUTS != 0
+    double* fAudioOutputs64[DISTRHO_PLUGIN_NUM_OUTPUTS];
+   #endif
+   #endif
    #if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS != 0
     bool fUsingCV;
    #endif
@@ -1802,9 +1840,10 @@ private:
     bool fLatencyChanged;
     uint32_t fLastKnownLatency;
    #endif
+    uint32_t fLastKnownTail;
+    bool fOfflineRenderingRequested;
   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-    uint32_t fMidiEventCount;
-    MidiEvent fMidiEvents[kMaxMidiEvents];
+    MidiEventArena& fMidiEvents;
    #if DISTRHO_PLUGIN_HAS_UI
     RingBufferControl<SmallStackBuffer> fNotesRingBuffer;
    #endif
@@ -1812,32 +1851,50 @@ private:
    #if DISTRHO_PLUGIN_WANT_TIMEPOS
     TimePosition fTimePosition;
    #endif
+   #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+    Plugin::ParallelTaskFunc fParallelTaskFunc;
+    void* fParallelTaskPtr;
+   #endif
 
     struct HostExtensions {
         const clap_host_t* const host;
         const clap_host_params_t* params;
+        const clap_host_tail_t* tail;
        #if DISTRHO_PLUGIN_WANT_LATENCY
         const clap_host_latency_t* latency;
         const clap_host_thread_check_t* threadCheck;
        #endif
+       #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+        const clap_host_thread_pool_t* threadPool;
+       #endif
 
         HostExtensions(const clap_host_t* const host)
             : host(host),
-              params(nullptr)
+              params(nullptr),
+              tail(nullptr)
            #if DISTRHO_PLUGIN_WANT_LATENCY
             , latency(nullptr)
             , threadCheck(nullptr)
            #endif
+           #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+            , threadPool(nullptr)
+           #endif
         {}
 
         bool init()
         {
             params = static_cast<const clap_host_params_t*>(host->get_extension(host, CLAP_EXT_PARAMS));
+            tail = static_cast<const clap_host_tail_t*>(host->get_extension(host, CLAP_EXT_TAIL));
            #if DISTRHO_PLUGIN_WANT_LATENCY
             DISTRHO_SAFE_ASSERT_RETURN(host->request_restart != nullptr, false);
             DISTRHO_SAFE_ASSERT_RETURN(host->request_callback != nullptr, false);
             latency = static_cast<const clap_host_latency_t*>(host->get_extension(host, CLAP_EXT_LATENCY));
             threadCheck = static_cast<const clap_host_thread_check_t*>(host->get_extension(host, CLAP_EXT_THREAD_CHECK));
+           #endif
+           #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+            threadPool = static_cast<const clap_host_thread_pool_t*>(host->get_extension(host, CLAP_EXT_THREAD_POOL));
+            if (threadPool != nullptr && threadPool->request_exec == nullptr)
+                threadPool = nullptr;
            #endif
             return true;
         }
@@ -2054,6 +2111,39 @@ private:
         return static_cast<PluginCLAP*>(ptr)->updateState(key, value);
     }
    #endif
+
+   #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+    bool parallelFor(const uint32_t taskCount, const Plugin::ParallelTaskFunc taskFunc, void* const taskPtr)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fHostExtensions.threadPool != nullptr, false);
+
+        fParallelTaskFunc = taskFunc;
+        fParallelTaskPtr = taskPtr;
+
+        // blocks until the host has run all tasks, or returns false if it rejects the request
+        const bool ok = fHostExtensions.threadPool->request_exec(fHost, taskCount);
+
+        fParallelTaskFunc = nullptr;
+        fParallelTaskPtr = nullptr;
+        return ok;
+    }
+
+    static bool parallelForCallback(void* const ptr,
+                                    const uint32_t taskCount,
+                                    const Plugin::ParallelTaskFunc taskFunc,
+                                    void* const taskPtr)
+    {
+        return static_cast<PluginCLAP*>(ptr)->parallelFor(taskCount, taskFunc, taskPtr);
+    }
+   #endif
+
+   #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+    static void stateLoadedCallback(void* const ptr)
+    {
+        const clap_host_t* const host = static_cast<PluginCLAP*>(ptr)->fHost;
+        host->request_callback(host);
+    }
+   #endif
 };
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -2363,6 +2453,53 @@ static const clap_plugin_params_t clap_plugin_params = {
     clap_plugin_params_flush
 };
 
+// --------------------------------------------------------------------------------------------------------------------
+// plugin render
+
+static bool CLAP_ABI clap_plugin_render_has_hard_realtime_requirement(const clap_plugin_t*)
+{
+    return false;
+}
+
+static bool CLAP_ABI clap_plugin_render_set(const clap_plugin_t* const plugin, const clap_plugin_render_mode mode)
+{
+    PluginCLAP* const instance = static_cast<PluginCLAP*>(plugin->plugin_data);
+    return instance->setRenderMode(mode);
+}
+
+static const clap_plugin_render_t clap_plugin_render = {
+    clap_plugin_render_has_hard_realtime_requirement,
+    clap_plugin_render_set
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// plugin tail
+
+static uint32_t CLAP_ABI clap_plugin_tail_get(const clap_plugin_t* const plugin)
+{
+    PluginCLAP* const instance = static_cast<PluginCLAP*>(plugin->plugin_data);
+    return instance->getTailLength();
+}
+
+static const clap_plugin_tail_t clap_plugin_tail = {
+    clap_plugin_tail_get
+};
+
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+// --------------------------------------------------------------------------------------------------------------------
+// plugin thread pool
+
+static void CLAP_ABI clap_plugin_thread_pool_exec(const clap_plugin_t* const plugin, const uint32_t task_index)
+{
+    PluginCLAP* const instance = static_cast<PluginCLAP*>(plugin->plugin_data);
+    instance->execParallelTask(task_index);
+}
+
+static const clap_plugin_thread_pool_t clap_plugin_thread_pool = {
+    clap_plugin_thread_pool_exec
+};
+#endif
+
 #if DISTRHO_PLUGIN_WANT_LATENCY
 // --------------------------------------------------------------------------------------------------------------------
 // plugin latency
@@ -2460,6 +2597,10 @@ static const void* CLAP_ABI clap_plugin_get_extension(const clap_plugin_t*, cons
         return &clap_plugin_params;
     if (std::strcmp(id, CLAP_EXT_STATE) == 0)
         return &clap_plugin_state;
+    if (std::strcmp(id, CLAP_EXT_TAIL) == 0)
+        return &clap_plugin_tail;
+    if (std::strcmp(id, CLAP_EXT_RENDER) == 0)
+        return &clap_plugin_render;
    #if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS != 0
     if (std::strcmp(id, CLAP_EXT_AUDIO_PORTS) == 0)
         return &clap_plugin_audio_ports;
@@ -2472,6 +2613,10 @@ static const void* CLAP_ABI clap_plugin_get_extension(const clap_plugin_t*, cons
     if (std::strcmp(id, CLAP_EXT_LATENCY) == 0)
         return &clap_plugin_latency;
    #endif
+   #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+    if (std::strcmp(id, CLAP_EXT_THREAD_POOL) == 0)
+        return &clap_plugin_thread_pool;
+   #endif
   #if DISTRHO_PLUGIN_HAS_UI
     if (std::strcmp(id, CLAP_EXT_GUI) == 0)
         return &clap_plugin_gui;
@@ -61,6 +61,14 @@
 # define DISTRHO_PLUGIN_IS_SYNTH 0
 #endif
 
+#ifndef DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+# define DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING 0
+#endif
+
+#ifndef DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+# define DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION 0
+#endif
+
 #ifndef DISTRHO_PLUGIN_WANT_DIRECT_ACCESS
 # define DISTRHO_PLUGIN_WANT_DIRECT_ACCESS 0
 #endif
@@ -77,10 +85,34 @@
 # define DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST 0
 #endif
 
+#ifndef DISTRHO_PLUGIN_MIDI_INPUT_EVENT_CAPACITY
+# define DISTRHO_PLUGIN_MIDI_INPUT_EVENT_CAPACITY 512
+#endif
+
+#ifndef DISTRHO_PLUGIN_MIDI_INPUT_SYSEX_CAPACITY
+# define DISTRHO_PLUGIN_MIDI_INPUT_SYSEX_CAPACITY 16384
+#endif
+
+#ifndef DISTRHO_PLUGIN_MIDI_OUTPUT_SCHEDULER_CAPACITY
+# define DISTRHO_PLUGIN_MIDI_OUTPUT_SCHEDULER_CAPACITY 512
+#endif
+
+#ifndef DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+# define DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING 0
+#endif
+
+#ifndef DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+# define DISTRHO_PLUGIN_WANT_PROCESSING_STATS 0
+#endif
+
 #ifndef DISTRHO_PLUGIN_WANT_PROGRAMS
 # define DISTRHO_PLUGIN_WANT_PROGRAMS 0
 #endif
 
+#ifndef DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+# define DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS 0
+#endif
+
 #ifndef DISTRHO_PLUGIN_WANT_STATE
 # define DISTRHO_PLUGIN_WANT_STATE 0
 #endif
@@ -137,6 +169,17 @@
 # define DISTRHO_PLUGIN_WANT_WEBVIEW 1
 #endif
 
+// --------------------------------------------------------------------------------------------------------------------
+// Define DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE if needed
+
+#ifndef DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE
+# define DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE 16
+#endif
+
+#if DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE < 1
+# error DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE must be at least 1
+#endif
+
 // --------------------------------------------------------------------------------------------------------------------
 // Define DISTRHO_UI_URI if needed
 
@@ -181,6 +224,13 @@
 # define DISTRHO_PLUGIN_WANT_FULL_STATE 1
 #endif
 
+// --------------------------------------------------------------------------------------------------------------------
+// Test if background state loading is used without state
+
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING && ! DISTRHO_PLUGIN_WANT_STATE
+# error Background state loading needs DISTRHO_PLUGIN_WANT_STATE enabled!
+#endif
+
 // --------------------------------------------------------------------------------------------------------------------
 // Disable file browser if using external UI
 
@@ -18,20 +18,98 @@
 #define DISTRHO_PLUGIN_INTERNAL_HPP_INCLUDED
 
 #include "../DistrhoPlugin.hpp"
+#include "../extra/BufferOps.hpp"
+#include "DistrhoPluginStateChunk.hpp"
 
 #ifdef DISTRHO_PLUGIN_TARGET_VST3
 # include "DistrhoPluginVST.hpp"
 #endif
 
+#include <new>
 #include <set>
 
+#ifdef DISTRHO_PROPER_CPP11_SUPPORT
+# include <atomic>
+#endif
+
+// -----------------------------------------------------------------------
+// Parallel processing falls back to serial execution where threads are not available
+
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING && defined(DISTRHO_PROPER_CPP11_SUPPORT) && !defined(DISTRHO_OS_WASM)
+# define DPF_PLUGIN_HAS_THREAD_POOL 1
+# include "../extra/ThreadPool.hpp"
+#else
+# define DPF_PLUGIN_HAS_THREAD_POOL 0
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+# include "../extra/Time.hpp"
+#endif
+
+// -----------------------------------------------------------------------
+// Background state loading falls back to loading within the caller where threads are not available
+
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING && defined(DISTRHO_PROPER_CPP11_SUPPORT) && !defined(DISTRHO_OS_WASM)
+# define DPF_PLUGIN_HAS_STATE_LOADER_THREAD 1
+# include "../extra/Thread.hpp"
+#else
+# define DPF_PLUGIN_HAS_STATE_LOADER_THREAD 0
+#endif
+
+// -----------------------------------------------------------------------
+// Real-time safety checks for selftest, relies on glibc symbol interposition
+
+#if defined(DPF_RUNTIME_TESTING) && defined(DISTRHO_PLUGIN_TARGET_JACK) && defined(__GLIBC__) && !defined(STATIC_BUILD)
+# define DPF_PLUGIN_HAS_REALTIME_CHECKS 1
+#else
+# define DPF_PLUGIN_HAS_REALTIME_CHECKS 0
+#endif
+
 START_NAMESPACE_DISTRHO
 
 // -----------------------------------------------------------------------
 // Maxmimum values
 
+// fixed-size host MIDI output lists, incoming MIDI uses MidiEventArena instead
 static const uint32_t kMaxMidiEvents = 512;
 
+#if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+static const uint32_t kMaxParameterChanges = 1024;
+#endif
+
+// -----------------------------------------------------------------------
+// Silence detection needs both audio inputs and outputs, and no MIDI input.
+// Plugins driven by MIDI can keep sounding long after the last event (held notes), there is no way to tell from here.
+
+#if DISTRHO_PLUGIN_NUM_INPUTS != 0 && DISTRHO_PLUGIN_NUM_OUTPUTS != 0 && ! DISTRHO_PLUGIN_WANT_MIDI_INPUT
+# define DPF_PLUGIN_HAS_SILENCE_DETECTION 1
+#else
+# define DPF_PLUGIN_HAS_SILENCE_DETECTION 0
+#endif
+
+#if DPF_PLUGIN_HAS_REALTIME_CHECKS
+// -----------------------------------------------------------------------
+// Marks the current thread as being inside PluginExporter::run(), see runSelfTests() in DistrhoPluginJACK.cpp
+
+struct ScopedRealtimeCheck {
+    ScopedRealtimeCheck() noexcept
+    {
+        ++getDepth();
+    }
+
+    ~ScopedRealtimeCheck() noexcept
+    {
+        --getDepth();
+    }
+
+    static uint32_t& getDepth() noexcept
+    {
+        static __thread uint32_t depth = 0;
+        return depth;
+    }
+};
+#endif
+
 // -----------------------------------------------------------------------
 // Static data, see DistrhoPlugin.cpp
 
@@ -48,6 +126,13 @@ extern bool        d_nextCanRequestParameterValueChanges;
 typedef bool (*writeMidiFunc) (void* ptr, const MidiEvent& midiEvent);
 typedef bool (*requestParameterValueChangeFunc) (void* ptr, uint32_t index, float value);
 typedef bool (*updateStateValueFunc) (void* ptr, const char* key, const char* value);
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+typedef bool (*parallelForFunc) (void* ptr, uint32_t taskCount, Plugin::ParallelTaskFunc taskFunc, void* taskPtr);
+#endif
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+typedef StateObject* (*loadStateObjectFunc) (void* ptr, uint32_t index, const char* value);
+typedef void (*stateLoadedFunc) (void* ptr);
+#endif
 
 // -----------------------------------------------------------------------
 // Helpers
@@ -68,6 +153,100 @@ struct PortGroupWithId : PortGroup {
           groupId(kPortGroupNone) {}
 };
 
+struct ParameterIndexList {
+    const uint32_t* indices;
+    uint32_t count;
+};
+
+static const uint32_t kNoSmoothedParameterSlot = (uint32_t)-1;
+
+struct SmoothedParameter {
+    uint32_t index;
+    uint32_t rampFrames;
+    uint32_t remainingFrames;
+    float current;
+    float target;
+    float step;
+    float* buffer;
+    bool constant;
+    bool bufferIsFilled;
+
+    void setTarget(const float value) noexcept
+    {
+        if (d_isEqual(target, value))
+            return;
+
+        target = value;
+
+        if (rampFrames == 0)
+        {
+            current = value;
+            remainingFrames = 0;
+            bufferIsFilled = false;
+            return;
+        }
+
+        // restart a linear ramp from the current value for the full smoothing time
+        remainingFrames = rampFrames;
+        step = (target - current) / static_cast<float>(rampFrames);
+    }
+
+    void clearToTarget() noexcept
+    {
+        current = target;
+        remainingFrames = 0;
+        bufferIsFilled = false;
+    }
+
+    void process(const uint32_t frames, const uint32_t bufferSize) noexcept
+    {
+        if (remainingFrames == 0)
+        {
+            constant = true;
+
+            // buffer only needs to be filled once while the value is not moving
+            if (! bufferIsFilled)
+            {
+                std::fill(buffer, buffer + bufferSize, target);
+                bufferIsFilled = true;
+            }
+            return;
+        }
+
+        const uint32_t rampFramesNow = std::min(frames, remainingFrames);
+        const float start = current;
+        const float rampStep = step;
+
+        // no dependency between iterations, so this can be vectorized
+        for (uint32_t i = 0; i < rampFramesNow; ++i)
+            buffer[i] = start + rampStep * static_cast<float>(i + 1);
+
+        remainingFrames -= rampFramesNow;
+
+        if (remainingFrames == 0)
+        {
+            // land exactly on target, without accumulated rounding errors
+            std::fill(buffer + rampFramesNow - 1, buffer + frames, target);
+            current = target;
+        }
+        else
+        {
+            current = buffer[rampFramesNow - 1];
+        }
+
+        constant = false;
+        bufferIsFilled = false;
+    }
+};
+
+#if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+struct ParameterChange {
+    uint32_t frame;
+    uint32_t index;
+    float value;
+};
+#endif
+
 static inline
 void fillInPredefinedPortGroupData(const uint32_t groupId, PortGroup& portGroup)
 {
@@ -104,6 +283,31 @@ void d_strncpy(char* const dst, const char* const src, const size_t length)
     }
 }
 
+template<typename T>
+static inline
+bool isBufferSilent(const T* const buffer, const uint32_t frames) noexcept
+{
+    // check in small fixed-size chunks without branching, so the compiler can vectorize the inner loop
+    uint32_t i = 0;
+
+    for (; i + 16 <= frames; i += 16)
+    {
+        bool nonZero = false;
+        for (uint32_t j = 0; j < 16; ++j)
+            nonZero |= buffer[i + j] != 0;
+        if (nonZero)
+            return false;
+    }
+
+    for (; i < frames; ++i)
+    {
+        if (buffer[i] != 0)
+            return false;
+    }
+
+    return true;
+}
+
 template<typename T>
 static inline
 void snprintf_t(char* const dst, const T value, const char* const format, const size_t size)
@@ -138,937 +342,2983 @@ void snprintf_u32(char* const dst, const uint32_t value, const size_t size)
 }
 
 // -----------------------------------------------------------------------
-// Plugin private data
-
-struct Plugin::PrivateData {
-    const bool canRequestParameterValueChanges;
-    const bool isDummy;
-    const bool isSelfTest;
-    bool isProcessing;
-
-#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-    AudioPortWithBusId* audioPorts;
-#endif
-
-    uint32_t   parameterCount;
-    uint32_t   parameterOffset;
-    Parameter* parameters;
-
-    uint32_t         portGroupCount;
-    PortGroupWithId* portGroups;
+// Atomic 32-bit words, used by the parameter store and bitset below
 
-#if DISTRHO_PLUGIN_WANT_PROGRAMS
-    uint32_t programCount;
-    String*  programNames;
+#ifdef DISTRHO_PROPER_CPP11_SUPPORT
+typedef std::atomic<uint32_t> AtomicWord;
+#else
+typedef volatile uint32_t AtomicWord;
 #endif
 
-#if DISTRHO_PLUGIN_WANT_STATE
-    uint32_t stateCount;
-    State*   states;
-#endif
+struct AtomicWordOps {
+    static void init(AtomicWord* const words, const uint32_t count) noexcept
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+           #ifdef DISTRHO_PROPER_CPP11_SUPPORT
+            new (&words[i]) AtomicWord(0);
+           #else
+            words[i] = 0;
+           #endif
+        }
+    }
 
-#if DISTRHO_PLUGIN_WANT_LATENCY
-    uint32_t latency;
-#endif
+   #ifdef DISTRHO_PROPER_CPP11_SUPPORT
+    static uint32_t load(const AtomicWord& word) noexcept
+    {
+        return word.load(std::memory_order_acquire);
+    }
 
-#if DISTRHO_PLUGIN_WANT_TIMEPOS
-    TimePosition timePosition;
-#endif
+    static void store(AtomicWord& word, const uint32_t value) noexcept
+    {
+        word.store(value, std::memory_order_release);
+    }
 
-    // Callbacks
-    void*         callbacksPtr;
-    writeMidiFunc writeMidiCallbackFunc;
-    requestParameterValueChangeFunc requestParameterValueChangeCallbackFunc;
-    updateStateValueFunc updateStateValueCallbackFunc;
+    static void increment(AtomicWord& word) noexcept
+    {
+        word.fetch_add(1, std::memory_order_release);
+    }
 
-    uint32_t bufferSize;
-    double   sampleRate;
-    char*    bundlePath;
+    static uint32_t fetchOr(AtomicWord& word, const uint32_t bits) noexcept
+    {
+        return word.fetch_or(bits, std::memory_order_acq_rel);
+    }
 
-    PrivateData() noexcept
-        : canRequestParameterValueChanges(d_nextCanRequestParameterValueChanges),
-          isDummy(d_nextPluginIsDummy),
-          isSelfTest(d_nextPluginIsSelfTest),
-          isProcessing(false),
-#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-          audioPorts(nullptr),
-#endif
-          parameterCount(0),
-          parameterOffset(0),
-          parameters(nullptr),
-          portGroupCount(0),
-          portGroups(nullptr),
-#if DISTRHO_PLUGIN_WANT_PROGRAMS
-          programCount(0),
-          programNames(nullptr),
-#endif
-#if DISTRHO_PLUGIN_WANT_STATE
-          stateCount(0),
-          states(nullptr),
-#endif
-#if DISTRHO_PLUGIN_WANT_LATENCY
-          latency(0),
-#endif
-          callbacksPtr(nullptr),
-          writeMidiCallbackFunc(nullptr),
-          requestParameterValueChangeCallbackFunc(nullptr),
-          updateStateValueCallbackFunc(nullptr),
-          bufferSize(d_nextBufferSize),
-          sampleRate(d_nextSampleRate),
-          bundlePath(d_nextBundlePath != nullptr ? strdup(d_nextBundlePath) : nullptr)
+    static uint32_t fetchAnd(AtomicWord& word, const uint32_t bits) noexcept
     {
-        DISTRHO_SAFE_ASSERT(bufferSize != 0);
-        DISTRHO_SAFE_ASSERT(d_isNotZero(sampleRate));
+        return word.fetch_and(bits, std::memory_order_acq_rel);
+    }
 
-#if defined(DISTRHO_PLUGIN_TARGET_DSSI) || defined(DISTRHO_PLUGIN_TARGET_LV2)
-        parameterOffset += DISTRHO_PLUGIN_NUM_INPUTS + DISTRHO_PLUGIN_NUM_OUTPUTS;
-# if DISTRHO_PLUGIN_WANT_LATENCY
-        parameterOffset += 1;
-# endif
-#endif
+    static uint32_t exchange(AtomicWord& word, const uint32_t value) noexcept
+    {
+        return word.exchange(value, std::memory_order_acq_rel);
+    }
+   #else
+    static uint32_t load(const AtomicWord& word) noexcept
+    {
+        return __atomic_load_n(&word, __ATOMIC_ACQUIRE);
+    }
 
-#ifdef DISTRHO_PLUGIN_TARGET_LV2
-# if (DISTRHO_PLUGIN_WANT_MIDI_INPUT || DISTRHO_PLUGIN_WANT_STATE || DISTRHO_PLUGIN_WANT_TIMEPOS)
-        parameterOffset += 1;
-# endif
-# if (DISTRHO_PLUGIN_WANT_MIDI_OUTPUT || DISTRHO_PLUGIN_WANT_STATE)
-        parameterOffset += 1;
-# endif
-#endif
+    static void store(AtomicWord& word, const uint32_t value) noexcept
+    {
+        __atomic_store_n(&word, value, __ATOMIC_RELEASE);
+    }
 
-#ifdef DISTRHO_PLUGIN_TARGET_VST3
-        parameterOffset += kVst3InternalParameterCount;
-#endif
+    static void increment(AtomicWord& word) noexcept
+    {
+        __atomic_fetch_add(&word, 1, __ATOMIC_RELEASE);
     }
 
-    ~PrivateData() noexcept
+    static uint32_t fetchOr(AtomicWord& word, const uint32_t bits) noexcept
     {
-#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-        if (audioPorts != nullptr)
-        {
-            delete[] audioPorts;
-            audioPorts = nullptr;
-        }
-#endif
+        return __atomic_fetch_or(&word, bits, __ATOMIC_ACQ_REL);
+    }
 
-        if (parameters != nullptr)
-        {
-            delete[] parameters;
-            parameters = nullptr;
-        }
+    static uint32_t fetchAnd(AtomicWord& word, const uint32_t bits) noexcept
+    {
+        return __atomic_fetch_and(&word, bits, __ATOMIC_ACQ_REL);
+    }
 
-        if (portGroups != nullptr)
-        {
-            delete[] portGroups;
-            portGroups = nullptr;
-        }
+    static uint32_t exchange(AtomicWord& word, const uint32_t value) noexcept
+    {
+        return __atomic_exchange_n(&word, value, __ATOMIC_ACQ_REL);
+    }
+   #endif
+};
 
-#if DISTRHO_PLUGIN_WANT_PROGRAMS
-        if (programNames != nullptr)
-        {
-            delete[] programNames;
-            programNames = nullptr;
-        }
-#endif
+// -----------------------------------------------------------------------
+// Lock-free bitset of parameter indices, used for change tracking
+//
+// Flagged indices are consumed one word at a time, so the cost of a scan depends on the number of set bits:
+//   for (uint32_t w = 0; w < bitset.getWordCount(); ++w)
+//       for (uint32_t bits = bitset.takeWord(w); bits != 0;)
+//           handle(w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits));
+
+class ParameterBitset
+{
+public:
+    static const uint32_t kBitsPerWord = 32;
 
-#if DISTRHO_PLUGIN_WANT_STATE
-        if (states != nullptr)
-        {
-            delete[] states;
-            states = nullptr;
-        }
-#endif
+    ParameterBitset() noexcept
+        : fCount(0),
+          fWordCount(0),
+          fWords(nullptr) {}
 
-        if (bundlePath != nullptr)
-        {
-            std::free(bundlePath);
-            bundlePath = nullptr;
-        }
+    ~ParameterBitset() noexcept
+    {
+        delete[] fWords;
     }
 
-#if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
-    bool writeMidiCallback(const MidiEvent& midiEvent)
+    void init(const uint32_t count)
     {
-        if (writeMidiCallbackFunc != nullptr)
-            return writeMidiCallbackFunc(callbacksPtr, midiEvent);
+        DISTRHO_SAFE_ASSERT_RETURN(fWords == nullptr,);
 
-        return false;
+        if (count == 0)
+            return;
+
+        fCount = count;
+        fWordCount = (count + kBitsPerWord - 1) / kBitsPerWord;
+        fWords = new AtomicWord[fWordCount];
+        AtomicWordOps::init(fWords, fWordCount);
     }
-#endif
 
-#if DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST
-    bool requestParameterValueChangeCallback(const uint32_t index, const float value)
+    uint32_t getCount() const noexcept
     {
-        if (requestParameterValueChangeCallbackFunc != nullptr)
-            return requestParameterValueChangeCallbackFunc(callbacksPtr, index, value);
+        return fCount;
+    }
 
-        return false;
+    uint32_t getWordCount() const noexcept
+    {
+        return fWordCount;
     }
-#endif
 
-#if DISTRHO_PLUGIN_WANT_STATE
-    bool updateStateValueCallback(const char* const key, const char* const value)
+    void set(const uint32_t index) noexcept
     {
-        d_stdout("updateStateValueCallback %p", updateStateValueCallbackFunc);
-        if (updateStateValueCallbackFunc != nullptr)
-            return updateStateValueCallbackFunc(callbacksPtr, key, value);
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount,);
 
-        return false;
+        AtomicWordOps::fetchOr(fWords[index / kBitsPerWord], 1U << (index % kBitsPerWord));
     }
-#endif
-};
 
-// -----------------------------------------------------------------------
-// Plugin exporter class
+    bool test(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount, false);
 
-class PluginExporter
-{
-public:
-    PluginExporter(void* const callbacksPtr,
-                   const writeMidiFunc writeMidiCall,
-                   const requestParameterValueChangeFunc requestParameterValueChangeCall,
-                   const updateStateValueFunc updateStateValueCall)
-        : fPlugin(createPlugin()),
-          fData((fPlugin != nullptr) ? fPlugin->pData : nullptr),
-          fIsActive(false)
+        return (AtomicWordOps::load(fWords[index / kBitsPerWord]) & (1U << (index % kBitsPerWord))) != 0;
+    }
+
+    // Clear a single bit, returning its previous state.
+    bool take(const uint32_t index) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount, false);
 
-#if defined(DPF_RUNTIME_TESTING) && defined(__GNUC__) && !defined(__clang__)
-        /* Run-time testing build.
-         * Verify that virtual functions are overriden if parameters, programs or states are in use.
-         * This does not work on all compilers, but we use it purely as informational check anyway. */
-        if (fData->parameterCount != 0)
-        {
-            if ((void*)(fPlugin->*(&Plugin::initParameter)) == (void*)&Plugin::initParameter)
-            {
-                d_stderr2("DPF warning: Plugins with parameters must implement `initParameter`");
-                abort();
-            }
-            if ((void*)(fPlugin->*(&Plugin::getParameterValue)) == (void*)&Plugin::getParameterValue)
-            {
-                d_stderr2("DPF warning: Plugins with parameters must implement `getParameterValue`");
-                abort();
-            }
-            if ((void*)(fPlugin->*(&Plugin::setParameterValue)) == (void*)&Plugin::setParameterValue)
-            {
-                d_stderr2("DPF warning: Plugins with parameters must implement `setParameterValue`");
-                abort();
-            }
-        }
+        const uint32_t bit = 1U << (index % kBitsPerWord);
+        return (AtomicWordOps::fetchAnd(fWords[index / kBitsPerWord], ~bit) & bit) != 0;
+    }
 
-# if DISTRHO_PLUGIN_WANT_PROGRAMS
-        if (fData->programCount != 0)
-        {
-            if ((void*)(fPlugin->*(&Plugin::initProgramName)) == (void*)&Plugin::initProgramName)
-            {
-                d_stderr2("DPF warning: Plugins with programs must implement `initProgramName`");
-                abort();
-            }
-            if ((void*)(fPlugin->*(&Plugin::loadProgram)) == (void*)&Plugin::loadProgram)
-            {
-                d_stderr2("DPF warning: Plugins with programs must implement `loadProgram`");
-                abort();
-            }
-        }
-# endif
+    // Clear a whole word, returning its previous bits.
+    uint32_t takeWord(const uint32_t wordIndex) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(wordIndex < fWordCount, wordIndex, fWordCount, 0);
 
-# if DISTRHO_PLUGIN_WANT_STATE
-        if (fData->stateCount != 0)
-        {
-            if ((void*)(fPlugin->*(static_cast<void(Plugin::*)(uint32_t,State&)>(&Plugin::initState))) ==
-                (void*)static_cast<void(Plugin::*)(uint32_t,State&)>(&Plugin::initState))
-            {
-                d_stderr2("DPF warning: Plugins with state must implement `initState`");
-                abort();
-            }
+        return AtomicWordOps::exchange(fWords[wordIndex], 0);
+    }
 
-            if ((void*)(fPlugin->*(&Plugin::setState)) == (void*)&Plugin::setState)
-            {
-                d_stderr2("DPF warning: Plugins with state must implement `setState`");
-                abort();
-            }
-        }
-# endif
+    // Set bits again, for when a taken word could not be fully handled.
+    void restoreWord(const uint32_t wordIndex, const uint32_t bits) noexcept
+    {
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(wordIndex < fWordCount, wordIndex, fWordCount,);
 
-# if DISTRHO_PLUGIN_WANT_FULL_STATE
-        if (fData->stateCount != 0)
-        {
-            if ((void*)(fPlugin->*(&Plugin::getState)) == (void*)&Plugin::getState)
-            {
-                d_stderr2("DPF warning: Plugins with full state must implement `getState`");
-                abort();
-            }
-        }
-        else
-        {
-            d_stderr2("DPF warning: Plugins with full state must have at least 1 state");
-            abort();
-        }
-# endif
-#endif
+        AtomicWordOps::fetchOr(fWords[wordIndex], bits);
+    }
 
-#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-        {
-            uint32_t j=0;
-# if DISTRHO_PLUGIN_NUM_INPUTS > 0
-            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_INPUTS; ++i, ++j)
-                fPlugin->initAudioPort(true, i, fData->audioPorts[j]);
-# endif
-# if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_OUTPUTS; ++i, ++j)
-                fPlugin->initAudioPort(false, i, fData->audioPorts[j]);
-# endif
-        }
-#endif // DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+    void clear() noexcept
+    {
+        for (uint32_t i = 0; i < fWordCount; ++i)
+            AtomicWordOps::store(fWords[i], 0);
+    }
 
-        for (uint32_t i=0, count=fData->parameterCount; i < count; ++i)
-            fPlugin->initParameter(i, fData->parameters[i]);
+    static uint32_t popLowestBit(uint32_t& bits) noexcept
+    {
+       #ifdef __GNUC__
+        const uint32_t bit = static_cast<uint32_t>(__builtin_ctz(bits));
+       #else
+        uint32_t bit = 0;
+        while ((bits & (1U << bit)) == 0)
+            ++bit;
+       #endif
+        bits &= bits - 1;
+        return bit;
+    }
 
-        {
-            std::set<uint32_t> portGroupIndices;
+private:
+    uint32_t fCount;
+    uint32_t fWordCount;
+    AtomicWord* fWords;
 
-#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
-                portGroupIndices.insert(fData->audioPorts[i].groupId);
-#endif
-            for (uint32_t i=0, count=fData->parameterCount; i < count; ++i)
-                portGroupIndices.insert(fData->parameters[i].groupId);
+    DISTRHO_DECLARE_NON_COPYABLE(ParameterBitset)
+};
 
-            portGroupIndices.erase(kPortGroupNone);
+// -----------------------------------------------------------------------
+// Parameter store, shared by DSP, UI and host threads without locks
+//
+// Values and generation counters are kept in separate cache-aligned arrays, with changes flagged in a bitset,
+// so wrappers can cheaply diff against the last known values and only visit parameters that actually changed.
 
-            if (const uint32_t portGroupSize = static_cast<uint32_t>(portGroupIndices.size()))
-            {
-                fData->portGroups = new PortGroupWithId[portGroupSize];
-                fData->portGroupCount = portGroupSize;
+class ParameterStore
+{
+public:
+    static const uint32_t kCacheLineSize = 64;
 
-                uint32_t index = 0;
-                for (std::set<uint32_t>::iterator it = portGroupIndices.begin(); it != portGroupIndices.end(); ++it, ++index)
-                {
-                    PortGroupWithId& portGroup(fData->portGroups[index]);
-                    portGroup.groupId = *it;
+    ParameterStore() noexcept
+        : fCount(0),
+          fMemory(nullptr),
+          fValues(nullptr),
+          fGenerations(nullptr),
+          fChanged() {}
 
-                    if (portGroup.groupId < portGroupSize)
-                        fPlugin->initPortGroup(portGroup.groupId, portGroup);
-                    else
-                        fillInPredefinedPortGroupData(portGroup.groupId, portGroup);
-                }
-            }
-        }
+    ~ParameterStore() noexcept
+    {
+        delete[] fMemory;
+    }
 
-#if DISTRHO_PLUGIN_WANT_PROGRAMS
-        for (uint32_t i=0, count=fData->programCount; i < count; ++i)
-            fPlugin->initProgramName(i, fData->programNames[i]);
-#endif
+    void init(const uint32_t count)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fMemory == nullptr,);
 
-#if DISTRHO_PLUGIN_WANT_STATE
-        for (uint32_t i=0, count=fData->stateCount; i < count; ++i)
-            fPlugin->initState(i, fData->states[i]);
-#endif
+        if (count == 0)
+            return;
 
-        fData->callbacksPtr = callbacksPtr;
-        fData->writeMidiCallbackFunc = writeMidiCall;
-        fData->requestParameterValueChangeCallbackFunc = requestParameterValueChangeCall;
-        fData->updateStateValueCallbackFunc = updateStateValueCall;
+        const std::size_t arraySize = (sizeof(AtomicWord) * count + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+
+        fMemory = new uint8_t[arraySize * 2 + kCacheLineSize - 1];
+
+        uint8_t* const ptr = fMemory + (kCacheLineSize - reinterpret_cast<uintptr_t>(fMemory) % kCacheLineSize) % kCacheLineSize;
+        fValues = reinterpret_cast<AtomicWord*>(ptr);
+        fGenerations = reinterpret_cast<AtomicWord*>(ptr + arraySize);
+        AtomicWordOps::init(fValues, count);
+        AtomicWordOps::init(fGenerations, count);
+
+        fChanged.init(count);
+        fCount = count;
     }
 
-    ~PluginExporter()
+    uint32_t getCount() const noexcept
     {
-        delete fPlugin;
+        return fCount;
     }
 
-    // -------------------------------------------------------------------
-
-    const char* getName() const noexcept
+    float getValue(const uint32_t index) const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount, 0.0f);
 
-        return fPlugin->getName();
+        const uint32_t bits = AtomicWordOps::load(fValues[index]);
+        float value;
+        std::memcpy(&value, &bits, sizeof(float));
+        return value;
     }
 
-    const char* getLabel() const noexcept
+    // Store a new value and bump its generation, optionally flagging it as changed.
+    void setValue(const uint32_t index, const float value, const bool markAsChanged) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount,);
 
-        return fPlugin->getLabel();
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(float));
+        AtomicWordOps::store(fValues[index], bits);
+        AtomicWordOps::increment(fGenerations[index]);
+
+        if (markAsChanged)
+            fChanged.set(index);
     }
 
-    const char* getDescription() const noexcept
+    // Same as setValue, but only if different from the stored value. Returns true if the value was updated.
+    bool updateValue(const uint32_t index, const float value, const bool markAsChanged) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+        if (d_isEqual(getValue(index), value))
+            return false;
 
-        return fPlugin->getDescription();
+        setValue(index, value, markAsChanged);
+        return true;
     }
 
-    const char* getMaker() const noexcept
+    uint32_t getGeneration(const uint32_t index) const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount, 0);
 
-        return fPlugin->getMaker();
+        return AtomicWordOps::load(fGenerations[index]);
     }
 
-    const char* getHomePage() const noexcept
+    // Parameters flagged as changed, see ParameterBitset for how to consume them.
+    ParameterBitset& getChanges() noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+        return fChanged;
+    }
 
-        return fPlugin->getHomePage();
+private:
+    uint32_t fCount;
+    uint8_t* fMemory;
+    AtomicWord* fValues;
+    AtomicWord* fGenerations;
+    ParameterBitset fChanged;
+
+    DISTRHO_DECLARE_NON_COPYABLE(ParameterStore)
+};
+
+// -----------------------------------------------------------------------
+// Per-instance storage for incoming MIDI events and their SysEx payloads.
+// Memory is only allocated in reserve(), appending is realtime-safe and counts events that do not fit.
+
+class MidiEventArena
+{
+public:
+    static const uint32_t kMaxEventCapacity = 65536;
+    static const uint32_t kMaxSysexCapacity = 1024 * 1024;
+
+    MidiEventArena() noexcept
+        : fEvents(nullptr),
+          fSortBuffer(nullptr),
+          fEventCapacity(0),
+          fEventCount(0),
+          fIsSorted(true),
+          fSysexData(nullptr),
+          fSysexCapacity(0),
+          fSysexUsed(0),
+          fOverflowCount(0),
+          fEventsOverflowed(false),
+          fSysexOverflowed(false) {}
+
+    ~MidiEventArena() noexcept
+    {
+        delete[] fEvents;
+        delete[] fSortBuffer;
+        delete[] fSysexData;
+    }
+
+    // Make room for at least the requested amount of events and SysEx bytes.
+    // Storage that overflowed since the last call is doubled, so the arena grows with what the host sends.
+    // This allocates memory and must not be called while processing.
+    void reserve(uint32_t eventCapacity, uint32_t sysexCapacity)
+    {
+        if (fEventsOverflowed && eventCapacity < fEventCapacity * 2)
+            eventCapacity = fEventCapacity * 2;
+        if (fSysexOverflowed && sysexCapacity < fSysexCapacity * 2)
+            sysexCapacity = fSysexCapacity * 2;
+
+        if (eventCapacity > kMaxEventCapacity)
+            eventCapacity = kMaxEventCapacity;
+        if (sysexCapacity > kMaxSysexCapacity)
+            sysexCapacity = kMaxSysexCapacity;
+
+        if (eventCapacity > fEventCapacity)
+        {
+            delete[] fEvents;
+            delete[] fSortBuffer;
+            fEvents = new MidiEvent[eventCapacity];
+            fSortBuffer = new MidiEvent[eventCapacity];
+            fEventCapacity = eventCapacity;
+        }
+
+        if (sysexCapacity > fSysexCapacity)
+        {
+            delete[] fSysexData;
+            fSysexData = new uint8_t[sysexCapacity];
+            fSysexCapacity = sysexCapacity;
+        }
+
+        fEventCount = fSysexUsed = 0;
+        fOverflowCount = 0;
+        fEventsOverflowed = fSysexOverflowed = false;
+        fIsSorted = true;
     }
 
-    const char* getLicense() const noexcept
+    // Remove all events, to be called at the start of each block.
+    void clear() noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
-
-        return fPlugin->getLicense();
+        fEventCount = fSysexUsed = 0;
+        fIsSorted = true;
     }
 
-    uint32_t getVersion() const noexcept
+    // Get the events sorted by frame, events on the same frame keep the order in which they were appended.
+    // Hosts usually deliver events in order, in which case no sorting takes place.
+    const MidiEvent* getSortedEvents() noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0);
+        if (! fIsSorted)
+        {
+            sortByFrame();
+            fIsSorted = true;
+        }
 
-        return fPlugin->getVersion();
+        return fEvents;
     }
 
-    long getUniqueId() const noexcept
+    uint32_t getCount() const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0);
+        return fEventCount;
+    }
 
-        return fPlugin->getUniqueId();
+    uint32_t getCapacity() const noexcept
+    {
+        return fEventCapacity;
     }
 
-    void* getInstancePointer() const noexcept
+    bool isFull() const noexcept
     {
-        return fPlugin;
+        return fEventCount == fEventCapacity;
     }
 
-    // -------------------------------------------------------------------
+    // Frame of the last appended event, or 0 if empty.
+    uint32_t getLastFrame() const noexcept
+    {
+        return fEventCount != 0 ? fEvents[fEventCount - 1].frame : 0;
+    }
 
-#if DISTRHO_PLUGIN_WANT_LATENCY
-    uint32_t getLatency() const noexcept
+    // Get a new short event to be filled in by the caller, or null if full.
+    MidiEvent* append(const uint32_t frame) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+        if (fEventCount == fEventCapacity)
+        {
+            addOverflow(1);
+            return nullptr;
+        }
 
-        return fData->latency;
+        if (fEventCount != 0 && frame < fEvents[fEventCount - 1].frame)
+            fIsSorted = false;
+
+        MidiEvent& midiEvent(fEvents[fEventCount++]);
+        midiEvent.frame = frame;
+        midiEvent.size = 0;
+        std::memset(midiEvent.data, 0, MidiEvent::kDataSize);
+        midiEvent.dataExt = nullptr;
+        return &midiEvent;
     }
-#endif
 
-#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-    AudioPortWithBusId& getAudioPort(const bool input, const uint32_t index) const noexcept
+    // Copy a raw MIDI message, data larger than MidiEvent::kDataSize is stored in the SysEx pool.
+    bool append(const uint32_t frame, const uint8_t* const data, const uint32_t size) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, sFallbackAudioPort);
+        DISTRHO_SAFE_ASSERT_RETURN(data != nullptr && size != 0, false);
 
-        if (input)
+        if (size > MidiEvent::kDataSize && fSysexCapacity - fSysexUsed < size)
         {
-# if DISTRHO_PLUGIN_NUM_INPUTS > 0
-            DISTRHO_SAFE_ASSERT_RETURN(index < DISTRHO_PLUGIN_NUM_INPUTS,  sFallbackAudioPort);
-# endif
+            ++fOverflowCount;
+            fSysexOverflowed = true;
+            return false;
+        }
+
+        MidiEvent* const midiEvent = append(frame);
+
+        if (midiEvent == nullptr)
+            return false;
+
+        midiEvent->size = size;
+
+        if (size > MidiEvent::kDataSize)
+        {
+            std::memcpy(fSysexData + fSysexUsed, data, size);
+            midiEvent->dataExt = fSysexData + fSysexUsed;
+            fSysexUsed += size;
         }
         else
         {
-# if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-            DISTRHO_SAFE_ASSERT_RETURN(index < DISTRHO_PLUGIN_NUM_OUTPUTS, sFallbackAudioPort);
-# endif
+            std::memcpy(midiEvent->data, data, size);
+        }
+
+        return true;
+    }
+
+    // Count events that were dropped without being offered to append(), e.g. the rest of a host list once full.
+    void addOverflow(const uint32_t count) noexcept
+    {
+        if (count == 0)
+            return;
+
+        fOverflowCount += count;
+        fEventsOverflowed = true;
+    }
+
+    // Amount of events dropped since the last reserve().
+    uint32_t getOverflowCount() const noexcept
+    {
+        return fOverflowCount;
+    }
+
+private:
+    MidiEvent* fEvents;
+    MidiEvent* fSortBuffer;
+    uint32_t fEventCapacity;
+    uint32_t fEventCount;
+    bool fIsSorted;
+
+    uint8_t* fSysexData;
+    uint32_t fSysexCapacity;
+    uint32_t fSysexUsed;
+
+    uint32_t fOverflowCount;
+    bool fEventsOverflowed;
+    bool fSysexOverflowed;
+
+    // Stable LSD radix sort on the frame, one counting pass per byte in use by the largest frame.
+    // Small lists use insertion sort instead, which is faster than building histograms for them.
+    void sortByFrame() noexcept
+    {
+        if (fEventCount <= 16)
+        {
+            for (uint32_t i = 1; i < fEventCount; ++i)
+            {
+                const MidiEvent midiEvent(fEvents[i]);
+                uint32_t j = i;
+
+                for (; j != 0 && fEvents[j - 1].frame > midiEvent.frame; --j)
+                    fEvents[j] = fEvents[j - 1];
+
+                fEvents[j] = midiEvent;
+            }
+            return;
+        }
+
+        uint32_t maxFrame = 0;
+        for (uint32_t i = 0; i < fEventCount; ++i)
+        {
+            if (fEvents[i].frame > maxFrame)
+                maxFrame = fEvents[i].frame;
+        }
+
+        MidiEvent* source = fEvents;
+        MidiEvent* target = fSortBuffer;
+        uint32_t offsets[256];
+
+        for (uint32_t shift = 0; shift < 32 && (maxFrame >> shift) != 0; shift += 8)
+        {
+            std::memset(offsets, 0, sizeof(offsets));
+
+            for (uint32_t i = 0; i < fEventCount; ++i)
+                ++offsets[(source[i].frame >> shift) & 0xff];
+
+            for (uint32_t i = 0, sum = 0; i < 256; ++i)
+            {
+                const uint32_t count = offsets[i];
+                offsets[i] = sum;
+                sum += count;
+            }
+
+            for (uint32_t i = 0; i < fEventCount; ++i)
+                target[offsets[(source[i].frame >> shift) & 0xff]++] = source[i];
+
+            MidiEvent* const tmp = source;
+            source = target;
+            target = tmp;
+        }
+
+        // both buffers have the same capacity, so the sorted one simply becomes the event storage
+        fEvents = source;
+        fSortBuffer = target;
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(MidiEventArena)
+};
+
+// -----------------------------------------------------------------------
+// Outgoing MIDI events scheduled ahead of time, kept in a binary min-heap ordered by absolute frame.
+// Events on the same frame keep the order in which they were scheduled.
+
+class MidiEventScheduler
+{
+public:
+    struct ScheduledEvent {
+        uint64_t frame;
+        uint32_t order;
+        MidiEvent event;
+    };
+
+    MidiEventScheduler(const uint32_t capacity)
+        : fEvents(capacity != 0 ? new ScheduledEvent[capacity] : nullptr),
+          fCapacity(capacity),
+          fCount(0),
+          fNextOrder(0) {}
+
+    ~MidiEventScheduler() noexcept
+    {
+        delete[] fEvents;
+    }
+
+    uint32_t getCount() const noexcept
+    {
+        return fCount;
+    }
+
+    bool isEmpty() const noexcept
+    {
+        return fCount == 0;
+    }
+
+    bool push(const uint64_t frame, const MidiEvent& midiEvent) noexcept
+    {
+        if (fCount == fCapacity)
+            return false;
+
+        ScheduledEvent& scheduledEvent(fEvents[fCount]);
+        scheduledEvent.frame = frame;
+        scheduledEvent.order = fNextOrder++;
+        scheduledEvent.event = midiEvent;
+        siftUp(fCount++);
+        return true;
+    }
+
+    // The earliest event, must not be called when empty.
+    const ScheduledEvent& top() const noexcept
+    {
+        return fEvents[0];
+    }
+
+    void pop() noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fCount != 0,);
+
+        if (--fCount != 0)
+        {
+            fEvents[0] = fEvents[fCount];
+            siftDown(0);
+        }
+    }
+
+    void clear() noexcept
+    {
+        fCount = 0;
+    }
+
+    // Move all pending events to @a frame while keeping their relative order.
+    // The storage is heap-sorted in place, a sorted array being a valid heap, so this does not allocate.
+    void retime(const uint64_t frame) noexcept
+    {
+        const uint32_t count = fCount;
+
+        if (count == 0)
+            return;
+
+        // repeatedly move the earliest event to the back, leaving the storage in descending order
+        while (fCount > 1)
+        {
+            const ScheduledEvent scheduledEvent(fEvents[0]);
+            fEvents[0] = fEvents[--fCount];
+            fEvents[fCount] = scheduledEvent;
+            siftDown(0);
+        }
+
+        fCount = count;
+
+        for (uint32_t i = 0, j = count - 1; i < j; ++i, --j)
+        {
+            const ScheduledEvent scheduledEvent(fEvents[i]);
+            fEvents[i] = fEvents[j];
+            fEvents[j] = scheduledEvent;
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            fEvents[i].frame = frame;
+            fEvents[i].order = fNextOrder++;
+        }
+    }
+
+private:
+    ScheduledEvent* const fEvents;
+    const uint32_t fCapacity;
+    uint32_t fCount;
+    uint32_t fNextOrder;
+
+    static bool isEarlier(const ScheduledEvent& a, const ScheduledEvent& b) noexcept
+    {
+        if (a.frame != b.frame)
+            return a.frame < b.frame;
+
+        // wrap-around safe comparison of the scheduling order
+        return static_cast<int32_t>(a.order - b.order) < 0;
+    }
+
+    void siftUp(uint32_t index) noexcept
+    {
+        const ScheduledEvent scheduledEvent(fEvents[index]);
+
+        while (index != 0)
+        {
+            const uint32_t parent = (index - 1) / 2;
+
+            if (! isEarlier(scheduledEvent, fEvents[parent]))
+                break;
+
+            fEvents[index] = fEvents[parent];
+            index = parent;
+        }
+
+        fEvents[index] = scheduledEvent;
+    }
+
+    void siftDown(uint32_t index) noexcept
+    {
+        const ScheduledEvent scheduledEvent(fEvents[index]);
+
+        for (;;)
+        {
+            uint32_t child = index * 2 + 1;
+
+            if (child >= fCount)
+                break;
+            if (child + 1 < fCount && isEarlier(fEvents[child + 1], fEvents[child]))
+                ++child;
+            if (! isEarlier(fEvents[child], scheduledEvent))
+                break;
+
+            fEvents[index] = fEvents[child];
+            index = child;
+        }
+
+        fEvents[index] = scheduledEvent;
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(MidiEventScheduler)
+};
+
+#if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+// -----------------------------------------------------------------------
+// Block timing histogram, written by the audio thread and readable from any other thread without locking.
+
+class ProcessingStatsCollector
+{
+public:
+    // 1% load per bucket up to 200%, the last bucket holds everything above
+    static const uint32_t kNumBuckets = 201;
+
+    ProcessingStatsCollector() noexcept
+        : fFramesPerNanosecond(0.0)
+    {
+        AtomicWordOps::init(fBuckets, kNumBuckets);
+        AtomicWordOps::init(&fBlockCount, 1);
+        AtomicWordOps::init(&fOverrunCount, 1);
+        AtomicWordOps::init(&fLastLoad, 1);
+        AtomicWordOps::init(&fMaxLoad, 1);
+    }
+
+    // Clear all statistics, must not be called while processing.
+    void reset(const double sampleRate) noexcept
+    {
+        fFramesPerNanosecond = sampleRate / 1000000000.0;
+
+        for (uint32_t i = 0; i < kNumBuckets; ++i)
+            AtomicWordOps::store(fBuckets[i], 0);
+
+        AtomicWordOps::store(fBlockCount, 0);
+        AtomicWordOps::store(fOverrunCount, 0);
+        AtomicWordOps::store(fLastLoad, 0);
+        AtomicWordOps::store(fMaxLoad, 0);
+    }
+
+    // Add the processing time of a block, to be called from the audio thread only.
+    void addBlock(const uint32_t frames, const uint64_t elapsedNanoseconds) noexcept
+    {
+        if (frames == 0)
+            return;
+
+        const float load = static_cast<float>(elapsedNanoseconds * fFramesPerNanosecond / frames);
+        const uint32_t bucket = load < 2.0f ? static_cast<uint32_t>(load * 100.0f) : kNumBuckets - 1;
+
+        // single writer, so a plain load and store is enough to increment
+        AtomicWordOps::store(fBuckets[bucket], AtomicWordOps::load(fBuckets[bucket]) + 1);
+
+        if (load > 1.0f)
+            AtomicWordOps::store(fOverrunCount, AtomicWordOps::load(fOverrunCount) + 1);
+        if (load > loadFloat(fMaxLoad))
+            storeFloat(fMaxLoad, load);
+
+        storeFloat(fLastLoad, load);
+        AtomicWordOps::store(fBlockCount, AtomicWordOps::load(fBlockCount) + 1);
+    }
+
+    ProcessingStats get() const noexcept
+    {
+        ProcessingStats stats;
+        stats.blockCount = AtomicWordOps::load(fBlockCount);
+        stats.overrunCount = AtomicWordOps::load(fOverrunCount);
+        stats.lastLoad = loadFloat(fLastLoad);
+        stats.maxLoad = loadFloat(fMaxLoad);
+
+        uint32_t counts[kNumBuckets];
+        uint32_t total = 0;
+
+        for (uint32_t i = 0; i < kNumBuckets; ++i)
+            total += counts[i] = AtomicWordOps::load(fBuckets[i]);
+
+        stats.p50Load = getPercentile(counts, total, 0.5, stats.maxLoad);
+        stats.p99Load = getPercentile(counts, total, 0.99, stats.maxLoad);
+        return stats;
+    }
+
+private:
+    AtomicWord fBuckets[kNumBuckets];
+    AtomicWord fBlockCount;
+    AtomicWord fOverrunCount;
+    AtomicWord fLastLoad;
+    AtomicWord fMaxLoad;
+    double fFramesPerNanosecond;
+
+    static float loadFloat(const AtomicWord& word) noexcept
+    {
+        const uint32_t bits = AtomicWordOps::load(word);
+        float value;
+        std::memcpy(&value, &bits, sizeof(float));
+        return value;
+    }
+
+    static void storeFloat(AtomicWord& word, const float value) noexcept
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(float));
+        AtomicWordOps::store(word, bits);
+    }
+
+    // Upper edge of the bucket containing the percentile, never above the highest value seen.
+    static float getPercentile(const uint32_t* const counts, const uint32_t total,
+                               const double percentile, const float maxLoad) noexcept
+    {
+        if (total == 0)
+            return 0.0f;
+
+        const uint32_t rank = static_cast<uint32_t>(total * percentile);
+        uint32_t cumulative = 0;
+
+        for (uint32_t i = 0; i < kNumBuckets - 1; ++i)
+        {
+            cumulative += counts[i];
+
+            if (cumulative > rank)
+                return std::min(static_cast<float>(i + 1) / 100.0f, maxLoad);
+        }
+
+        return maxLoad;
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(ProcessingStatsCollector)
+};
+#endif
+
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+// -----------------------------------------------------------------------
+// Background loading of states, see Plugin::requestStateLoad()
+//
+// Every state has 3 object slots:
+//  - pending: set by the loader, waiting to be handed over
+//  - current: what run() sees, only replaced by handOver() at the start of a block
+//  - retired: the object replaced by handOver(), deleted later by the loader
+// An object is only handed over once the previous retired one is gone, so the audio thread never deletes anything.
+
+class StateLoader
+{
+public:
+    StateLoader() noexcept
+        : fSlots(nullptr),
+          fCount(0),
+          fLoadFunc(nullptr),
+          fLoadPtr(nullptr),
+          fLoadedFunc(nullptr),
+          fLoadedPtr(nullptr)
+         #if DPF_PLUGIN_HAS_STATE_LOADER_THREAD
+        , fMutex(),
+          fSignal(),
+          fThread(*this)
+         #endif
+          {}
+
+    ~StateLoader() noexcept
+    {
+        stop();
+
+        for (uint32_t i = 0; i < fCount; ++i)
+        {
+            delete exchange(fSlots[i].pending, nullptr);
+            delete exchange(fSlots[i].current, nullptr);
+            delete exchange(fSlots[i].retired, nullptr);
+        }
+
+        delete[] fSlots;
+    }
+
+    void init(const uint32_t count, const loadStateObjectFunc loadFunc, void* const loadPtr)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fSlots == nullptr,);
+
+        fLoadFunc = loadFunc;
+        fLoadPtr = loadPtr;
+
+        if (count == 0)
+            return;
+
+        fSlots = new Slot[count];
+        fCount = count;
+        fHandOvers.init(count);
+        fLoaded.init(count);
+    }
+
+    // Notify the wrapper when a load has finished, called from the loader thread.
+    void setLoadedCallback(const stateLoadedFunc loadedFunc, void* const loadedPtr) noexcept
+    {
+        fLoadedFunc = loadedFunc;
+        fLoadedPtr = loadedPtr;
+    }
+
+    bool request(const uint32_t index, const char* const value)
+    {
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount, false);
+        DISTRHO_SAFE_ASSERT_RETURN(value != nullptr, false);
+
+        Slot& slot(fSlots[index]);
+
+       #if DPF_PLUGIN_HAS_STATE_LOADER_THREAD
+        if (fThread.isThreadRunning() || fThread.startThread())
+        {
+            {
+                const MutexLocker cml(fMutex);
+                slot.request = value;
+                slot.hasRequest = true;
+                AtomicWordOps::store(slot.loading, 1);
+            }
+
+            fSignal.signal();
+            return true;
+        }
+       #endif
+
+        AtomicWordOps::store(slot.loading, 1);
+        reclaim();
+        load(index, value);
+        return true;
+    }
+
+    bool isLoading(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount, false);
+
+        return AtomicWordOps::load(fSlots[index].loading) != 0;
+    }
+
+    StateObject* getObject(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fCount, index, fCount, nullptr);
+
+        return load(fSlots[index].current);
+    }
+
+    // Make newly loaded objects current, called at the start of every block and on activation.
+    void handOver() noexcept
+    {
+        for (uint32_t w = 0, count = fHandOvers.getWordCount(); w < count; ++w)
+        {
+            for (uint32_t bits = fHandOvers.takeWord(w); bits != 0;)
+            {
+                const uint32_t i = w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits);
+                Slot& slot(fSlots[i]);
+
+                // previous object still waiting to be deleted, try again on the next block
+                if (load(slot.retired) != nullptr)
+                {
+                    fHandOvers.set(i);
+                    continue;
+                }
+
+                if (StateObject* const object = exchange(slot.pending, nullptr))
+                {
+                    store(slot.retired, load(slot.current));
+                    store(slot.current, object);
+                }
+            }
+        }
+    }
+
+    ParameterBitset& getLoaded() noexcept
+    {
+        return fLoaded;
+    }
+
+    // Stop the loader thread, must be called before the plugin is deleted.
+    void stop() noexcept
+    {
+       #if DPF_PLUGIN_HAS_STATE_LOADER_THREAD
+        if (fThread.isThreadRunning())
+        {
+            fThread.signalThreadShouldExit();
+            fSignal.signal();
+            fThread.stopThread(-1);
+        }
+       #endif
+    }
+
+private:
+   #ifdef DISTRHO_PROPER_CPP11_SUPPORT
+    typedef std::atomic<StateObject*> AtomicObject;
+
+    static StateObject* load(const AtomicObject& object) noexcept
+    {
+        return object.load(std::memory_order_acquire);
+    }
+
+    static void store(AtomicObject& object, StateObject* const value) noexcept
+    {
+        object.store(value, std::memory_order_release);
+    }
+
+    static StateObject* exchange(AtomicObject& object, StateObject* const value) noexcept
+    {
+        return object.exchange(value, std::memory_order_acq_rel);
+    }
+   #else
+    typedef StateObject* volatile AtomicObject;
+
+    static StateObject* load(const AtomicObject& object) noexcept
+    {
+        return __atomic_load_n(&object, __ATOMIC_ACQUIRE);
+    }
+
+    static void store(AtomicObject& object, StateObject* const value) noexcept
+    {
+        __atomic_store_n(&object, value, __ATOMIC_RELEASE);
+    }
+
+    static StateObject* exchange(AtomicObject& object, StateObject* const value) noexcept
+    {
+        return __atomic_exchange_n(&object, value, __ATOMIC_ACQ_REL);
+    }
+   #endif
+
+    struct Slot {
+        AtomicObject pending;
+        AtomicObject current;
+        AtomicObject retired;
+        AtomicWord loading;
+        String request;
+        bool hasRequest;
+
+        Slot() noexcept
+            : pending(nullptr),
+              current(nullptr),
+              retired(nullptr),
+              loading(0),
+              request(),
+              hasRequest(false) {}
+    };
+
+    Slot* fSlots;
+    uint32_t fCount;
+    ParameterBitset fHandOvers;
+    ParameterBitset fLoaded;
+    loadStateObjectFunc fLoadFunc;
+    void* fLoadPtr;
+    stateLoadedFunc fLoadedFunc;
+    void* fLoadedPtr;
+
+    void load(const uint32_t index, const char* const value)
+    {
+        Slot& slot(fSlots[index]);
+
+        if (StateObject* const object = fLoadFunc(fLoadPtr, index, value))
+        {
+            // an older object that was never handed over can go right away
+            delete exchange(slot.pending, object);
+            fHandOvers.set(index);
+        }
+
+        {
+           #if DPF_PLUGIN_HAS_STATE_LOADER_THREAD
+            const MutexLocker cml(fMutex);
+
+            // a newer request came in while loading, keep reporting as busy
+            if (! slot.hasRequest)
+           #endif
+                AtomicWordOps::store(slot.loading, 0);
+        }
+
+        fLoaded.set(index);
+
+        if (fLoadedFunc != nullptr)
+            fLoadedFunc(fLoadedPtr);
+    }
+
+    // Delete retired objects, returning true if some are still waiting to be handed over.
+    bool reclaim() noexcept
+    {
+        bool waiting = false;
+
+        for (uint32_t i = 0; i < fCount; ++i)
+        {
+            delete exchange(fSlots[i].retired, nullptr);
+
+            if (load(fSlots[i].pending) != nullptr)
+                waiting = true;
+        }
+
+        return waiting;
+    }
+
+   #if DPF_PLUGIN_HAS_STATE_LOADER_THREAD
+    Mutex fMutex;
+    Signal fSignal;
+
+    struct LoaderThread : Thread {
+        StateLoader& loader;
+
+        explicit LoaderThread(StateLoader& l) noexcept
+            : Thread("DPF state loader"),
+              loader(l) {}
+
+        void run() override
+        {
+            loader.runLoader(*this);
+        }
+    } fThread;
+
+    void runLoader(const Thread& thread)
+    {
+        String value;
+
+        while (! thread.shouldThreadExit())
+        {
+            for (uint32_t i = 0; i < fCount && ! thread.shouldThreadExit(); ++i)
+            {
+                {
+                    const MutexLocker cml(fMutex);
+
+                    if (! fSlots[i].hasRequest)
+                        continue;
+
+                    value = fSlots[i].request;
+                    fSlots[i].hasRequest = false;
+                }
+
+                load(i, value);
+            }
+
+            // keep polling while objects are waiting for the audio thread, so that the ones they replace get deleted
+            if (reclaim())
+                d_msleep(50);
+            else
+                fSignal.wait();
+        }
+    }
+   #endif
+
+    DISTRHO_DECLARE_NON_COPYABLE(StateLoader)
+};
+#endif
+
+// -----------------------------------------------------------------------
+// Plugin private data
+
+struct Plugin::PrivateData {
+    const bool canRequestParameterValueChanges;
+    const bool isDummy;
+    const bool isSelfTest;
+    bool isProcessing;
+
+#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+    AudioPortWithBusId* audioPorts;
+#endif
+
+    uint32_t   parameterCount;
+    uint32_t   parameterOffset;
+    Parameter* parameters;
+
+    uint32_t         portGroupCount;
+    PortGroupWithId* portGroups;
+
+#if DISTRHO_PLUGIN_WANT_PROGRAMS
+    uint32_t programCount;
+    String*  programNames;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_STATE
+    uint32_t stateCount;
+    State*   states;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_LATENCY
+    uint32_t latency;
+#endif
+
+    uint32_t tailLength;
+    bool hasTailLength;
+
+    // Parameter smoothing, see kParameterIsSmoothed
+    uint32_t smoothedParameterCount;
+    SmoothedParameter* smoothedParameters;
+    uint32_t* smoothedParameterSlots;
+
+#if DISTRHO_PLUGIN_WANT_TIMEPOS
+    TimePosition timePosition;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    // Incoming MIDI for the current block, filled by the host wrappers
+    MidiEventArena midiInputEvents;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS && DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+    // offset of the current sub-block within the host block, added to outgoing MIDI
+    uint32_t runFrameOffset;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+    // Outgoing MIDI waiting for its frame, see Plugin::scheduleMidiEvent
+    MidiEventScheduler midiOutputScheduler;
+
+    // absolute frame of the first frame in the current host block
+    uint64_t blockStartFrame;
+#endif
+
+    // Callbacks
+    void*         callbacksPtr;
+    writeMidiFunc writeMidiCallbackFunc;
+    requestParameterValueChangeFunc requestParameterValueChangeCallbackFunc;
+    updateStateValueFunc updateStateValueCallbackFunc;
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+    parallelForFunc parallelForCallbackFunc;
+#endif
+
+#if DPF_PLUGIN_HAS_THREAD_POOL
+    // fallback for hosts without a thread pool, started on first activation
+    ThreadPool threadPool;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+    StateLoader stateLoader;
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+    ProcessingStatsCollector processingStats;
+    // print statistics on deactivation, enabled through the DPF_STATS environment variable
+    bool dumpProcessingStats;
+#endif
+
+    uint32_t bufferSize;
+    double   sampleRate;
+    bool     isOfflineRendering;
+    char*    bundlePath;
+
+    PrivateData() noexcept
+        : canRequestParameterValueChanges(d_nextCanRequestParameterValueChanges),
+          isDummy(d_nextPluginIsDummy),
+          isSelfTest(d_nextPluginIsSelfTest),
+          isProcessing(false),
+#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+          audioPorts(nullptr),
+#endif
+          parameterCount(0),
+          parameterOffset(0),
+          parameters(nullptr),
+          portGroupCount(0),
+          portGroups(nullptr),
+#if DISTRHO_PLUGIN_WANT_PROGRAMS
+          programCount(0),
+          programNames(nullptr),
+#endif
+#if DISTRHO_PLUGIN_WANT_STATE
+          stateCount(0),
+          states(nullptr),
+#endif
+#if DISTRHO_PLUGIN_WANT_LATENCY
+          latency(0),
+#endif
+          tailLength(0),
+          hasTailLength(false),
+          smoothedParameterCount(0),
+          smoothedParameters(nullptr),
+          smoothedParameterSlots(nullptr),
+#if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS && DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+          runFrameOffset(0),
+#endif
+#if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+          midiOutputScheduler(DISTRHO_PLUGIN_MIDI_OUTPUT_SCHEDULER_CAPACITY),
+          blockStartFrame(0),
+#endif
+          callbacksPtr(nullptr),
+          writeMidiCallbackFunc(nullptr),
+          requestParameterValueChangeCallbackFunc(nullptr),
+          updateStateValueCallbackFunc(nullptr),
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+          parallelForCallbackFunc(nullptr),
+#endif
+#if DPF_PLUGIN_HAS_THREAD_POOL
+          threadPool(),
+#endif
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+          stateLoader(),
+#endif
+#if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+          processingStats(),
+          dumpProcessingStats(std::getenv("DPF_STATS") != nullptr),
+#endif
+          bufferSize(d_nextBufferSize),
+          sampleRate(d_nextSampleRate),
+          isOfflineRendering(false),
+          bundlePath(d_nextBundlePath != nullptr ? strdup(d_nextBundlePath) : nullptr)
+    {
+        DISTRHO_SAFE_ASSERT(bufferSize != 0);
+        DISTRHO_SAFE_ASSERT(d_isNotZero(sampleRate));
+
+#if defined(DISTRHO_PLUGIN_TARGET_DSSI) || defined(DISTRHO_PLUGIN_TARGET_LV2)
+        parameterOffset += DISTRHO_PLUGIN_NUM_INPUTS + DISTRHO_PLUGIN_NUM_OUTPUTS;
+# if DISTRHO_PLUGIN_WANT_LATENCY
+        parameterOffset += 1;
+# endif
+#endif
+
+#ifdef DISTRHO_PLUGIN_TARGET_LV2
+# if (DISTRHO_PLUGIN_WANT_MIDI_INPUT || DISTRHO_PLUGIN_WANT_STATE || DISTRHO_PLUGIN_WANT_TIMEPOS)
+        parameterOffset += 1;
+# endif
+# if (DISTRHO_PLUGIN_WANT_MIDI_OUTPUT || DISTRHO_PLUGIN_WANT_STATE)
+        parameterOffset += 1;
+# endif
+#endif
+
+#ifdef DISTRHO_PLUGIN_TARGET_VST3
+        parameterOffset += kVst3InternalParameterCount;
+#endif
+    }
+
+    ~PrivateData() noexcept
+    {
+#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+        if (audioPorts != nullptr)
+        {
+            delete[] audioPorts;
+            audioPorts = nullptr;
+        }
+#endif
+
+        if (parameters != nullptr)
+        {
+            delete[] parameters;
+            parameters = nullptr;
+        }
+
+        if (portGroups != nullptr)
+        {
+            delete[] portGroups;
+            portGroups = nullptr;
+        }
+
+#if DISTRHO_PLUGIN_WANT_PROGRAMS
+        if (programNames != nullptr)
+        {
+            delete[] programNames;
+            programNames = nullptr;
+        }
+#endif
+
+#if DISTRHO_PLUGIN_WANT_STATE
+        if (states != nullptr)
+        {
+            delete[] states;
+            states = nullptr;
+        }
+#endif
+
+        if (smoothedParameters != nullptr)
+        {
+            for (uint32_t i=0; i < smoothedParameterCount; ++i)
+                delete[] smoothedParameters[i].buffer;
+
+            delete[] smoothedParameters;
+            smoothedParameters = nullptr;
+        }
+
+        if (smoothedParameterSlots != nullptr)
+        {
+            delete[] smoothedParameterSlots;
+            smoothedParameterSlots = nullptr;
+        }
+
+        if (bundlePath != nullptr)
+        {
+            std::free(bundlePath);
+            bundlePath = nullptr;
+        }
+    }
+
+#if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+    bool writeMidiCallback(const MidiEvent& midiEvent)
+    {
+        if (writeMidiCallbackFunc == nullptr)
+            return false;
+
+        // scheduled events due up to this one go first, so that the host receives everything in order
+        if (isProcessing && ! midiOutputScheduler.isEmpty())
+            writeScheduledMidiEvents(getRunFrame() + midiEvent.frame + 1);
+
+       #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+        if (runFrameOffset != 0)
+        {
+            MidiEvent offsetMidiEvent(midiEvent);
+            offsetMidiEvent.frame += runFrameOffset;
+            return writeMidiCallbackFunc(callbacksPtr, offsetMidiEvent);
+        }
+       #endif
+
+        return writeMidiCallbackFunc(callbacksPtr, midiEvent);
+    }
+
+    uint64_t getRunFrame() const noexcept
+    {
+       #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+        return blockStartFrame + runFrameOffset;
+       #else
+        return blockStartFrame;
+       #endif
+    }
+
+    // Write scheduled events due before @a endFrame, stopping early if the host buffer is full.
+    // Events left behind are written at the start of the next block.
+    void writeScheduledMidiEvents(const uint64_t endFrame)
+    {
+        if (writeMidiCallbackFunc == nullptr)
+            return;
+
+        while (! midiOutputScheduler.isEmpty())
+        {
+            const MidiEventScheduler::ScheduledEvent& scheduledEvent(midiOutputScheduler.top());
+
+            if (scheduledEvent.frame >= endFrame)
+                break;
+
+            MidiEvent midiEvent(scheduledEvent.event);
+            midiEvent.frame = scheduledEvent.frame > blockStartFrame
+                            ? static_cast<uint32_t>(scheduledEvent.frame - blockStartFrame)
+                            : 0;
+
+            if (! writeMidiCallbackFunc(callbacksPtr, midiEvent))
+                break;
+
+            midiOutputScheduler.pop();
+        }
+    }
+
+    void flushScheduledMidiEvents(const uint32_t frame)
+    {
+        if (! isProcessing)
+        {
+            midiOutputScheduler.retime(blockStartFrame);
+            return;
+        }
+
+        const uint64_t absoluteFrame = getRunFrame() + frame;
+        midiOutputScheduler.retime(absoluteFrame);
+        writeScheduledMidiEvents(absoluteFrame + 1);
+    }
+
+    // Called after each host block, writes the remaining events due within it and advances the timeline.
+    void finishScheduledMidiEvents(const uint32_t frames)
+    {
+        if (! midiOutputScheduler.isEmpty())
+            writeScheduledMidiEvents(blockStartFrame + frames);
+
+        blockStartFrame += frames;
+    }
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST
+    bool requestParameterValueChangeCallback(const uint32_t index, const float value)
+    {
+        if (requestParameterValueChangeCallbackFunc != nullptr)
+            return requestParameterValueChangeCallbackFunc(callbacksPtr, index, value);
+
+        return false;
+    }
+#endif
+
+#if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+    void parallelFor(const uint32_t taskCount, const Plugin::ParallelTaskFunc taskFunc, void* const taskPtr)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(taskFunc != nullptr,);
+
+        if (taskCount > 1 && isProcessing)
+        {
+            if (parallelForCallbackFunc != nullptr && parallelForCallbackFunc(callbacksPtr, taskCount, taskFunc, taskPtr))
+                return;
+
+           #if DPF_PLUGIN_HAS_THREAD_POOL
+            if (threadPool.isRunning())
+            {
+                threadPool.parallelFor(taskCount, taskFunc, taskPtr);
+                return;
+            }
+           #endif
+        }
+
+        for (uint32_t i=0; i < taskCount; ++i)
+            taskFunc(taskPtr, i);
+    }
+#endif
+
+#if DISTRHO_PLUGIN_WANT_STATE
+    bool updateStateValueCallback(const char* const key, const char* const value)
+    {
+        d_stdout("updateStateValueCallback %p", updateStateValueCallbackFunc);
+        if (updateStateValueCallbackFunc != nullptr)
+            return updateStateValueCallbackFunc(callbacksPtr, key, value);
+
+        return false;
+    }
+#endif
+};
+
+// -----------------------------------------------------------------------
+// Plugin exporter class
+
+class PluginExporter
+{
+public:
+    PluginExporter(void* const callbacksPtr,
+                   const writeMidiFunc writeMidiCall,
+                   const requestParameterValueChangeFunc requestParameterValueChangeCall,
+                   const updateStateValueFunc updateStateValueCall)
+        : fPlugin(createPlugin()),
+          fData((fPlugin != nullptr) ? fPlugin->pData : nullptr),
+          fIsActive(false),
+          fParameterIndices(nullptr),
+          fParameterSymbolHashes(nullptr),
+          fParameterSymbolHashCount(0)
+#if DPF_PLUGIN_HAS_SILENCE_DETECTION
+        , fSilentFrames(0),
+          fInputsAreSilentHint(false),
+          fOutputsAreSilent(false)
+#endif
+#if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+        , fParameterChangeCount(0)
+# if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        , fSegmentMidiEvents(nullptr),
+          fSegmentMidiEventCapacity(0)
+# endif
+#endif
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
+
+#if defined(DPF_RUNTIME_TESTING) && defined(__GNUC__) && !defined(__clang__)
+        /* Run-time testing build.
+         * Verify that virtual functions are overriden if parameters, programs or states are in use.
+         * This does not work on all compilers, but we use it purely as informational check anyway. */
+        if (fData->parameterCount != 0)
+        {
+            if ((void*)(fPlugin->*(&Plugin::initParameter)) == (void*)&Plugin::initParameter)
+            {
+                d_stderr2("DPF warning: Plugins with parameters must implement `initParameter`");
+                abort();
+            }
+            if ((void*)(fPlugin->*(&Plugin::getParameterValue)) == (void*)&Plugin::getParameterValue)
+            {
+                d_stderr2("DPF warning: Plugins with parameters must implement `getParameterValue`");
+                abort();
+            }
+            if ((void*)(fPlugin->*(&Plugin::setParameterValue)) == (void*)&Plugin::setParameterValue)
+            {
+                d_stderr2("DPF warning: Plugins with parameters must implement `setParameterValue`");
+                abort();
+            }
+        }
+
+# if DISTRHO_PLUGIN_WANT_PROGRAMS
+        if (fData->programCount != 0)
+        {
+            if ((void*)(fPlugin->*(&Plugin::initProgramName)) == (void*)&Plugin::initProgramName)
+            {
+                d_stderr2("DPF warning: Plugins with programs must implement `initProgramName`");
+                abort();
+            }
+            if ((void*)(fPlugin->*(&Plugin::loadProgram)) == (void*)&Plugin::loadProgram)
+            {
+                d_stderr2("DPF warning: Plugins with programs must implement `loadProgram`");
+                abort();
+            }
+        }
+# endif
+
+# if DISTRHO_PLUGIN_WANT_STATE
+        if (fData->stateCount != 0)
+        {
+            if ((void*)(fPlugin->*(static_cast<void(Plugin::*)(uint32_t,State&)>(&Plugin::initState))) ==
+                (void*)static_cast<void(Plugin::*)(uint32_t,State&)>(&Plugin::initState))
+            {
+                d_stderr2("DPF warning: Plugins with state must implement `initState`");
+                abort();
+            }
+
+            if ((void*)(fPlugin->*(&Plugin::setState)) == (void*)&Plugin::setState)
+            {
+                d_stderr2("DPF warning: Plugins with state must implement `setState`");
+                abort();
+            }
+        }
+# endif
+
+# if DISTRHO_PLUGIN_WANT_FULL_STATE
+        if (fData->stateCount != 0)
+        {
+            if ((void*)(fPlugin->*(&Plugin::getState)) == (void*)&Plugin::getState)
+            {
+                d_stderr2("DPF warning: Plugins with full state must implement `getState`");
+                abort();
+            }
+        }
+        else
+        {
+            d_stderr2("DPF warning: Plugins with full state must have at least 1 state");
+            abort();
+        }
+# endif
+#endif
+
+#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+        {
+            uint32_t j=0;
+# if DISTRHO_PLUGIN_NUM_INPUTS > 0
+            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_INPUTS; ++i, ++j)
+                fPlugin->initAudioPort(true, i, fData->audioPorts[j]);
+# endif
+# if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_OUTPUTS; ++i, ++j)
+                fPlugin->initAudioPort(false, i, fData->audioPorts[j]);
+# endif
+        }
+#endif // DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+
+        for (uint32_t i=0, count=fData->parameterCount; i < count; ++i)
+            fPlugin->initParameter(i, fData->parameters[i]);
+
+        fParameterStore.init(fData->parameterCount);
+
+        for (uint32_t i=0, count=fData->parameterCount; i < count; ++i)
+            fParameterStore.setValue(i, fPlugin->getParameterValue(i), false);
+
+        fInputParameters.indices = fOutputParameters.indices = fTriggerParameters.indices = nullptr;
+        fInputParameters.count = fOutputParameters.count = fTriggerParameters.count = 0;
+
+        if (const uint32_t count = fData->parameterCount)
+        {
+            uint32_t outputCount = 0;
+            for (uint32_t i=0; i < count; ++i)
+            {
+                if (fData->parameters[i].hints & kParameterIsOutput)
+                    ++outputCount;
+            }
+
+            // inputs and outputs take the first half, triggers (a subset of inputs) the second
+            fParameterIndices = new uint32_t[count * 2];
+            fInputParameters.indices = fParameterIndices;
+            fOutputParameters.indices = fParameterIndices + (count - outputCount);
+            fTriggerParameters.indices = fParameterIndices + count;
+
+            for (uint32_t i=0; i < count; ++i)
+            {
+                const uint32_t hints = fData->parameters[i].hints;
+
+                if (hints & kParameterIsOutput)
+                {
+                    fParameterIndices[count - outputCount + fOutputParameters.count++] = i;
+                    continue;
+                }
+
+                fParameterIndices[fInputParameters.count++] = i;
+
+                if ((hints & kParameterIsTrigger) == kParameterIsTrigger)
+                    fParameterIndices[count + fTriggerParameters.count++] = i;
+            }
+        }
+
+        initParameterSymbolHashes();
+        initSmoothedParameters();
+
+       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        reserveMidiInputEvents();
+       #endif
+
+        {
+            std::set<uint32_t> portGroupIndices;
+
+#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
+                portGroupIndices.insert(fData->audioPorts[i].groupId);
+#endif
+            for (uint32_t i=0, count=fData->parameterCount; i < count; ++i)
+                portGroupIndices.insert(fData->parameters[i].groupId);
+
+            portGroupIndices.erase(kPortGroupNone);
+
+            if (const uint32_t portGroupSize = static_cast<uint32_t>(portGroupIndices.size()))
+            {
+                fData->portGroups = new PortGroupWithId[portGroupSize];
+                fData->portGroupCount = portGroupSize;
+
+                uint32_t index = 0;
+                for (std::set<uint32_t>::iterator it = portGroupIndices.begin(); it != portGroupIndices.end(); ++it, ++index)
+                {
+                    PortGroupWithId& portGroup(fData->portGroups[index]);
+                    portGroup.groupId = *it;
+
+                    if (portGroup.groupId < portGroupSize)
+                        fPlugin->initPortGroup(portGroup.groupId, portGroup);
+                    else
+                        fillInPredefinedPortGroupData(portGroup.groupId, portGroup);
+                }
+            }
+        }
+
+#if DISTRHO_PLUGIN_WANT_PROGRAMS
+        for (uint32_t i=0, count=fData->programCount; i < count; ++i)
+            fPlugin->initProgramName(i, fData->programNames[i]);
+#endif
+
+#if DISTRHO_PLUGIN_WANT_STATE
+        for (uint32_t i=0, count=fData->stateCount; i < count; ++i)
+            fPlugin->initState(i, fData->states[i]);
+#endif
+
+#if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+        fData->stateLoader.init(fData->stateCount, loadStateObjectCallback, fPlugin);
+#endif
+
+        fData->callbacksPtr = callbacksPtr;
+        fData->writeMidiCallbackFunc = writeMidiCall;
+        fData->requestParameterValueChangeCallbackFunc = requestParameterValueChangeCall;
+        fData->updateStateValueCallbackFunc = updateStateValueCall;
+    }
+
+    ~PluginExporter()
+    {
+       #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+        // the loader thread calls into the plugin
+        if (fData != nullptr)
+            fData->stateLoader.stop();
+       #endif
+
+        delete fPlugin;
+        delete[] fParameterIndices;
+        delete[] fParameterSymbolHashes;
+       #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS && DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        delete[] fSegmentMidiEvents;
+       #endif
+    }
+
+    // -------------------------------------------------------------------
+
+    const char* getName() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+
+        return fPlugin->getName();
+    }
+
+    const char* getLabel() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+
+        return fPlugin->getLabel();
+    }
+
+    const char* getDescription() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+
+        return fPlugin->getDescription();
+    }
+
+    const char* getMaker() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+
+        return fPlugin->getMaker();
+    }
+
+    const char* getHomePage() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+
+        return fPlugin->getHomePage();
+    }
+
+    const char* getLicense() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, "");
+
+        return fPlugin->getLicense();
+    }
+
+    uint32_t getVersion() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0);
+
+        return fPlugin->getVersion();
+    }
+
+    long getUniqueId() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0);
+
+        return fPlugin->getUniqueId();
+    }
+
+    void* getInstancePointer() const noexcept
+    {
+        return fPlugin;
+    }
+
+    // -------------------------------------------------------------------
+
+#if DISTRHO_PLUGIN_WANT_LATENCY
+    uint32_t getLatency() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+
+        return fData->latency;
+    }
+#endif
+
+#if DISTRHO_PLUGIN_NUM_INPUTS+DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+    AudioPortWithBusId& getAudioPort(const bool input, const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, sFallbackAudioPort);
+
+        if (input)
+        {
+# if DISTRHO_PLUGIN_NUM_INPUTS > 0
+            DISTRHO_SAFE_ASSERT_RETURN(index < DISTRHO_PLUGIN_NUM_INPUTS,  sFallbackAudioPort);
+# endif
+        }
+        else
+        {
+# if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            DISTRHO_SAFE_ASSERT_RETURN(index < DISTRHO_PLUGIN_NUM_OUTPUTS, sFallbackAudioPort);
+# endif
         }
 
         return fData->audioPorts[index + (input ? 0 : DISTRHO_PLUGIN_NUM_INPUTS)];
     }
 
-    uint32_t getAudioPortHints(const bool input, const uint32_t index) const noexcept
+    uint32_t getAudioPortHints(const bool input, const uint32_t index) const noexcept
+    {
+        return getAudioPort(input, index).hints;
+    }
+    
+    uint32_t getAudioPortCountWithGroupId(const bool input, const uint32_t groupId) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+
+        uint32_t numPorts = 0;
+
+        if (input)
+        {
+           #if DISTRHO_PLUGIN_NUM_INPUTS > 0
+            for (uint32_t i=0; i<DISTRHO_PLUGIN_NUM_INPUTS; ++i)
+            {
+                if (fData->audioPorts[i].groupId == groupId)
+                    ++numPorts;
+            }
+           #endif
+        }
+        else
+        {
+           #if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            for (uint32_t i=0; i<DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
+            {
+                if (fData->audioPorts[i + DISTRHO_PLUGIN_NUM_INPUTS].groupId == groupId)
+                    ++numPorts;
+            }
+           #endif
+        }
+
+        return numPorts;
+    }
+#endif
+
+    uint32_t getParameterCount() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+
+        return fData->parameterCount;
+    }
+
+    uint32_t getParameterOffset() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+
+        return fData->parameterOffset;
+    }
+
+    uint32_t getParameterHints(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0x0);
+
+        return fData->parameters[index].hints;
+    }
+
+    ParameterDesignation getParameterDesignation(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, kParameterDesignationNull);
+
+        return fData->parameters[index].designation;
+    }
+
+    bool isParameterInput(const uint32_t index) const noexcept
+    {
+        return (getParameterHints(index) & kParameterIsOutput) == 0x0;
+    }
+
+    bool isParameterOutput(const uint32_t index) const noexcept
+    {
+        return (getParameterHints(index) & kParameterIsOutput) != 0x0;
+    }
+
+    bool isParameterInteger(const uint32_t index) const noexcept
+    {
+        return (getParameterHints(index) & kParameterIsInteger) != 0x0;
+    }
+
+    bool isParameterTrigger(const uint32_t index) const noexcept
+    {
+        return (getParameterHints(index) & kParameterIsTrigger) == kParameterIsTrigger;
+    }
+
+    bool isParameterOutputOrTrigger(const uint32_t index) const noexcept
+    {
+        const uint32_t hints = getParameterHints(index);
+
+        if (hints & kParameterIsOutput)
+            return true;
+        if ((hints & kParameterIsTrigger) == kParameterIsTrigger)
+            return true;
+
+        return false;
+    }
+
+    const String& getParameterName(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+
+        return fData->parameters[index].name;
+    }
+
+    const String& getParameterShortName(const uint32_t index) const noexcept
     {
-        return getAudioPort(input, index).hints;
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+
+        return fData->parameters[index].shortName;
     }
-    
-    uint32_t getAudioPortCountWithGroupId(const bool input, const uint32_t groupId) const noexcept
+
+    const String& getParameterSymbol(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+
+        return fData->parameters[index].symbol;
+    }
+
+    // Find an input parameter by the hash of its symbol, as used in state chunks.
+    bool findParameterBySymbolHash(const uint32_t symbolHash, uint32_t& index) const noexcept
+    {
+        const uint64_t key = static_cast<uint64_t>(symbolHash) << 32;
+        const uint64_t* const begin = fParameterSymbolHashes;
+        const uint64_t* const end = begin + fParameterSymbolHashCount;
+        const uint64_t* const it = std::lower_bound(begin, end, key);
+
+        if (it == end || (*it >> 32) != symbolHash)
+            return false;
+
+        index = static_cast<uint32_t>(*it & 0xffffffff);
+        return true;
+    }
+
+    const String& getParameterUnit(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+
+        return fData->parameters[index].unit;
+    }
+
+    const String& getParameterDescription(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+
+        return fData->parameters[index].description;
+    }
+
+    const ParameterEnumerationValues& getParameterEnumValues(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackEnumValues);
+
+        return fData->parameters[index].enumValues;
+    }
+
+    const ParameterRanges& getParameterRanges(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackRanges);
+
+        return fData->parameters[index].ranges;
+    }
+
+    uint8_t getParameterMidiCC(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0);
+
+        return fData->parameters[index].midiCC;
+    }
+
+    uint32_t getParameterGroupId(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, kPortGroupNone);
+
+        return fData->parameters[index].groupId;
+    }
+
+    float getParameterDefault(const uint32_t index) const
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0.0f);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0.0f);
+
+        return fData->parameters[index].ranges.def;
+    }
+
+    float getParameterValue(const uint32_t index) const
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0.0f);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0.0f);
+
+        return fPlugin->getParameterValue(index);
+    }
+
+    // This is the only place a host parameter change is written to the parameter store,
+    // wrappers pass markAsChanged instead of writing the store themselves.
+    void setParameterValue(const uint32_t index, const float value, const bool markAsChanged = false)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount,);
+
+        fPlugin->setParameterValue(index, value);
+        fParameterStore.setValue(index, value, markAsChanged);
+        setSmoothedParameterTarget(index, value);
+    }
+
+    ParameterStore& getParameterStore() noexcept
+    {
+        return fParameterStore;
+    }
+
+    // Parameter indices grouped by type, built once on init. Triggers are also part of the input list.
+    const ParameterIndexList& getInputParameterIndexList() const noexcept
+    {
+        return fInputParameters;
+    }
+
+    const ParameterIndexList& getOutputParameterIndexList() const noexcept
+    {
+        return fOutputParameters;
+    }
+
+    const ParameterIndexList& getTriggerParameterIndexList() const noexcept
+    {
+        return fTriggerParameters;
+    }
+
+    /*
+    bool getParameterIndexForSymbol(const char* const symbol, uint32_t& index)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
+
+        for (uint32_t i=0; i < fData->parameterCount; ++i)
+        {
+            if (fData->parameters[i].symbol == symbol)
+            {
+                index = i;
+                return true;
+            }
+        }
+
+        return false;
+    }
+    */
+
+    uint32_t getPortGroupCount() const noexcept
     {
         DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
 
-        uint32_t numPorts = 0;
+        return fData->portGroupCount;
+    }
+
+    const PortGroupWithId& getPortGroupById(const uint32_t groupId) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && fData->portGroupCount != 0, sFallbackPortGroup);
+
+        for (uint32_t i=0; i < fData->portGroupCount; ++i)
+        {
+            const PortGroupWithId& portGroup(fData->portGroups[i]);
+
+            if (portGroup.groupId == groupId)
+                return portGroup;
+        }
+
+        return sFallbackPortGroup;
+    }
+
+    const PortGroupWithId& getPortGroupByIndex(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->portGroupCount, sFallbackPortGroup);
+
+        return fData->portGroups[index];
+    }
+
+    const String& getPortGroupSymbolForId(const uint32_t groupId) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, sFallbackString);
+
+        return getPortGroupById(groupId).symbol;
+    }
+
+#if DISTRHO_PLUGIN_WANT_PROGRAMS
+    uint32_t getProgramCount() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+
+        return fData->programCount;
+    }
+
+    const String& getProgramName(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->programCount, sFallbackString);
+
+        return fData->programNames[index];
+    }
+
+    void loadProgram(const uint32_t index)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->programCount,);
+
+        fPlugin->loadProgram(index);
+
+        for (uint32_t i=0; i < fData->smoothedParameterCount; ++i)
+        {
+            const uint32_t paramIndex = fData->smoothedParameters[i].index;
+            setSmoothedParameterTarget(paramIndex, fPlugin->getParameterValue(paramIndex));
+        }
+    }
+#endif
+
+#if DISTRHO_PLUGIN_WANT_STATE
+    uint32_t getStateCount() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+
+        return fData->stateCount;
+    }
+
+    uint32_t getStateHints(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, 0x0);
+
+        return fData->states[index].hints;
+    }
+
+    const String& getStateKey(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+
+        return fData->states[index].key;
+    }
+
+    const String& getStateDefaultValue(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+
+        return fData->states[index].defaultValue;
+    }
+
+    const String& getStateLabel(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+
+        return fData->states[index].label;
+    }
+
+    const String& getStateDescription(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+
+        return fData->states[index].description;
+    }
+
+   #ifdef __MOD_DEVICES__
+    const String& getStateFileTypes(const uint32_t index) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+
+        return fData->states[index].fileTypes;
+    }
+   #endif
+
+   #if DISTRHO_PLUGIN_WANT_FULL_STATE
+    String getStateValue(const char* const key) const
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, sFallbackString);
+        DISTRHO_SAFE_ASSERT_RETURN(key != nullptr && key[0] != '\0', sFallbackString);
+
+        return fPlugin->getState(key);
+    }
+   #endif
+
+    void setState(const char* const key, const char* const value)
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(key != nullptr && key[0] != '\0',);
+        DISTRHO_SAFE_ASSERT_RETURN(value != nullptr,);
+
+        fPlugin->setState(key, value);
+    }
+
+    bool wantStateKey(const char* const key) const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
+        DISTRHO_SAFE_ASSERT_RETURN(key != nullptr && key[0] != '\0', false);
 
-        if (input)
-        {
-           #if DISTRHO_PLUGIN_NUM_INPUTS > 0
-            for (uint32_t i=0; i<DISTRHO_PLUGIN_NUM_INPUTS; ++i)
-            {
-                if (fData->audioPorts[i].groupId == groupId)
-                    ++numPorts;
-            }
-           #endif
-        }
-        else
+        for (uint32_t i=0; i < fData->stateCount; ++i)
         {
-           #if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-            for (uint32_t i=0; i<DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
-            {
-                if (fData->audioPorts[i + DISTRHO_PLUGIN_NUM_INPUTS].groupId == groupId)
-                    ++numPorts;
-            }
-           #endif
+            if (fData->states[i].key == key)
+                return true;
         }
 
-        return numPorts;
+        return false;
     }
 #endif
 
-    uint32_t getParameterCount() const noexcept
+#if DISTRHO_PLUGIN_WANT_TIMEPOS
+    void setTimePosition(const TimePosition& timePosition) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
 
-        return fData->parameterCount;
+        std::memcpy(&fData->timePosition, &timePosition, sizeof(TimePosition));
     }
+#endif
 
-    uint32_t getParameterOffset() const noexcept
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    // Storage for incoming MIDI, wrappers clear and fill it each block and pass its events to run().
+    MidiEventArena& getMidiInputEvents() noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
-
-        return fData->parameterOffset;
+        return fData->midiInputEvents;
     }
+   #endif
 
-    uint32_t getParameterHints(const uint32_t index) const noexcept
+   #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+    // Get notified when a background state load finishes, the callback is called from the loader thread.
+    void setStateLoadedCallback(const stateLoadedFunc stateLoadedCall) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0x0);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
 
-        return fData->parameters[index].hints;
+        fData->stateLoader.setLoadedCallback(stateLoadedCall, fData->callbacksPtr);
     }
 
-    ParameterDesignation getParameterDesignation(const uint32_t index) const noexcept
+    // States whose background load has finished since last taken, consumed by wrappers to notify hosts and UIs.
+    bool isStateLoading(const uint32_t index) const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, kParameterDesignationNull);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
 
-        return fData->parameters[index].designation;
+        return fData->stateLoader.isLoading(index);
     }
 
-    bool isParameterInput(const uint32_t index) const noexcept
+    ParameterBitset& getLoadedStates() noexcept
     {
-        return (getParameterHints(index) & kParameterIsOutput) == 0x0;
+        return fData->stateLoader.getLoaded();
     }
+   #endif
 
-    bool isParameterOutput(const uint32_t index) const noexcept
+   #if DISTRHO_PLUGIN_WANT_PARALLEL_PROCESSING
+    // Route Plugin::parallelFor through a host-provided thread pool.
+    // The callback returns false if the host rejects the request, in which case tasks run serially.
+    void setParallelForCallback(const parallelForFunc parallelForCall) noexcept
     {
-        return (getParameterHints(index) & kParameterIsOutput) != 0x0;
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
+
+        fData->parallelForCallbackFunc = parallelForCall;
     }
+   #endif
 
-    bool isParameterInteger(const uint32_t index) const noexcept
+    // -------------------------------------------------------------------
+
+    bool isActive() const noexcept
     {
-        return (getParameterHints(index) & kParameterIsInteger) != 0x0;
+        return fIsActive;
     }
 
-    bool isParameterTrigger(const uint32_t index) const noexcept
+    void activate()
     {
-        return (getParameterHints(index) & kParameterIsTrigger) == kParameterIsTrigger;
+        activateInternal(true);
     }
 
-    bool isParameterOutputOrTrigger(const uint32_t index) const noexcept
+    void deactivate()
     {
-        const uint32_t hints = getParameterHints(index);
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(fIsActive,);
 
-        if (hints & kParameterIsOutput)
-            return true;
-        if ((hints & kParameterIsTrigger) == kParameterIsTrigger)
-            return true;
+        fIsActive = false;
+        fPlugin->deactivate();
 
-        return false;
+       #if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+        printProcessingStatsIfNeeded();
+       #endif
     }
 
-    const String& getParameterName(const uint32_t index) const noexcept
+    void deactivateIfNeeded()
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
 
-        return fData->parameters[index].name;
+        if (fIsActive)
+        {
+            fIsActive = false;
+            fPlugin->deactivate();
+
+           #if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+            printProcessingStatsIfNeeded();
+           #endif
+        }
     }
 
-    const String& getParameterShortName(const uint32_t index) const noexcept
+   #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+    // Queue a parameter change to be applied at a specific frame during the next run() call.
+    // Returns false if the queue is full, in which case the caller should apply the value directly.
+    bool addParameterChange(const uint32_t frame, const uint32_t index, const float value) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
+        DISTRHO_SAFE_ASSERT_RETURN(index < fData->parameterCount, false);
 
-        return fData->parameters[index].shortName;
-    }
+        if (fParameterChangeCount == kMaxParameterChanges)
+            return false;
 
-    const String& getParameterSymbol(const uint32_t index) const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
+        // keep the list sorted by frame, hosts usually send changes in order so this is cheap
+        uint32_t i = fParameterChangeCount++;
+        for (; i != 0 && fParameterChanges[i - 1].frame > frame; --i)
+            fParameterChanges[i] = fParameterChanges[i - 1];
 
-        return fData->parameters[index].symbol;
+        ParameterChange& change(fParameterChanges[i]);
+        change.frame = frame;
+        change.index = index;
+        change.value = value;
+        return true;
     }
+   #endif
 
-    const String& getParameterUnit(const uint32_t index) const noexcept
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    void run(const float** const inputs, float** const outputs, const uint32_t frames,
+             const MidiEvent* const midiEvents, const uint32_t midiEventCount)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
-
-        return fData->parameters[index].unit;
+        runAndMeasure(inputs, outputs, frames, midiEvents, midiEventCount);
     }
-
-    const String& getParameterDescription(const uint32_t index) const noexcept
+   #else
+    void run(const float** const inputs, float** const outputs, const uint32_t frames)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackString);
-
-        return fData->parameters[index].description;
+        runAndMeasure(inputs, outputs, frames, nullptr, 0);
     }
+   #endif
 
-    const ParameterEnumerationValues& getParameterEnumValues(const uint32_t index) const noexcept
+   #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    void run(const double** const inputs, double** const outputs, const uint32_t frames,
+             const MidiEvent* const midiEvents, const uint32_t midiEventCount)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackEnumValues);
-
-        return fData->parameters[index].enumValues;
+        runAndMeasure(inputs, outputs, frames, midiEvents, midiEventCount);
     }
-
-    const ParameterRanges& getParameterRanges(const uint32_t index) const noexcept
+   #else
+    void run(const double** const inputs, double** const outputs, const uint32_t frames)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, sFallbackRanges);
-
-        return fData->parameters[index].ranges;
+        runAndMeasure(inputs, outputs, frames, nullptr, 0);
     }
+   #endif
+   #endif
 
-    uint8_t getParameterMidiCC(const uint32_t index) const noexcept
+    // -------------------------------------------------------------------
+
+    uint32_t getTailLength() const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
 
-        return fData->parameters[index].midiCC;
+        return fData->tailLength;
     }
 
-    uint32_t getParameterGroupId(const uint32_t index) const noexcept
+   #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+    // Let the host tell us the inputs for the next run() are silent, saves us from scanning them.
+    void setInputsAreSilent() noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, kPortGroupNone);
-
-        return fData->parameters[index].groupId;
+        fInputsAreSilentHint = true;
     }
 
-    float getParameterDefault(const uint32_t index) const
+    // Whether the last run() call was skipped due to silence, with all outputs cleared.
+    bool areOutputsSilent() const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0.0f);
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0.0f);
-
-        return fData->parameters[index].ranges.def;
+        return fOutputsAreSilent;
     }
+   #endif
 
-    float getParameterValue(const uint32_t index) const
+    // -------------------------------------------------------------------
+
+   #ifdef DISTRHO_PLUGIN_TARGET_AU
+    void setAudioPortIO(const uint16_t numInputs, const uint16_t numOutputs)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, 0.0f);
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount, 0.0f);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
 
-        return fPlugin->getParameterValue(index);
+        if (fIsActive) fPlugin->deactivate();
+        fPlugin->ioChanged(numInputs, numOutputs);
+        if (fIsActive) fPlugin->activate();
     }
+   #endif
+
+    // -------------------------------------------------------------------
 
-    void setParameterValue(const uint32_t index, const float value)
+    uint32_t getBufferSize() const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->parameterCount,);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+        return fData->bufferSize;
+    }
 
-        fPlugin->setParameterValue(index, value);
+    double getSampleRate() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0.0);
+        return fData->sampleRate;
     }
 
-    /*
-    bool getParameterIndexForSymbol(const char* const symbol, uint32_t& index)
+    bool setBufferSize(const uint32_t bufferSize, const bool doCallback = false)
     {
         DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, false);
+        DISTRHO_SAFE_ASSERT(bufferSize >= 2);
 
-        for (uint32_t i=0; i < fData->parameterCount; ++i)
+        if (fData->bufferSize == bufferSize)
+            return false;
+
+        fData->bufferSize = bufferSize;
+
+        for (uint32_t i=0; i < fData->smoothedParameterCount; ++i)
         {
-            if (fData->parameters[i].symbol == symbol)
-            {
-                index = i;
-                return true;
-            }
+            SmoothedParameter& param(fData->smoothedParameters[i]);
+            delete[] param.buffer;
+            param.buffer = new float[bufferSize];
+            param.clearToTarget();
         }
 
-        return false;
+        if (doCallback)
+        {
+            if (fIsActive) fPlugin->deactivate();
+            fPlugin->bufferSizeChanged(bufferSize);
+            if (fIsActive) fPlugin->activate();
+        }
+
+        return true;
     }
-    */
 
-    uint32_t getPortGroupCount() const noexcept
+    void setSampleRate(const double sampleRate, const bool doCallback = false)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+        DISTRHO_SAFE_ASSERT(sampleRate > 0.0);
 
-        return fData->portGroupCount;
-    }
+        if (d_isEqual(fData->sampleRate, sampleRate))
+            return;
 
-    const PortGroupWithId& getPortGroupById(const uint32_t groupId) const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && fData->portGroupCount != 0, sFallbackPortGroup);
+        fData->sampleRate = sampleRate;
 
-        for (uint32_t i=0; i < fData->portGroupCount; ++i)
-        {
-            const PortGroupWithId& portGroup(fData->portGroups[i]);
+        updateSmoothedParameterRamps();
 
-            if (portGroup.groupId == groupId)
-                return portGroup;
+        if (doCallback)
+        {
+            if (fIsActive) fPlugin->deactivate();
+            fPlugin->sampleRateChanged(sampleRate);
+            if (fIsActive) fPlugin->activate();
         }
+    }
 
-        return sFallbackPortGroup;
+    bool isOfflineRendering() const noexcept
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
+        return fData->isOfflineRendering;
     }
 
-    const PortGroupWithId& getPortGroupByIndex(const uint32_t index) const noexcept
+    void setOfflineRendering(const bool offline, const bool doCallback = false)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->portGroupCount, sFallbackPortGroup);
+        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
+        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
 
-        return fData->portGroups[index];
+        if (fData->isOfflineRendering == offline)
+            return;
+
+        fData->isOfflineRendering = offline;
+
+        if (doCallback)
+        {
+            if (fIsActive) fPlugin->deactivate();
+            fPlugin->renderModeChanged(offline);
+            if (fIsActive) fPlugin->activate();
+        }
     }
 
-    const String& getPortGroupSymbolForId(const uint32_t groupId) const noexcept
+private:
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    // -------------------------------------------------------------------
+    // MIDI input storage, see MidiEventArena
+
+    void reserveMidiInputEvents()
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, sFallbackString);
+        // one event per frame of the largest block the host announced, unless configured higher
+        const uint32_t eventCapacity = std::max<uint32_t>(DISTRHO_PLUGIN_MIDI_INPUT_EVENT_CAPACITY, fData->bufferSize);
 
-        return getPortGroupById(groupId).symbol;
+        if (const uint32_t overflowCount = fData->midiInputEvents.getOverflowCount())
+            d_stderr2("DPF: %u incoming MIDI events were dropped, growing event storage", overflowCount);
+
+        fData->midiInputEvents.reserve(eventCapacity, DISTRHO_PLUGIN_MIDI_INPUT_SYSEX_CAPACITY);
+
+       #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+        if (fSegmentMidiEventCapacity < fData->midiInputEvents.getCapacity())
+        {
+            delete[] fSegmentMidiEvents;
+            fSegmentMidiEventCapacity = fData->midiInputEvents.getCapacity();
+            fSegmentMidiEvents = new MidiEvent[fSegmentMidiEventCapacity];
+        }
+       #endif
     }
+   #endif
 
-#if DISTRHO_PLUGIN_WANT_PROGRAMS
-    uint32_t getProgramCount() const noexcept
+private:
+   #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+    static StateObject* loadStateObjectCallback(void* const ptr, const uint32_t index, const char* const value)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
-
-        return fData->programCount;
+        return static_cast<Plugin*>(ptr)->loadStateObject(index, value);
     }
+   #endif
 
-    const String& getProgramName(const uint32_t index) const noexcept
+   #if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+    void printProcessingStatsIfNeeded()
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->programCount, sFallbackString);
+        if (! fData->dumpProcessingStats)
+            return;
 
-        return fData->programNames[index];
-    }
+        const ProcessingStats stats(fData->processingStats.get());
 
-    void loadProgram(const uint32_t index)
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->programCount,);
+        if (stats.blockCount == 0)
+            return;
 
-        fPlugin->loadProgram(index);
+        d_stdout("%s: %u blocks at %u frames, load p50 %.1f%%, p99 %.1f%%, max %.1f%%, %u overruns",
+                 getName(), stats.blockCount, fData->bufferSize,
+                 stats.p50Load * 100.0f, stats.p99Load * 100.0f, stats.maxLoad * 100.0f, stats.overrunCount);
     }
-#endif
+   #endif
 
-#if DISTRHO_PLUGIN_WANT_STATE
-    uint32_t getStateCount() const noexcept
+    // -------------------------------------------------------------------
+    // Symbol hash lookup table for state chunks, sorted by hash with the parameter index in the low bits
+
+    void initParameterSymbolHashes()
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
+        const uint32_t count = fData->parameterCount;
 
-        return fData->stateCount;
-    }
+        if (count == 0)
+            return;
 
-    uint32_t getStateHints(const uint32_t index) const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, 0x0);
+        fParameterSymbolHashes = new uint64_t[count];
 
-        return fData->states[index].hints;
-    }
+        for (uint32_t i=0; i < count; ++i)
+        {
+            if (isParameterOutputOrTrigger(i))
+                continue;
 
-    const String& getStateKey(const uint32_t index) const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+            const uint32_t hash = d_stateSymbolHash(fData->parameters[i].symbol);
+            fParameterSymbolHashes[fParameterSymbolHashCount++] = static_cast<uint64_t>(hash) << 32 | i;
+        }
 
-        return fData->states[index].key;
+        std::sort(fParameterSymbolHashes, fParameterSymbolHashes + fParameterSymbolHashCount);
+
+        for (uint32_t i=1; i < fParameterSymbolHashCount; ++i)
+        {
+            if ((fParameterSymbolHashes[i] >> 32) == (fParameterSymbolHashes[i - 1] >> 32))
+            {
+                d_stderr2("DPF warning: Parameters '%s' and '%s' have the same symbol hash, "
+                          "only the first will be restored from state",
+                          fData->parameters[fParameterSymbolHashes[i - 1] & 0xffffffff].symbol.buffer(),
+                          fData->parameters[fParameterSymbolHashes[i] & 0xffffffff].symbol.buffer());
+            }
+        }
     }
 
-    const String& getStateDefaultValue(const uint32_t index) const noexcept
+    // -------------------------------------------------------------------
+    // Parameter smoothing, see kParameterIsSmoothed
+
+    void initSmoothedParameters()
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+        const uint32_t count = fData->parameterCount;
+        uint32_t smoothedCount = 0;
 
-        return fData->states[index].defaultValue;
-    }
+        for (uint32_t i=0; i < count; ++i)
+        {
+            if (isParameterSmoothed(i))
+                ++smoothedCount;
+        }
 
-    const String& getStateLabel(const uint32_t index) const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+        if (smoothedCount == 0)
+            return;
 
-        return fData->states[index].label;
-    }
+        fData->smoothedParameters = new SmoothedParameter[smoothedCount];
+        fData->smoothedParameterSlots = new uint32_t[count];
+        fData->smoothedParameterCount = smoothedCount;
 
-    const String& getStateDescription(const uint32_t index) const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+        for (uint32_t i=0, slot=0; i < count; ++i)
+        {
+            if (! isParameterSmoothed(i))
+            {
+                fData->smoothedParameterSlots[i] = kNoSmoothedParameterSlot;
+                continue;
+            }
 
-        return fData->states[index].description;
+            SmoothedParameter& param(fData->smoothedParameters[slot]);
+            param.index = i;
+            param.rampFrames = 0;
+            param.remainingFrames = 0;
+            param.current = param.target = fParameterStore.getValue(i);
+            param.step = 0.f;
+            param.buffer = new float[fData->bufferSize];
+            param.constant = true;
+            param.bufferIsFilled = false;
+
+            fData->smoothedParameterSlots[i] = slot++;
+        }
+
+        updateSmoothedParameterRamps();
     }
 
-   #ifdef __MOD_DEVICES__
-    const String& getStateFileTypes(const uint32_t index) const noexcept
+    bool isParameterSmoothed(const uint32_t index) const noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr && index < fData->stateCount, sFallbackString);
+        const uint32_t hints = fData->parameters[index].hints;
 
-        return fData->states[index].fileTypes;
+        if ((hints & kParameterIsSmoothed) == 0x0)
+            return false;
+
+        // smoothing only makes sense for continuous input parameters
+        DISTRHO_SAFE_ASSERT_RETURN((hints & kParameterIsOutput) == 0x0, false);
+        DISTRHO_SAFE_ASSERT_RETURN((hints & kParameterIsTrigger) != kParameterIsTrigger, false);
+        return true;
     }
-   #endif
 
-   #if DISTRHO_PLUGIN_WANT_FULL_STATE
-    String getStateValue(const char* const key) const
+    void updateSmoothedParameterRamps() noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, sFallbackString);
-        DISTRHO_SAFE_ASSERT_RETURN(key != nullptr && key[0] != '\0', sFallbackString);
+        for (uint32_t i=0; i < fData->smoothedParameterCount; ++i)
+        {
+            SmoothedParameter& param(fData->smoothedParameters[i]);
+            const float smoothingTime = fData->parameters[param.index].smoothingTime;
 
-        return fPlugin->getState(key);
+            param.rampFrames = smoothingTime > 0.f
+                             ? static_cast<uint32_t>(smoothingTime * fData->sampleRate + 0.5)
+                             : 0;
+            param.clearToTarget();
+        }
     }
-   #endif
 
-    void setState(const char* const key, const char* const value)
+    void setSmoothedParameterTarget(const uint32_t index, const float value) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(key != nullptr && key[0] != '\0',);
-        DISTRHO_SAFE_ASSERT_RETURN(value != nullptr,);
-
-        fPlugin->setState(key, value);
+        if (fData->smoothedParameterSlots != nullptr && fData->smoothedParameterSlots[index] != kNoSmoothedParameterSlot)
+            fData->smoothedParameters[fData->smoothedParameterSlots[index]].setTarget(value);
     }
 
-    bool wantStateKey(const char* const key) const noexcept
+    void processSmoothedParameters(const uint32_t frames) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
-        DISTRHO_SAFE_ASSERT_RETURN(key != nullptr && key[0] != '\0', false);
+        if (frames == 0)
+            return;
 
-        for (uint32_t i=0; i < fData->stateCount; ++i)
+        const uint32_t bufferSize = fData->bufferSize;
+
+        if (frames > bufferSize)
         {
-            if (fData->states[i].key == key)
-                return true;
+            DISTRHO_SAFE_ASSERT_UINT2(frames <= bufferSize, frames, bufferSize);
+
+            // the ramp cannot be written past the buffer, jump to the target so the buffer is constant
+            for (uint32_t i=0; i < fData->smoothedParameterCount; ++i)
+            {
+                fData->smoothedParameters[i].clearToTarget();
+                fData->smoothedParameters[i].process(bufferSize, bufferSize);
+            }
+            return;
         }
 
-        return false;
+        for (uint32_t i=0; i < fData->smoothedParameterCount; ++i)
+            fData->smoothedParameters[i].process(frames, bufferSize);
     }
-#endif
 
-#if DISTRHO_PLUGIN_WANT_TIMEPOS
-    void setTimePosition(const TimePosition& timePosition) noexcept
+   #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+    void applyParameterChange(const uint32_t index, const float value)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
-
-        std::memcpy(&fData->timePosition, &timePosition, sizeof(TimePosition));
+        fPlugin->setParameterValue(index, value);
+        setSmoothedParameterTarget(index, value);
     }
-#endif
+   #endif
 
     // -------------------------------------------------------------------
+    // Activation, shared by activate() and run()
 
-    bool isActive() const noexcept
-    {
-        return fIsActive;
-    }
-
-    void activate()
+    // Called from run() when the host skipped activate(), possibly on the audio thread.
+    // Thread creation is skipped in that case, parallelFor falls back to running tasks serially.
+    void activateInternal(const bool canStartThreads)
     {
         DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
         DISTRHO_SAFE_ASSERT_RETURN(! fIsActive,);
 
-        fIsActive = true;
-        fPlugin->activate();
-    }
+       #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+        fSilentFrames = 0;
+       #endif
 
-    void deactivate()
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(fIsActive,);
+        for (uint32_t i=0; i < fData->smoothedParameterCount; ++i)
+            fData->smoothedParameters[i].clearToTarget();
 
-        fIsActive = false;
-        fPlugin->deactivate();
-    }
+       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        reserveMidiInputEvents();
+       #endif
 
-    void deactivateIfNeeded()
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+       #if DPF_PLUGIN_HAS_THREAD_POOL
+        // workers are spawned once and kept around, unless the host provides its own thread pool
+        if (canStartThreads && ! fData->isDummy && fData->parallelForCallbackFunc == nullptr)
+            fData->threadPool.start(ThreadPool::getDefaultNumWorkers());
+       #else
+        // unused
+        (void)canStartThreads;
+       #endif
 
-        if (fIsActive)
-        {
-            fIsActive = false;
-            fPlugin->deactivate();
-        }
+       #if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+        fData->processingStats.reset(fData->sampleRate);
+       #endif
+
+       #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+        fData->stateLoader.handOver();
+       #endif
+
+        fIsActive = true;
+        fPlugin->activate();
     }
 
-   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-    void run(const float** const inputs, float** const outputs, const uint32_t frames,
-             const MidiEvent* const midiEvents, const uint32_t midiEventCount)
+    // -------------------------------------------------------------------
+    // Common part of all run() variants, wraps runPlugin with realtime checks and stats
+
+    template<typename T>
+    void runAndMeasure(const T** const inputs, T** const outputs, const uint32_t frames,
+                       const MidiEvent* const midiEvents, const uint32_t midiEventCount)
     {
         DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
         DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
 
+        // hosts that skip activate() still need the full setup done there, except for starting threads
         if (! fIsActive)
-        {
-            fIsActive = true;
-            fPlugin->activate();
-        }
+            activateInternal(false);
 
-        fData->isProcessing = true;
-        fPlugin->run(inputs, outputs, frames, midiEvents, midiEventCount);
-        fData->isProcessing = false;
-    }
-   #else
-    void run(const float** const inputs, float** const outputs, const uint32_t frames)
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+       #if DPF_PLUGIN_HAS_REALTIME_CHECKS
+        const ScopedRealtimeCheck srtc;
+       #endif
 
-        if (! fIsActive)
-        {
-            fIsActive = true;
-            fPlugin->activate();
-        }
+       #if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+        const uint64_t startTime = d_gettime_ns();
+       #endif
 
         fData->isProcessing = true;
-        fPlugin->run(inputs, outputs, frames);
+        runPlugin(inputs, outputs, frames, midiEvents, midiEventCount);
+       #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+        fData->finishScheduledMidiEvents(frames);
+       #endif
         fData->isProcessing = false;
+
+       #if DISTRHO_PLUGIN_WANT_PROCESSING_STATS
+        fData->processingStats.addBlock(frames, d_gettime_ns() - startTime);
+       #endif
     }
-   #endif
 
     // -------------------------------------------------------------------
+    // Run the plugin, skipping silence and splitting blocks as needed
 
-   #ifdef DISTRHO_PLUGIN_TARGET_AU
-    void setAudioPortIO(const uint16_t numInputs, const uint16_t numOutputs)
+    template<typename T>
+    void runPlugin(const T** const inputs, T** const outputs, const uint32_t frames,
+                   const MidiEvent* const midiEvents, const uint32_t midiEventCount)
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
+       #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+        fData->stateLoader.handOver();
+       #endif
 
-        if (fIsActive) fPlugin->deactivate();
-        fPlugin->ioChanged(numInputs, numOutputs);
-        if (fIsActive) fPlugin->activate();
-    }
-   #endif
+       #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+        if (canSkipRun(inputs, frames))
+        {
+            for (uint32_t i = 0; i < DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
+            {
+                if (outputs[i] != nullptr)
+                    BufferOps::clear(outputs[i], frames);
+            }
 
-    // -------------------------------------------------------------------
+           #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+            for (uint32_t i = 0; i < fParameterChangeCount; ++i)
+                applyParameterChange(fParameterChanges[i].index, fParameterChanges[i].value);
+            fParameterChangeCount = 0;
+           #endif
 
-    uint32_t getBufferSize() const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0);
-        return fData->bufferSize;
-    }
+            // nothing to hear, so no point in ramping
+            for (uint32_t i = 0; i < fData->smoothedParameterCount; ++i)
+                fData->smoothedParameters[i].clearToTarget();
+            return;
+        }
+       #endif
 
-    double getSampleRate() const noexcept
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, 0.0);
-        return fData->sampleRate;
+       #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+        if (fParameterChangeCount != 0)
+            return runWithParameterChanges(inputs, outputs, frames, midiEvents, midiEventCount);
+       #endif
+
+        processSmoothedParameters(frames);
+
+       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        fPlugin->run(inputs, outputs, frames, midiEvents, midiEventCount);
+       #else
+        fPlugin->run(inputs, outputs, frames);
+
+        // unused
+        (void)midiEvents;
+        (void)midiEventCount;
+       #endif
     }
 
-    bool setBufferSize(const uint32_t bufferSize, const bool doCallback = false)
+   #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+    template<typename T>
+    bool canSkipRun(const T** const inputs, const uint32_t frames) noexcept
     {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr, false);
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr, false);
-        DISTRHO_SAFE_ASSERT(bufferSize >= 2);
+        const bool inputsAreSilentHint = fInputsAreSilentHint;
+        fInputsAreSilentHint = false;
+        fOutputsAreSilent = false;
 
-        if (fData->bufferSize == bufferSize)
+        // plugin did not tell us its tail, or opted out
+        if (! fData->hasTailLength || fData->tailLength == kTailLengthInfinite)
             return false;
 
-        fData->bufferSize = bufferSize;
+        bool inputsAreSilent = true;
 
-        if (doCallback)
+        if (! inputsAreSilentHint)
         {
-            if (fIsActive) fPlugin->deactivate();
-            fPlugin->bufferSizeChanged(bufferSize);
-            if (fIsActive) fPlugin->activate();
+            for (uint32_t i = 0; i < DISTRHO_PLUGIN_NUM_INPUTS; ++i)
+            {
+                if (inputs[i] != nullptr && ! isBufferSilent(inputs[i], frames))
+                {
+                    inputsAreSilent = false;
+                    break;
+                }
+            }
+        }
+
+        if (! inputsAreSilent)
+        {
+            fSilentFrames = 0;
+            return false;
+        }
+
+        // keep running until delayed output and the tail have fully elapsed
+       #if DISTRHO_PLUGIN_WANT_LATENCY
+        const uint64_t silentFramesNeeded = static_cast<uint64_t>(fData->tailLength) + fData->latency;
+       #else
+        const uint64_t silentFramesNeeded = fData->tailLength;
+       #endif
+
+        if (fSilentFrames < silentFramesNeeded)
+        {
+            fSilentFrames = std::min<uint64_t>(fSilentFrames + frames, silentFramesNeeded);
+            return false;
         }
 
+        fOutputsAreSilent = true;
         return true;
     }
+   #endif
 
-    void setSampleRate(const double sampleRate, const bool doCallback = false)
-    {
-        DISTRHO_SAFE_ASSERT_RETURN(fData != nullptr,);
-        DISTRHO_SAFE_ASSERT_RETURN(fPlugin != nullptr,);
-        DISTRHO_SAFE_ASSERT(sampleRate > 0.0);
+   #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+    // -------------------------------------------------------------------
+    // Sample-accurate parameters, split the block at each change point
+
+    template<typename T>
+    void runWithParameterChanges(const T** const inputs, T** const outputs, const uint32_t frames,
+                                 const MidiEvent* const midiEvents, const uint32_t midiEventCount)
+    {
+        const T* segmentInputs[DISTRHO_PLUGIN_NUM_INPUTS != 0 ? DISTRHO_PLUGIN_NUM_INPUTS : 1];
+        /* */ T* segmentOutputs[DISTRHO_PLUGIN_NUM_OUTPUTS != 0 ? DISTRHO_PLUGIN_NUM_OUTPUTS : 1];
+
+       #if DISTRHO_PLUGIN_WANT_TIMEPOS
+        const uint64_t timePositionFrame = fData->timePosition.frame;
+       #endif
+        const uint32_t minFrames = DISTRHO_PLUGIN_MINIMUM_SUBBLOCK_SIZE;
+        // no segment starts past this point, so the last one is never smaller than minFrames
+        const uint32_t lastSplit = frames > minFrames ? frames - minFrames : 0;
+        uint32_t changeIndex = 0;
+        uint32_t midiIndex = 0;
+        uint32_t segmentFrames;
+
+        for (uint32_t offset = 0; offset < frames; offset += segmentFrames)
+        {
+            // the last segment takes all remaining changes, others those within the minimum segment size
+            const bool isLastSegment = offset + minFrames > lastSplit;
+            const uint32_t applyEnd = isLastSegment ? frames : offset + minFrames;
 
-        if (d_isEqual(fData->sampleRate, sampleRate))
-            return;
+            while (changeIndex < fParameterChangeCount && fParameterChanges[changeIndex].frame < applyEnd)
+            {
+                const ParameterChange& change(fParameterChanges[changeIndex++]);
+                applyParameterChange(change.index, change.value);
+            }
 
-        fData->sampleRate = sampleRate;
+            uint32_t end = frames;
 
-        if (doCallback)
-        {
-            if (fIsActive) fPlugin->deactivate();
-            fPlugin->sampleRateChanged(sampleRate);
-            if (fIsActive) fPlugin->activate();
+            // split at next change, changes too close to the end are moved back to start the last segment
+            if (! isLastSegment && changeIndex < fParameterChangeCount)
+                end = std::min(fParameterChanges[changeIndex].frame, lastSplit);
+
+            segmentFrames = end - offset;
+
+           #if DISTRHO_PLUGIN_NUM_INPUTS > 0
+            for (uint32_t i = 0; i < DISTRHO_PLUGIN_NUM_INPUTS; ++i)
+                segmentInputs[i] = inputs[i] != nullptr ? inputs[i] + offset : nullptr;
+           #else
+            segmentInputs[0] = nullptr;
+           #endif
+           #if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            for (uint32_t i = 0; i < DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
+                segmentOutputs[i] = outputs[i] != nullptr ? outputs[i] + offset : nullptr;
+           #else
+            segmentOutputs[0] = nullptr;
+           #endif
+
+           #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+            fData->runFrameOffset = offset;
+           #endif
+
+           #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+            uint32_t segmentMidiEventCount = 0;
+
+            for (; midiIndex < midiEventCount && (end == frames || midiEvents[midiIndex].frame < end); ++midiIndex)
+            {
+                if (segmentMidiEventCount == fSegmentMidiEventCapacity)
+                    continue;
+
+                MidiEvent& midiEvent(fSegmentMidiEvents[segmentMidiEventCount++]);
+                midiEvent = midiEvents[midiIndex];
+                midiEvent.frame = midiEvent.frame > offset ? midiEvent.frame - offset : 0;
+            }
+
+            processSmoothedParameters(segmentFrames);
+            fPlugin->run(segmentInputs, segmentOutputs, segmentFrames, fSegmentMidiEvents, segmentMidiEventCount);
+           #else
+            processSmoothedParameters(segmentFrames);
+            fPlugin->run(segmentInputs, segmentOutputs, segmentFrames);
+           #endif
+
+           #if DISTRHO_PLUGIN_WANT_TIMEPOS
+            if (fData->timePosition.playing)
+                fData->timePosition.frame += segmentFrames;
+           #endif
         }
+
+        // changes at or past the block end, which hosts should not send, take effect for the next block
+        for (; changeIndex < fParameterChangeCount; ++changeIndex)
+            applyParameterChange(fParameterChanges[changeIndex].index, fParameterChanges[changeIndex].value);
+
+        fParameterChangeCount = 0;
+
+       #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+        fData->runFrameOffset = 0;
+       #endif
+       #if DISTRHO_PLUGIN_WANT_TIMEPOS
+        fData->timePosition.frame = timePositionFrame;
+       #endif
+
+        // unused when not needed
+        (void)inputs;
+        (void)outputs;
+        (void)midiEvents;
+        (void)midiEventCount;
+        (void)midiIndex;
     }
+   #endif
 
-private:
     // -------------------------------------------------------------------
     // Plugin and DistrhoPlugin data
 
@@ -1076,6 +3326,31 @@ private:
     Plugin::PrivateData* const fData;
     bool fIsActive;
 
+    // Last known parameter values, shared with the wrappers
+    ParameterStore fParameterStore;
+
+    uint32_t* fParameterIndices;
+    uint64_t* fParameterSymbolHashes;
+    uint32_t fParameterSymbolHashCount;
+    ParameterIndexList fInputParameters;
+    ParameterIndexList fOutputParameters;
+    ParameterIndexList fTriggerParameters;
+
+   #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+    uint64_t fSilentFrames;
+    bool fInputsAreSilentHint;
+    bool fOutputsAreSilent;
+   #endif
+
+   #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+    ParameterChange fParameterChanges[kMaxParameterChanges];
+    uint32_t fParameterChangeCount;
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    MidiEvent* fSegmentMidiEvents;
+    uint32_t fSegmentMidiEventCapacity;
+   #endif
+   #endif
+
     // -------------------------------------------------------------------
     // Static fallback data, see DistrhoPlugin.cpp
 
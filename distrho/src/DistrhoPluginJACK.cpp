@@ -27,10 +27,28 @@
 # include "../extra/Sleep.hpp"
 #endif
 
-#ifdef DPF_RUNTIME_TESTING
+#if defined(DPF_RUNTIME_TESTING) || ! defined(DISTRHO_OS_WASM)
 # include "../extra/Thread.hpp"
 #endif
 
+#ifndef DISTRHO_OS_WASM
+# include "../extra/Base64.hpp"
+# include "../extra/ScopedPointer.hpp"
+# include "../extra/Time.hpp"
+# include <algorithm>
+# include <vector>
+#endif
+
+#ifdef DPF_RUNTIME_TESTING
+# if DPF_PLUGIN_HAS_REALTIME_CHECKS
+#  include <cerrno>
+#  include <dlfcn.h>
+#  include <execinfo.h>
+#  include <fcntl.h>
+#  include <pthread.h>
+# endif
+#endif
+
 #if defined(HAVE_JACK) && defined(STATIC_BUILD) && !defined(DISTRHO_OS_WASM)
 # define JACKBRIDGE_DIRECT
 #endif
@@ -229,6 +247,7 @@ public:
         jackbridge_set_thread_init_callback(fClient, jackThreadInitCallback, this);
         jackbridge_set_buffer_size_callback(fClient, jackBufferSizeCallback, this);
         jackbridge_set_sample_rate_callback(fClient, jackSampleRateCallback, this);
+        jackbridge_set_freewheel_callback(fClient, jackFreewheelCallback, this);
         jackbridge_set_process_callback(fClient, jackProcessCallback, this);
         jackbridge_on_shutdown(fClient, jackShutdownCallback, this);
 
@@ -361,8 +380,39 @@ protected:
         fPlugin.setSampleRate(nframes, true);
     }
 
+    void jackFreewheel(const bool starting)
+    {
+        // called outside the process callback, reactivate here while processing is held off
+        const MutexLocker cml(fRenderModeLock);
+
+        const bool wasActive = fPlugin.isActive();
+
+        if (wasActive)
+            fPlugin.deactivate();
+
+        fPlugin.setOfflineRendering(starting, true);
+
+        if (wasActive)
+            fPlugin.activate();
+    }
+
     void jackProcess(const jack_nframes_t nframes)
     {
+        const MutexTryLocker cmtl(fRenderModeLock);
+
+        // render mode is changing, output silence for this block
+        if (! cmtl.wasLocked())
+        {
+#if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
+                std::memset(jackbridge_port_get_buffer(fPortAudioOuts[i], nframes), 0, sizeof(float)*nframes);
+#endif
+#if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+            jackbridge_midi_clear_buffer(jackbridge_port_get_buffer(fPortMidiOut, nframes));
+#endif
+            return;
+        }
+
 #if DISTRHO_PLUGIN_NUM_INPUTS > 0
         const float* audioIns[DISTRHO_PLUGIN_NUM_INPUTS];
 
@@ -430,8 +480,8 @@ protected:
 #endif
 
 #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        uint32_t  midiEventCount = 0;
-        MidiEvent midiEvents[512];
+        MidiEventArena& midiEvents(fPlugin.getMidiInputEvents());
+        midiEvents.clear();
 
 # if DISTRHO_PLUGIN_HAS_UI
         while (fNotesRingBuffer.isDataAvailableForReading())
@@ -440,22 +490,14 @@ protected:
             if (! fNotesRingBuffer.readCustomData(midiData, 3))
                 break;
 
-            MidiEvent& midiEvent(midiEvents[midiEventCount++]);
-            midiEvent.frame = 0;
-            midiEvent.size  = 3;
-            std::memcpy(midiEvent.data, midiData, 3);
-
-            if (midiEventCount == 512)
-                break;
+            midiEvents.append(0, midiData, 3);
         }
 # endif
-#else
-        static const uint32_t midiEventCount = 0;
 #endif
 
         void* const midiInBuf = jackbridge_port_get_buffer(fPortEventsIn, nframes);
 
-        if (const uint32_t eventCount = std::min(512u - midiEventCount, jackbridge_midi_get_event_count(midiInBuf)))
+        if (const uint32_t eventCount = jackbridge_midi_get_event_count(midiInBuf))
         {
             jack_midi_event_t jevent;
 
@@ -505,21 +547,13 @@ protected:
 #endif
 
 #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-                MidiEvent& midiEvent(midiEvents[midiEventCount++]);
-
-                midiEvent.frame = jevent.time;
-                midiEvent.size  = static_cast<uint32_t>(jevent.size);
-
-                if (midiEvent.size > MidiEvent::kDataSize)
-                    midiEvent.dataExt = jevent.buffer;
-                else
-                    std::memcpy(midiEvent.data, jevent.buffer, midiEvent.size);
+                midiEvents.append(jevent.time, jevent.buffer, static_cast<uint32_t>(jevent.size));
 #endif
             }
         }
 
 #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        fPlugin.run(audioIns, audioOuts, nframes, midiEvents, midiEventCount);
+        fPlugin.run(audioIns, audioOuts, nframes, midiEvents.getSortedEvents(), midiEvents.getCount());
 #else
         fPlugin.run(audioIns, audioOuts, nframes);
 #endif
@@ -592,6 +626,7 @@ private:
 #endif
 
     jack_client_t* fClient;
+    Mutex fRenderModeLock;
 
 #if DISTRHO_PLUGIN_NUM_INPUTS > 0
     jack_port_t* fPortAudioIns[DISTRHO_PLUGIN_NUM_INPUTS];
@@ -737,6 +772,11 @@ private:
         return 0;
     }
 
+    static void jackFreewheelCallback(int starting, void* ptr)
+    {
+        thisPtr->jackFreewheel(starting != 0);
+    }
+
     static int jackProcessCallback(jack_nframes_t nframes, void* ptr)
     {
         thisPtr->jackProcess(nframes);
@@ -810,6 +850,135 @@ private:
 // -----------------------------------------------------------------------
 
 #ifdef DPF_RUNTIME_TESTING
+#if DPF_PLUGIN_HAS_REALTIME_CHECKS
+/* Real-time safety checks.
+ * Memory allocation, locking, file and console I/O and sleeping are intercepted for the whole process (see hooks below),
+ * and reported when they happen on a thread that is inside PluginExporter::run().
+ * Each unique call stack is recorded once together with how many times it was hit.
+ * Set DPF_RUNTIME_TESTING_ABORT to 1 in the environment to abort on the first violation instead.
+ */
+struct RealtimeViolation {
+    const char* function;
+    uint32_t hits;
+    int numFrames;
+    void* frames[32];
+};
+
+static const uint32_t kMaxRealtimeViolations = 64;
+
+static RealtimeViolation sRealtimeViolations[kMaxRealtimeViolations];
+static uint32_t sRealtimeViolationCount = 0;
+static uint32_t sRealtimeViolationsNotRecorded = 0;
+static volatile int sRealtimeViolationLock = 0;
+static bool sRealtimeChecksEnabled = false;
+static bool sRealtimeChecksAbort = false;
+
+static void enableRealtimeChecks()
+{
+    const char* const abortEnv = std::getenv("DPF_RUNTIME_TESTING_ABORT");
+    sRealtimeChecksAbort = abortEnv != nullptr && std::strcmp(abortEnv, "1") == 0;
+
+    // the first backtrace call loads libgcc, do it now instead of in the middle of a check
+    void* frames[1];
+    backtrace(frames, 1);
+
+    sRealtimeChecksEnabled = true;
+}
+
+static void disableRealtimeChecks()
+{
+    sRealtimeChecksEnabled = false;
+}
+
+static void recordRealtimeViolation(const char* const function)
+{
+    // do not report the allocations and locking done while recording
+    uint32_t& depth(ScopedRealtimeCheck::getDepth());
+    const uint32_t savedDepth = depth;
+    depth = 0;
+
+    void* frames[32];
+    const int numFrames = backtrace(frames, 32);
+
+    if (sRealtimeChecksAbort)
+    {
+        d_stderr2("DPF real-time violation: %s called during run()", function);
+        backtrace_symbols_fd(frames, numFrames, STDERR_FILENO);
+        std::abort();
+    }
+
+    while (__sync_lock_test_and_set(&sRealtimeViolationLock, 1) != 0) {}
+
+    bool found = false;
+
+    for (uint32_t i = 0; i < sRealtimeViolationCount; ++i)
+    {
+        RealtimeViolation& violation(sRealtimeViolations[i]);
+
+        if (violation.function == function &&
+            violation.numFrames == numFrames &&
+            std::memcmp(violation.frames, frames, sizeof(void*) * numFrames) == 0)
+        {
+            ++violation.hits;
+            found = true;
+            break;
+        }
+    }
+
+    if (! found)
+    {
+        if (sRealtimeViolationCount != kMaxRealtimeViolations)
+        {
+            RealtimeViolation& violation(sRealtimeViolations[sRealtimeViolationCount++]);
+            violation.function = function;
+            violation.hits = 1;
+            violation.numFrames = numFrames;
+            std::memcpy(violation.frames, frames, sizeof(void*) * numFrames);
+        }
+        else
+        {
+            ++sRealtimeViolationsNotRecorded;
+        }
+    }
+
+    __sync_lock_release(&sRealtimeViolationLock);
+
+    depth = savedDepth;
+}
+
+static inline void checkRealtimeSafety(const char* const function)
+{
+    if (sRealtimeChecksEnabled && ScopedRealtimeCheck::getDepth() != 0)
+        recordRealtimeViolation(function);
+}
+
+static void printRealtimeViolationReport()
+{
+    if (sRealtimeViolationCount == 0)
+    {
+        d_stdout("Real-time safety checks: no violations found");
+        return;
+    }
+
+    d_stderr2("Real-time safety checks: %u unique violations found during run()", sRealtimeViolationCount);
+
+    for (uint32_t i = 0; i < sRealtimeViolationCount; ++i)
+    {
+        const RealtimeViolation& violation(sRealtimeViolations[i]);
+
+        d_stderr2("#%u: %s, called %u times from:", i + 1, violation.function, violation.hits);
+
+        // skip the frames of the checker itself
+        const int skipFrames = violation.numFrames > 2 ? 2 : 0;
+        std::fflush(stderr);
+        backtrace_symbols_fd(violation.frames + skipFrames, violation.numFrames - skipFrames, STDERR_FILENO);
+    }
+
+    if (sRealtimeViolationsNotRecorded != 0)
+        d_stderr2("%u more violations were not recorded", sRealtimeViolationsNotRecorded);
+}
+#endif
+
 class PluginProcessTestingThread : public Thread
 {
     PluginExporter& plugin;
@@ -887,10 +1056,22 @@ bool runSelfTests()
         for (int i=0; i<DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
             outputs[i] = buffer;
 
-       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        plugin.run(inputs, outputs, 128, nullptr, 0);
-       #else
-        plugin.run(inputs, outputs, 128);
+       #if DPF_PLUGIN_HAS_REALTIME_CHECKS
+        enableRealtimeChecks();
+       #endif
+
+        // a few blocks, so that work done only on the first run is not mistaken for steady state
+        for (int i=0; i<8; ++i)
+        {
+           #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+            plugin.run(inputs, outputs, 128, nullptr, 0);
+           #else
+            plugin.run(inputs, outputs, 128);
+           #endif
+        }
+
+       #if DPF_PLUGIN_HAS_REALTIME_CHECKS
+        disableRealtimeChecks();
        #endif
 
         plugin.deactivate();
@@ -900,6 +1081,10 @@ bool runSelfTests()
        #endif
     }
 
+   #if DPF_PLUGIN_HAS_REALTIME_CHECKS
+    printRealtimeViolationReport();
+   #endif
+
     return true;
 
     // multi-threaded processing with UI
@@ -957,64 +1142,1486 @@ bool runSelfTests()
 }
 #endif // DPF_RUNTIME_TESTING
 
-END_NAMESPACE_DISTRHO
+#ifndef DISTRHO_OS_WASM
+// -----------------------------------------------------------------------
+// Offline rendering, processes audio and MIDI files as fast as possible
+
+// about 1 second of audio per chunk, with a few chunks in flight between the I/O and render threads
+static const uint32_t kRenderChunkFrames = 65536;
+static const uint32_t kRenderChunkCount = 4;
+
+static inline uint16_t readLE16(const uint8_t* const data) noexcept
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static inline uint32_t readLE32(const uint8_t* const data) noexcept
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8)
+         | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+static inline uint32_t readBE32(const uint8_t* const data) noexcept
+{
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16)
+         | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+static inline void writeLE16(uint8_t* const data, const uint16_t value) noexcept
+{
+    data[0] = static_cast<uint8_t>(value);
+    data[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static inline void writeLE32(uint8_t* const data, const uint32_t value) noexcept
+{
+    data[0] = static_cast<uint8_t>(value);
+    data[1] = static_cast<uint8_t>(value >> 8);
+    data[2] = static_cast<uint8_t>(value >> 16);
+    data[3] = static_cast<uint8_t>(value >> 24);
+}
+
+static bool readWholeFile(const char* const filename, std::vector<uint8_t>& data)
+{
+    std::FILE* const file = std::fopen(filename, "rb");
+    DISTRHO_SAFE_ASSERT_RETURN(file != nullptr, false);
+
+    uint8_t buffer[16384];
+    for (std::size_t r; (r = std::fread(buffer, 1, sizeof(buffer), file)) != 0;)
+        data.insert(data.end(), buffer, buffer + r);
+
+    std::fclose(file);
+    return true;
+}
 
 // -----------------------------------------------------------------------
+// WAV file reading, supports 8/16/24/32-bit integer and 32/64-bit float
 
-int main(int argc, char* argv[])
+class RenderWavReader
 {
-    USE_NAMESPACE_DISTRHO;
+public:
+    RenderWavReader()
+        : fFile(nullptr),
+          fFormat(0),
+          fBits(0),
+          fChannels(0),
+          fSampleRate(0),
+          fFrameCount(0),
+          fFramesLeft(0) {}
+
+    ~RenderWavReader()
+    {
+        if (fFile != nullptr)
+            std::fclose(fFile);
+    }
 
-    initSignalHandler();
+    bool open(const char* const filename)
+    {
+        fFile = std::fopen(filename, "rb");
 
-   #ifndef STATIC_BUILD
-    // find plugin bundle
-    static String bundlePath;
-    if (bundlePath.isEmpty())
+        if (fFile == nullptr)
+        {
+            d_stderr2("Failed to open '%s' for reading", filename);
+            return false;
+        }
+
+        uint8_t header[12];
+        if (std::fread(header, 1, 12, fFile) != 12
+            || std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0)
+        {
+            d_stderr2("'%s' is not a WAV file", filename);
+            return false;
+        }
+
+        bool hasFormat = false;
+
+        for (uint8_t chunk[8]; std::fread(chunk, 1, 8, fFile) == 8;)
+        {
+            const uint32_t chunkSize = readLE32(chunk + 4);
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+            {
+                uint8_t fmt[40] = {};
+                const uint32_t fmtSize = std::min<uint32_t>(chunkSize, sizeof(fmt));
+                if (std::fread(fmt, 1, fmtSize, fFile) != fmtSize)
+                    break;
+
+                fFormat = readLE16(fmt);
+                fChannels = readLE16(fmt + 2);
+                fSampleRate = readLE32(fmt + 4);
+                fBits = readLE16(fmt + 14);
+
+                // WAVE_FORMAT_EXTENSIBLE, the real format is in the subformat GUID
+                if (fFormat == 0xFFFE && fmtSize >= 26)
+                    fFormat = readLE16(fmt + 24);
+
+                hasFormat = true;
+                std::fseek(fFile, static_cast<long>(chunkSize - fmtSize + (chunkSize & 1)), SEEK_CUR);
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0)
+            {
+                if (! hasFormat)
+                    break;
+
+                if (! (fFormat == 1 && (fBits == 8 || fBits == 16 || fBits == 24 || fBits == 32))
+                    && ! (fFormat == 3 && (fBits == 32 || fBits == 64)))
+                {
+                    d_stderr2("'%s' uses an unsupported sample format (format %u, %u bits)",
+                              filename, fFormat, fBits);
+                    return false;
+                }
+
+                if (fChannels == 0)
+                    break;
+
+                fFrameCount = fFramesLeft = chunkSize / (fChannels * fBits / 8);
+                return true;
+            }
+            else
+            {
+                std::fseek(fFile, static_cast<long>(chunkSize + (chunkSize & 1)), SEEK_CUR);
+            }
+        }
+
+        d_stderr2("'%s' has no valid audio data", filename);
+        return false;
+    }
+
+    uint32_t getChannelCount() const noexcept
     {
-        String tmpPath(getBinaryFilename());
-        tmpPath.truncate(tmpPath.rfind(DISTRHO_OS_SEP));
-      #if defined(DISTRHO_OS_MAC)
-        if (tmpPath.endsWith("/MacOS"))
+        return fChannels;
+    }
+
+    uint32_t getSampleRate() const noexcept
+    {
+        return fSampleRate;
+    }
+
+    uint64_t getFrameCount() const noexcept
+    {
+        return fFrameCount;
+    }
+
+    // Reads the next frames into planar buffers, padding with silence past the end of the file.
+    // A mono file is sent to all channels, otherwise file channels map 1:1 and the rest is silent.
+    bool read(float** const buffers, const uint32_t channels, const uint32_t frames)
+    {
+        const uint32_t framesToRead = static_cast<uint32_t>(std::min<uint64_t>(frames, fFramesLeft));
+        const uint32_t bytesPerSample = fBits / 8;
+        const uint32_t frameSize = fChannels * bytesPerSample;
+
+        fBuffer.resize(static_cast<std::size_t>(framesToRead) * frameSize);
+
+        if (framesToRead != 0 && std::fread(fBuffer.data(), frameSize, framesToRead, fFile) != framesToRead)
+            return false;
+
+        fFramesLeft -= framesToRead;
+
+        for (uint32_t c = 0; c < channels; ++c)
         {
-            tmpPath.truncate(tmpPath.rfind('/'));
-            if (tmpPath.endsWith("/Contents"))
+            float* const buffer = buffers[c];
+            const uint32_t fileChannel = fChannels == 1 ? 0 : c;
+
+            if (fileChannel >= fChannels)
             {
-                tmpPath.truncate(tmpPath.rfind('/'));
-                bundlePath = tmpPath;
-                d_nextBundlePath = bundlePath.buffer();
+                std::memset(buffer, 0, sizeof(float) * frames);
+                continue;
+            }
+
+            const uint8_t* data = fBuffer.data() + fileChannel * bytesPerSample;
+
+            for (uint32_t i = 0; i < framesToRead; ++i, data += frameSize)
+                buffer[i] = decodeSample(data);
+
+            if (framesToRead != frames)
+                std::memset(buffer + framesToRead, 0, sizeof(float) * (frames - framesToRead));
+        }
+
+        return true;
+    }
+
+private:
+    std::FILE* fFile;
+    uint16_t fFormat;
+    uint16_t fBits;
+    uint32_t fChannels;
+    uint32_t fSampleRate;
+    uint64_t fFrameCount;
+    uint64_t fFramesLeft;
+    std::vector<uint8_t> fBuffer;
+
+    float decodeSample(const uint8_t* const data) const noexcept
+    {
+        if (fFormat == 3)
+        {
+            if (fBits == 64)
+            {
+                const uint64_t bits = readLE32(data) | (static_cast<uint64_t>(readLE32(data + 4)) << 32);
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return static_cast<float>(value);
             }
+
+            const uint32_t bits = readLE32(data);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
         }
-      #else
-       #ifdef DISTRHO_OS_WINDOWS
-        const DWORD attr = GetFileAttributesA(tmpPath + DISTRHO_OS_SEP_STR "resources");
-        if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0)
-       #else
-        if (access(tmpPath + DISTRHO_OS_SEP_STR "resources", F_OK) == 0)
-       #endif
+
+        switch (fBits)
         {
-            bundlePath = tmpPath;
-            d_nextBundlePath = bundlePath.buffer();
+        case 8:
+            return static_cast<float>(static_cast<int>(data[0]) - 128) / 128.f;
+        case 16:
+            return static_cast<float>(static_cast<int16_t>(readLE16(data))) / 32768.f;
+        case 24:
+            return static_cast<float>(static_cast<int32_t>((data[0] << 8) | (data[1] << 16) | (data[2] << 24)) >> 8)
+                 / 8388608.f;
+        default:
+            return static_cast<float>(static_cast<int32_t>(readLE32(data)) / 2147483648.0);
         }
-      #endif
     }
-   #endif
 
-   #ifdef DPF_USING_LD_LINUX_WEBVIEW
-    if (argc >= 2 && std::strcmp(argv[1], "dpf-ld-linux-webview") == 0)
-        return dpf_webview_start(argc - 1, argv + 1);
-   #endif
+    DISTRHO_DECLARE_NON_COPYABLE(RenderWavReader)
+};
 
-    if (argc == 2 && std::strcmp(argv[1], "selftest") == 0)
+// -----------------------------------------------------------------------
+// WAV file writing, always as 32-bit float so renders are bit-exact
+
+class RenderWavWriter
+{
+public:
+    RenderWavWriter()
+        : fFile(nullptr),
+          fChannels(0),
+          fDataSize(0) {}
+
+    ~RenderWavWriter()
     {
-       #ifdef DPF_RUNTIME_TESTING
-        return runSelfTests() ? 0 : 1;
-       #else
-        d_stderr2("Code was built without DPF_RUNTIME_TESTING macro enabled, selftest option is not available");
-        return 1;
-       #endif
+        if (fFile != nullptr)
+            std::fclose(fFile);
+    }
+
+    bool open(const char* const filename, const uint32_t channels, const uint32_t sampleRate)
+    {
+        fFile = std::fopen(filename, "wb");
+
+        if (fFile == nullptr)
+        {
+            d_stderr2("Failed to open '%s' for writing", filename);
+            return false;
+        }
+
+        fChannels = channels;
+
+        // sizes are filled in by close()
+        uint8_t header[44] = {};
+        std::memcpy(header, "RIFF", 4);
+        std::memcpy(header + 8, "WAVEfmt ", 8);
+        writeLE32(header + 16, 16);
+        writeLE16(header + 20, 3);
+        writeLE16(header + 22, static_cast<uint16_t>(channels));
+        writeLE32(header + 24, sampleRate);
+        writeLE32(header + 28, sampleRate * channels * 4);
+        writeLE16(header + 32, static_cast<uint16_t>(channels * 4));
+        writeLE16(header + 34, 32);
+        std::memcpy(header + 36, "data", 4);
+
+        return std::fwrite(header, 1, sizeof(header), fFile) == sizeof(header);
+    }
+
+    bool write(const float* const* const buffers, const uint32_t frames)
+    {
+        fBuffer.resize(static_cast<std::size_t>(frames) * fChannels * 4);
+
+        uint8_t* data = fBuffer.data();
+        for (uint32_t i = 0; i < frames; ++i)
+        {
+            for (uint32_t c = 0; c < fChannels; ++c, data += 4)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &buffers[c][i], sizeof(bits));
+                writeLE32(data, bits);
+            }
+        }
+
+        if (std::fwrite(fBuffer.data(), 1, fBuffer.size(), fFile) != fBuffer.size())
+            return false;
+
+        fDataSize += fBuffer.size();
+        return true;
     }
 
+    bool close()
+    {
+        DISTRHO_SAFE_ASSERT_RETURN(fFile != nullptr, false);
+
+        if (fDataSize > 0xFFFFFFFFULL - 36)
+            d_stderr2("Output is larger than 4GiB, the WAV header will be invalid");
+
+        uint8_t size[4];
+        bool ok = true;
+
+        writeLE32(size, static_cast<uint32_t>(fDataSize + 36));
+        ok &= std::fseek(fFile, 4, SEEK_SET) == 0 && std::fwrite(size, 1, 4, fFile) == 4;
+
+        writeLE32(size, static_cast<uint32_t>(fDataSize));
+        ok &= std::fseek(fFile, 40, SEEK_SET) == 0 && std::fwrite(size, 1, 4, fFile) == 4;
+
+        ok &= std::fclose(fFile) == 0;
+        fFile = nullptr;
+        return ok;
+    }
+
+private:
+    std::FILE* fFile;
+    uint32_t fChannels;
+    uint64_t fDataSize;
+    std::vector<uint8_t> fBuffer;
+
+    DISTRHO_DECLARE_NON_COPYABLE(RenderWavWriter)
+};
+
+#if DISTRHO_PLUGIN_WANT_MIDI_INPUT || DISTRHO_PLUGIN_WANT_TIMEPOS
+// -----------------------------------------------------------------------
+// Standard MIDI file reading, all tracks merged and converted to frames
+
+class RenderMidiFile
+{
+public:
+    struct Event {
+        uint64_t frame;
+        uint32_t offset; // into fData
+        uint32_t size;
+    };
+
+    RenderMidiFile()
+        : fDivision(0),
+          fEndFrame(0) {}
+
+    bool load(const char* const filename, const double sampleRate)
+    {
+        std::vector<uint8_t> file;
+
+        if (! readWholeFile(filename, file))
+        {
+            d_stderr2("Failed to open '%s' for reading", filename);
+            return false;
+        }
+
+        if (file.size() < 14 || std::memcmp(file.data(), "MThd", 4) != 0 || readBE32(file.data() + 4) < 6)
+        {
+            d_stderr2("'%s' is not a standard MIDI file", filename);
+            return false;
+        }
+
+        const uint8_t* const header = file.data() + 8;
+        const uint32_t trackCount = static_cast<uint32_t>((header[2] << 8) | header[3]);
+        fDivision = static_cast<uint16_t>((header[4] << 8) | header[5]);
+
+        std::vector<TickEvent> events;
+        std::size_t pos = 8 + readBE32(file.data() + 4);
+
+        for (uint32_t t = 0; t < trackCount && pos + 8 <= file.size(); ++t)
+        {
+            const uint32_t trackSize = readBE32(file.data() + pos + 4);
+            const bool isTrack = std::memcmp(file.data() + pos, "MTrk", 4) == 0;
+            pos += 8;
+
+            if (trackSize > file.size() - pos)
+            {
+                d_stderr2("'%s' has a truncated track", filename);
+                return false;
+            }
+
+            if (isTrack && ! parseTrack(file.data() + pos, trackSize, events))
+            {
+                d_stderr2("'%s' has an invalid track", filename);
+                return false;
+            }
+
+            pos += trackSize;
+        }
+
+        // merge tracks, stable so that events at the same tick keep their track order
+        std::stable_sort(events.begin(), events.end(), TickEvent::compare);
+
+        TempoSegment segment;
+        segment.tick = 0;
+        segment.frame = 0.0;
+        segment.bar = 0.0;
+        segment.usPerQuarter = 500000.0;
+        segment.beatsPerBar = 4.f;
+        segment.beatType = 4.f;
+        fTempoMap.push_back(segment);
+
+        for (std::size_t i = 0; i < events.size(); ++i)
+        {
+            const TickEvent& ev(events[i]);
+            const uint64_t frame = static_cast<uint64_t>(getFrameForTick(ev.tick, sampleRate) + 0.5);
+
+            switch (ev.type)
+            {
+            case kTypeMidi: {
+                Event event;
+                event.frame = frame;
+                event.offset = ev.offset;
+                event.size = ev.size;
+                fEvents.push_back(event);
+                break;
+            }
+            case kTypeTempo:
+            case kTypeTimeSignature:
+                if (isSMPTE())
+                    break;
+                segment = getSegmentAtTick(ev.tick, sampleRate);
+                if (ev.type == kTypeTempo)
+                {
+                    const uint8_t* const d = &fData[ev.offset];
+                    segment.usPerQuarter = static_cast<double>((d[0] << 16) | (d[1] << 8) | d[2]);
+                }
+                else
+                {
+                    segment.beatsPerBar = fData[ev.offset];
+                    segment.beatType = static_cast<float>(1 << std::min<uint8_t>(fData[ev.offset + 1], 6));
+                }
+                if (fTempoMap.back().tick == segment.tick)
+                    fTempoMap.back() = segment;
+                else
+                    fTempoMap.push_back(segment);
+                break;
+            case kTypeEndOfTrack:
+                break;
+            }
+
+            fEndFrame = std::max(fEndFrame, frame);
+        }
+
+        return true;
+    }
+
+    const std::vector<Event>& getEvents() const noexcept
+    {
+        return fEvents;
+    }
+
+    const uint8_t* getEventData(const Event& event) const noexcept
+    {
+        return &fData[event.offset];
+    }
+
+    uint64_t getEndFrame() const noexcept
+    {
+        return fEndFrame;
+    }
+
+   #if DISTRHO_PLUGIN_WANT_TIMEPOS
+    // musical position for a frame, using the tempo and time signature changes of the file
+    void fillTimePosition(TimePosition& timePos, const uint64_t frame, const double sampleRate) const
+    {
+        if (isSMPTE() || fTempoMap.empty())
+        {
+            timePos.bbt.valid = false;
+            return;
+        }
+
+        std::size_t s = fTempoMap.size() - 1;
+        while (s != 0 && fTempoMap[s].frame > static_cast<double>(frame))
+            --s;
+
+        const TempoSegment& seg(fTempoMap[s]);
+        const double quarters = (frame - seg.frame) / sampleRate * 1e6 / seg.usPerQuarter;
+        const double beats = quarters * seg.beatType / 4.0;
+        const double bars = seg.bar + beats / seg.beatsPerBar;
+        const double barFloor = std::floor(bars);
+        const double beatInBar = (bars - barFloor) * seg.beatsPerBar;
+        const double ticksPerBeat = fDivision * 4.0 / seg.beatType;
+
+        timePos.bbt.valid = true;
+        timePos.bbt.bar = static_cast<int32_t>(barFloor) + 1;
+        timePos.bbt.beat = static_cast<int32_t>(beatInBar) + 1;
+        timePos.bbt.tick = (beatInBar - std::floor(beatInBar)) * ticksPerBeat;
+        timePos.bbt.barStartTick = barFloor * seg.beatsPerBar * ticksPerBeat;
+        timePos.bbt.beatsPerBar = seg.beatsPerBar;
+        timePos.bbt.beatType = seg.beatType;
+        timePos.bbt.ticksPerBeat = ticksPerBeat;
+        timePos.bbt.beatsPerMinute = 60e6 / seg.usPerQuarter;
+    }
+   #endif
+
+private:
+    enum EventType {
+        kTypeMidi,
+        kTypeTempo,
+        kTypeTimeSignature,
+        kTypeEndOfTrack
+    };
+
+    struct TickEvent {
+        uint64_t tick;
+        uint32_t offset;
+        uint32_t size;
+        EventType type;
+
+        static bool compare(const TickEvent& a, const TickEvent& b) noexcept
+        {
+            return a.tick < b.tick;
+        }
+    };
+
+    struct TempoSegment {
+        uint64_t tick;
+        double frame;
+        double bar;
+        double usPerQuarter;
+        float beatsPerBar;
+        float beatType;
+    };
+
+    uint16_t fDivision;
+    uint64_t fEndFrame;
+    std::vector<uint8_t> fData;
+    std::vector<Event> fEvents;
+    std::vector<TempoSegment> fTempoMap;
+
+    bool isSMPTE() const noexcept
+    {
+        return (fDivision & 0x8000) != 0;
+    }
+
+    double getFrameForTick(const uint64_t tick, const double sampleRate) const
+    {
+        if (isSMPTE())
+        {
+            const int fps = -static_cast<int8_t>(fDivision >> 8);
+            const int ticksPerFrame = fDivision & 0xFF;
+            return static_cast<double>(tick) * sampleRate / (fps * ticksPerFrame);
+        }
+
+        std::size_t s = fTempoMap.size() - 1;
+        while (s != 0 && fTempoMap[s].tick > tick)
+            --s;
+
+        const TempoSegment& seg(fTempoMap[s]);
+        return seg.frame + (tick - seg.tick) * seg.usPerQuarter * 1e-6 * sampleRate / fDivision;
+    }
+
+    TempoSegment getSegmentAtTick(const uint64_t tick, const double sampleRate) const
+    {
+        const TempoSegment& last(fTempoMap.back());
+        const double quarters = static_cast<double>(tick - last.tick) / fDivision;
+
+        TempoSegment segment(last);
+        segment.tick = tick;
+        segment.frame = getFrameForTick(tick, sampleRate);
+        segment.bar = last.bar + quarters * last.beatType / 4.0 / last.beatsPerBar;
+        return segment;
+    }
+
+    static bool readVarLen(const uint8_t* const data, const uint32_t size, uint32_t& pos, uint32_t& value) noexcept
+    {
+        value = 0;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (pos >= size)
+                return false;
+
+            const uint8_t byte = data[pos++];
+            value = (value << 7) | (byte & 0x7F);
+
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    void addEvent(std::vector<TickEvent>& events, const uint64_t tick, const EventType type,
+                  const uint8_t prefix, const uint8_t* const data, const uint32_t size)
+    {
+        TickEvent event;
+        event.tick = tick;
+        event.offset = static_cast<uint32_t>(fData.size());
+        event.size = size + (prefix != 0 ? 1 : 0);
+        event.type = type;
+
+        if (prefix != 0)
+            fData.push_back(prefix);
+        fData.insert(fData.end(), data, data + size);
+        events.push_back(event);
+    }
+
+    bool parseTrack(const uint8_t* const data, const uint32_t size, std::vector<TickEvent>& events)
+    {
+        uint64_t tick = 0;
+        uint8_t runningStatus = 0;
+
+        for (uint32_t pos = 0, delta, length; pos < size;)
+        {
+            if (! readVarLen(data, size, pos, delta) || pos >= size)
+                return false;
+
+            tick += delta;
+
+            uint8_t status = data[pos];
+
+            if (status < 0x80)
+            {
+                if (runningStatus == 0)
+                    return false;
+                status = runningStatus;
+            }
+            else
+            {
+                ++pos;
+            }
+
+            if (status == 0xFF)
+            {
+                if (pos >= size)
+                    return false;
+
+                const uint8_t type = data[pos++];
+
+                if (! readVarLen(data, size, pos, length) || length > size - pos)
+                    return false;
+
+                if (type == 0x51 && length == 3)
+                    addEvent(events, tick, kTypeTempo, 0, data + pos, 3);
+                else if (type == 0x58 && length >= 2)
+                    addEvent(events, tick, kTypeTimeSignature, 0, data + pos, 2);
+                else if (type == 0x2F)
+                    addEvent(events, tick, kTypeEndOfTrack, 0, nullptr, 0);
+
+                pos += length;
+            }
+            else if (status == 0xF0 || status == 0xF7)
+            {
+                if (! readVarLen(data, size, pos, length) || length > size - pos)
+                    return false;
+
+                // 0xF0 starts a SysEx message, 0xF7 is an escape for arbitrary bytes
+                if (length != 0)
+                    addEvent(events, tick, kTypeMidi, status == 0xF0 ? 0xF0 : 0, data + pos, length);
+
+                pos += length;
+                runningStatus = 0;
+            }
+            else
+            {
+                length = (status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0 ? 1 : 2;
+
+                if (length > size - pos)
+                    return false;
+
+                addEvent(events, tick, kTypeMidi, status, data + pos, length);
+
+                pos += length;
+                runningStatus = status;
+            }
+        }
+
+        return true;
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(RenderMidiFile)
+};
+#endif
+
+// -----------------------------------------------------------------------
+// Plugin state loading, accepts the same data as VST3 and CLAP chunks, either raw or base64 encoded
+
+static bool loadRenderState(PluginExporter& plugin, const char* const filename)
+{
+    std::vector<uint8_t> data;
+
+    if (! readWholeFile(filename, data))
+    {
+        d_stderr2("Failed to open '%s' for reading", filename);
+        return false;
+    }
+
+    if (std::find(data.begin(), data.end(), '\0') == data.end())
+    {
+        data.push_back('\0');
+        data = d_getChunkFromBase64String(reinterpret_cast<const char*>(data.data()));
+    }
+
+    // make sure the last legacy string is terminated
+    data.push_back('\0');
+
+    StateChunkReader chunk(data.data(), data.size());
+
+    if (! chunk.isValid())
+    {
+        d_stderr2("Invalid plugin state in '%s'", filename);
+        return false;
+    }
+
+   #if DISTRHO_PLUGIN_WANT_PROGRAMS
+    const int32_t program = chunk.getProgram();
+    if (program >= 0 && static_cast<uint32_t>(program) < plugin.getProgramCount())
+        plugin.loadProgram(static_cast<uint32_t>(program));
+   #endif
+
+   #if DISTRHO_PLUGIN_WANT_STATE
+    for (const char *key, *value; chunk.readNextState(key, value);)
+    {
+        if (plugin.wantStateKey(key))
+            plugin.setState(key, value);
+    }
+   #endif
+
+    uint32_t symbolHash, index;
+    for (float value; chunk.readNextParameter(symbolHash, value);)
+    {
+        if (plugin.findParameterBySymbolHash(symbolHash, index))
+            plugin.setParameterValue(index, value);
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------
+// File I/O thread, reads input and writes output in large chunks while the plugin runs
+
+class RenderFileThread : public Thread
+{
+public:
+    RenderFileThread(RenderWavReader* const reader, RenderWavWriter& writer,
+                     const uint64_t totalFrames, const uint32_t chunkFrames, const uint32_t skipFrames)
+        : Thread("DPF render I/O"),
+          fReader(reader),
+          fWriter(writer),
+          fTotalFrames(totalFrames),
+          fChunkFrames(chunkFrames),
+          fChunkCount(static_cast<uint32_t>((totalFrames + chunkFrames - 1) / chunkFrames)),
+          fSkipFrames(skipFrames),
+          fFilled(0),
+          fProcessed(0),
+          fFailed(false)
+    {
+        for (uint32_t i = 0; i < kRenderChunkCount; ++i)
+        {
+            for (uint32_t c = 0; c < kInputCount; ++c)
+            {
+                fInputData[i][c].resize(chunkFrames);
+                fInputs[i][c] = fInputData[i][c].data();
+            }
+
+            for (uint32_t c = 0; c < kOutputCount; ++c)
+            {
+                fOutputData[i][c].resize(chunkFrames);
+                fOutputs[i][c] = fOutputData[i][c].data();
+            }
+        }
+    }
+
+    uint32_t getChunkCount() const noexcept
+    {
+        return fChunkCount;
+    }
+
+    uint32_t getChunkFrames(const uint32_t chunk) const noexcept
+    {
+        return static_cast<uint32_t>(std::min<uint64_t>(fChunkFrames,
+                                                        fTotalFrames - static_cast<uint64_t>(chunk) * fChunkFrames));
+    }
+
+    // Wait for the next input chunk to be available, returns false on I/O errors.
+    bool waitForChunk(const uint32_t chunk, float**& inputs, float**& outputs)
+    {
+        for (;;)
+        {
+            {
+                const MutexLocker cml(fLock);
+
+                if (fFailed)
+                    return false;
+
+                if (fFilled > chunk)
+                    break;
+            }
+
+            fChunkReady.wait();
+        }
+
+        inputs = fInputs[chunk % kRenderChunkCount];
+        outputs = fOutputs[chunk % kRenderChunkCount];
+        return true;
+    }
+
+    void finishChunk() noexcept
+    {
+        {
+            const MutexLocker cml(fLock);
+            ++fProcessed;
+        }
+
+        fWorkAvailable.signal();
+    }
+
+    bool hasFailed() noexcept
+    {
+        const MutexLocker cml(fLock);
+        return fFailed;
+    }
+
+    // Stops the thread once all processed chunks have been written.
+    void stop() noexcept
+    {
+        signalThreadShouldExit();
+        fWorkAvailable.signal();
+        stopThread(-1);
+    }
+
+protected:
+    void run() override
+    {
+        uint32_t filled = 0, written = 0;
+
+        // when asked to exit, chunks already processed are still written
+        while (written < fChunkCount)
+        {
+            uint32_t processed;
+            {
+                const MutexLocker cml(fLock);
+                processed = fProcessed;
+            }
+
+            bool ok = true;
+
+            // writing first, as that frees up chunks for reading
+            if (written < processed)
+            {
+                ok = writeChunk(written);
+                ++written;
+            }
+            else if (shouldThreadExit())
+            {
+                break;
+            }
+            else if (filled < fChunkCount && filled - written < kRenderChunkCount)
+            {
+                const uint32_t slot = filled % kRenderChunkCount;
+
+                if (fReader != nullptr)
+                    ok = fReader->read(fInputs[slot], kInputCount, getChunkFrames(filled));
+
+                ++filled;
+                {
+                    const MutexLocker cml(fLock);
+                    fFilled = filled;
+                }
+                fChunkReady.signal();
+            }
+            else
+            {
+                fWorkAvailable.wait();
+            }
+
+            if (! ok)
+            {
+                {
+                    const MutexLocker cml(fLock);
+                    fFailed = true;
+                }
+                fChunkReady.signal();
+                break;
+            }
+        }
+    }
+
+private:
+    static const uint32_t kInputCount = DISTRHO_PLUGIN_NUM_INPUTS;
+    static const uint32_t kOutputCount = DISTRHO_PLUGIN_NUM_OUTPUTS;
+
+    RenderWavReader* const fReader;
+    RenderWavWriter& fWriter;
+    const uint64_t fTotalFrames;
+    const uint32_t fChunkFrames;
+    const uint32_t fChunkCount;
+    uint32_t fSkipFrames;
+
+    std::vector<float> fInputData[kRenderChunkCount][kInputCount > 0 ? kInputCount : 1];
+    std::vector<float> fOutputData[kRenderChunkCount][kOutputCount > 0 ? kOutputCount : 1];
+    float* fInputs[kRenderChunkCount][kInputCount > 0 ? kInputCount : 1];
+    float* fOutputs[kRenderChunkCount][kOutputCount > 0 ? kOutputCount : 1];
+
+    Mutex fLock;
+    Signal fChunkReady;
+    Signal fWorkAvailable;
+    uint32_t fFilled;
+    uint32_t fProcessed;
+    bool fFailed;
+
+    bool writeChunk(const uint32_t chunk)
+    {
+        const uint32_t frames = getChunkFrames(chunk);
+        const uint32_t skip = std::min(fSkipFrames, frames);
+        fSkipFrames -= skip;
+
+        if (skip == frames)
+            return true;
+
+        const float* outputs[kOutputCount > 0 ? kOutputCount : 1] = {};
+        for (uint32_t c = 0; c < kOutputCount; ++c)
+            outputs[c] = fOutputs[chunk % kRenderChunkCount][c] + skip;
+
+        return fWriter.write(outputs, frames - skip);
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(RenderFileThread)
+};
+
+#if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+static bool renderWriteMidiCallback(void*, const MidiEvent&)
+{
+    return true;
+}
+#endif
+
+// -----------------------------------------------------------------------
+// render command, `render <in.wav|-> <out.wav> [--midi file] [--state file] [--block N] [--rate R]`
+
+static int runOfflineRender(const int argc, char* argv[])
+{
+    const char* const inputFilename = argv[0];
+    const char* const outputFilename = argv[1];
+    const char* midiFilename = nullptr;
+    const char* stateFilename = nullptr;
+    uint32_t blockSize = 512;
+    double sampleRate = 0.0;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--midi") == 0 && hasValue)
+            midiFilename = argv[++i];
+        else if (std::strcmp(argv[i], "--state") == 0 && hasValue)
+            stateFilename = argv[++i];
+        else if (std::strcmp(argv[i], "--block") == 0 && hasValue)
+            blockSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--rate") == 0 && hasValue)
+            sampleRate = std::atof(argv[++i]);
+        else
+            blockSize = 0;
+    }
+
+    if (blockSize == 0 || sampleRate < 0.0)
+    {
+        d_stderr2("Usage: render <in.wav|-> <out.wav> [--midi in.mid] [--state preset] [--block N] [--rate R]");
+        return 1;
+    }
+
+   #if ! (DISTRHO_PLUGIN_WANT_MIDI_INPUT || DISTRHO_PLUGIN_WANT_TIMEPOS)
+    if (midiFilename != nullptr)
+    {
+        d_stderr2("This plugin does not use MIDI input or time position, ignoring '%s'", midiFilename);
+        midiFilename = nullptr;
+    }
+   #endif
+
+    ScopedPointer<RenderWavReader> reader;
+    uint64_t inputFrames = 0;
+
+    if (std::strcmp(inputFilename, "-") != 0)
+    {
+        reader = new RenderWavReader();
+
+        if (! reader->open(inputFilename))
+            return 1;
+
+        inputFrames = reader->getFrameCount();
+
+        if (sampleRate == 0.0)
+            sampleRate = reader->getSampleRate();
+        else if (d_isNotEqual(sampleRate, static_cast<double>(reader->getSampleRate())))
+            d_stderr("Input is %u Hz but rendering at %g Hz, no resampling is done", reader->getSampleRate(), sampleRate);
+    }
+    else if (midiFilename == nullptr)
+    {
+        d_stderr2("An input file or MIDI file is needed to know how much to render");
+        return 1;
+    }
+
+    if (sampleRate == 0.0)
+        sampleRate = 48000.0;
+
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT || DISTRHO_PLUGIN_WANT_TIMEPOS
+    RenderMidiFile midiFile;
+
+    if (midiFilename != nullptr)
+    {
+        if (! midiFile.load(midiFilename, sampleRate))
+            return 1;
+
+        inputFrames = std::max(inputFrames, midiFile.getEndFrame());
+    }
+   #endif
+
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    const std::vector<RenderMidiFile::Event>& midiFileEvents(midiFile.getEvents());
+    std::size_t midiFileIndex = 0;
+   #endif
+
+    d_nextBufferSize = blockSize;
+    d_nextSampleRate = sampleRate;
+   #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
+    PluginExporter plugin(nullptr, renderWriteMidiCallback, nullptr, nullptr);
+   #else
+    PluginExporter plugin(nullptr, nullptr, nullptr, nullptr);
+   #endif
+
+    if (stateFilename != nullptr && ! loadRenderState(plugin, stateFilename))
+        return 1;
+
+   #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+    // rendering needs any data loaded in the background right from the first block
+    for (uint32_t i=0, count=plugin.getStateCount(); i < count; ++i)
+    {
+        while (plugin.isStateLoading(i))
+            d_msleep(1);
+    }
+   #endif
+
+    plugin.setOfflineRendering(true);
+    plugin.activate();
+
+    // compensate latency so output lines up with input, and keep the tail the plugin asks for
+   #if DISTRHO_PLUGIN_WANT_LATENCY
+    const uint32_t latency = plugin.getLatency();
+   #else
+    const uint32_t latency = 0;
+   #endif
+    const uint32_t tail = plugin.getTailLength() != kTailLengthInfinite ? plugin.getTailLength() : 0;
+    const uint64_t totalFrames = inputFrames + tail + latency;
+
+    RenderWavWriter writer;
+    if (! writer.open(outputFilename, DISTRHO_PLUGIN_NUM_OUTPUTS, static_cast<uint32_t>(sampleRate + 0.5)))
+        return 1;
+
+    // chunks hold a whole number of blocks, so the plugin always sees the requested block size
+    const uint32_t chunkFrames = std::max<uint32_t>(1, kRenderChunkFrames / blockSize) * blockSize;
+
+    RenderFileThread fileThread(reader.get(), writer, totalFrames, chunkFrames, latency);
+    fileThread.startThread();
+
+   #if defined(__SSE2_MATH__)
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+   #endif
+
+   #if DISTRHO_PLUGIN_WANT_TIMEPOS
+    TimePosition timePosition;
+    timePosition.playing = true;
+   #endif
+
+    const uint64_t startTime = d_gettime_ns();
+    uint64_t frame = 0;
+    bool ok = true;
+
+    for (uint32_t chunk = 0; chunk < fileThread.getChunkCount() && ! gCloseSignalReceived; ++chunk)
+    {
+        float** chunkInputs;
+        float** chunkOutputs;
+
+        if (! fileThread.waitForChunk(chunk, chunkInputs, chunkOutputs))
+        {
+            ok = false;
+            break;
+        }
+
+        const uint32_t chunkFrames = fileThread.getChunkFrames(chunk);
+
+        for (uint32_t offset = 0; offset < chunkFrames; offset += blockSize)
+        {
+            const uint32_t frames = std::min(blockSize, chunkFrames - offset);
+
+            const float* inputs[DISTRHO_PLUGIN_NUM_INPUTS > 0 ? DISTRHO_PLUGIN_NUM_INPUTS : 1] = {};
+            float* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS > 0 ? DISTRHO_PLUGIN_NUM_OUTPUTS : 1] = {};
+           #if DISTRHO_PLUGIN_NUM_INPUTS > 0
+            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_INPUTS; ++i)
+                inputs[i] = chunkInputs[i] + offset;
+           #endif
+           #if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            for (uint32_t i=0; i < DISTRHO_PLUGIN_NUM_OUTPUTS; ++i)
+                outputs[i] = chunkOutputs[i] + offset;
+           #endif
+
+           #if DISTRHO_PLUGIN_WANT_TIMEPOS
+            timePosition.frame = frame;
+            midiFile.fillTimePosition(timePosition, frame, sampleRate);
+            plugin.setTimePosition(timePosition);
+           #endif
+
+           #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+            MidiEventArena& midiEvents(plugin.getMidiInputEvents());
+            midiEvents.clear();
+
+            for (; midiFileIndex < midiFileEvents.size() && midiFileEvents[midiFileIndex].frame < frame + frames; ++midiFileIndex)
+            {
+                const RenderMidiFile::Event& event(midiFileEvents[midiFileIndex]);
+                midiEvents.append(static_cast<uint32_t>(event.frame - frame), midiFile.getEventData(event), event.size);
+            }
+
+            plugin.run(inputs, outputs, frames, midiEvents.getSortedEvents(), midiEvents.getCount());
+           #else
+            plugin.run(inputs, outputs, frames);
+           #endif
+
+            frame += frames;
+        }
+
+        fileThread.finishChunk();
+    }
+
+    fileThread.stop();
+
+    const double elapsed = static_cast<double>(d_gettime_ns() - startTime) * 1e-9;
+
+    plugin.deactivate();
+
+    ok &= ! fileThread.hasFailed();
+    ok &= writer.close();
+
+    if (! ok || gCloseSignalReceived)
+    {
+        d_stderr2(ok ? "Render was interrupted" : "Render failed, could not read or write audio files");
+        return 1;
+    }
+
+    const double seconds = static_cast<double>(frame) / sampleRate;
+    d_stdout("Rendered %.2f seconds of audio in %.2f seconds, %.1fx realtime",
+             seconds, elapsed, elapsed > 0.0 ? seconds / elapsed : 0.0);
+
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    if (const uint32_t dropped = plugin.getMidiInputEvents().getOverflowCount())
+        d_stderr("%u MIDI events were dropped, try a smaller block size", dropped);
+   #endif
+
+    return 0;
+}
+#endif // DISTRHO_OS_WASM
+
+END_NAMESPACE_DISTRHO
+
+#if DPF_PLUGIN_HAS_REALTIME_CHECKS
+// -----------------------------------------------------------------------
+// Real-time safety check hooks, these replace the libc functions for the whole process
+
+extern "C" {
+
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+
+void* malloc(const size_t size) noexcept
+{
+    DISTRHO_NAMESPACE::checkRealtimeSafety("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(const size_t count, const size_t size) noexcept
+{
+    DISTRHO_NAMESPACE::checkRealtimeSafety("calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* const ptr, const size_t size) noexcept
+{
+    DISTRHO_NAMESPACE::checkRealtimeSafety("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(const size_t alignment, const size_t size) noexcept
+{
+    DISTRHO_NAMESPACE::checkRealtimeSafety("memalign");
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(const size_t alignment, const size_t size) noexcept
+{
+    DISTRHO_NAMESPACE::checkRealtimeSafety("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** const ptr, const size_t alignment, const size_t size) noexcept
+{
+    DISTRHO_NAMESPACE::checkRealtimeSafety("posix_memalign");
+
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    void* const ret = __libc_memalign(alignment, size);
+
+    if (ret == nullptr)
+        return ENOMEM;
+
+    *ptr = ret;
+    return 0;
+}
+
+void free(void* const ptr) noexcept
+{
+    if (ptr != nullptr)
+        DISTRHO_NAMESPACE::checkRealtimeSafety("free");
+
+    __libc_free(ptr);
+}
+
+}
+
+// the remaining hooks forward to the next definition in the library search order
+template<typename Func>
+static inline Func getNextFunction(Func& func, const char* const name) noexcept
+{
+    if (func == nullptr)
+        func = reinterpret_cast<Func>(dlsym(RTLD_NEXT, name));
+
+    return func;
+}
+
+// checks the call and loads the next definition of @a Next into a local `next` function pointer
+#define DPF_REALTIME_HOOK(Function, Next) \
+    static __typeof__(&Next) next = nullptr; \
+    DISTRHO_NAMESPACE::checkRealtimeSafety(Function); \
+    getNextFunction(next, #Next)
+
+extern "C" {
+
+int pthread_mutex_lock(pthread_mutex_t* const mutex) noexcept
+{
+    DPF_REALTIME_HOOK("pthread_mutex_lock", pthread_mutex_lock);
+    return next(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t* const cond, pthread_mutex_t* const mutex)
+{
+    DPF_REALTIME_HOOK("pthread_cond_wait", pthread_cond_wait);
+    return next(cond, mutex);
+}
+
+int nanosleep(const struct timespec* const req, struct timespec* const rem)
+{
+    DPF_REALTIME_HOOK("nanosleep", nanosleep);
+    return next(req, rem);
+}
+
+int usleep(const useconds_t usec)
+{
+    DPF_REALTIME_HOOK("usleep", usleep);
+    return next(usec);
+}
+
+unsigned int sleep(const unsigned int seconds)
+{
+    DPF_REALTIME_HOOK("sleep", sleep);
+    return next(seconds);
+}
+
+int open(const char* const path, const int flags, ...)
+{
+    mode_t mode = 0;
+
+   #ifdef O_TMPFILE
+    if (flags & (O_CREAT|O_TMPFILE))
+   #else
+    if (flags & O_CREAT)
+   #endif
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, int);
+        va_end(args);
+    }
+
+    DPF_REALTIME_HOOK("open", open);
+    return next(path, flags, mode);
+}
+
+int close(const int fd)
+{
+    DPF_REALTIME_HOOK("close", close);
+    return next(fd);
+}
+
+ssize_t read(const int fd, void* const buf, const size_t count)
+{
+    DPF_REALTIME_HOOK("read", read);
+    return next(fd, buf, count);
+}
+
+ssize_t write(const int fd, const void* const buf, const size_t count)
+{
+    DPF_REALTIME_HOOK("write", write);
+    return next(fd, buf, count);
+}
+
+FILE* fopen(const char* const path, const char* const mode)
+{
+    DPF_REALTIME_HOOK("fopen", fopen);
+    return next(path, mode);
+}
+
+int fclose(FILE* const stream)
+{
+    DPF_REALTIME_HOOK("fclose", fclose);
+    return next(stream);
+}
+
+size_t fwrite(const void* const ptr, const size_t size, const size_t count, FILE* const stream)
+{
+    DPF_REALTIME_HOOK("fwrite", fwrite);
+    return next(ptr, size, count, stream);
+}
+
+int fputs(const char* const str, FILE* const stream)
+{
+    DPF_REALTIME_HOOK("fputs", fputs);
+    return next(str, stream);
+}
+
+int puts(const char* const str)
+{
+    DPF_REALTIME_HOOK("puts", puts);
+    return next(str);
+}
+
+int fflush(FILE* const stream)
+{
+    DPF_REALTIME_HOOK("fflush", fflush);
+    return next(stream);
+}
+
+int vfprintf(FILE* const stream, const char* const fmt, va_list args)
+{
+    DPF_REALTIME_HOOK("vfprintf", vfprintf);
+    return next(stream, fmt, args);
+}
+
+int fprintf(FILE* const stream, const char* const fmt, ...)
+{
+    DPF_REALTIME_HOOK("fprintf", vfprintf);
+
+    va_list args;
+    va_start(args, fmt);
+    const int ret = next(stream, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int printf(const char* const fmt, ...)
+{
+    DPF_REALTIME_HOOK("printf", vfprintf);
+
+    va_list args;
+    va_start(args, fmt);
+    const int ret = next(stdout, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+// fortified variants, used instead of the above when building with _FORTIFY_SOURCE
+int __vfprintf_chk(FILE*, int, const char*, va_list);
+
+int __fprintf_chk(FILE* const stream, const int flag, const char* const fmt, ...)
+{
+    DPF_REALTIME_HOOK("fprintf", __vfprintf_chk);
+
+    va_list args;
+    va_start(args, fmt);
+    const int ret = next(stream, flag, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int __printf_chk(const int flag, const char* const fmt, ...)
+{
+    DPF_REALTIME_HOOK("printf", __vfprintf_chk);
+
+    va_list args;
+    va_start(args, fmt);
+    const int ret = next(stdout, flag, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int __vfprintf_chk(FILE* const stream, const int flag, const char* const fmt, va_list args)
+{
+    DPF_REALTIME_HOOK("vfprintf", __vfprintf_chk);
+    return next(stream, flag, fmt, args);
+}
+
+}
+
+#undef DPF_REALTIME_HOOK
+#endif // DPF_PLUGIN_HAS_REALTIME_CHECKS
+
+// -----------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    USE_NAMESPACE_DISTRHO;
+
+    initSignalHandler();
+
+   #ifndef STATIC_BUILD
+    // find plugin bundle
+    static String bundlePath;
+    if (bundlePath.isEmpty())
+    {
+        String tmpPath(getBinaryFilename());
+        tmpPath.truncate(tmpPath.rfind(DISTRHO_OS_SEP));
+      #if defined(DISTRHO_OS_MAC)
+        if (tmpPath.endsWith("/MacOS"))
+        {
+            tmpPath.truncate(tmpPath.rfind('/'));
+            if (tmpPath.endsWith("/Contents"))
+            {
+                tmpPath.truncate(tmpPath.rfind('/'));
+                bundlePath = tmpPath;
+                d_nextBundlePath = bundlePath.buffer();
+            }
+        }
+      #else
+       #ifdef DISTRHO_OS_WINDOWS
+        const DWORD attr = GetFileAttributesA(tmpPath + DISTRHO_OS_SEP_STR "resources");
+        if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0)
+       #else
+        if (access(tmpPath + DISTRHO_OS_SEP_STR "resources", F_OK) == 0)
+       #endif
+        {
+            bundlePath = tmpPath;
+            d_nextBundlePath = bundlePath.buffer();
+        }
+      #endif
+    }
+   #endif
+
+   #ifdef DPF_USING_LD_LINUX_WEBVIEW
+    if (argc >= 2 && std::strcmp(argv[1], "dpf-ld-linux-webview") == 0)
+        return dpf_webview_start(argc - 1, argv + 1);
+   #endif
+
+    if (argc == 2 && std::strcmp(argv[1], "selftest") == 0)
+    {
+       #ifdef DPF_RUNTIME_TESTING
+        return runSelfTests() ? 0 : 1;
+       #else
+        d_stderr2("Code was built without DPF_RUNTIME_TESTING macro enabled, selftest option is not available");
+        return 1;
+       #endif
+    }
+
+   #ifndef DISTRHO_OS_WASM
+    if (argc >= 4 && std::strcmp(argv[1], "render") == 0)
+        return runOfflineRender(argc - 2, argv + 2);
+   #endif
+
    #if defined(DISTRHO_OS_WINDOWS) && DISTRHO_PLUGIN_HAS_UI
     /* the code below is based on
      * https://www.tillett.info/2013/05/13/how-to-create-a-windows-program-that-works-as-both-as-a-gui-and-console-application/
@@ -82,7 +82,6 @@ public:
           fRunCount(0),
 #endif
           fPortControls(nullptr),
-          fLastControlValues(nullptr),
           fSampleRate(sampleRate),
           fURIDs(uridMap),
 #if DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST
@@ -107,19 +106,10 @@ public:
 
         if (const uint32_t count = fPlugin.getParameterCount())
         {
-            fPortControls      = new float*[count];
-            fLastControlValues = new float[count];
+            fPortControls = new float*[count];
 
             for (uint32_t i=0; i < count; ++i)
-            {
                 fPortControls[i] = nullptr;
-                fLastControlValues[i] = fPlugin.getParameterValue(i);
-            }
-        }
-        else
-        {
-            fPortControls      = nullptr;
-            fLastControlValues = nullptr;
         }
 
 #if DISTRHO_LV2_USE_EVENTS_IN
@@ -174,12 +164,6 @@ public:
             fPortControls = nullptr;
         }
 
-        if (fLastControlValues)
-        {
-            delete[] fLastControlValues;
-            fLastControlValues = nullptr;
-        }
-
 #if DISTRHO_PLUGIN_WANT_STATE
         if (fNeededUiSends != nullptr)
         {
@@ -328,7 +312,8 @@ public:
     {
         // cache midi input and time position first
 #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        uint32_t midiEventCount = 0;
+        MidiEventArena& midiEvents(fPlugin.getMidiInputEvents());
+        midiEvents.clear();
 #endif
 
 #if DISTRHO_PLUGIN_WANT_MIDI_INPUT || DISTRHO_PLUGIN_WANT_TIMEPOS
@@ -340,26 +325,8 @@ public:
 # if DISTRHO_PLUGIN_WANT_MIDI_INPUT
             if (event->body.type == fURIDs.midiEvent)
             {
-                if (midiEventCount >= kMaxMidiEvents)
-                    continue;
-
-                const uint8_t* const data((const uint8_t*)(event + 1));
-
-                MidiEvent& midiEvent(fMidiEvents[midiEventCount++]);
-
-                midiEvent.frame = event->time.frames;
-                midiEvent.size  = event->body.size;
-
-                if (midiEvent.size > MidiEvent::kDataSize)
-                {
-                    midiEvent.dataExt = data;
-                    std::memset(midiEvent.data, 0, MidiEvent::kDataSize);
-                }
-                else
-                {
-                    midiEvent.dataExt = nullptr;
-                    std::memcpy(midiEvent.data, data, midiEvent.size);
-                }
+                if (event->body.size != 0)
+                    midiEvents.append(event->time.frames, (const uint8_t*)(event + 1), event->body.size);
 
                 continue;
             }
@@ -601,20 +568,20 @@ public:
         }
 #endif
 
-        // Check for updated parameters
+        // Check for updated parameters, only input ports can change
+        const ParameterStore& store(fPlugin.getParameterStore());
+        const ParameterIndexList& inputs(fPlugin.getInputParameterIndexList());
         float curValue;
 
-        for (uint32_t i=0, count=fPlugin.getParameterCount(); i < count; ++i)
+        for (uint32_t k=0; k < inputs.count; ++k)
         {
+            const uint32_t i = inputs.indices[k];
+
             if (!getPortControlValue(i, curValue))
                 continue;
 
-            if (fPlugin.isParameterInput(i) && d_isNotEqual(fLastControlValues[i], curValue))
-            {
-                fLastControlValues[i] = curValue;
-
+            if (d_isNotEqual(store.getValue(i), curValue))
                 fPlugin.setParameterValue(i, curValue);
-            }
         }
 
         // Run plugin
@@ -625,7 +592,7 @@ public:
            #endif
 
            #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-            fPlugin.run(fPortAudioIns, fPortAudioOuts, sampleCount, fMidiEvents, midiEventCount);
+            fPlugin.run(fPortAudioIns, fPortAudioOuts, sampleCount, midiEvents.getSortedEvents(), midiEvents.getCount());
            #else
             fPlugin.run(fPortAudioIns, fPortAudioOuts, sampleCount);
            #endif
@@ -696,6 +663,22 @@ public:
 
         updateParameterOutputsAndTriggers();
 
+       #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING && DISTRHO_PLUGIN_HAS_UI
+        // let the UI know the data behind the current value is now in use
+        ParameterBitset& loaded(fPlugin.getLoadedStates());
+
+        for (uint32_t w=0, count=loaded.getWordCount(); w<count; ++w)
+        {
+            for (uint32_t bits = loaded.takeWord(w); bits != 0;)
+            {
+                const uint32_t i = w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits);
+
+                if ((fPlugin.getStateHints(i) & kStateIsOnlyForDSP) == 0x0)
+                    fNeededUiSends[i] = true;
+            }
+        }
+       #endif
+
        #if DISTRHO_PLUGIN_WANT_STATE
         fEventsOutData.initIfNeeded(fURIDs.atomSequence);
 
@@ -890,9 +873,10 @@ public:
             if (fPlugin.isParameterOutput(i))
                 continue;
 
-            fLastControlValues[i] = fPlugin.getParameterValue(i);
+            const float value = fPlugin.getParameterValue(i);
+            fPlugin.getParameterStore().setValue(i, value, false);
 
-            setPortControlValue(i, fLastControlValues[i]);
+            setPortControlValue(i, value);
         }
 
        #if DISTRHO_PLUGIN_WANT_FULL_STATE
@@ -1203,11 +1187,7 @@ private:
    #endif
 
     // Temporary data
-    float* fLastControlValues;
     double fSampleRate;
-   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-    MidiEvent fMidiEvents[kMaxMidiEvents];
-   #endif
    #if DISTRHO_PLUGIN_WANT_TIMEPOS
     TimePosition fTimePosition;
 
@@ -1385,20 +1365,19 @@ private:
 
     void updateParameterOutputsAndTriggers()
     {
+        ParameterStore& store(fPlugin.getParameterStore());
+        const ParameterIndexList& outputs(fPlugin.getOutputParameterIndexList());
         float curValue;
 
-        for (uint32_t i=0, count=fPlugin.getParameterCount(); i < count; ++i)
+        // NOTE: host is responsible for auto-updating control port buffers of triggers
+        for (uint32_t k=0; k < outputs.count; ++k)
         {
-            if (fPlugin.isParameterOutput(i))
-            {
-                curValue = fLastControlValues[i] = fPlugin.getParameterValue(i);
+            const uint32_t i = outputs.indices[k];
 
-                setPortControlValue(i, curValue);
-            }
-            else if ((fPlugin.getParameterHints(i) & kParameterIsTrigger) == kParameterIsTrigger)
-            {
-                // NOTE: host is responsible for auto-updating control port buffers
-            }
+            curValue = fPlugin.getParameterValue(i);
+            store.setValue(i, curValue, false);
+
+            setPortControlValue(i, curValue);
         }
 
        #if DISTRHO_PLUGIN_WANT_LATENCY
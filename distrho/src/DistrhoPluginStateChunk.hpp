@@ -0,0 +1,469 @@
+/*
+ * DISTRHO Plugin Framework (DPF)
+ * Copyright (C) 2012-2024 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef DISTRHO_PLUGIN_STATE_CHUNK_HPP_INCLUDED
+#define DISTRHO_PLUGIN_STATE_CHUNK_HPP_INCLUDED
+
+#include "../extra/ScopedSafeLocale.hpp"
+#include "../extra/String.hpp"
+
+#include <algorithm>
+#include <vector>
+
+START_NAMESPACE_DISTRHO
+
+/* ------------------------------------------------------------------------------------------------------------
+ * State chunk, shared between plugin formats that save an opaque blob (VST2, VST3, CLAP and AU)
+ *
+ * Binary layout, all integers little-endian:
+ *   char[4]  magic "DPFs"
+ *   uint32   format version
+ *   uint32   size of the whole chunk in bytes, including this header
+ *   int32    current program, or -1 if none
+ *   uint32   number of states
+ *   uint32   number of parameters
+ *   states, each one:     uint32 key size, key bytes, '\0', uint32 value size, value bytes, '\0'
+ *   parameters, each one: uint32 symbol hash, float value
+ *
+ * Parameters are identified by a hash of their symbol, so they can be reordered, added or removed safely.
+ * Strings are null-terminated so they can be passed to the plugin without any copies.
+ *
+ * The older text format (null-separated key/value strings with begin/end markers, terminated by '\xfe')
+ * is still accepted when reading.
+ */
+
+static const uint32_t kStateChunkVersion = 1;
+static const uint32_t kStateChunkHeaderSize = 24;
+static const int32_t  kStateChunkNoProgram = -1;
+
+// Chunks come from preset files and hosts, never trust their size beyond this
+static const uint32_t kStateChunkMaxSize = 256 * 1024 * 1024;
+// Buffer grows at most this much per read, so a bogus size in the header does not allocate up front
+static const uint32_t kStateChunkReadBlockSize = 1024 * 1024;
+
+static inline
+uint32_t d_stateChunkReadU32(const uint8_t* const data) noexcept
+{
+    return static_cast<uint32_t>(data[0])
+         | static_cast<uint32_t>(data[1]) << 8
+         | static_cast<uint32_t>(data[2]) << 16
+         | static_cast<uint32_t>(data[3]) << 24;
+}
+
+static inline
+bool d_isBinaryStateChunk(const uint8_t* const data, const std::size_t size) noexcept
+{
+    return size >= kStateChunkHeaderSize && std::memcmp(data, "DPFs", 4) == 0;
+}
+
+/**
+   Hash a parameter symbol for use in state chunks (32-bit FNV-1a).
+ */
+static inline
+uint32_t d_stateSymbolHash(const char* symbol) noexcept
+{
+    uint32_t hash = 2166136261U;
+
+    for (; *symbol != '\0'; ++symbol)
+    {
+        hash ^= static_cast<uint8_t>(*symbol);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+class StateChunkWriter
+{
+public:
+    StateChunkWriter(const int32_t program = kStateChunkNoProgram)
+        : fStateCount(0),
+          fParameterCount(0)
+    {
+        fData.reserve(256);
+        fData.resize(kStateChunkHeaderSize);
+
+        std::memcpy(&fData[0], "DPFs", 4);
+        writeU32At(4, kStateChunkVersion);
+        writeU32At(12, static_cast<uint32_t>(program));
+    }
+
+    void reserve(const std::size_t size)
+    {
+        fData.reserve(size);
+    }
+
+    void addState(const char* const key, const std::size_t keySize,
+                  const char* const value, const std::size_t valueSize)
+    {
+        appendString(key, keySize);
+        appendString(value, valueSize);
+        ++fStateCount;
+    }
+
+    void addState(const String& key, const String& value)
+    {
+        addState(key.buffer(), key.length(), value.buffer(), value.length());
+    }
+
+    void addParameter(const char* const symbol, const float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        const std::size_t offset = fData.size();
+        fData.resize(offset + 8);
+        writeU32At(offset, d_stateSymbolHash(symbol));
+        writeU32At(offset + 4, bits);
+        ++fParameterCount;
+    }
+
+    // finalize the header and get the chunk data
+    const std::vector<uint8_t>& finish()
+    {
+        writeU32At(8, static_cast<uint32_t>(fData.size()));
+        writeU32At(16, fStateCount);
+        writeU32At(20, fParameterCount);
+        return fData;
+    }
+
+private:
+    std::vector<uint8_t> fData;
+    uint32_t fStateCount;
+    uint32_t fParameterCount;
+
+    void writeU32At(const std::size_t offset, const uint32_t value) noexcept
+    {
+        fData[offset]     = static_cast<uint8_t>(value);
+        fData[offset + 1] = static_cast<uint8_t>(value >> 8);
+        fData[offset + 2] = static_cast<uint8_t>(value >> 16);
+        fData[offset + 3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    void appendString(const char* const str, const std::size_t size)
+    {
+        const std::size_t offset = fData.size();
+        fData.resize(offset + 4 + size + 1);
+        writeU32At(offset, static_cast<uint32_t>(size));
+        std::memcpy(&fData[offset + 4], str, size);
+        fData[offset + 4 + size] = '\0';
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(StateChunkWriter)
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+class StateChunkReader
+{
+public:
+   /**
+      Validate and prepare a chunk for reading, in either the binary or the older text format.
+      The data is not copied, it must remain valid while this reader is in use.
+    */
+    StateChunkReader(const uint8_t* const data, const std::size_t size) noexcept
+        : fData(data),
+          fSize(size),
+          fValid(false),
+          fLegacy(false),
+          fProgram(kStateChunkNoProgram),
+          fStateCount(0),
+          fParameterCount(0),
+          fStatesOffset(0),
+          fStatesEnd(0),
+          fParametersOffset(0),
+          fParametersEnd(0)
+    {
+        if (data == nullptr || size == 0)
+            return;
+
+        if (d_isBinaryStateChunk(data, size))
+            fValid = parseBinaryHeader();
+        else
+            fValid = parseLegacyLayout();
+    }
+
+    bool isValid() const noexcept
+    {
+        return fValid;
+    }
+
+    bool isLegacy() const noexcept
+    {
+        return fLegacy;
+    }
+
+    int32_t getProgram() const noexcept
+    {
+        return fProgram;
+    }
+
+    uint32_t getStateCount() const noexcept
+    {
+        return fStateCount;
+    }
+
+    uint32_t getParameterCount() const noexcept
+    {
+        return fParameterCount;
+    }
+
+   /**
+      Read the next state key and value, returning false when there are no more.
+      Both strings are null-terminated and point inside the chunk data.
+    */
+    bool readNextState(const char*& key, const char*& value) noexcept
+    {
+        if (fStatesOffset >= fStatesEnd)
+            return false;
+
+        if (fLegacy)
+        {
+            key = reinterpret_cast<const char*>(fData + fStatesOffset);
+            fStatesOffset += std::strlen(key) + 1;
+            value = reinterpret_cast<const char*>(fData + fStatesOffset);
+            fStatesOffset += std::strlen(value) + 1;
+            return true;
+        }
+
+        key = reinterpret_cast<const char*>(fData + fStatesOffset + 4);
+        fStatesOffset += 4 + d_stateChunkReadU32(fData + fStatesOffset) + 1;
+        value = reinterpret_cast<const char*>(fData + fStatesOffset + 4);
+        fStatesOffset += 4 + d_stateChunkReadU32(fData + fStatesOffset) + 1;
+        return true;
+    }
+
+   /**
+      Read the next parameter symbol hash and value, returning false when there are no more.
+    */
+    bool readNextParameter(uint32_t& symbolHash, float& value) noexcept
+    {
+        if (fParametersOffset >= fParametersEnd)
+            return false;
+
+        if (fLegacy)
+        {
+            const char* const symbol = reinterpret_cast<const char*>(fData + fParametersOffset);
+            fParametersOffset += std::strlen(symbol) + 1;
+            const char* const text = reinterpret_cast<const char*>(fData + fParametersOffset);
+            fParametersOffset += std::strlen(text) + 1;
+
+            const ScopedSafeLocale ssl;
+            symbolHash = d_stateSymbolHash(symbol);
+            value = static_cast<float>(std::atof(text));
+            return true;
+        }
+
+        const uint32_t bits = d_stateChunkReadU32(fData + fParametersOffset + 4);
+        symbolHash = d_stateChunkReadU32(fData + fParametersOffset);
+        std::memcpy(&value, &bits, sizeof(value));
+        fParametersOffset += 8;
+        return true;
+    }
+
+private:
+    const uint8_t* const fData;
+    std::size_t fSize;
+    bool fValid;
+    bool fLegacy;
+    int32_t fProgram;
+    uint32_t fStateCount;
+    uint32_t fParameterCount;
+    std::size_t fStatesOffset, fStatesEnd;
+    std::size_t fParametersOffset, fParametersEnd;
+
+    // check the whole binary layout upfront, so that reading later on never goes out of bounds
+    bool parseBinaryHeader() noexcept
+    {
+        if (d_stateChunkReadU32(fData + 4) > kStateChunkVersion)
+        {
+            d_stderr2("DPF warning: state chunk was saved with a newer version (%u), ignoring it",
+                      d_stateChunkReadU32(fData + 4));
+            return false;
+        }
+
+        const uint32_t chunkSize = d_stateChunkReadU32(fData + 8);
+        DISTRHO_SAFE_ASSERT_UINT2_RETURN(chunkSize >= kStateChunkHeaderSize && chunkSize <= fSize,
+                                         chunkSize, static_cast<uint>(fSize), false);
+        fSize = chunkSize;
+
+        fProgram = static_cast<int32_t>(d_stateChunkReadU32(fData + 12));
+        fStateCount = d_stateChunkReadU32(fData + 16);
+        fParameterCount = d_stateChunkReadU32(fData + 20);
+
+        std::size_t offset = kStateChunkHeaderSize;
+        fStatesOffset = offset;
+
+        for (uint32_t i = 0; i < fStateCount * 2; ++i)
+        {
+            DISTRHO_SAFE_ASSERT_RETURN(offset + 4 <= fSize, false);
+            const std::size_t strSize = d_stateChunkReadU32(fData + offset);
+            DISTRHO_SAFE_ASSERT_RETURN(strSize < fSize && offset + 4 + strSize + 1 <= fSize, false);
+            DISTRHO_SAFE_ASSERT_RETURN(fData[offset + 4 + strSize] == '\0', false);
+            offset += 4 + strSize + 1;
+        }
+
+        fStatesEnd = offset;
+        fParametersOffset = offset;
+        fParametersEnd = offset + static_cast<std::size_t>(fParameterCount) * 8;
+
+        DISTRHO_SAFE_ASSERT_RETURN(fParametersEnd <= fSize, false);
+        return true;
+    }
+
+    // find the next null-terminated string at offset, returning false if there is none
+    bool nextLegacyString(std::size_t& offset, const char*& str) const noexcept
+    {
+        if (offset >= fSize || fData[offset] == 0xfe)
+            return false;
+
+        const void* const end = std::memchr(fData + offset, '\0', fSize - offset);
+
+        if (end == nullptr)
+            return false;
+
+        str = reinterpret_cast<const char*>(fData + offset);
+        offset = static_cast<std::size_t>(static_cast<const uint8_t*>(end) - fData) + 1;
+        return true;
+    }
+
+    bool parseLegacyLayout() noexcept
+    {
+        fLegacy = true;
+
+        std::size_t offset = 0;
+        const char* key;
+        const char* value;
+
+        while (nextLegacyString(offset, key))
+        {
+            if (std::strcmp(key, "__dpf_state_begin__") == 0)
+            {
+                fStatesOffset = fStatesEnd = offset;
+
+                while (nextLegacyString(offset, key) && std::strcmp(key, "__dpf_state_end__") != 0)
+                {
+                    DISTRHO_SAFE_ASSERT_RETURN(nextLegacyString(offset, value), false);
+                    fStatesEnd = offset;
+                    ++fStateCount;
+                }
+                continue;
+            }
+
+            if (std::strcmp(key, "__dpf_parameters_begin__") == 0)
+            {
+                fParametersOffset = fParametersEnd = offset;
+
+                while (nextLegacyString(offset, key) && std::strcmp(key, "__dpf_parameters_end__") != 0)
+                {
+                    DISTRHO_SAFE_ASSERT_RETURN(nextLegacyString(offset, value), false);
+                    fParametersEnd = offset;
+                    ++fParameterCount;
+                }
+                continue;
+            }
+
+            if (! nextLegacyString(offset, value))
+                break;
+
+            if (std::strcmp(key, "__dpf_program__") == 0)
+                fProgram = std::atoi(value);
+        }
+
+        return true;
+    }
+
+    DISTRHO_DECLARE_NON_COPYABLE(StateChunkReader)
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+
+/**
+   Read a complete state chunk from a host stream.
+   @a read is called as `int32_t read(void* buffer, int32_t size)` and must return the number of bytes read,
+   0 at the end of the stream or a negative number on error.
+   Binary chunks are read up to their exact size, text chunks up to their terminator.
+   Chunks larger than kStateChunkMaxSize are rejected.
+   The resulting data is always followed by an extra null byte.
+ */
+template<class ReadFunc>
+static inline
+bool d_readStateChunk(ReadFunc& read, std::vector<uint8_t>& data)
+{
+    data.clear();
+
+    std::size_t wanted = kStateChunkHeaderSize;
+    std::size_t scanned = 0;
+    bool sizeKnown = false;
+
+    for (;;)
+    {
+        if (data.size() >= wanted)
+        {
+            if (! sizeKnown && d_isBinaryStateChunk(&data[0], data.size()))
+            {
+                sizeKnown = true;
+                wanted = d_stateChunkReadU32(&data[8]);
+                DISTRHO_SAFE_ASSERT_RETURN(wanted >= kStateChunkHeaderSize, false);
+                DISTRHO_SAFE_ASSERT_UINT_RETURN(wanted <= kStateChunkMaxSize, wanted, false);
+                continue;
+            }
+
+            if (sizeKnown)
+            {
+                data.resize(wanted);
+                break;
+            }
+
+            // text format, keep going in bigger blocks until we find the terminator
+            if (std::memchr(&data[scanned], 0xfe, data.size() - scanned) != nullptr)
+                break;
+
+            scanned = data.size();
+            wanted = scanned + 4096;
+            DISTRHO_SAFE_ASSERT_UINT_RETURN(wanted <= kStateChunkMaxSize, wanted, false);
+        }
+
+        const std::size_t offset = data.size();
+        const int32_t size = static_cast<int32_t>(std::min<std::size_t>(wanted - offset, kStateChunkReadBlockSize));
+        data.resize(offset + static_cast<std::size_t>(size));
+
+        const int32_t ret = read(&data[offset], size);
+
+        if (ret <= 0)
+        {
+            data.resize(offset);
+            DISTRHO_SAFE_ASSERT_INT_RETURN(ret == 0, ret, false);
+
+            if (sizeKnown)
+                return false;
+            break;
+        }
+
+        data.resize(offset + static_cast<std::size_t>(ret));
+    }
+
+    data.push_back('\0');
+    return data.size() > 1;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+
+END_NAMESPACE_DISTRHO
+
+#endif // DISTRHO_PLUGIN_STATE_CHUNK_HPP_INCLUDED
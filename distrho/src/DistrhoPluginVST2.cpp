@@ -52,9 +52,21 @@ typedef struct _VstMidiEvent {
     char _ignore2[4];
 } VstMidiEvent;
 
+typedef struct _VstMidiSysexEvent {
+    int32_t type;
+    int32_t byteSize;
+    int32_t deltaFrames;
+    int32_t _ignore1;
+    int32_t dumpBytes;
+    intptr_t _ignore2;
+    const char* sysexDump;
+    intptr_t _ignore3;
+} VstMidiSysexEvent;
+
 typedef union _VstEvent {
     int32_t type;
     VstMidiEvent midi; // type 1
+    VstMidiSysexEvent sysex; // type 6
 } VstEvent;
 
 typedef struct _HostVstEvents {
@@ -411,10 +423,6 @@ public:
                 parameterValues[i] = NAN;
         }
 
-       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        fMidiEventCount = 0;
-       #endif
-
       #if DISTRHO_PLUGIN_HAS_UI
         fVstUI           = nullptr;
         fVstRect.top     = 0;
@@ -559,7 +567,7 @@ public:
             if (value != 0)
             {
                #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-                fMidiEventCount = 0;
+                fPlugin.getMidiInputEvents().clear();
 
                 // tell host we want MIDI events
                 hostCallback(VST_HOST_OPCODE_06);
@@ -675,7 +683,12 @@ public:
 
         case VST_EFFECT_OPCODE_13: // window idle
             if (fVstUI != nullptr)
+            {
+               #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+                sendLoadedStatesToUI();
+               #endif
                 fVstUI->idle();
+            }
             break;
 
        #if !DISTRHO_PLUGIN_HAS_EXTERNAL_UI
@@ -703,77 +716,34 @@ public:
                 fStateChunk = nullptr;
             }
 
-            const uint32_t paramCount = fPlugin.getParameterCount();
-
-            if (fPlugin.getStateCount() == 0 && paramCount == 0)
+           #if DISTRHO_PLUGIN_WANT_FULL_STATE
+            // Update current state
+            for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
             {
-                fStateChunk    = new char[1];
-                fStateChunk[0] = '\0';
-                ret = 1;
+                const String& key = cit->first;
+                fStateMap[key] = fPlugin.getStateValue(key);
             }
-            else
-            {
-               #if DISTRHO_PLUGIN_WANT_FULL_STATE
-                // Update current state
-                for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
-                {
-                    const String& key = cit->first;
-                    fStateMap[key] = fPlugin.getStateValue(key);
-                }
-               #endif
-
-                String chunkStr;
-
-                for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
-                {
-                    const String& key   = cit->first;
-                    const String& value = cit->second;
-
-                    // join key and value
-                    String tmpStr;
-                    tmpStr  = key;
-                    tmpStr += "\xff";
-                    tmpStr += value;
-                    tmpStr += "\xff";
-
-                    chunkStr += tmpStr;
-                }
-
-                if (paramCount != 0)
-                {
-                    // add another separator
-                    chunkStr += "\xff";
-
-                    for (uint32_t i=0; i<paramCount; ++i)
-                    {
-                        if (fPlugin.isParameterOutputOrTrigger(i))
-                            continue;
+           #endif
 
-                        // join key and value
-                        String tmpStr;
-                        tmpStr  = fPlugin.getParameterSymbol(i);
-                        tmpStr += "\xff";
-                        tmpStr += String(fPlugin.getParameterValue(i));
-                        tmpStr += "\xff";
+            // programs are saved by the host, so they are not part of the chunk
+            StateChunkWriter writer;
 
-                        chunkStr += tmpStr;
-                    }
-                }
+            for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
+                writer.addState(cit->first, cit->second);
 
-                const std::size_t chunkSize = chunkStr.length()+1;
+            for (uint32_t i=0, count=fPlugin.getParameterCount(); i<count; ++i)
+            {
+                if (fPlugin.isParameterOutputOrTrigger(i))
+                    continue;
 
-                fStateChunk = new char[chunkSize];
-                std::memcpy(fStateChunk, chunkStr.buffer(), chunkStr.length());
-                fStateChunk[chunkSize-1] = '\0';
+                writer.addParameter(fPlugin.getParameterSymbol(i), fPlugin.getParameterValue(i));
+            }
 
-                for (std::size_t i=0; i<chunkSize; ++i)
-                {
-                    if (fStateChunk[i] == '\xff')
-                        fStateChunk[i] = '\0';
-                }
+            const std::vector<uint8_t>& chunk(writer.finish());
 
-                ret = chunkSize;
-            }
+            fStateChunk = new char[chunk.size()];
+            std::memcpy(fStateChunk, chunk.data(), chunk.size());
+            ret = static_cast<intptr_t>(chunk.size());
 
             *(void**)ptr = fStateChunk;
             return ret;
@@ -786,6 +756,41 @@ public:
 
             const size_t chunkSize = static_cast<size_t>(value);
 
+            if (d_isBinaryStateChunk(static_cast<const uint8_t*>(ptr), chunkSize))
+            {
+                StateChunkReader chunk(static_cast<const uint8_t*>(ptr), chunkSize);
+                DISTRHO_SAFE_ASSERT_RETURN(chunk.isValid(), 0);
+
+                for (const char *key, *value; chunk.readNextState(key, value);)
+                {
+                    setStateFromUI(key, value);
+
+                   #if DISTRHO_PLUGIN_HAS_UI
+                    if (fVstUI != nullptr)
+                    {
+                        // TODO skip DSP only states
+                        fVstUI->setStateFromPlugin(key, value);
+                    }
+                   #endif
+                }
+
+                uint32_t symbolHash, index;
+                for (float fvalue; chunk.readNextParameter(symbolHash, fvalue);)
+                {
+                    if (! fPlugin.findParameterBySymbolHash(symbolHash, index))
+                        continue;
+
+                    fPlugin.setParameterValue(index, fvalue);
+                   #if DISTRHO_PLUGIN_HAS_UI
+                    if (fVstUI != nullptr)
+                        setParameterValueFromPlugin(index, fvalue);
+                   #endif
+                }
+
+                return 1;
+            }
+
+            // older text-based chunk
             const char* key   = (const char*)ptr;
             const char* value = nullptr;
             size_t size, bytesRead = 0;
@@ -881,23 +886,28 @@ public:
                 if (events->numEvents == 0)
                     break;
 
+                MidiEventArena& midiEvents(fPlugin.getMidiInputEvents());
+
                 for (int i=0, count=events->numEvents; i < count; ++i)
                 {
                     const VstEvent* const vstEvent = events->events[i];
 
                     if (vstEvent == nullptr)
                         break;
-                    if (vstEvent->type != 1)
-                        continue;
-                    if (fMidiEventCount >= kMaxMidiEvents)
-                        break;
-
-                    const VstMidiEvent& vstMidiEvent(events->events[i]->midi);
 
-                    MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-                    midiEvent.frame  = vstMidiEvent.deltaFrames;
-                    midiEvent.size   = 3;
-                    std::memcpy(midiEvent.data, vstMidiEvent.midiData, sizeof(uint8_t)*3);
+                    switch (vstEvent->type)
+                    {
+                    case 1:
+                        midiEvents.append(vstEvent->midi.deltaFrames,
+                                          reinterpret_cast<const uint8_t*>(vstEvent->midi.midiData), 3);
+                        break;
+                    case 6:
+                        if (vstEvent->sysex.sysexDump != nullptr && vstEvent->sysex.dumpBytes > 0)
+                            midiEvents.append(vstEvent->sysex.deltaFrames,
+                                              reinterpret_cast<const uint8_t*>(vstEvent->sysex.sysexDump),
+                                              static_cast<uint32_t>(vstEvent->sysex.dumpBytes));
+                        break;
+                    }
                 }
             }
             break;
@@ -914,6 +924,9 @@ public:
             }
             break;
 
+        case VST_EFFECT_OPCODE_TAIL_SAMPLES:
+            return std::min<uint32_t>(fPlugin.getTailLength(), INT32_MAX);
+
         case VST_EFFECT_OPCODE_SUPPORTS:
             if (const char* const canDo = (const char*)ptr)
             {
@@ -929,7 +942,8 @@ public:
                     return 1;
                #endif
                 if (std::strcmp(canDo, "receiveVstEvents") == 0 ||
-                    std::strcmp(canDo, "receiveVstMidiEvent") == 0)
+                    std::strcmp(canDo, "receiveVstMidiEvent") == 0 ||
+                    std::strcmp(canDo, "receiveVstSysexEvent") == 0)
                    #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
                     return 1;
                    #else
@@ -1010,7 +1024,8 @@ public:
        #endif
     }
 
-    void vst_processReplacing(const float** const inputs, float** const outputs, const int32_t sampleFrames)
+    template<typename T>
+    void vst_processReplacing(const T** const inputs, T** const outputs, const int32_t sampleFrames)
     {
         if (! fPlugin.isActive())
         {
@@ -1080,30 +1095,26 @@ public:
        #endif
 
       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+        MidiEventArena& midiEvents(fPlugin.getMidiInputEvents());
+
        #if DISTRHO_PLUGIN_HAS_UI
-        if (fMidiEventCount != kMaxMidiEvents && fNotesRingBuffer.isDataAvailableForReading())
+        if (fNotesRingBuffer.isDataAvailableForReading())
         {
             uint8_t midiData[3];
-            const uint32_t frame = fMidiEventCount != 0 ? fMidiEvents[fMidiEventCount - 1].frame : 0;
+            const uint32_t frame = midiEvents.getLastFrame();
 
             while (fNotesRingBuffer.isDataAvailableForReading())
             {
                 if (! fNotesRingBuffer.readCustomData(midiData, 3))
                     break;
 
-                MidiEvent& midiEvent(fMidiEvents[fMidiEventCount++]);
-                midiEvent.frame = frame;
-                midiEvent.size  = 3;
-                std::memcpy(midiEvent.data, midiData, 3);
-
-                if (fMidiEventCount == kMaxMidiEvents)
-                    break;
+                midiEvents.append(frame, midiData, 3);
             }
         }
        #endif
 
-        fPlugin.run(inputs, outputs, sampleFrames, fMidiEvents, fMidiEventCount);
-        fMidiEventCount = 0;
+        fPlugin.run(inputs, outputs, sampleFrames, midiEvents.getSortedEvents(), midiEvents.getCount());
+        midiEvents.clear();
       #else
         fPlugin.run(inputs, outputs, sampleFrames);
       #endif
@@ -1126,11 +1137,6 @@ private:
     // Temporary data
     char fProgramName[32];
 
-   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-    uint32_t  fMidiEventCount;
-    MidiEvent fMidiEvents[kMaxMidiEvents];
-   #endif
-
    #if DISTRHO_PLUGIN_WANT_TIMEPOS
     TimePosition fTimePosition;
    #endif
@@ -1229,6 +1235,31 @@ private:
         parameterValues[index] = realValue;
         parameterChecks[index] = true;
     }
+
+   #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+    // let the UI know the data behind the current value is now in use
+    void sendLoadedStatesToUI()
+    {
+        ParameterBitset& loaded(fPlugin.getLoadedStates());
+
+        for (uint32_t w=0, count=loaded.getWordCount(); w<count; ++w)
+        {
+            for (uint32_t bits = loaded.takeWord(w); bits != 0;)
+            {
+                const uint32_t i = w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits);
+
+                if (fPlugin.getStateHints(i) & kStateIsOnlyForDSP)
+                    continue;
+
+                const String& key(fPlugin.getStateKey(i));
+                const StringMap::const_iterator cit = fStateMap.find(key);
+
+                if (cit != fStateMap.end())
+                    fVstUI->setStateFromPlugin(key, cit->second);
+            }
+        }
+    }
+   #endif
    #endif
 
    #if DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST
@@ -1591,6 +1622,17 @@ static void VST_FUNCTION_INTERFACE vst_processReplacingCallback(vst_effect* cons
         pluginPtr->vst_processReplacing(const_cast<const float**>(inputs), outputs, sampleFrames);
 }
 
+#if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+static void VST_FUNCTION_INTERFACE vst_processDoubleReplacingCallback(vst_effect* const effect,
+                                                                      const double* const* const inputs,
+                                                                      double** const outputs,
+                                                                      const int32_t sampleFrames)
+{
+    if (PluginVst* const pluginPtr = getEffectPlugin(effect))
+        pluginPtr->vst_processReplacing(const_cast<const double**>(inputs), outputs, sampleFrames);
+}
+#endif
+
 // --------------------------------------------------------------------------------------------------------------------
 
 END_NAMESPACE_DISTRHO
@@ -1692,6 +1734,9 @@ const vst_effect* VSTPluginMain(const vst_host_callback audioMaster)
 
     // plugin flags
     effect->flags |= 1 << 4; // uses process_float
+   #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+    effect->flags |= 1 << 12; // uses process_double
+   #endif
    #if DISTRHO_PLUGIN_IS_SYNTH
     effect->flags |= 1 << 8;
    #endif
@@ -1708,6 +1753,9 @@ const vst_effect* VSTPluginMain(const vst_host_callback audioMaster)
     effect->get_parameter = vst_getParameterCallback;
     effect->set_parameter = vst_setParameterCallback;
     effect->process_float = vst_processReplacingCallback;
+   #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+    effect->process_double = vst_processDoubleReplacingCallback;
+   #endif
 
     // special values
     effect->valid       = 101;
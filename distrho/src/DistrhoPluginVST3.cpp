@@ -297,290 +297,6 @@ class PluginVst3
             cvPorts(0) {}
     } inputBuses, outputBuses;
 
-   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-    /* Handy class for storing and sorting VST3 events and MIDI CC parameters.
-     * It will only store events for which a MIDI conversion is possible.
-     */
-    struct InputEventList {
-        enum Type {
-            NoteOn,
-            NoteOff,
-            SysexData,
-            PolyPressure,
-            CC_Normal,
-            CC_ChannelPressure,
-            CC_Pitchbend,
-            UI_MIDI // event from UI
-        };
-        struct InputEventStorage {
-            Type type;
-            union {
-                v3_event_note_on noteOn;
-                v3_event_note_off noteOff;
-                v3_event_data sysexData;
-                v3_event_poly_pressure polyPressure;
-                uint8_t midi[3];
-            };
-        } eventListStorage[kMaxMidiEvents];
-
-        struct InputEvent {
-            int32_t sampleOffset;
-            const InputEventStorage* storage;
-            InputEvent* next;
-        } eventList[kMaxMidiEvents];
-
-        uint16_t numUsed;
-        int32_t firstSampleOffset;
-        int32_t lastSampleOffset;
-        InputEvent* firstEvent;
-        InputEvent* lastEvent;
-
-        void init()
-        {
-            numUsed = 0;
-            firstSampleOffset = lastSampleOffset = 0;
-            firstEvent = nullptr;
-        }
-
-        uint32_t convert(MidiEvent midiEvents[kMaxMidiEvents]) const noexcept
-        {
-            uint32_t count = 0;
-
-            for (const InputEvent* event = firstEvent; event != nullptr; event = event->next)
-            {
-                MidiEvent& midiEvent(midiEvents[count++]);
-                midiEvent.frame = event->sampleOffset;
-
-                const InputEventStorage& eventStorage(*event->storage);
-
-                switch (eventStorage.type)
-                {
-                case NoteOn:
-                    midiEvent.size = 3;
-                    midiEvent.data[0] = 0x90 | (eventStorage.noteOn.channel & 0xf);
-                    midiEvent.data[1] = eventStorage.noteOn.pitch;
-                    midiEvent.data[2] = std::max(0, std::min(127, d_roundToIntPositive(eventStorage.noteOn.velocity * 127)));
-                    midiEvent.data[3] = 0;
-                    break;
-                case NoteOff:
-                    midiEvent.size = 3;
-                    midiEvent.data[0] = 0x80 | (eventStorage.noteOff.channel & 0xf);
-                    midiEvent.data[1] = eventStorage.noteOff.pitch;
-                    midiEvent.data[2] = std::max(0, std::min(127, d_roundToIntPositive(eventStorage.noteOff.velocity * 127)));
-                    midiEvent.data[3] = 0;
-                    break;
-                /* TODO
-                case SysexData:
-                    break;
-                */
-                case PolyPressure:
-                    midiEvent.size = 3;
-                    midiEvent.data[0] = 0xA0 | (eventStorage.polyPressure.channel & 0xf);
-                    midiEvent.data[1] = eventStorage.polyPressure.pitch;
-                    midiEvent.data[2] = std::max(0, std::min(127, d_roundToIntPositive(eventStorage.polyPressure.pressure * 127)));
-                    midiEvent.data[3] = 0;
-                    break;
-                case CC_Normal:
-                    midiEvent.size = 3;
-                    midiEvent.data[0] = 0xB0 | (eventStorage.midi[0] & 0xf);
-                    midiEvent.data[1] = eventStorage.midi[1];
-                    midiEvent.data[2] = eventStorage.midi[2];
-                    break;
-                case CC_ChannelPressure:
-                    midiEvent.size = 2;
-                    midiEvent.data[0] = 0xD0 | (eventStorage.midi[0] & 0xf);
-                    midiEvent.data[1] = eventStorage.midi[1];
-                    midiEvent.data[2] = 0;
-                    break;
-                case CC_Pitchbend:
-                    midiEvent.size = 3;
-                    midiEvent.data[0] = 0xE0 | (eventStorage.midi[0] & 0xf);
-                    midiEvent.data[1] = eventStorage.midi[1];
-                    midiEvent.data[2] = eventStorage.midi[2];
-                    break;
-                case UI_MIDI:
-                    midiEvent.size = 3;
-                    midiEvent.data[0] = eventStorage.midi[0];
-                    midiEvent.data[1] = eventStorage.midi[1];
-                    midiEvent.data[2] = eventStorage.midi[2];
-                    break;
-                default:
-                    midiEvent.size = 0;
-                    break;
-                }
-            }
-
-            return count;
-        }
-
-        bool appendEvent(const v3_event& event) noexcept
-        {
-            // only save events that can be converted directly into MIDI
-            switch (event.type)
-            {
-            case V3_EVENT_NOTE_ON:
-            case V3_EVENT_NOTE_OFF:
-            // case V3_EVENT_DATA:
-            case V3_EVENT_POLY_PRESSURE:
-                break;
-            default:
-                return false;
-            }
-
-            InputEventStorage& eventStorage(eventListStorage[numUsed]);
-
-            switch (event.type)
-            {
-            case V3_EVENT_NOTE_ON:
-                eventStorage.type = NoteOn;
-                eventStorage.noteOn = event.note_on;
-                break;
-            case V3_EVENT_NOTE_OFF:
-                eventStorage.type = NoteOff;
-                eventStorage.noteOff = event.note_off;
-                break;
-            case V3_EVENT_DATA:
-                eventStorage.type = SysexData;
-                eventStorage.sysexData = event.data;
-                break;
-            case V3_EVENT_POLY_PRESSURE:
-                eventStorage.type = PolyPressure;
-                eventStorage.polyPressure = event.poly_pressure;
-                break;
-            default:
-                return false;
-            }
-
-            eventList[numUsed].sampleOffset = event.sample_offset;
-            eventList[numUsed].storage = &eventStorage;
-
-            return placeSorted(event.sample_offset);
-        }
-
-        bool appendCC(const int32_t sampleOffset, v3_param_id paramId, const double normalized) noexcept
-        {
-            InputEventStorage& eventStorage(eventListStorage[numUsed]);
-
-            paramId -= kVst3InternalParameterMidiCC_start;
-
-            const uint8_t cc = paramId % 130;
-
-            switch (cc)
-            {
-            case 128:
-                eventStorage.type = CC_ChannelPressure;
-                eventStorage.midi[1] = std::max(0, std::min(127, d_roundToIntPositive(normalized * 127)));
-                eventStorage.midi[2] = 0;
-                break;
-            case 129:
-                eventStorage.type = CC_Pitchbend;
-                eventStorage.midi[1] = std::max(0, std::min(16384, (int)(normalized * 16384))) & 0x7f;
-                eventStorage.midi[2] = std::max(0, std::min(16384, (int)(normalized * 16384))) >> 7;
-                break;
-            default:
-                eventStorage.type = CC_Normal;
-                eventStorage.midi[1] = cc;
-                eventStorage.midi[2] = std::max(0, std::min(127, d_roundToIntPositive(normalized * 127)));
-                break;
-            }
-
-            eventStorage.midi[0] = paramId / 130;
-
-            eventList[numUsed].sampleOffset = sampleOffset;
-            eventList[numUsed].storage = &eventStorage;
-
-            return placeSorted(sampleOffset);
-        }
-
-       #if DISTRHO_PLUGIN_HAS_UI
-        // NOTE always runs first
-        bool appendFromUI(const uint8_t midiData[3])
-        {
-            InputEventStorage& eventStorage(eventListStorage[numUsed]);
-
-            eventStorage.type = UI_MIDI;
-            std::memcpy(eventStorage.midi, midiData, sizeof(uint8_t)*3);
-
-            InputEvent* const event = &eventList[numUsed];
-
-            event->sampleOffset = 0;
-            event->storage = &eventStorage;
-            event->next = nullptr;
-
-            if (numUsed == 0)
-            {
-                firstEvent = lastEvent = event;
-            }
-            else
-            {
-                lastEvent->next = event;
-                lastEvent = event;
-            }
-
-            return ++numUsed == kMaxMidiEvents;
-        }
-       #endif
-
-    private:
-        bool placeSorted(const int32_t sampleOffset) noexcept
-        {
-            InputEvent* const event = &eventList[numUsed];
-
-            // initialize
-            if (numUsed == 0)
-            {
-                firstSampleOffset = lastSampleOffset = sampleOffset;
-                firstEvent = lastEvent = event;
-                event->next = nullptr;
-            }
-            // push to the back
-            else if (sampleOffset >= lastSampleOffset)
-            {
-                lastSampleOffset = sampleOffset;
-                lastEvent->next = event;
-                lastEvent = event;
-                event->next = nullptr;
-            }
-            // push to the front
-            else if (sampleOffset < firstSampleOffset)
-            {
-                firstSampleOffset = sampleOffset;
-                event->next = firstEvent;
-                firstEvent = event;
-            }
-            // find place in between events
-            else
-            {
-                // keep reference out of the loop so we can check validity afterwards
-                InputEvent* event2 = firstEvent;
-
-                // iterate all events
-                for (; event2 != nullptr; event2 = event2->next)
-                {
-                    // if offset is higher than iterated event, stop and insert in-between
-                    if (sampleOffset > event2->sampleOffset)
-                        break;
-
-                    // if offset matches, find the last event with the same offset so we can push after it
-                    if (sampleOffset == event2->sampleOffset)
-                    {
-                        event2 = event2->next;
-                        for (; event2 != nullptr && sampleOffset == event2->sampleOffset; event2 = event2->next) {}
-                        break;
-                    }
-                }
-
-                DISTRHO_SAFE_ASSERT_RETURN(event2 != nullptr, true);
-
-                event->next = event2->next;
-                event2->next = event;
-            }
-
-            return ++numUsed == kMaxMidiEvents;
-        }
-    } inputEventList;
-   #endif // DISTRHO_PLUGIN_WANT_MIDI_INPUT
-
 public:
     PluginVst3(v3_host_application** const host, const bool isComponent)
         : fPlugin(this, writeMidiCallback, requestParameterValueChangeCallback, nullptr),
@@ -594,9 +310,13 @@ public:
         #endif
           fParameterCount(fPlugin.getParameterCount()),
           fVst3ParameterCount(fParameterCount + kVst3InternalParameterCount),
+          fParameterStore(fPlugin.getParameterStore()),
           fCachedParameterValues(nullptr),
           fDummyAudioBuffer(nullptr),
-          fParameterValuesChangedDuringProcessing(nullptr)
+         #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+          fDummyAudioBuffer64(nullptr),
+         #endif
+          fParameterValuesChangedDuringProcessing()
        #if DPF_VST3_USES_SEPARATE_CONTROLLER
         , fIsComponent(isComponent)
        #endif
@@ -628,32 +348,27 @@ public:
         fillInBusInfoDetails<false>();
        #endif
 
-        if (const uint32_t extraParameterCount = fParameterCount + kVst3InternalParameterBaseCount)
-        {
-            fCachedParameterValues = new float[extraParameterCount];
-
-           #if DPF_VST3_USES_SEPARATE_CONTROLLER
-            fCachedParameterValues[kVst3InternalParameterBufferSize] = fPlugin.getBufferSize();
-            fCachedParameterValues[kVst3InternalParameterSampleRate] = fPlugin.getSampleRate();
-           #endif
-           #if DISTRHO_PLUGIN_WANT_LATENCY
-            fCachedParameterValues[kVst3InternalParameterLatency]    = fLastKnownLatency;
-           #endif
-           #if DISTRHO_PLUGIN_WANT_PROGRAMS
-            fCachedParameterValues[kVst3InternalParameterProgram]    = 0.0f;
-           #endif
+       #if DPF_VST3_USES_SEPARATE_CONTROLLER || DISTRHO_PLUGIN_WANT_LATENCY || DISTRHO_PLUGIN_WANT_PROGRAMS
+        fCachedParameterValues = new float[kVst3InternalParameterBaseCount];
 
-            for (uint32_t i=0; i < fParameterCount; ++i)
-                fCachedParameterValues[kVst3InternalParameterBaseCount + i] = fPlugin.getParameterDefault(i);
+       #if DPF_VST3_USES_SEPARATE_CONTROLLER
+        fCachedParameterValues[kVst3InternalParameterBufferSize] = fPlugin.getBufferSize();
+        fCachedParameterValues[kVst3InternalParameterSampleRate] = fPlugin.getSampleRate();
+       #endif
+       #if DISTRHO_PLUGIN_WANT_LATENCY
+        fCachedParameterValues[kVst3InternalParameterLatency]    = fLastKnownLatency;
+       #endif
+       #if DISTRHO_PLUGIN_WANT_PROGRAMS
+        fCachedParameterValues[kVst3InternalParameterProgram]    = 0.0f;
+       #endif
 
-            fParameterValuesChangedDuringProcessing = new bool[extraParameterCount];
-            std::memset(fParameterValuesChangedDuringProcessing, 0, sizeof(bool)*extraParameterCount);
+       #if DISTRHO_PLUGIN_HAS_UI
+        fParameterValueChangesForUI = new bool[kVst3InternalParameterBaseCount];
+        std::memset(fParameterValueChangesForUI, 0, sizeof(bool)*kVst3InternalParameterBaseCount);
+       #endif
+       #endif
 
-           #if DISTRHO_PLUGIN_HAS_UI
-            fParameterValueChangesForUI = new bool[extraParameterCount];
-            std::memset(fParameterValueChangesForUI, 0, sizeof(bool)*extraParameterCount);
-           #endif
-        }
+        fParameterValuesChangedDuringProcessing.init(fParameterCount + kVst3InternalParameterBaseCount);
 
        #if DISTRHO_PLUGIN_WANT_STATE
         for (uint32_t i=0, count=fPlugin.getStateCount(); i<count; ++i)
@@ -683,11 +398,13 @@ public:
             fDummyAudioBuffer = nullptr;
         }
 
-        if (fParameterValuesChangedDuringProcessing != nullptr)
+       #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+        if (fDummyAudioBuffer64 != nullptr)
         {
-            delete[] fParameterValuesChangedDuringProcessing;
-            fParameterValuesChangedDuringProcessing = nullptr;
+            delete[] fDummyAudioBuffer64;
+            fDummyAudioBuffer64 = nullptr;
         }
+       #endif
 
        #if DISTRHO_PLUGIN_HAS_UI
         if (fParameterValueChangesForUI != nullptr)
@@ -701,13 +418,93 @@ public:
     // ----------------------------------------------------------------------------------------------------------------
     // utilities and common code
 
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+    // Convert a VST3 event into MIDI, events without a direct MIDI equivalent are ignored.
+    static void _appendMidiEvent(MidiEventArena& midiEvents, const v3_event& event) noexcept
+    {
+        const uint32_t frame = static_cast<uint32_t>(std::max(0, event.sample_offset));
+
+        switch (event.type)
+        {
+        case V3_EVENT_NOTE_ON:
+            if (MidiEvent* const midiEvent = midiEvents.append(frame))
+            {
+                midiEvent->size = 3;
+                midiEvent->data[0] = 0x90 | (event.note_on.channel & 0xf);
+                midiEvent->data[1] = event.note_on.pitch;
+                midiEvent->data[2] = std::max(0, std::min(127, d_roundToIntPositive(event.note_on.velocity * 127)));
+            }
+            break;
+        case V3_EVENT_NOTE_OFF:
+            if (MidiEvent* const midiEvent = midiEvents.append(frame))
+            {
+                midiEvent->size = 3;
+                midiEvent->data[0] = 0x80 | (event.note_off.channel & 0xf);
+                midiEvent->data[1] = event.note_off.pitch;
+                midiEvent->data[2] = std::max(0, std::min(127, d_roundToIntPositive(event.note_off.velocity * 127)));
+            }
+            break;
+        case V3_EVENT_POLY_PRESSURE:
+            if (MidiEvent* const midiEvent = midiEvents.append(frame))
+            {
+                midiEvent->size = 3;
+                midiEvent->data[0] = 0xA0 | (event.poly_pressure.channel & 0xf);
+                midiEvent->data[1] = event.poly_pressure.pitch;
+                midiEvent->data[2] = std::max(0, std::min(127, d_roundToIntPositive(event.poly_pressure.pressure * 127)));
+            }
+            break;
+        case V3_EVENT_DATA:
+            // only MIDI SysEx data, copied as the host only keeps it valid during this block
+            if (event.data.type == 0 && event.data.bytes != nullptr && event.data.size != 0)
+                midiEvents.append(frame, event.data.bytes, event.data.size);
+            break;
+        }
+    }
+
+    // Convert a MIDI CC parameter change into MIDI, see kVst3InternalParameterMidiCC_start.
+    static void _appendMidiCC(MidiEventArena& midiEvents, const int32_t sampleOffset,
+                              v3_param_id paramId, const double normalized) noexcept
+    {
+        MidiEvent* const midiEvent = midiEvents.append(static_cast<uint32_t>(std::max(0, sampleOffset)));
+
+        if (midiEvent == nullptr)
+            return;
+
+        paramId -= kVst3InternalParameterMidiCC_start;
+
+        const uint8_t channel = (paramId / 130) & 0xf;
+        const uint8_t cc = paramId % 130;
+
+        switch (cc)
+        {
+        case 128:
+            midiEvent->size = 2;
+            midiEvent->data[0] = 0xD0 | channel;
+            midiEvent->data[1] = std::max(0, std::min(127, d_roundToIntPositive(normalized * 127)));
+            break;
+        case 129:
+            midiEvent->size = 3;
+            midiEvent->data[0] = 0xE0 | channel;
+            midiEvent->data[1] = std::max(0, std::min(16384, (int)(normalized * 16384))) & 0x7f;
+            midiEvent->data[2] = std::max(0, std::min(16384, (int)(normalized * 16384))) >> 7;
+            break;
+        default:
+            midiEvent->size = 3;
+            midiEvent->data[0] = 0xB0 | channel;
+            midiEvent->data[1] = cc;
+            midiEvent->data[2] = std::max(0, std::min(127, d_roundToIntPositive(normalized * 127)));
+            break;
+        }
+    }
+   #endif
+
     double _getNormalizedParameterValue(const uint32_t index, const double plain)
     {
         const ParameterRanges& ranges(fPlugin.getParameterRanges(index));
         return ranges.getFixedAndNormalizedValue(plain);
     }
 
-    void _setNormalizedPluginParameterValue(const uint32_t index, const double normalized)
+    void _setNormalizedPluginParameterValue(const uint32_t index, const double normalized, const uint32_t frame = 0)
     {
         const ParameterRanges& ranges(fPlugin.getParameterRanges(index));
         const uint32_t hints = fPlugin.getParameterHints(index);
@@ -719,7 +516,7 @@ public:
             const float midRange = ranges.min + (ranges.max - ranges.min) / 2.f;
             const bool isHigh = value > midRange;
 
-            if (isHigh == (fCachedParameterValues[kVst3InternalParameterBaseCount + index] > midRange))
+            if (isHigh == (fParameterStore.getValue(index) > midRange))
                 return;
 
             value = isHigh ? ranges.max : ranges.min;
@@ -728,7 +525,7 @@ public:
         {
             const int ivalue = d_roundToInt(value);
 
-            if (d_roundToInt(fCachedParameterValues[kVst3InternalParameterBaseCount + index]) == ivalue)
+            if (d_roundToInt(fParameterStore.getValue(index)) == ivalue)
                 return;
 
             value = ivalue;
@@ -736,23 +533,29 @@ public:
         else
         {
             // deal with low resolution of some hosts, which convert double to float internally and lose precision
-            if (std::abs(ranges.getNormalizedValue(static_cast<double>(fCachedParameterValues[kVst3InternalParameterBaseCount + index])) - normalized) < 0.0000001)
+            if (std::abs(ranges.getNormalizedValue(static_cast<double>(fParameterStore.getValue(index))) - normalized) < 0.0000001)
                 return;
         }
 
-        fCachedParameterValues[kVst3InternalParameterBaseCount + index] = value;
+        if (fPlugin.isParameterOutputOrTrigger(index))
+        {
+            fParameterStore.setValue(index, value, true);
+            return;
+        }
 
-      #if DISTRHO_PLUGIN_HAS_UI
-       #if DPF_VST3_USES_SEPARATE_CONTROLLER
-        if (!fIsComponent)
-       #endif
+       #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+        if (frame != 0 && fPlugin.addParameterChange(frame, index, value))
         {
-            fParameterValueChangesForUI[kVst3InternalParameterBaseCount + index] = true;
+            // the plugin gets the value during run(), the store is updated now
+            fParameterStore.setValue(index, value, true);
+            return;
         }
-      #endif
+       #else
+        // unused
+        (void)frame;
+       #endif
 
-        if (!fPlugin.isParameterOutputOrTrigger(index))
-            fPlugin.setParameterValue(index, value);
+        fPlugin.setParameterValue(index, value, true);
     }
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -936,214 +739,95 @@ public:
         return V3_OK;
     }
 
-    /* state: we pack pairs of key-value strings each separated by a null/zero byte.
+    /* state: we use the binary DPF state chunk, see DistrhoPluginStateChunk.hpp.
      * current-program comes first, then dpf key/value states and then parameters.
-     * parameters are simply converted to/from strings and floats.
-     * the parameter symbol is used as the "key", so it is possible to reorder them or even remove and add safely.
-     * there are markers for begin and end of state and parameters, so they never conflict.
+     * parameters are stored by a hash of their symbol, so it is possible to reorder them or even remove and add safely.
+     * the older text-based format is still accepted when loading.
      */
+    struct StreamReader {
+        v3_bstream** const stream;
+
+        int32_t operator()(void* const buffer, const int32_t size) const
+        {
+            int32_t read = 0;
+            const v3_result res = v3_cpp_obj(stream)->read(stream, buffer, size, &read);
+            DISTRHO_SAFE_ASSERT_INT_RETURN(res == V3_OK, res, -1);
+            return read;
+        }
+    };
+
     v3_result setState(v3_bstream** const stream)
     {
        #if DISTRHO_PLUGIN_HAS_UI
         const bool connectedToUI = fConnectionFromCtrlToView != nullptr && fConnectedToUI;
        #endif
         bool componentValuesChanged = false;
-        String key, value;
-        bool empty = true;
-        bool hasValue = false;
-        bool fillingKey = true; // if filling key or value
-        char queryingType = 'i'; // can be 'n', 's' or 'p' (none, states, parameters)
-
-        char buffer[512], orig;
-        buffer[sizeof(buffer)-1] = '\xff';
-        v3_result res;
 
-        for (int32_t terminated = 0, read; terminated == 0;)
-        {
-            read = -1;
-            res = v3_cpp_obj(stream)->read(stream, buffer, sizeof(buffer)-1, &read);
-            DISTRHO_SAFE_ASSERT_INT_RETURN(res == V3_OK, res, res);
-            DISTRHO_SAFE_ASSERT_INT_RETURN(read > 0, read, V3_INTERNAL_ERR);
+        std::vector<uint8_t> data;
+        StreamReader reader = { stream };
 
-            if (read == 0)
-                return empty ? V3_INVALID_ARG : V3_OK;
-
-            empty = false;
-            for (int32_t i = 0; i < read; ++i)
-            {
-                // found terminator, stop here
-                if (buffer[i] == '\xfe')
-                {
-                    terminated = 1;
-                    break;
-                }
-
-                // store character at read position
-                orig = buffer[read];
-
-                // place null character to create valid string
-                buffer[read] = '\0';
-
-                // append to temporary vars
-                if (fillingKey)
-                {
-                    key += buffer + i;
-                }
-                else
-                {
-                    value += buffer + i;
-                    hasValue = true;
-                }
-
-                // increase buffer offset by length of string
-                i += std::strlen(buffer + i);
-
-                // restore read character
-                buffer[read] = orig;
-
-                // if buffer offset points to null, we found the end of a string, lets check
-                if (buffer[i] == '\0')
-                {
-                    // special keys
-                    if (key == "__dpf_state_begin__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'i' || queryingType == 'n',
-                                                       queryingType, V3_INTERNAL_ERR);
-                        queryingType = 's';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-                    if (key == "__dpf_state_end__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 's', queryingType, V3_INTERNAL_ERR);
-                        queryingType = 'n';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-                    if (key == "__dpf_parameters_begin__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'i' || queryingType == 'n',
-                                                       queryingType, V3_INTERNAL_ERR);
-                        queryingType = 'p';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-                    if (key == "__dpf_parameters_end__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'p', queryingType, V3_INTERNAL_ERR);
-                        queryingType = 'x';
-                        key.clear();
-                        value.clear();
-                        hasValue = false;
-                        continue;
-                    }
-
-                    // no special key, swap between reading real key and value
-                    fillingKey = !fillingKey;
-
-                    // if there is no value yet keep reading until we have one
-                    if (! hasValue)
-                        continue;
+        if (! d_readStateChunk(reader, data))
+            return V3_INVALID_ARG;
 
-                    if (key == "__dpf_program__")
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_RETURN(queryingType == 'i', queryingType, V3_INTERNAL_ERR);
-                        queryingType = 'n';
+        StateChunkReader chunk(data.data(), data.size());
+        DISTRHO_SAFE_ASSERT_RETURN(chunk.isValid(), V3_INTERNAL_ERR);
 
-                        d_debug("found program '%s'", value.buffer());
+       #if DISTRHO_PLUGIN_WANT_PROGRAMS
+        if (chunk.getProgram() >= 0 && static_cast<uint32_t>(chunk.getProgram()) < fPlugin.getProgramCount())
+        {
+            d_debug("found program '%d'", chunk.getProgram());
 
-                      #if DISTRHO_PLUGIN_WANT_PROGRAMS
-                        const int program = std::atoi(value.buffer());
-                        DISTRHO_SAFE_ASSERT_CONTINUE(program >= 0);
+            fCurrentProgram = static_cast<uint32_t>(chunk.getProgram());
+            fPlugin.loadProgram(fCurrentProgram);
 
-                        fCurrentProgram = static_cast<uint32_t>(program);
-                        fPlugin.loadProgram(fCurrentProgram);
+           #if DISTRHO_PLUGIN_HAS_UI
+            if (connectedToUI)
+            {
+                fParameterValueChangesForUI[kVst3InternalParameterProgram] = false;
+                sendParameterSetToUI(kVst3InternalParameterProgram, fCurrentProgram);
+            }
+           #endif
+        }
+       #endif
 
-                       #if DISTRHO_PLUGIN_HAS_UI
-                        if (connectedToUI)
-                        {
-                            fParameterValueChangesForUI[kVst3InternalParameterProgram] = false;
-                            sendParameterSetToUI(kVst3InternalParameterProgram, program);
-                        }
-                       #endif
-                      #endif
-                    }
-                    else if (queryingType == 's')
-                    {
-                        d_debug("found state '%s' '%s'", key.buffer(), value.buffer());
+       #if DISTRHO_PLUGIN_WANT_STATE
+        for (const char *key, *value; chunk.readNextState(key, value);)
+        {
+            d_debug("found state '%s' '%s'", key, value);
 
-                       #if DISTRHO_PLUGIN_WANT_STATE
-                        if (fPlugin.wantStateKey(key))
-                        {
-                            fStateMap[key] = value;
-                            fPlugin.setState(key, value);
+            if (fPlugin.wantStateKey(key))
+            {
+                const String dkey(key);
+                fStateMap[dkey] = value;
+                fPlugin.setState(key, value);
 
-                           #if DISTRHO_PLUGIN_HAS_UI
-                            if (connectedToUI)
-                                sendStateSetToUI(key, value);
-                           #endif
-                        }
-                       #endif
-                    }
-                    else if (queryingType == 'p')
-                    {
-                        d_debug("found parameter '%s' '%s'", key.buffer(), value.buffer());
-                        float fvalue;
+               #if DISTRHO_PLUGIN_HAS_UI
+                if (connectedToUI)
+                    sendStateSetToUI(key, value);
+               #endif
+            }
+        }
+       #endif
 
-                        // find parameter with this symbol, and set its value
-                        for (uint32_t j=0; j < fParameterCount; ++j)
-                        {
-                            if (fPlugin.isParameterOutputOrTrigger(j))
-                                continue;
-                            if (fPlugin.getParameterSymbol(j) != key)
-                                continue;
-
-                            if (fPlugin.getParameterHints(j) & kParameterIsInteger)
-                            {
-                                fvalue = std::atoi(value.buffer());
-                            }
-                            else
-                            {
-                                const ScopedSafeLocale ssl;
-                                fvalue = std::atof(value.buffer());
-                            }
-
-                            fCachedParameterValues[kVst3InternalParameterBaseCount + j] = fvalue;
-
-                           #if DPF_VST3_USES_SEPARATE_CONTROLLER
-                            // If this is the component make sure the controller also knows about the state change
-                            if (fIsComponent)
-                            {
-                                componentValuesChanged = true;
-                                fParameterValuesChangedDuringProcessing[kVst3InternalParameterBaseCount + j] = true;
-                            }
-                           #else
-                            componentValuesChanged = true;
-                           #endif
-
-                           #if DISTRHO_PLUGIN_HAS_UI
-                            if (connectedToUI)
-                            {
-                                // UI parameter updates are handled outside the read loop (after host param restart)
-                                fParameterValueChangesForUI[kVst3InternalParameterBaseCount + j] = true;
-                            }
-                           #endif
-                            fPlugin.setParameterValue(j, fvalue);
-                            break;
-                        }
-                    }
+        uint32_t symbolHash, index;
+        for (float fvalue; chunk.readNextParameter(symbolHash, fvalue);)
+        {
+            if (! fPlugin.findParameterBySymbolHash(symbolHash, index))
+                continue;
 
-                    key.clear();
-                    value.clear();
-                    hasValue = false;
-                }
+           #if DPF_VST3_USES_SEPARATE_CONTROLLER
+            // If this is the component make sure the controller also knows about the state change
+            if (fIsComponent)
+            {
+                componentValuesChanged = true;
+                fParameterValuesChangedDuringProcessing.set(kVst3InternalParameterBaseCount + index);
             }
+           #else
+            componentValuesChanged = true;
+           #endif
+
+            // UI parameter updates are handled outside the read loop (after host param restart)
+            fPlugin.setParameterValue(index, fvalue);
         }
 
         if (fComponentHandler != nullptr && componentValuesChanged)
@@ -1156,9 +840,8 @@ public:
             {
                 if (fPlugin.isParameterOutputOrTrigger(i))
                     continue;
-                fParameterValueChangesForUI[kVst3InternalParameterBaseCount + i] = false;
-                sendParameterSetToUI(kVst3InternalParameterCount + i,
-                                     fCachedParameterValues[kVst3InternalParameterBaseCount + i]);
+                fParameterStore.getChanges().take(i);
+                sendParameterSetToUI(kVst3InternalParameterCount + i, fParameterStore.getValue(i));
             }
         }
        #endif
@@ -1168,20 +851,6 @@ public:
 
     v3_result getState(v3_bstream** const stream)
     {
-        const uint32_t paramCount = fPlugin.getParameterCount();
-       #if DISTRHO_PLUGIN_WANT_STATE
-        const uint32_t stateCount = fPlugin.getStateCount();
-       #else
-        constexpr const uint32_t stateCount = 0;
-       #endif
-
-        if (stateCount == 0 && paramCount == 0)
-        {
-            char buffer = '\0';
-            int32_t ignored;
-            return v3_cpp_obj(stream)->write(stream, &buffer, 1, &ignored);
-        }
-
        #if DISTRHO_PLUGIN_WANT_FULL_STATE
         // Update current state
         for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
@@ -1191,81 +860,36 @@ public:
         }
        #endif
 
-        String state;
-
        #if DISTRHO_PLUGIN_WANT_PROGRAMS
-        {
-            String tmpStr("__dpf_program__\xff");
-            tmpStr += String(fCurrentProgram);
-            tmpStr += "\xff";
-
-            state += tmpStr;
-        }
+        StateChunkWriter writer(static_cast<int32_t>(fCurrentProgram));
+       #else
+        StateChunkWriter writer;
        #endif
 
        #if DISTRHO_PLUGIN_WANT_STATE
-        if (stateCount != 0)
-        {
-            state += "__dpf_state_begin__\xff";
-
-            for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
-            {
-                const String& key(cit->first);
-                const String& value(cit->second);
-
-                // join key and value
-                String tmpStr;
-                tmpStr  = key;
-                tmpStr += "\xff";
-                tmpStr += value;
-                tmpStr += "\xff";
-
-                state += tmpStr;
-            }
-
-            state += "__dpf_state_end__\xff";
-        }
+        for (StringMap::const_iterator cit=fStateMap.begin(), cite=fStateMap.end(); cit != cite; ++cit)
+            writer.addState(cit->first, cit->second);
        #endif
 
-        if (paramCount != 0)
-        {
-            state += "__dpf_parameters_begin__\xff";
-
-            for (uint32_t i=0; i<paramCount; ++i)
-            {
-                if (fPlugin.isParameterOutputOrTrigger(i))
-                    continue;
-
-                // join key and value
-                String tmpStr;
-                tmpStr  = fPlugin.getParameterSymbol(i);
-                tmpStr += "\xff";
-                if (fPlugin.getParameterHints(i) & kParameterIsInteger)
-                    tmpStr += String(d_roundToInt(fPlugin.getParameterValue(i)));
-                else
-                    tmpStr += String(fPlugin.getParameterValue(i));
-                tmpStr += "\xff";
-
-                state += tmpStr;
-            }
+        for (uint32_t i=0; i<fParameterCount; ++i)
+        {
+            if (fPlugin.isParameterOutputOrTrigger(i))
+                continue;
 
-            state += "__dpf_parameters_end__\xff";
+            writer.addParameter(fPlugin.getParameterSymbol(i), fPlugin.getParameterValue(i));
         }
 
-        // terminator
-        state += "\xfe";
-
-        state.replace('\xff', '\0');
+        const std::vector<uint8_t>& state(writer.finish());
 
         // now saving state, carefully until host written bytes matches full state size
-        const char* buffer = state.buffer();
-        const int32_t size = static_cast<int32_t>(state.length())+1;
+        const uint8_t* const buffer = state.data();
+        const int32_t size = static_cast<int32_t>(state.size());
         v3_result res;
 
         for (int32_t wrtntotal = 0, wrtn; wrtntotal < size; wrtntotal += wrtn)
         {
             wrtn = 0;
-            res = v3_cpp_obj(stream)->write(stream, const_cast<char*>(buffer) + wrtntotal, size - wrtntotal, &wrtn);
+            res = v3_cpp_obj(stream)->write(stream, const_cast<uint8_t*>(buffer) + wrtntotal, size - wrtntotal, &wrtn);
 
             DISTRHO_SAFE_ASSERT_INT_RETURN(res == V3_OK, res, res);
             DISTRHO_SAFE_ASSERT_INT_RETURN(wrtn > 0, wrtn, V3_INTERNAL_ERR);
@@ -1344,22 +968,28 @@ public:
 
     v3_result setupProcessing(v3_process_setup* const setup)
     {
+       #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+        DISTRHO_SAFE_ASSERT_INT_RETURN(setup->symbolic_sample_size == V3_SAMPLE_32 ||
+                                       setup->symbolic_sample_size == V3_SAMPLE_64,
+                                       setup->symbolic_sample_size, V3_INVALID_ARG);
+       #else
         DISTRHO_SAFE_ASSERT_RETURN(setup->symbolic_sample_size == V3_SAMPLE_32, V3_INVALID_ARG);
+       #endif
 
         const bool active = fPlugin.isActive();
         fPlugin.deactivateIfNeeded();
 
-        // TODO process_mode can be V3_REALTIME, V3_PREFETCH, V3_OFFLINE
-
+        // V3_PREFETCH is still bound by real-time deadlines, only V3_OFFLINE counts as offline rendering
+        fPlugin.setOfflineRendering(setup->process_mode == V3_OFFLINE, true);
         fPlugin.setSampleRate(setup->sample_rate, true);
         fPlugin.setBufferSize(setup->max_block_size, true);
 
       #if DPF_VST3_USES_SEPARATE_CONTROLLER
         fCachedParameterValues[kVst3InternalParameterBufferSize] = setup->max_block_size;
-        fParameterValuesChangedDuringProcessing[kVst3InternalParameterBufferSize] = true;
+        fParameterValuesChangedDuringProcessing.set(kVst3InternalParameterBufferSize);
 
         fCachedParameterValues[kVst3InternalParameterSampleRate] = setup->sample_rate;
-        fParameterValuesChangedDuringProcessing[kVst3InternalParameterSampleRate] = true;
+        fParameterValuesChangedDuringProcessing.set(kVst3InternalParameterSampleRate);
        #if DISTRHO_PLUGIN_HAS_UI
         fParameterValueChangesForUI[kVst3InternalParameterSampleRate] = true;
        #endif
@@ -1371,6 +1001,11 @@ public:
         delete[] fDummyAudioBuffer;
         fDummyAudioBuffer = new float[setup->max_block_size];
 
+       #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+        delete[] fDummyAudioBuffer64;
+        fDummyAudioBuffer64 = new double[setup->max_block_size];
+       #endif
+
         return V3_OK;
     }
 
@@ -1391,7 +1026,13 @@ public:
 
     v3_result process(v3_process_data* const data)
     {
+       #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+        DISTRHO_SAFE_ASSERT_INT_RETURN(data->symbolic_sample_size == V3_SAMPLE_32 ||
+                                       data->symbolic_sample_size == V3_SAMPLE_64,
+                                       data->symbolic_sample_size, V3_INVALID_ARG);
+       #else
         DISTRHO_SAFE_ASSERT_RETURN(data->symbolic_sample_size == V3_SAMPLE_32, V3_INVALID_ARG);
+       #endif
         // d_debug("process %i", data->symbolic_sample_size);
 
         // activate plugin if not done yet
@@ -1461,96 +1102,36 @@ public:
             return V3_OK;
         }
 
-        const float* inputs[DISTRHO_PLUGIN_NUM_INPUTS != 0 ? DISTRHO_PLUGIN_NUM_INPUTS : 1];
-        /* */ float* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS != 0 ? DISTRHO_PLUGIN_NUM_OUTPUTS : 1];
-
-        std::memset(fDummyAudioBuffer, 0, sizeof(float)*data->nframes);
-
-        {
-            int32_t i = 0;
-           #if DISTRHO_PLUGIN_NUM_INPUTS > 0
-            if (data->inputs != nullptr)
-            {
-                for (int32_t b = 0; b < data->num_input_buses; ++b) {
-                    for (int32_t j = 0; j < data->inputs[b].num_channels; ++j)
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_BREAK(i < DISTRHO_PLUGIN_NUM_INPUTS, i);
-                        if (!fEnabledInputs[i] && i < DISTRHO_PLUGIN_NUM_INPUTS) {
-                            inputs[i++] = fDummyAudioBuffer;
-                            continue;
-                        }
-
-                        inputs[i++] = data->inputs[b].channel_buffers_32[j];
-                    }
-                }
-            }
-           #endif
-            for (; i < std::max(1, DISTRHO_PLUGIN_NUM_INPUTS); ++i)
-                inputs[i] = fDummyAudioBuffer;
-        }
-
-        {
-            int32_t i = 0;
-           #if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
-            if (data->outputs != nullptr)
-            {
-                for (int32_t b = 0; b < data->num_output_buses; ++b) {
-                    for (int32_t j = 0; j < data->outputs[b].num_channels; ++j)
-                    {
-                        DISTRHO_SAFE_ASSERT_INT_BREAK(i < DISTRHO_PLUGIN_NUM_OUTPUTS, i);
-                        if (!fEnabledOutputs[i] && i < DISTRHO_PLUGIN_NUM_OUTPUTS) {
-                            outputs[i++] = fDummyAudioBuffer;
-                            continue;
-                        }
-
-                        outputs[i++] = data->outputs[b].channel_buffers_32[j];
-                    }
-                }
-            }
-           #endif
-            for (; i < std::max(1, DISTRHO_PLUGIN_NUM_OUTPUTS); ++i)
-                outputs[i] = fDummyAudioBuffer;
-        }
-
        #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
         fHostEventOutputHandle = data->output_events;
        #endif
 
       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        bool canAppendMoreEvents = true;
-        inputEventList.init();
+        // events are appended as received, the plugin exporter sorts them by frame if needed
+        MidiEventArena& midiEvents(fPlugin.getMidiInputEvents());
+        midiEvents.clear();
 
        #if DISTRHO_PLUGIN_HAS_UI
+        // NOTE always runs first
         while (fNotesRingBuffer.isDataAvailableForReading())
         {
             uint8_t midiData[3];
             if (! fNotesRingBuffer.readCustomData(midiData, 3))
                 break;
 
-            if (inputEventList.appendFromUI(midiData))
-            {
-                canAppendMoreEvents = false;
-                break;
-            }
+            midiEvents.append(0, midiData, 3);
         }
        #endif
 
-        if (canAppendMoreEvents)
+        if (v3_event_list** const eventptr = data->input_events)
         {
-            if (v3_event_list** const eventptr = data->input_events)
+            v3_event event;
+            for (uint32_t i = 0, count = v3_cpp_obj(eventptr)->get_event_count(eventptr); i < count; ++i)
             {
-                v3_event event;
-                for (uint32_t i = 0, count = v3_cpp_obj(eventptr)->get_event_count(eventptr); i < count; ++i)
-                {
-                    if (v3_cpp_obj(eventptr)->get_event(eventptr, i, &event) != V3_OK)
-                        break;
+                if (v3_cpp_obj(eventptr)->get_event(eventptr, i, &event) != V3_OK)
+                    break;
 
-                    if (inputEventList.appendEvent(event))
-                    {
-                        canAppendMoreEvents = false;
-                        break;
-                    }
-                }
+                _appendMidiEvent(midiEvents, event);
             }
         }
       #endif
@@ -1573,18 +1154,14 @@ public:
                 {
                    #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
                     // if there are any MIDI CC events as parameter changes, handle them here
-                    if (canAppendMoreEvents && rindex >= kVst3InternalParameterMidiCC_start && rindex <= kVst3InternalParameterMidiCC_end)
+                    if (rindex >= kVst3InternalParameterMidiCC_start && rindex <= kVst3InternalParameterMidiCC_end)
                     {
                         for (int32_t j = 0, pcount = v3_cpp_obj(queue)->get_point_count(queue); j < pcount; ++j)
                         {
                             if (v3_cpp_obj(queue)->get_point(queue, j, &offset, &normalized) != V3_OK)
                                 break;
 
-                            if (inputEventList.appendCC(offset, rindex, normalized))
-                            {
-                                canAppendMoreEvents = false;
-                                break;
-                            }
+                            _appendMidiCC(midiEvents, offset, rindex, normalized);
                         }
                     }
                    #endif
@@ -1592,6 +1169,19 @@ public:
                 }
                #endif
 
+                const uint32_t index = rindex - kVst3InternalParameterCount;
+
+               #if DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
+                // queue every point, the plugin exporter will split the block at each change
+                for (int32_t j = 0, pcount = v3_cpp_obj(queue)->get_point_count(queue); j < pcount; ++j)
+                {
+                    if (v3_cpp_obj(queue)->get_point(queue, j, &offset, &normalized) != V3_OK)
+                        break;
+
+                    _setNormalizedPluginParameterValue(index, normalized,
+                                                       static_cast<uint32_t>(std::max(0, std::min(offset, data->nframes - 1))));
+                }
+               #else
                 if (v3_cpp_obj(queue)->get_point_count(queue) <= 0)
                     continue;
 
@@ -1602,22 +1192,58 @@ public:
                 if (offset != 0)
                     continue;
 
-                const uint32_t index = rindex - kVst3InternalParameterCount;
                 _setNormalizedPluginParameterValue(index, normalized);
+               #endif
             }
         }
 
-       #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-        const uint32_t midiEventCount = inputEventList.convert(fMidiEvents);
-        fPlugin.run(inputs, outputs, data->nframes, fMidiEvents, midiEventCount);
-       #else
-        fPlugin.run(inputs, outputs, data->nframes);
+       #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+        if (_areInputsSilent(data))
+            fPlugin.setInputsAreSilent();
+       #endif
+
+       #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+        if (data->symbolic_sample_size == V3_SAMPLE_64)
+        {
+            const double* inputs[DISTRHO_PLUGIN_NUM_INPUTS != 0 ? DISTRHO_PLUGIN_NUM_INPUTS : 1];
+            /* */ double* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS != 0 ? DISTRHO_PLUGIN_NUM_OUTPUTS : 1];
+            _setupAudioBuffers(data, inputs, outputs, fDummyAudioBuffer64);
+
+           #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+            fPlugin.run(inputs, outputs, data->nframes, midiEvents.getSortedEvents(), midiEvents.getCount());
+           #else
+            fPlugin.run(inputs, outputs, data->nframes);
+           #endif
+        }
+        else
        #endif
+        {
+            const float* inputs[DISTRHO_PLUGIN_NUM_INPUTS != 0 ? DISTRHO_PLUGIN_NUM_INPUTS : 1];
+            /* */ float* outputs[DISTRHO_PLUGIN_NUM_OUTPUTS != 0 ? DISTRHO_PLUGIN_NUM_OUTPUTS : 1];
+            _setupAudioBuffers(data, inputs, outputs, fDummyAudioBuffer);
+
+           #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
+            fPlugin.run(inputs, outputs, data->nframes, midiEvents.getSortedEvents(), midiEvents.getCount());
+           #else
+            fPlugin.run(inputs, outputs, data->nframes);
+           #endif
+        }
 
        #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
         fHostEventOutputHandle = nullptr;
        #endif
 
+       #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+        if (data->outputs != nullptr)
+        {
+            const bool silent = fPlugin.areOutputsSilent();
+
+            for (int32_t b = 0; b < data->num_output_buses; ++b)
+                data->outputs[b].channel_silence_bitset = silent ? _getSilenceMask(data->outputs[b].num_channels) : 0;
+        }
+       #endif
+
+       #if ! DISTRHO_PLUGIN_WANT_SAMPLE_ACCURATE_PARAMETERS
         // if there are any parameter changes after frame 0, set them here
         if (v3_param_changes** const inparamsptr = data->input_params)
         {
@@ -1652,14 +1278,119 @@ public:
                 _setNormalizedPluginParameterValue(index, normalized);
             }
         }
+       #endif
 
         updateParametersFromProcessing(data->output_params, data->nframes - 1);
         return V3_OK;
     }
 
+   #if DPF_PLUGIN_HAS_SILENCE_DETECTION
+    // ----------------------------------------------------------------------------------------------------------------
+    // silence flags
+
+    static uint64_t _getSilenceMask(const int32_t numChannels) noexcept
+    {
+        return numChannels >= 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << numChannels) - 1;
+    }
+
+    static bool _areInputsSilent(const v3_process_data* const data) noexcept
+    {
+        if (data->inputs == nullptr || data->num_input_buses <= 0)
+            return false;
+
+        for (int32_t b = 0; b < data->num_input_buses; ++b)
+        {
+            const uint64_t mask = _getSilenceMask(data->inputs[b].num_channels);
+
+            if ((data->inputs[b].channel_silence_bitset & mask) != mask)
+                return false;
+        }
+
+        return true;
+    }
+   #endif
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // audio buffer setup, shared between single and double precision processing
+
+    static float** _getChannelBuffers(const v3_audio_bus_buffers& buffers, const float*) noexcept
+    {
+        return buffers.channel_buffers_32;
+    }
+
+    static double** _getChannelBuffers(const v3_audio_bus_buffers& buffers, const double*) noexcept
+    {
+        return buffers.channel_buffers_64;
+    }
+
+    template<typename T>
+    void _setupAudioBuffers(v3_process_data* const data, const T** const inputs, T** const outputs, T* const dummyBuffer)
+    {
+        // only clear the dummy buffer when it is actually in use, which is not the case for most blocks
+        bool dummyBufferInUse = false;
+
+        {
+            int32_t i = 0;
+           #if DISTRHO_PLUGIN_NUM_INPUTS > 0
+            if (data->inputs != nullptr)
+            {
+                for (int32_t b = 0; b < data->num_input_buses; ++b) {
+                    for (int32_t j = 0; j < data->inputs[b].num_channels; ++j)
+                    {
+                        DISTRHO_SAFE_ASSERT_INT_BREAK(i < DISTRHO_PLUGIN_NUM_INPUTS, i);
+                        if (!fEnabledInputs[i] && i < DISTRHO_PLUGIN_NUM_INPUTS) {
+                            inputs[i++] = dummyBuffer;
+                            dummyBufferInUse = true;
+                            continue;
+                        }
+
+                        inputs[i++] = _getChannelBuffers(data->inputs[b], dummyBuffer)[j];
+                    }
+                }
+            }
+           #endif
+            for (; i < std::max(1, DISTRHO_PLUGIN_NUM_INPUTS); ++i)
+            {
+                inputs[i] = dummyBuffer;
+                dummyBufferInUse = true;
+            }
+        }
+
+        {
+            int32_t i = 0;
+           #if DISTRHO_PLUGIN_NUM_OUTPUTS > 0
+            if (data->outputs != nullptr)
+            {
+                for (int32_t b = 0; b < data->num_output_buses; ++b) {
+                    for (int32_t j = 0; j < data->outputs[b].num_channels; ++j)
+                    {
+                        DISTRHO_SAFE_ASSERT_INT_BREAK(i < DISTRHO_PLUGIN_NUM_OUTPUTS, i);
+                        if (!fEnabledOutputs[i] && i < DISTRHO_PLUGIN_NUM_OUTPUTS) {
+                            outputs[i++] = dummyBuffer;
+                            dummyBufferInUse = true;
+                            continue;
+                        }
+
+                        outputs[i++] = _getChannelBuffers(data->outputs[b], dummyBuffer)[j];
+                    }
+                }
+            }
+           #endif
+            for (; i < std::max(1, DISTRHO_PLUGIN_NUM_OUTPUTS); ++i)
+            {
+                outputs[i] = dummyBuffer;
+                dummyBufferInUse = true;
+            }
+        }
+
+        if (dummyBufferInUse)
+            BufferOps::clear(dummyBuffer, data->nframes);
+    }
+
     uint32_t getTailSamples() const noexcept
     {
-        return 0;
+        // NOTE kTailLengthInfinite matches VST3 kInfiniteTail
+        return fPlugin.getTailLength();
     }
 
     // ----------------------------------------------------------------------------------------------------------------
@@ -2032,7 +1763,7 @@ public:
         const uint32_t index = static_cast<uint32_t>(rindex - kVst3InternalParameterCount);
         DISTRHO_SAFE_ASSERT_UINT2_RETURN(index < fParameterCount, index, fParameterCount, 0.0);
 
-        return _getNormalizedParameterValue(index, fCachedParameterValues[kVst3InternalParameterBaseCount + index]);
+        return _getNormalizedParameterValue(index, fParameterStore.getValue(index));
     }
 
     v3_result setParameterNormalized(const v3_param_id rindex, const double normalized)
@@ -2080,7 +1811,7 @@ public:
                 {
                     if (fPlugin.isParameterOutputOrTrigger(i))
                         continue;
-                    fCachedParameterValues[kVst3InternalParameterBaseCount + i] = fPlugin.getParameterValue(i);
+                    fParameterStore.setValue(i, fPlugin.getParameterValue(i), false);
                 }
 
                #if DISTRHO_PLUGIN_HAS_UI
@@ -2216,12 +1947,10 @@ public:
             }
            #endif
 
+            fParameterStore.getChanges().clear();
+
             for (uint32_t i=0; i<fParameterCount; ++i)
-            {
-                fParameterValueChangesForUI[kVst3InternalParameterBaseCount + i] = false;
-                sendParameterSetToUI(kVst3InternalParameterCount + i,
-                                     fCachedParameterValues[kVst3InternalParameterBaseCount + i]);
-            }
+                sendParameterSetToUI(kVst3InternalParameterCount + i, fParameterStore.getValue(i));
 
             sendReadyToUI();
             return V3_OK;
@@ -2251,15 +1980,38 @@ public:
             }
            #endif
 
-            for (uint32_t i=0; i<fParameterCount; ++i)
+            ParameterBitset& changes(fParameterStore.getChanges());
+
+            for (uint32_t w=0, count=changes.getWordCount(); w<count; ++w)
             {
-                if (! fParameterValueChangesForUI[kVst3InternalParameterBaseCount + i])
-                    continue;
+                for (uint32_t bits = changes.takeWord(w); bits != 0;)
+                {
+                    const uint32_t i = w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits);
+                    sendParameterSetToUI(kVst3InternalParameterCount + i, fParameterStore.getValue(i));
+                }
+            }
+
+           #if DISTRHO_PLUGIN_WANT_BACKGROUND_STATE_LOADING
+            // let the UI know the data behind the current value is now in use
+            ParameterBitset& loaded(fPlugin.getLoadedStates());
+
+            for (uint32_t w=0, count=loaded.getWordCount(); w<count; ++w)
+            {
+                for (uint32_t bits = loaded.takeWord(w); bits != 0;)
+                {
+                    const uint32_t i = w * ParameterBitset::kBitsPerWord + ParameterBitset::popLowestBit(bits);
+
+                    if (fPlugin.getStateHints(i) & kStateIsOnlyForDSP)
+                        continue;
+
+                    const String& key(fPlugin.getStateKey(i));
+                    const StringMap::const_iterator cit = fStateMap.find(key);
 
-                fParameterValueChangesForUI[kVst3InternalParameterBaseCount + i] = false;
-                sendParameterSetToUI(kVst3InternalParameterCount + i,
-                                     fCachedParameterValues[kVst3InternalParameterBaseCount + i]);
+                    if (cit != fStateMap.end())
+                        sendStateSetToUI(key, cit->second);
+                }
             }
+           #endif
 
             sendReadyToUI();
             return V3_OK;
@@ -2315,9 +2067,9 @@ public:
             const uint32_t index = rindex - kVst3InternalParameterCount;
             const double normalized = _getNormalizedParameterValue(index, value);
 
-            fCachedParameterValues[kVst3InternalParameterBaseCount + index] = value;
-
-            if (! fPlugin.isParameterOutputOrTrigger(index))
+            if (fPlugin.isParameterOutputOrTrigger(index))
+                fParameterStore.setValue(index, value, false);
+            else
                 fPlugin.setParameterValue(index, value);
 
             return v3_cpp_obj(fComponentHandler)->perform_edit(fComponentHandler, rindex, normalized);
@@ -2452,9 +2204,13 @@ private:
     // Temporary data
     const uint32_t fParameterCount;
     const uint32_t fVst3ParameterCount; // full offset + real
-    float* fCachedParameterValues; // basic offset + real
+    ParameterStore& fParameterStore;
+    float* fCachedParameterValues; // basic offset only
     float* fDummyAudioBuffer;
-    bool* fParameterValuesChangedDuringProcessing; // basic offset + real
+   #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+    double* fDummyAudioBuffer64;
+   #endif
+    ParameterBitset fParameterValuesChangedDuringProcessing; // basic offset + real
    #if DISTRHO_PLUGIN_NUM_INPUTS > 0
     bool fEnabledInputs[DISTRHO_PLUGIN_NUM_INPUTS];
    #endif
@@ -2465,18 +2221,15 @@ private:
     const bool fIsComponent;
    #endif
    #if DISTRHO_PLUGIN_HAS_UI
-    bool* fParameterValueChangesForUI; // basic offset + real
+    bool* fParameterValueChangesForUI; // basic offset only
     bool fConnectedToUI;
    #endif
    #if DISTRHO_PLUGIN_WANT_LATENCY
     uint32_t fLastKnownLatency;
    #endif
-  #if DISTRHO_PLUGIN_WANT_MIDI_INPUT
-    MidiEvent fMidiEvents[kMaxMidiEvents];
-   #if DISTRHO_PLUGIN_HAS_UI
+   #if DISTRHO_PLUGIN_WANT_MIDI_INPUT && DISTRHO_PLUGIN_HAS_UI
     SmallStackRingBuffer fNotesRingBuffer;
    #endif
-  #endif
    #if DISTRHO_PLUGIN_WANT_MIDI_OUTPUT
     v3_event_list** fHostEventOutputHandle;
    #endif
@@ -2879,73 +2632,87 @@ private:
         float curValue, defValue;
         double normalized;
 
-       #if DPF_VST3_USES_SEPARATE_CONTROLLER
-        for (v3_param_id i=kVst3InternalParameterBufferSize; i<=kVst3InternalParameterSampleRate; ++i)
+       #if DISTRHO_PLUGIN_WANT_LATENCY
+        const uint32_t latency = fPlugin.getLatency();
+
+        if (fLastKnownLatency != latency)
         {
-            if (! fParameterValuesChangedDuringProcessing[i])
-                continue;
+            fLastKnownLatency = latency;
 
-            normalized = plainParameterToNormalized(i, fCachedParameterValues[i]);
-            fParameterValuesChangedDuringProcessing[i] = false;
-            addParameterDataToHostOutputEvents(outparamsptr, i, normalized);
+            normalized = plainParameterToNormalized(kVst3InternalParameterLatency,
+                                                    fCachedParameterValues[kVst3InternalParameterLatency]);
+            addParameterDataToHostOutputEvents(outparamsptr, kVst3InternalParameterLatency, normalized);
         }
        #endif
 
-        for (uint32_t i=0; i<fParameterCount; ++i)
+        // NOTE: no output parameter support in VST3, simulate it here
+        const ParameterIndexList& outputs(fPlugin.getOutputParameterIndexList());
+
+        for (uint32_t k=0; k<outputs.count; ++k)
         {
-            if (fPlugin.isParameterOutput(i))
-            {
-                // NOTE: no output parameter support in VST3, simulate it here
-                curValue = fPlugin.getParameterValue(i);
+            const uint32_t i = outputs.indices[k];
+            curValue = fPlugin.getParameterValue(i);
 
-                if (d_isEqual(curValue, fCachedParameterValues[kVst3InternalParameterBaseCount + i]))
-                    continue;
-            }
-            else if (fPlugin.isParameterTrigger(i))
-            {
-                // NOTE: no trigger parameter support in VST3, simulate it here
-                defValue = fPlugin.getParameterDefault(i);
-                curValue = fPlugin.getParameterValue(i);
+            if (! fParameterStore.updateValue(i, curValue, true))
+                continue;
 
-                if (d_isEqual(curValue, defValue))
-                    continue;
+            normalized = _getNormalizedParameterValue(i, curValue);
 
-                curValue = defValue;
-                fPlugin.setParameterValue(i, curValue);
-            }
-            else if (fParameterValuesChangedDuringProcessing[kVst3InternalParameterBaseCount + i])
-            {
-                fParameterValuesChangedDuringProcessing[kVst3InternalParameterBaseCount + i] = false;
-                curValue = fPlugin.getParameterValue(i);
-            }
-            else
-            {
+            if (! addParameterDataToHostOutputEvents(outparamsptr, kVst3InternalParameterCount + i, normalized, offset))
+                return;
+        }
+
+        // NOTE: no trigger parameter support in VST3, simulate it here
+        const ParameterIndexList& triggers(fPlugin.getTriggerParameterIndexList());
+
+        for (uint32_t k=0; k<triggers.count; ++k)
+        {
+            const uint32_t i = triggers.indices[k];
+            defValue = fPlugin.getParameterDefault(i);
+            curValue = fPlugin.getParameterValue(i);
+
+            if (d_isEqual(curValue, defValue))
                 continue;
-            }
 
-            fCachedParameterValues[kVst3InternalParameterBaseCount + i] = curValue;
-           #if DISTRHO_PLUGIN_HAS_UI
-            fParameterValueChangesForUI[kVst3InternalParameterBaseCount + i] = true;
-           #endif
+            fPlugin.setParameterValue(i, defValue, true);
 
-            normalized = _getNormalizedParameterValue(i, curValue);
+            normalized = _getNormalizedParameterValue(i, defValue);
 
             if (! addParameterDataToHostOutputEvents(outparamsptr, kVst3InternalParameterCount + i, normalized, offset))
-                break;
+                return;
         }
 
-       #if DISTRHO_PLUGIN_WANT_LATENCY
-        const uint32_t latency = fPlugin.getLatency();
-
-        if (fLastKnownLatency != latency)
+        // parameters flagged from state changes or plugin requests, only visits the ones that are set
+        for (uint32_t w=0, count=fParameterValuesChangedDuringProcessing.getWordCount(); w<count; ++w)
         {
-            fLastKnownLatency = latency;
+            for (uint32_t bits = fParameterValuesChangedDuringProcessing.takeWord(w); bits != 0;)
+            {
+                const uint32_t bit = ParameterBitset::popLowestBit(bits);
+                const uint32_t rindex = w * ParameterBitset::kBitsPerWord + bit;
 
-            normalized = plainParameterToNormalized(kVst3InternalParameterLatency,
-                                                    fCachedParameterValues[kVst3InternalParameterLatency]);
-            addParameterDataToHostOutputEvents(outparamsptr, kVst3InternalParameterLatency, normalized);
+               #if DPF_VST3_USES_SEPARATE_CONTROLLER || DISTRHO_PLUGIN_WANT_LATENCY || DISTRHO_PLUGIN_WANT_PROGRAMS
+                if (rindex < kVst3InternalParameterBaseCount)
+                {
+                    normalized = plainParameterToNormalized(rindex, fCachedParameterValues[rindex]);
+                    addParameterDataToHostOutputEvents(outparamsptr, rindex, normalized);
+                    continue;
+                }
+               #endif
+
+                const uint32_t i = rindex - kVst3InternalParameterBaseCount;
+                curValue = fPlugin.getParameterValue(i);
+                fParameterStore.setValue(i, curValue, true);
+
+                normalized = _getNormalizedParameterValue(i, curValue);
+
+                if (! addParameterDataToHostOutputEvents(outparamsptr, kVst3InternalParameterCount + i, normalized, offset))
+                {
+                    // host queue is full, try the remaining ones again on the next cycle
+                    fParameterValuesChangedDuringProcessing.restoreWord(w, bits | (1U << bit));
+                    return;
+                }
+            }
         }
-       #endif
     }
 
     bool addParameterDataToHostOutputEvents(v3_param_changes** const outparamsptr,
@@ -3044,7 +2811,7 @@ private:
    #if DISTRHO_PLUGIN_WANT_PARAMETER_VALUE_CHANGE_REQUEST
     bool requestParameterValueChange(const uint32_t index, float)
     {
-        fParameterValuesChangedDuringProcessing[kVst3InternalParameterBaseCount + index] = true;
+        fParameterValuesChangedDuringProcessing.set(kVst3InternalParameterBaseCount + index);
         return true;
     }
 
@@ -4079,7 +3846,11 @@ struct dpf_audio_processor : v3_audio_processor_cpp {
     {
         // NOTE runs during RT
         // d_debug("dpf_audio_processor::can_process_sample_size => %i", symbolic_sample_size);
+       #if DISTRHO_PLUGIN_WANT_DOUBLE_PRECISION
+        return symbolic_sample_size == V3_SAMPLE_32 || symbolic_sample_size == V3_SAMPLE_64 ? V3_OK : V3_NOT_IMPLEMENTED;
+       #else
         return symbolic_sample_size == V3_SAMPLE_32 ? V3_OK : V3_NOT_IMPLEMENTED;
+       #endif
     }
 
     static uint32_t V3_API get_latency_samples(void* const self)
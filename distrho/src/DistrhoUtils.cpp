@@ -79,6 +79,8 @@ const char* getPluginFormatName() noexcept
 {
 #if defined(DISTRHO_PLUGIN_TARGET_AU)
     return "AudioUnit";
+#elif defined(DISTRHO_PLUGIN_TARGET_BENCH)
+    return "Benchmark";
 #elif defined(DISTRHO_PLUGIN_TARGET_CARLA)
     return "Carla";
 #elif defined(DISTRHO_PLUGIN_TARGET_JACK)
@@ -19,6 +19,7 @@
 
 #include "JackBridge.hpp"
 
+#include "../../extra/BufferOps.hpp"
 #include "../../extra/RingBuffer.hpp"
 
 #if DISTRHO_PLUGIN_NUM_INPUTS > 2
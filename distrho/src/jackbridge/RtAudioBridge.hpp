@@ -369,7 +369,7 @@ struct RtAudioBridge : NativeBridge {
         if (self->jackProcessCallback == nullptr)
         {
             if (outputBuffer != nullptr)
-                std::memset((float*)outputBuffer, 0, sizeof(float)*numFrames*DISTRHO_PLUGIN_NUM_OUTPUTS_2);
+                BufferOps::clear((float*)outputBuffer, numFrames*DISTRHO_PLUGIN_NUM_OUTPUTS_2);
             return 0;
         }
 
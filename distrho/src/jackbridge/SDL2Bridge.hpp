@@ -216,11 +216,7 @@ struct SDL2Bridge : NativeBridge {
 
         const float* const fstream = (const float*)stream;
 
-        for (uint i=0; i<DISTRHO_PLUGIN_NUM_INPUTS_2; ++i)
-        {
-            for (uint j=0; j<numFrames; ++j)
-                self->audioBuffers[i][j] = fstream[j * DISTRHO_PLUGIN_NUM_INPUTS_2 + i];
-        }
+        BufferOps::deinterleave(self->audioBuffers, fstream, DISTRHO_PLUGIN_NUM_INPUTS_2, numFrames);
 
        #if DISTRHO_PLUGIN_NUM_OUTPUTS == 0
         // if there are no outputs, run process callback now
@@ -241,7 +237,7 @@ struct SDL2Bridge : NativeBridge {
 
         if (self->jackProcessCallback == nullptr)
         {
-            std::memset(stream, 0, len);
+            BufferOps::clear((float*)stream, static_cast<uint>(len / sizeof(float)));
             return;
         }
 
@@ -253,11 +249,7 @@ struct SDL2Bridge : NativeBridge {
 
         float* const fstream = (float*)stream;
 
-        for (uint i=0; i < DISTRHO_PLUGIN_NUM_OUTPUTS_2; ++i)
-        {
-            for (uint j=0; j < numFrames; ++j)
-                fstream[j * DISTRHO_PLUGIN_NUM_OUTPUTS_2 + i] = self->audioBuffers[DISTRHO_PLUGIN_NUM_INPUTS + i][j];
-        }
+        BufferOps::interleave(fstream, self->audioBuffers + DISTRHO_PLUGIN_NUM_INPUTS, DISTRHO_PLUGIN_NUM_OUTPUTS_2, numFrames);
     }
    #endif
 };
@@ -501,7 +501,7 @@ struct WebBridge : NativeBridge {
         else
         {
             for (uint i=0; i<DISTRHO_PLUGIN_NUM_OUTPUTS_2; ++i)
-                std::memset(self->audioBuffers[DISTRHO_PLUGIN_NUM_INPUTS + i], 0, sizeof(float)*numFrames);
+                BufferOps::clear(self->audioBuffers[DISTRHO_PLUGIN_NUM_INPUTS + i], numFrames);
         }
     }
 
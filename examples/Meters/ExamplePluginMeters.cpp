@@ -15,6 +15,7 @@
  */
 
 #include "DistrhoPlugin.hpp"
+#include "extra/BufferOps.hpp"
 
 START_NAMESPACE_DISTRHO
 
@@ -209,24 +210,8 @@ protected:
     */
     void run(const float** inputs, float** outputs, uint32_t frames) override
     {
-        float tmp;
-        float tmpLeft  = 0.0f;
-        float tmpRight = 0.0f;
-
-        for (uint32_t i=0; i<frames; ++i)
-        {
-            // left
-            tmp = std::abs(inputs[0][i]);
-
-            if (tmp > tmpLeft)
-                tmpLeft = tmp;
-
-            // right
-            tmp = std::abs(inputs[1][i]);
-
-            if (tmp > tmpRight)
-                tmpRight = tmp;
-        }
+        float tmpLeft  = BufferOps::peak(inputs[0], frames);
+        float tmpRight = BufferOps::peak(inputs[1], frames);
 
         if (tmpLeft > 1.0f)
             tmpLeft = 1.0f;
@@ -32,6 +32,8 @@
 // Define parameters
 enum ParameterIndices {
     paramCaptureLoop,
+    paramMarkovOrder,
+    paramVoices,
     // paramClearLoop, // Future: A button to clear
     // ... other parameters later
     paramCount
@@ -1,7 +1,8 @@
 // LoopareliusPlugin.cpp
 #include "LoopareliusPlugin.hpp"
 #include <iostream> 
-#include <cstring> // For memcpy
+#include <algorithm>
+#include <cstring> // For memset, memmove
 
 // For DPF's MIDI event type and parameter hint constants
 #include "DistrhoDetails.hpp" 
@@ -9,20 +10,35 @@
 
 START_NAMESPACE_DISTRHO
 
+namespace {
+    // Note-offs go first on the same frame, so that ending a note never cuts a new one on the same key.
+    bool isOutputEventBefore(const MidiEvent& a, const MidiEvent& b) {
+        if (a.frame != b.frame) {
+            return a.frame < b.frame;
+        }
+        return (a.data[0] & 0xF0) == 0x80 && (b.data[0] & 0xF0) != 0x80;
+    }
+}
+
 LoopareliusPlugin::LoopareliusPlugin()
     : Plugin(paramCount, 0, 0), // Parameters from DistrhoPluginInfo.h
       retrospectiveBuffer(10.0), 
-      playbackActive(false),
-      variationPlayheadAbsoluteFrames(0),
-      currentVariationStartAbsoluteFrame(0),
-      currentVariationTotalFrames(0),
+      variationWorker(retrospectiveBuffer),
+      numActiveVoices(1),
+      numPendingNoteOffs(0),
+      numOutputEvents(0),
       currentAbsoluteFrameCounter(0),
-      fCaptureLoopButtonState(0.0f)
+      fCaptureLoopButtonState(0.0f),
+      fMarkovOrder(1.0f),
+      fVoices(1.0f)
 {
+    std::memset(voices, 0, sizeof(voices));
+    std::memset(outputKeyCounts, 0, sizeof(outputKeyCounts));
     std::cout << "[LoopareliusCpp] Plugin Constructed. Sample Rate: " << getSampleRate() << std::endl;
 }
 
 LoopareliusPlugin::~LoopareliusPlugin() {
+    variationWorker.stop();
     std::cout << "[LoopareliusCpp] Plugin Destroyed." << std::endl;
 }
 
@@ -65,6 +81,24 @@ void LoopareliusPlugin::initParameter(uint32_t index, Parameter& parameter) {
             parameter.ranges.max = 1.0f;
             std::cout << "[LoopareliusCpp] Initialized parameter 'Capture' (Index " << index << ") with hints: " << parameter.hints << std::endl;
             break;
+        case paramMarkovOrder:
+            // Number of previous notes each generated note depends on, applied on the next capture
+            parameter.name = "Markov Order";
+            parameter.symbol = "markov_order";
+            parameter.hints = kParameterIsInteger | kParameterIsAutomatable;
+            parameter.ranges.def = 1.0f;
+            parameter.ranges.min = 1.0f;
+            parameter.ranges.max = static_cast<float>(MarkovChain::kMaxOrder);
+            break;
+        case paramVoices:
+            // Number of variations playing at the same time, each voice plays its own sequence of variations
+            parameter.name = "Voices";
+            parameter.symbol = "voices";
+            parameter.hints = kParameterIsInteger | kParameterIsAutomatable;
+            parameter.ranges.def = 1.0f;
+            parameter.ranges.min = 1.0f;
+            parameter.ranges.max = static_cast<float>(kMaxVoices);
+            break;
         default:
             std::cout << "[LoopareliusCpp] initParameter: Unhandled index " << index << std::endl;
             break;
@@ -75,30 +109,39 @@ float LoopareliusPlugin::getParameterValue(uint32_t index) const {
     switch (index) {
         case paramCaptureLoop:
             return fCaptureLoopButtonState;
+        case paramMarkovOrder:
+            return fMarkovOrder;
+        case paramVoices:
+            return fVoices;
     }
     return 0.0f;
 }
 
 void LoopareliusPlugin::setParameterValue(uint32_t index, float value) {
-    std::cout << "[LoopareliusCpp] setParameterValue called. Index: " << index << ", Value: " << value << std::endl; // ALWAYS PRINT THIS
-
+    // Hosts may call this from the audio thread, so nothing here may block or allocate, including logging.
     switch (index) {
         case paramCaptureLoop:
-            fCaptureLoopButtonState = value; // Store the value regardless for now
-            std::cout << "[LoopareliusCpp] paramCaptureLoop (Index 0) received value: " << value << std::endl;
-            
-            // For now, trigger on any non-zero value to test if it's called
-            if (value > 0.0f) { // Or even just `if (value != 0.0f)` or simply remove this if for testing
-                std::cout << "[LoopareliusCpp] Capture condition met (value > 0.0f). Calling handleCaptureAction()." << std::endl;
-                handleCaptureAction(); 
+            fCaptureLoopButtonState = value;
+
+            // Trigger on any non-zero value, the actual work happens in the variation worker.
+            if (value > 0.0f) {
+                d_debug("[LoopareliusCpp] Requesting capture.");
+                variationWorker.requestCapture();
+            }
+            break;
+        case paramMarkovOrder:
+            fMarkovOrder = value;
+            variationWorker.setMarkovOrder(static_cast<int>(value + 0.5f));
+            break;
+        case paramVoices:
+            fVoices = value;
+            numActiveVoices = value < 1.0f ? 1u : static_cast<uint32_t>(value + 0.5f);
+            if (numActiveVoices > kMaxVoices) {
+                numActiveVoices = kMaxVoices;
             }
-            // else {
-            //     std::cout << "[LoopareliusCpp] Capture condition NOT met (value <= 0.0f)." << std::endl;
-            // }
+            variationWorker.setNumVoices(static_cast<int>(numActiveVoices));
             break;
-        // Add other cases if you have more parameters
         default:
-            std::cout << "[LoopareliusCpp] setParameterValue called for unhandled index: " << index << std::endl;
             break;
     }
 }
@@ -107,74 +150,271 @@ void LoopareliusPlugin::setParameterValue(uint32_t index, float value) {
 void LoopareliusPlugin::activate() {
     currentAbsoluteFrameCounter = 0; 
     retrospectiveBuffer.clear();
-    capturedLoop.clear();
-    currentVariation.clear();
-    markovModels.clearModels();
-    playbackActive = false;
-    pendingHostNoteOns.clear();
+    variationWorker.stop();
+    variationWorker.reset(getSampleRate());
+    variationWorker.start();
+    std::memset(voices, 0, sizeof(voices));
+    numPendingNoteOffs = 0;
+    numOutputEvents = 0;
+    std::memset(outputKeyCounts, 0, sizeof(outputKeyCounts));
+    std::memset(activeKeys, 0, sizeof(activeKeys));
+    std::memset(sustainPedalDown, 0, sizeof(sustainPedalDown));
     fCaptureLoopButtonState = 0.0f;
     std::cout << "[LoopareliusCpp] Plugin Activated. Sample Rate: " << getSampleRate() << std::endl;
 }
 
 void LoopareliusPlugin::deactivate() {
+    variationWorker.stop();
     std::cout << "[LoopareliusCpp] Plugin Deactivated." << std::endl;
 }
 
-// --- Core Logic Triggers ---
-void LoopareliusPlugin::handleCaptureAction() {
-    std::cout << "[LoopareliusCpp] Handling capture action..." << std::endl;
-    capturedLoop = retrospectiveBuffer.getNormalizedBufferedEvents(); 
-    
-    if (capturedLoop.empty()) {
-        std::cout << "[LoopareliusCpp] Captured loop is empty." << std::endl;
-        playbackActive = false;
+// --- Host Notes Capture ---
+void LoopareliusPlugin::hostNoteOn(uint8_t channel, uint8_t note, uint8_t velocity, uint64_t absoluteFrame) {
+    ActiveKey& key = activeKeys[channel][note];
+
+    // Striking a sustained key again ends its previous notes
+    captureHostNotes(channel, note, key.numSustained, absoluteFrame);
+
+    // Too many stacked notes, end the oldest one
+    if (key.numHeld == kMaxStackedNotes) {
+        captureHostNotes(channel, note, 1, absoluteFrame);
+    }
+
+    HeldNote& held = key.notes[key.numHeld++];
+    held.absoluteFrame = absoluteFrame;
+    held.velocity = velocity;
+}
+
+// Stacked notes on the same key are released oldest first.
+void LoopareliusPlugin::hostNoteOff(uint8_t channel, uint8_t note, uint64_t absoluteFrame) {
+    ActiveKey& key = activeKeys[channel][note];
+
+    if (key.numHeld == 0) {
+        return;
+    }
+
+    if (sustainPedalDown[channel]) {
+        ++key.numSustained;
+        --key.numHeld;
+    } else {
+        captureHostNotes(channel, note, 1, absoluteFrame);
+    }
+}
+
+void LoopareliusPlugin::hostSustainPedal(uint8_t channel, bool down, uint64_t absoluteFrame) {
+    sustainPedalDown[channel] = down;
+
+    if (down) {
+        return;
+    }
+
+    // Notes released under the pedal end now
+    for (uint8_t note = 0; note < 128; ++note) {
+        captureHostNotes(channel, note, activeKeys[channel][note].numSustained, absoluteFrame);
+    }
+}
+
+// Captures the count oldest notes of a key, ending them at releaseAbsoluteFrame.
+void LoopareliusPlugin::captureHostNotes(uint8_t channel, uint8_t note, uint32_t count, uint64_t releaseAbsoluteFrame) {
+    if (count == 0) {
+        return;
+    }
+
+    const double sampleRate = getSampleRate();
+    ActiveKey& key = activeKeys[channel][note];
+    const uint32_t numNotes = key.numSustained + key.numHeld;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const HeldNote& held = key.notes[i];
+        double durationSeconds = static_cast<double>(releaseAbsoluteFrame - held.absoluteFrame) / sampleRate;
+
+        if (durationSeconds < 0.001) durationSeconds = 0.001;
+
+        retrospectiveBuffer.addEvent(
+            CustomMidiEvent(static_cast<double>(held.absoluteFrame) / sampleRate,
+                           note, held.velocity, durationSeconds, channel)
+        );
+    }
+
+    std::memmove(key.notes, key.notes + count, (numNotes - count) * sizeof(HeldNote));
+
+    const uint32_t numSustainedEnded = std::min<uint32_t>(count, key.numSustained);
+    key.numSustained = static_cast<uint8_t>(key.numSustained - numSustainedEnded);
+    key.numHeld = static_cast<uint8_t>(key.numHeld - (count - numSustainedEnded));
+}
+
+// --- Variation Playback ---
+// Stops the current variation of a voice at startAbsoluteFrame and plays the given one (or the same one again) from there.
+void LoopareliusPlugin::switchVariation(VariationVoice& voice, const Variation* variation, uint64_t startAbsoluteFrame) {
+    if (voice.variation != nullptr) {
+        carryNoteOffs(voice, startAbsoluteFrame);
+        if (voice.variation != variation) {
+            variationWorker.releaseVariation(voice.variation);
+        }
+    }
+
+    voice.variation = variation;
+    voice.totalFrames = variation->totalFrames;
+    voice.startAbsoluteFrame = startAbsoluteFrame;
+    voice.cursor = 0;
+    voice.playbackActive = !variation->schedule.empty();
+}
+
+// Ends a voice that was turned off, its variation goes back to the worker.
+void LoopareliusPlugin::stopVoice(VariationVoice& voice, uint64_t stopAbsoluteFrame) {
+    if (voice.variation == nullptr) {
         return;
     }
-    std::cout << "[LoopareliusCpp] Captured " << capturedLoop.size() << " events for model." << std::endl;
 
-    markovModels.buildModels(capturedLoop);
-    generateNewVariationAndPreparePlayback();
+    carryNoteOffs(voice, stopAbsoluteFrame);
+    variationWorker.releaseVariation(voice.variation);
+    voice.variation = nullptr;
+    voice.playbackActive = false;
 }
 
-void LoopareliusPlugin::generateNewVariationAndPreparePlayback() {
-    if (capturedLoop.empty()) {
-        std::cout << "[LoopareliusCpp] No captured loop to generate variation from." << std::endl;
-        playbackActive = false;
-        currentVariation.clear();
+// Keeps the note-offs of every note the voice already started, so none of them hangs after a switch.
+void LoopareliusPlugin::carryNoteOffs(const VariationVoice& voice, uint64_t stopAbsoluteFrame) {
+    if (!voice.playbackActive) {
         return;
     }
 
-    currentVariation = markovModels.generateVariation(capturedLoop, capturedLoop.size());
-    
-    if (currentVariation.empty()) {
-        std::cout << "[LoopareliusCpp] Generated variation is empty." << std::endl;
-        playbackActive = false;
+    const std::vector<ScheduledEvent>& schedule = voice.variation->schedule;
+    const uint64_t stopFrame = stopAbsoluteFrame - voice.startAbsoluteFrame;
+
+    for (size_t i = voice.cursor; i < schedule.size(); ++i) {
+        const ScheduledEvent& event = schedule[i];
+        if ((event.status & 0xF0) != 0x80 || event.noteOnFrame >= stopFrame) {
+            continue;
+        }
+
+        const uint64_t absoluteFrame = voice.startAbsoluteFrame + event.frame;
+        if (numPendingNoteOffs < kMaxPendingNoteOffs) {
+            PendingNoteOff& noteOff = pendingNoteOffs[numPendingNoteOffs++];
+            noteOff.absoluteFrame = absoluteFrame;
+            noteOff.status = event.status;
+            noteOff.note = event.note;
+        } else {
+            // Out of room, end the note right away rather than leaving it hanging
+            queueOutputEvent(stopAbsoluteFrame, event.status, event.note, 0);
+        }
+    }
+}
+
+// The schedule is sorted, so only the entries from the cursor up to the end of this block are visited.
+void LoopareliusPlugin::playVoice(uint32_t index, uint64_t blockEndAbsoluteFrame) {
+    VariationVoice& voice = voices[index];
+
+    // A voice turned off while playing an empty variation has nothing left to finish
+    if (!voice.playbackActive && index >= numActiveVoices) {
+        stopVoice(voice, currentAbsoluteFrameCounter);
         return;
     }
 
-    std::cout << "[LoopareliusCpp] Generated new variation with " << currentVariation.size() << " events." << std::endl;
+    while (voice.playbackActive) {
+        const std::vector<ScheduledEvent>& schedule = voice.variation->schedule;
+        const uint64_t variationEndAbsoluteFrame = voice.startAbsoluteFrame + voice.totalFrames;
+        const uint64_t playUntilAbsoluteFrame = std::min(blockEndAbsoluteFrame, variationEndAbsoluteFrame);
+
+        while (voice.cursor < schedule.size()) {
+            const ScheduledEvent& event = schedule[voice.cursor];
+            const uint64_t eventAbsoluteFrame = voice.startAbsoluteFrame + event.frame;
+            if (eventAbsoluteFrame >= playUntilAbsoluteFrame) {
+                break;
+            }
+            queueOutputEvent(eventAbsoluteFrame, event.status, event.note, event.velocity);
+            ++voice.cursor;
+        }
+
+        if (variationEndAbsoluteFrame >= blockEndAbsoluteFrame) {
+            break;
+        }
+
+        // Voices turned off finish their current variation and stop there
+        if (index >= numActiveVoices) {
+            stopVoice(voice, variationEndAbsoluteFrame);
+            break;
+        }
+
+        // The variation ends within this block, the next one starts right at its end.
+        // The worker keeps the next variation ready, replay the current one in the rare case it is late.
+        const Variation* variation = variationWorker.takeNextVariation(static_cast<int>(index), true);
+        switchVariation(voice, variation != nullptr ? variation : voice.variation, variationEndAbsoluteFrame);
+    }
+}
+
+void LoopareliusPlugin::sendPendingNoteOffs(uint64_t blockEndAbsoluteFrame) {
+    for (uint32_t i = 0; i < numPendingNoteOffs;) {
+        const PendingNoteOff& noteOff = pendingNoteOffs[i];
+        if (noteOff.absoluteFrame < blockEndAbsoluteFrame) {
+            queueOutputEvent(noteOff.absoluteFrame, noteOff.status, noteOff.note, 0);
+            pendingNoteOffs[i] = pendingNoteOffs[--numPendingNoteOffs];
+        } else {
+            ++i;
+        }
+    }
+}
 
-    currentVariationTotalFrames = 0;
-    if (!currentVariation.empty()) {
-        const CustomMidiEvent& lastEvent = currentVariation.back(); 
-        currentVariationTotalFrames = static_cast<uint32_t>((lastEvent.timestamp + lastEvent.duration) * getSampleRate());
+void LoopareliusPlugin::queueOutputEvent(uint64_t absoluteFrame, uint8_t status, uint8_t note, uint8_t velocity) {
+    if (numOutputEvents == kMaxOutputEvents) {
+        flushOutputEvents();
     }
-     if(currentVariationTotalFrames == 0 && !currentVariation.empty()) { 
-        currentVariationTotalFrames = static_cast<uint32_t>(currentVariation.front().duration * getSampleRate());
+
+    MidiEvent& event = outputEvents[numOutputEvents++];
+    event.frame = absoluteFrame > currentAbsoluteFrameCounter
+                ? static_cast<uint32_t>(absoluteFrame - currentAbsoluteFrameCounter)
+                : 0;
+    event.size = 3;
+    event.data[0] = status;
+    event.data[1] = note;
+    event.data[2] = velocity;
+    event.data[3] = 0;
+    event.dataExt = nullptr;
+}
+
+void LoopareliusPlugin::flushOutputEvents() {
+    // Stable insertion sort, the queue is mostly in order already
+    for (uint32_t i = 1; i < numOutputEvents; ++i) {
+        const MidiEvent event = outputEvents[i];
+        uint32_t j = i;
+        while (j > 0 && isOutputEventBefore(event, outputEvents[j - 1])) {
+            outputEvents[j] = outputEvents[j - 1];
+            --j;
+        }
+        outputEvents[j] = event;
     }
 
-    currentVariationStartAbsoluteFrame = currentAbsoluteFrameCounter; 
-    // variationPlayheadAbsoluteFrames = currentVariationStartAbsoluteFrame; // This line was redundant here
-    playbackActive = true;
-    std::cout << "[LoopareliusCpp] Playback prepared. Total var frames: " << currentVariationTotalFrames 
-              << ". Starting at host frame: " << currentVariationStartAbsoluteFrame << std::endl;
+    for (uint32_t i = 0; i < numOutputEvents; ++i) {
+        const MidiEvent& event = outputEvents[i];
+        uint8_t& keyCount = outputKeyCounts[event.data[0] & 0x0F][event.data[1] & 0x7F];
+
+        if ((event.data[0] & 0xF0) == 0x90) {
+            if (keyCount < 0xFF) {
+                ++keyCount;
+            }
+        } else if (keyCount == 0 || --keyCount != 0) {
+            // Not sounding, or another voice still holds the key
+            continue;
+        }
+
+        writeMidiEvent(event);
+    }
+    numOutputEvents = 0;
 }
 
 // --- Real-time Audio/MIDI Processing ---
 void LoopareliusPlugin::run(const float** /*inputs*/, float** /*outputs*/, uint32_t nframes,
                              const DISTRHO::MidiEvent* hostMidiEvents, uint32_t hostMidiEventCount)
 {
-    const double sampleRate = getSampleRate();
+    const uint64_t currentBlockEndAbsoluteFrame = currentAbsoluteFrameCounter + nframes;
+
+    // 0. Switch to the first variations of a new capture as soon as they are ready
+    // Idle voices, like ones just turned on, start with any variation
+    for (uint32_t v = 0; v < numActiveVoices; ++v) {
+        VariationVoice& voice = voices[v];
+        if (const Variation* variation = variationWorker.takeNextVariation(static_cast<int>(v), voice.variation == nullptr)) {
+            switchVariation(voice, variation, currentAbsoluteFrameCounter);
+        }
+    }
 
     // 1. Process Incoming MIDI
     for (uint32_t i = 0; i < hostMidiEventCount; ++i) {
@@ -184,73 +424,30 @@ void LoopareliusPlugin::run(const float** /*inputs*/, float** /*outputs*/, uint3
         const uint8_t statusByte = hostEvent.data[0];
         const uint8_t statusNoChannel = statusByte & 0xF0;
         const uint8_t channel = statusByte & 0x0F;
-        const uint8_t note = hostEvent.data[1];
+        const uint8_t note = hostEvent.data[1] & 0x7F;
         const uint8_t velocityByte = hostEvent.data[2];
 
-        auto key = std::make_pair(static_cast<int>(note), static_cast<int>(channel));
-
         if (statusNoChannel == 0x90 && velocityByte > 0) { 
-            pendingHostNoteOns[key] = std::make_pair(eventIncomingAbsoluteFrame, static_cast<int>(velocityByte));
+            hostNoteOn(channel, note, velocityByte, eventIncomingAbsoluteFrame);
         } else if (statusNoChannel == 0x80 || (statusNoChannel == 0x90 && velocityByte == 0)) { 
-            auto it = pendingHostNoteOns.find(key);
-            if (it != pendingHostNoteOns.end()) {
-                uint64_t noteOnFrame = it->second.first;
-                int actualVelocity = it->second.second;
-                double durationSeconds = static_cast<double>(eventIncomingAbsoluteFrame - noteOnFrame) / sampleRate;
-                
-                if (durationSeconds < 0.001) durationSeconds = 0.001;
-
-                retrospectiveBuffer.addEvent(
-                    CustomMidiEvent(static_cast<double>(noteOnFrame) / sampleRate, 
-                                   key.first, actualVelocity, durationSeconds, key.second)
-                );
-                pendingHostNoteOns.erase(it);
-            }
+            hostNoteOff(channel, note, eventIncomingAbsoluteFrame);
+        } else if (statusNoChannel == 0xB0 && hostEvent.data[1] == 64) {
+            hostSustainPedal(channel, velocityByte >= 64, eventIncomingAbsoluteFrame);
         }
     }
 
-    // 2. Handle Playback of Current Variation
-    if (playbackActive && !currentVariation.empty()) {
-        uint64_t currentBlockEndAbsoluteFrame = currentAbsoluteFrameCounter + nframes;
-
-        for (const CustomMidiEvent& eventToPlay : currentVariation) { 
-            uint64_t noteOnAbsoluteFrameForVariation = currentVariationStartAbsoluteFrame + 
-                                                       static_cast<uint64_t>(eventToPlay.timestamp * sampleRate);
-            uint64_t noteOffAbsoluteFrameForVariation = noteOnAbsoluteFrameForVariation + 
-                                                        static_cast<uint64_t>(eventToPlay.duration * sampleRate);
-            
-            DISTRHO::MidiEvent dpfEventToSend; 
-            dpfEventToSend.size = 3; 
-            if (dpfEventToSend.size < 4) dpfEventToSend.data[3] = 0;
-
-            if (noteOnAbsoluteFrameForVariation >= currentAbsoluteFrameCounter && 
-                noteOnAbsoluteFrameForVariation < currentBlockEndAbsoluteFrame) 
-            {
-                dpfEventToSend.frame = static_cast<uint32_t>(noteOnAbsoluteFrameForVariation - currentAbsoluteFrameCounter);
-                dpfEventToSend.data[0] = static_cast<uint8_t>(0x90 | eventToPlay.channel);
-                dpfEventToSend.data[1] = static_cast<uint8_t>(eventToPlay.noteNumber);
-                dpfEventToSend.data[2] = static_cast<uint8_t>(eventToPlay.velocity);
-                writeMidiEvent(dpfEventToSend); 
-            }
+    // Note-offs carried over from previous blocks
+    sendPendingNoteOffs(currentBlockEndAbsoluteFrame);
 
-            if (noteOffAbsoluteFrameForVariation >= currentAbsoluteFrameCounter && 
-                noteOffAbsoluteFrameForVariation < currentBlockEndAbsoluteFrame)
-            {
-                dpfEventToSend.frame = static_cast<uint32_t>(noteOffAbsoluteFrameForVariation - currentAbsoluteFrameCounter);
-                dpfEventToSend.data[0] = static_cast<uint8_t>(0x80 | eventToPlay.channel);
-                dpfEventToSend.data[1] = static_cast<uint8_t>(eventToPlay.noteNumber);
-                dpfEventToSend.data[2] = static_cast<uint8_t>(0); 
-                writeMidiEvent(dpfEventToSend);
-            }
-        }
-        
-        if ( (currentAbsoluteFrameCounter + nframes) >= (currentVariationStartAbsoluteFrame + currentVariationTotalFrames) &&
-             currentVariationTotalFrames > 0 ) 
-        {
-             std::cout << "[LoopareliusCpp] Variation ended. Generating new one." << std::endl;
-             generateNewVariationAndPreparePlayback(); 
-        }
+    // 2. Handle Playback of the Variations, each voice independently
+    for (uint32_t v = 0; v < kMaxVoices; ++v) {
+        playVoice(v, currentBlockEndAbsoluteFrame);
     }
+
+    // 3. Note-offs carried over by variations ending within this block
+    sendPendingNoteOffs(currentBlockEndAbsoluteFrame);
+    flushOutputEvents();
+
     currentAbsoluteFrameCounter += nframes;
 }
 
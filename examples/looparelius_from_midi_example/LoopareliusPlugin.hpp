@@ -4,10 +4,9 @@
 #include "DistrhoPlugin.hpp"        
 #include "CustomMidiEvent.h"        
 #include "RetrospectiveMidiBuffer.h"
-#include "MarkovModels.h"           
+#include "VariationWorker.h"
 
 #include <vector>
-#include <map> 
 
 using LoopareliusUtils::CustomMidiEvent; // Use our namespaced struct
 
@@ -35,24 +34,80 @@ protected:
              const MidiEvent* midiEvents, uint32_t midiEventCount) override; 
 
 private:
+    // Note-off of a previous variation, still to be sent after switching to the next one.
+    struct PendingNoteOff {
+        uint64_t absoluteFrame;
+        uint8_t status;
+        uint8_t note;
+    };
+
+    static constexpr uint32_t kMaxStackedNotes = 4;
+
+    // Host note-on waiting for its note-off, to be captured with its duration.
+    struct HeldNote {
+        uint64_t absoluteFrame;
+        uint8_t velocity;
+    };
+
+    // Notes of one channel and key, oldest first.
+    // The first numSustained ones were released while the sustain pedal was down, the following numHeld are still held.
+    struct ActiveKey {
+        HeldNote notes[kMaxStackedNotes];
+        uint8_t numSustained;
+        uint8_t numHeld;
+    };
+
+    // One playback lane, playing its variations one after the other.
+    struct VariationVoice {
+        const Variation* variation;
+        bool playbackActive;
+        size_t cursor; // next entry of variation->schedule to play
+        uint64_t startAbsoluteFrame;
+        uint32_t totalFrames;
+    };
+
+    static constexpr uint32_t kMaxVoices = VariationWorker::kMaxVoices;
+    static constexpr uint32_t kMaxPendingNoteOffs = 256;
+    static constexpr uint32_t kMaxOutputEvents = 512;
+
     RetrospectiveMidiBuffer retrospectiveBuffer;
-    MarkovModels markovModels;
-    std::vector<CustomMidiEvent> capturedLoop;     
-    std::vector<CustomMidiEvent> currentVariation; 
-    
-    bool playbackActive;
-    uint64_t variationPlayheadAbsoluteFrames; 
-    uint64_t currentVariationStartAbsoluteFrame; 
-    uint32_t currentVariationTotalFrames;     
+    VariationWorker variationWorker;
+
+    VariationVoice voices[kMaxVoices];
+    uint32_t numActiveVoices;
+
+    PendingNoteOff pendingNoteOffs[kMaxPendingNoteOffs];
+    uint32_t numPendingNoteOffs;
+
+    // Output of the current block, sorted by frame before being sent to the host.
+    MidiEvent outputEvents[kMaxOutputEvents];
+    uint32_t numOutputEvents;
+
+    // Number of voices sounding each output key, a key is only released once all of them end their note.
+    uint8_t outputKeyCounts[16][128];
 
     uint64_t currentAbsoluteFrameCounter; 
     
-    std::map<std::pair<int, int>, std::pair<uint64_t, int>> pendingHostNoteOns;
+    // Host notes being played, indexed by channel and note number.
+    ActiveKey activeKeys[16][128];
+    bool sustainPedalDown[16];
 
     float fCaptureLoopButtonState;
+    float fMarkovOrder;
+    float fVoices;
+
+    void hostNoteOn(uint8_t channel, uint8_t note, uint8_t velocity, uint64_t absoluteFrame);
+    void hostNoteOff(uint8_t channel, uint8_t note, uint64_t absoluteFrame);
+    void hostSustainPedal(uint8_t channel, bool down, uint64_t absoluteFrame);
+    void captureHostNotes(uint8_t channel, uint8_t note, uint32_t count, uint64_t releaseAbsoluteFrame);
 
-    void handleCaptureAction();
-    void generateNewVariationAndPreparePlayback();
+    void switchVariation(VariationVoice& voice, const Variation* variation, uint64_t startAbsoluteFrame);
+    void stopVoice(VariationVoice& voice, uint64_t stopAbsoluteFrame);
+    void carryNoteOffs(const VariationVoice& voice, uint64_t stopAbsoluteFrame);
+    void playVoice(uint32_t index, uint64_t blockEndAbsoluteFrame);
+    void sendPendingNoteOffs(uint64_t blockEndAbsoluteFrame);
+    void queueOutputEvent(uint64_t absoluteFrame, uint8_t status, uint8_t note, uint8_t velocity);
+    void flushOutputEvents();
     
     DISTRHO_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopareliusPlugin)
 };
@@ -1,162 +1,470 @@
 #include "MarkovModels.h"
-#include <iostream> 
-#include <iomanip>  
-#include <algorithm> // For std::max
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
 
-namespace { 
-    double roundToPrecision(double value, int precision = 3) {
-        double factor = std::pow(10.0, precision);
-        return std::round(value * factor) / factor;
+namespace {
+    constexpr uint64_t kEmptyContext = ~static_cast<uint64_t>(0);
+    constexpr int kSymbolBits = 16;
+    constexpr uint32_t kAlwaysKeep = 0xFFFFFFFF;
+
+    int32_t toMilliseconds(double value) {
+        return static_cast<int32_t>(std::lround(value * 1000.0));
+    }
+
+    uint32_t nextPowerOfTwo(uint32_t value) {
+        uint32_t size = 1;
+        while (size < value) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    uint32_t hashContext(uint64_t context) {
+        context ^= context >> 33;
+        context *= 0xff51afd7ed558ccdULL;
+        context ^= context >> 33;
+        return static_cast<uint32_t>(context);
+    }
+
+    void pushHistory(int* history, int& length, int symbol) {
+        if (symbol < 0) {
+            return;
+        }
+        if (length == MarkovChain::kMaxOrder) {
+            std::copy(history + 1, history + length, history);
+            --length;
+        }
+        history[length++] = symbol;
+    }
+}
+
+// --- ValueBins ---
+void ValueBins::build(const std::vector<double>& values) {
+    milliseconds.clear();
+    for (double value : values) {
+        milliseconds.push_back(toMilliseconds(value));
+    }
+    std::sort(milliseconds.begin(), milliseconds.end());
+    milliseconds.erase(std::unique(milliseconds.begin(), milliseconds.end()), milliseconds.end());
+}
+
+void ValueBins::clear() {
+    milliseconds.clear();
+}
+
+int ValueBins::size() const {
+    return static_cast<int>(milliseconds.size());
+}
+
+int ValueBins::findNearest(double value) const {
+    if (milliseconds.empty()) {
+        return -1;
+    }
+
+    const int32_t ms = toMilliseconds(value);
+    const auto it = std::lower_bound(milliseconds.begin(), milliseconds.end(), ms);
+
+    if (it == milliseconds.end()) {
+        return size() - 1;
+    }
+    if (it != milliseconds.begin() && ms - *(it - 1) < *it - ms) {
+        return static_cast<int>(it - milliseconds.begin()) - 1;
+    }
+    return static_cast<int>(it - milliseconds.begin());
+}
+
+double ValueBins::getValue(int bin) const {
+    return milliseconds[bin] / 1000.0;
+}
+
+// --- MarkovChain ---
+constexpr int MarkovChain::kMaxOrder;
+
+void MarkovChain::clear() {
+    numSymbols = 0;
+    states.clear();
+    contextKeys.clear();
+    contextStates.clear();
+    contextMask = 0;
+    outcomes.clear();
+    thresholds.clear();
+    aliases.clear();
+    weights.clear();
+}
+
+void MarkovChain::build(const std::vector<int>& sequence, int newNumSymbols, int order, bool closeLoop) {
+    clear();
+
+    numSymbols = std::max(0, newNumSymbols);
+    // Context keys pack each symbol in kSymbolBits
+    maxOrder = numSymbols <= (1 << kSymbolBits) ? std::max(1, std::min(order, kMaxOrder)) : 1;
+    states.assign(numSymbols, State{0, 0});
+
+    const size_t length = sequence.size();
+    const size_t numTransitions = closeLoop ? length : (length > 0 ? length - 1 : 0);
+    if (numTransitions == 0) {
+        return;
+    }
+
+    // First order rows are indexed by symbol, a counting sort groups the transitions by row
+    rowStarts.assign(numSymbols + 1, 0);
+    for (size_t i = 0; i < numTransitions; ++i) {
+        ++rowStarts[sequence[i] + 1];
+    }
+    for (int symbol = 0; symbol < numSymbols; ++symbol) {
+        rowStarts[symbol + 1] += rowStarts[symbol];
+    }
+
+    transitions.resize(numTransitions);
+    rowFill.assign(rowStarts.begin(), rowStarts.end() - 1);
+    for (size_t i = 0; i < numTransitions; ++i) {
+        Transition& transition = transitions[rowFill[sequence[i]]++];
+        transition.context = makeContextKey(&sequence[i], 1);
+        transition.next = static_cast<uint32_t>(sequence[(i + 1) % length]);
+    }
+
+    for (int symbol = 0; symbol < numSymbols; ++symbol) {
+        const uint32_t start = rowStarts[symbol];
+        const uint32_t count = rowStarts[symbol + 1] - start;
+        if (count > 0) {
+            std::sort(transitions.begin() + start, transitions.begin() + start + count);
+            addState(transitions[start].context, &transitions[start], count);
+        }
+    }
+
+    // Longer contexts are sparse, they are sorted by context and stored in the hashed map
+    transitions.clear();
+    int context[kMaxOrder];
+    for (int contextOrder = 2; contextOrder <= maxOrder && static_cast<size_t>(contextOrder) <= length; ++contextOrder) {
+        for (size_t i = 0; i < numTransitions; ++i) {
+            if (!closeLoop && i + 1 < static_cast<size_t>(contextOrder)) {
+                continue;
+            }
+            for (int j = 0; j < contextOrder; ++j) {
+                context[j] = sequence[(i + length + 1 - contextOrder + j) % length];
+            }
+            transitions.push_back(Transition{makeContextKey(context, contextOrder),
+                                             static_cast<uint32_t>(sequence[(i + 1) % length])});
+        }
+    }
+    if (transitions.empty()) {
+        return;
+    }
+
+    std::sort(transitions.begin(), transitions.end());
+
+    const uint32_t capacity = nextPowerOfTwo(static_cast<uint32_t>(transitions.size()) * 2);
+    contextKeys.assign(capacity, kEmptyContext);
+    contextStates.assign(capacity, 0);
+    contextMask = capacity - 1;
+
+    size_t runStart = 0;
+    for (size_t i = 1; i <= transitions.size(); ++i) {
+        if (i == transitions.size() || transitions[i].context != transitions[runStart].context) {
+            addState(transitions[runStart].context, &transitions[runStart], static_cast<uint32_t>(i - runStart));
+            runStart = i;
+        }
     }
 }
 
-MarkovModels::MarkovModels() : rng(std::random_device{}()) {}
+uint64_t MarkovChain::makeContextKey(const int* symbols, int order) {
+    // The order goes in the top bits, the most recent symbol in the lowest ones
+    uint64_t key = static_cast<uint64_t>(order) << 60;
+    for (int j = 0; j < order; ++j) {
+        // build() only uses longer contexts when every symbol fits in kSymbolBits
+        key |= static_cast<uint64_t>(static_cast<uint32_t>(symbols[j])) << (kSymbolBits * (order - 1 - j));
+    }
+    return key;
+}
+
+// Builds the alias table of one context from its sorted transitions (Vose's method).
+void MarkovChain::addState(uint64_t context, const Transition* contextTransitions, uint32_t count) {
+    const uint32_t first = static_cast<uint32_t>(outcomes.size());
+
+    scaled.clear();
+    for (uint32_t i = 0; i < count;) {
+        uint32_t end = i + 1;
+        while (end < count && contextTransitions[end].next == contextTransitions[i].next) {
+            ++end;
+        }
+        outcomes.push_back(contextTransitions[i].next);
+        scaled.push_back(static_cast<double>(end - i));
+        i = end;
+    }
+
+    const uint32_t numOutcomes = static_cast<uint32_t>(scaled.size());
+    thresholds.resize(first + numOutcomes, kAlwaysKeep);
+    aliases.resize(first + numOutcomes);
+    weights.resize(first + numOutcomes);
+
+    smaller.clear();
+    larger.clear();
+    for (uint32_t j = 0; j < numOutcomes; ++j) {
+        weights[first + j] = static_cast<float>(scaled[j] / count);
+        aliases[first + j] = first + j;
+        scaled[j] = scaled[j] * numOutcomes / count;
+        (scaled[j] < 1.0 ? smaller : larger).push_back(j);
+    }
+
+    while (!smaller.empty() && !larger.empty()) {
+        const uint32_t small = smaller.back();
+        const uint32_t large = larger.back();
+        smaller.pop_back();
+
+        thresholds[first + small] = static_cast<uint32_t>(std::min(scaled[small] * 4294967296.0, 4294967295.0));
+        aliases[first + small] = first + large;
+
+        scaled[large] -= 1.0 - scaled[small];
+        if (scaled[large] < 1.0) {
+            larger.pop_back();
+            smaller.push_back(large);
+        }
+    }
+    // Whatever is left is 1 up to rounding errors, thresholds already default to kAlwaysKeep
+
+    const State state = { first, numOutcomes };
+    if ((context >> 60) == 1) {
+        states[static_cast<uint32_t>(context)] = state;
+    } else {
+        insertContext(context, static_cast<uint32_t>(states.size()));
+        states.push_back(state);
+    }
+}
+
+void MarkovChain::insertContext(uint64_t context, uint32_t stateIndex) {
+    uint32_t slot = hashContext(context) & contextMask;
+    while (contextKeys[slot] != kEmptyContext) {
+        slot = (slot + 1) & contextMask;
+    }
+    contextKeys[slot] = context;
+    contextStates[slot] = stateIndex;
+}
+
+const MarkovChain::State* MarkovChain::findContext(uint64_t context) const {
+    if (contextKeys.empty()) {
+        return nullptr;
+    }
+
+    uint32_t slot = hashContext(context) & contextMask;
+    while (contextKeys[slot] != kEmptyContext) {
+        if (contextKeys[slot] == context) {
+            return &states[contextStates[slot]];
+        }
+        slot = (slot + 1) & contextMask;
+    }
+    return nullptr;
+}
+
+bool MarkovChain::sample(const int* history, int historyLength, std::mt19937& rng, int& outSymbol) const {
+    const State* state = nullptr;
+
+    for (int contextOrder = std::min(historyLength, maxOrder); contextOrder > 1 && state == nullptr; --contextOrder) {
+        state = findContext(makeContextKey(history + historyLength - contextOrder, contextOrder));
+    }
+    if (state == nullptr && historyLength > 0) {
+        const int symbol = history[historyLength - 1];
+        if (symbol >= 0 && symbol < numSymbols && states[symbol].count > 0) {
+            state = &states[symbol];
+        }
+    }
+    if (state == nullptr) {
+        return false;
+    }
+
+    // A single draw picks the entry with its high bits and decides between it and its alias with the low ones
+    const uint64_t draw = static_cast<uint64_t>(static_cast<uint32_t>(rng())) * state->count;
+    const uint32_t index = state->first + static_cast<uint32_t>(draw >> 32);
+    const uint32_t coin = static_cast<uint32_t>(draw);
+
+    outSymbol = static_cast<int>(outcomes[coin < thresholds[index] ? index : aliases[index]]);
+    return true;
+}
+
+int MarkovChain::getNumSymbols() const {
+    return numSymbols;
+}
+
+void MarkovChain::getSuccessors(int symbol, std::vector<std::pair<int, float>>& outSuccessors) const {
+    outSuccessors.clear();
+    if (symbol < 0 || symbol >= numSymbols) {
+        return;
+    }
+
+    const State& state = states[symbol];
+    for (uint32_t i = state.first; i < state.first + state.count; ++i) {
+        outSuccessors.emplace_back(static_cast<int>(outcomes[i]), weights[i]);
+    }
+}
+
+// --- MarkovModels ---
+MarkovModels::MarkovModels() : order(1), rng(std::random_device{}()) {}
+
+void MarkovModels::setOrder(int newOrder) {
+    order = std::max(1, std::min(newOrder, MarkovChain::kMaxOrder));
+}
+
+int MarkovModels::getOrder() const {
+    return order;
+}
 
 void MarkovModels::clearModels() {
     pitchModel.clear();
     rhythmModel.clear();
     durationModel.clear();
+    rhythmBins.clear();
+    durationBins.clear();
 }
 
 void MarkovModels::buildModels(const std::vector<LoopareliusUtils::CustomMidiEvent>& loop) {
-    clearModels(); 
+    clearModels();
 
     if (loop.size() < 2) {
         return;
     }
 
-    for (size_t i = 0; i < loop.size() - 1; ++i) {
-        const LoopareliusUtils::CustomMidiEvent& currentEvent = loop[i];
-        const LoopareliusUtils::CustomMidiEvent& nextEvent = loop[i+1];
-
-        pitchModel[currentEvent.noteNumber].push_back(nextEvent.noteNumber);
-
-        double currentIOI = nextEvent.timestamp - currentEvent.timestamp;
-        currentIOI = std::max(0.001, currentIOI); 
-        double roundedCurrentIOI = roundToPrecision(currentIOI);
-
-        if (i + 2 < loop.size()) {
-            const LoopareliusUtils::CustomMidiEvent& nextNextEvent = loop[i+2];
-            double nextIOI = nextNextEvent.timestamp - nextEvent.timestamp;
-            nextIOI = std::max(0.001, nextIOI);
-            rhythmModel[roundedCurrentIOI].push_back(roundToPrecision(nextIOI));
-        } else if (loop.size() > 1) { 
-            double firstIOIinLoop = loop[1].timestamp - loop[0].timestamp;
-            firstIOIinLoop = std::max(0.001, firstIOIinLoop);
-            rhythmModel[roundedCurrentIOI].push_back(roundToPrecision(firstIOIinLoop));
-        }
+    symbols.clear();
+    for (const LoopareliusUtils::CustomMidiEvent& event : loop) {
+        symbols.push_back(event.noteNumber & 0x7F);
+    }
+    pitchModel.build(symbols, 128, order, false);
 
-        double roundedCurrentDuration = roundToPrecision(currentEvent.duration);
-        double roundedNextDuration = roundToPrecision(nextEvent.duration);
-        durationModel[roundedCurrentDuration].push_back(roundedNextDuration);
+    // The last IOI leads back to the first one, as the loop repeats
+    values.clear();
+    for (size_t i = 0; i + 1 < loop.size(); ++i) {
+        values.push_back(std::max(0.001, loop[i + 1].timestamp - loop[i].timestamp));
     }
+    rhythmBins.build(values);
+    symbols.clear();
+    for (double ioi : values) {
+        symbols.push_back(rhythmBins.findNearest(ioi));
+    }
+    rhythmModel.build(symbols, rhythmBins.size(), order, true);
 
-    if (!loop.empty()) {
-        double roundedLastEventDuration = roundToPrecision(loop.back().duration);
-        // Check if key exists or if its vector is empty before adding fallback
-        auto it = durationModel.find(roundedLastEventDuration);
-        if (it == durationModel.end() || it->second.empty()) {
-             if (it == durationModel.end()) { // Key doesn't exist, create it
-                durationModel[roundedLastEventDuration].push_back(roundToPrecision(loop.front().duration));
-             } else { // Key exists but vector is empty
-                it->second.push_back(roundToPrecision(loop.front().duration));
-             }
-        }
+    // Same for durations, so the last note always has a successor
+    values.clear();
+    for (const LoopareliusUtils::CustomMidiEvent& event : loop) {
+        values.push_back(event.duration);
     }
+    durationBins.build(values);
+    symbols.clear();
+    for (double duration : values) {
+        symbols.push_back(durationBins.findNearest(duration));
+    }
+    durationModel.build(symbols, durationBins.size(), order, true);
 }
 
 std::vector<LoopareliusUtils::CustomMidiEvent> MarkovModels::generateVariation(
-    const std::vector<LoopareliusUtils::CustomMidiEvent>& seedLoop, 
-    size_t numNotesToGenerate) 
+    const std::vector<LoopareliusUtils::CustomMidiEvent>& seedLoop,
+    size_t numNotesToGenerate)
 {
     std::vector<LoopareliusUtils::CustomMidiEvent> variation;
     if (seedLoop.empty() || numNotesToGenerate == 0) {
         return variation;
     }
+    variation.reserve(numNotesToGenerate);
+
+    LoopareliusUtils::CustomMidiEvent firstEvent = seedLoop.front();
+    firstEvent.timestamp = 0.0;
+    variation.push_back(firstEvent);
 
-    LoopareliusUtils::CustomMidiEvent lastGeneratedEvent = seedLoop.front();
-    lastGeneratedEvent.timestamp = 0.0;
-    variation.push_back(lastGeneratedEvent);
+    // Previous states of each model, the most recent one last
+    int pitchHistory[MarkovChain::kMaxOrder];
+    int rhythmHistory[MarkovChain::kMaxOrder];
+    int durationHistory[MarkovChain::kMaxOrder];
+    int pitchHistoryLength = 0;
+    int rhythmHistoryLength = 0;
+    int durationHistoryLength = 0;
+
+    pushHistory(pitchHistory, pitchHistoryLength, firstEvent.noteNumber & 0x7F);
+    if (seedLoop.size() > 1) {
+        pushHistory(rhythmHistory, rhythmHistoryLength,
+                    rhythmBins.findNearest(std::max(0.001, seedLoop[1].timestamp - seedLoop[0].timestamp)));
+    }
+    pushHistory(durationHistory, durationHistoryLength, durationBins.findNearest(firstEvent.duration));
 
     double currentPlaybackTime = 0.0;
 
     for (size_t i = 1; i < numNotesToGenerate; ++i) {
-        int prevNote = lastGeneratedEvent.noteNumber;
-        double prevDurationRounded = roundToPrecision(lastGeneratedEvent.duration);
-        
-        double prevIOIRounded = 0.5; 
-        if (variation.size() > 1) {
-            double actualPrevIOI = variation.back().timestamp - variation[variation.size()-2].timestamp;
-            prevIOIRounded = roundToPrecision(std::max(0.001, actualPrevIOI));
-        } else if (seedLoop.size() > 1) {
-            double seedFirstIOI = seedLoop[1].timestamp - seedLoop[0].timestamp;
-            prevIOIRounded = roundToPrecision(std::max(0.001, seedFirstIOI));
-        }
-
-        int nextNote = prevNote;
-        auto pitchIt = pitchModel.find(prevNote);
-        if (pitchIt != pitchModel.end() && !pitchIt->second.empty()) {
-            std::uniform_int_distribution<> distrib(0, static_cast<int>(pitchIt->second.size() - 1));
-            nextNote = pitchIt->second[distrib(rng)];
-        } else {
-            nextNote = seedLoop[i % seedLoop.size()].noteNumber;
+        const LoopareliusUtils::CustomMidiEvent& seedEvent = seedLoop[i % seedLoop.size()];
+        int symbol = 0;
+
+        int nextNote = seedEvent.noteNumber;
+        if (pitchModel.sample(pitchHistory, pitchHistoryLength, rng, symbol)) {
+            nextNote = symbol;
         }
+        pushHistory(pitchHistory, pitchHistoryLength, nextNote & 0x7F);
 
+        // Fallback values go back into the history as their nearest bin
         double nextIOI = 0.5;
-        auto rhythmIt = rhythmModel.find(prevIOIRounded);
-        if (rhythmIt != rhythmModel.end() && !rhythmIt->second.empty()) {
-            std::uniform_int_distribution<> distrib(0, static_cast<int>(rhythmIt->second.size() - 1));
-            nextIOI = rhythmIt->second[distrib(rng)];
+        if (rhythmModel.sample(rhythmHistory, rhythmHistoryLength, rng, symbol)) {
+            nextIOI = rhythmBins.getValue(symbol);
         } else {
-            if (seedLoop.size() > i && i > 0) {
+            if (seedLoop.size() > i) {
                 double originalIOI = seedLoop[i].timestamp - seedLoop[i-1].timestamp;
                 if (originalIOI > 0.0001) nextIOI = originalIOI;
             }
+            symbol = rhythmBins.findNearest(nextIOI);
         }
         nextIOI = std::max(0.001, nextIOI);
+        pushHistory(rhythmHistory, rhythmHistoryLength, symbol);
 
-        double nextDuration = 0.25;
-        auto durationIt = durationModel.find(prevDurationRounded);
-        if (durationIt != durationModel.end() && !durationIt->second.empty()) {
-            std::uniform_int_distribution<> distrib(0, static_cast<int>(durationIt->second.size() - 1));
-            nextDuration = durationIt->second[distrib(rng)];
+        double nextDuration = seedEvent.duration;
+        if (durationModel.sample(durationHistory, durationHistoryLength, rng, symbol)) {
+            nextDuration = durationBins.getValue(symbol);
         } else {
-            nextDuration = seedLoop[i % seedLoop.size()].duration;
+            symbol = durationBins.findNearest(nextDuration);
         }
         nextDuration = std::max(0.001, nextDuration);
-            
+        pushHistory(durationHistory, durationHistoryLength, symbol);
+
         currentPlaybackTime += nextIOI;
-        
-        LoopareliusUtils::CustomMidiEvent newEvent(
+
+        variation.emplace_back(
             currentPlaybackTime,
             nextNote,
-            seedLoop[i % seedLoop.size()].velocity,
+            seedEvent.velocity,
             nextDuration,
-            seedLoop[i % seedLoop.size()].channel
+            seedEvent.channel
         );
-        variation.push_back(newEvent);
-        lastGeneratedEvent = newEvent;
     }
     return variation;
 }
 
 void MarkovModels::printModels() const {
-    std::cout << "\n--- Pitch Model ---" << std::endl;
-    for (const auto& pair : pitchModel) {
-        std::cout << "  Note " << pair.first << " -> { ";
-        for (int nextNote : pair.second) { std::cout << nextNote << " "; }
+    std::vector<std::pair<int, float>> successors;
+
+    std::cout << "\n--- Pitch Model (order " << order << ", first order shown) ---" << std::endl;
+    for (int note = 0; note < pitchModel.getNumSymbols(); ++note) {
+        pitchModel.getSuccessors(note, successors);
+        if (successors.empty()) continue;
+        std::cout << "  Note " << note << " -> { ";
+        for (const auto& next : successors) {
+            std::cout << next.first << " (" << std::fixed << std::setprecision(2) << next.second << ") ";
+        }
         std::cout << "}" << std::endl;
     }
     std::cout << "\n--- Rhythm (IOI) Model (seconds) ---" << std::endl;
-    for (const auto& pair : rhythmModel) {
-        std::cout << "  IOI " << std::fixed << std::setprecision(3) << pair.first << "s -> { ";
-        for (double nextIOI : pair.second) { std::cout << std::fixed << std::setprecision(3) << nextIOI << "s "; }
+    for (int bin = 0; bin < rhythmModel.getNumSymbols(); ++bin) {
+        rhythmModel.getSuccessors(bin, successors);
+        if (successors.empty()) continue;
+        std::cout << "  IOI " << std::fixed << std::setprecision(3) << rhythmBins.getValue(bin) << "s -> { ";
+        for (const auto& next : successors) {
+            std::cout << std::fixed << std::setprecision(3) << rhythmBins.getValue(next.first) << "s ("
+                      << std::setprecision(2) << next.second << ") ";
+        }
         std::cout << "}" << std::endl;
     }
     std::cout << "\n--- Duration Model (seconds) ---" << std::endl;
-    for (const auto& pair : durationModel) {
-        std::cout << "  Dur " << std::fixed << std::setprecision(3) << pair.first << "s -> { ";
-        for (double nextDur : pair.second) { std::cout << std::fixed << std::setprecision(3) << nextDur << "s "; }
+    for (int bin = 0; bin < durationModel.getNumSymbols(); ++bin) {
+        durationModel.getSuccessors(bin, successors);
+        if (successors.empty()) continue;
+        std::cout << "  Dur " << std::fixed << std::setprecision(3) << durationBins.getValue(bin) << "s -> { ";
+        for (const auto& next : successors) {
+            std::cout << std::fixed << std::setprecision(3) << durationBins.getValue(next.first) << "s ("
+                      << std::setprecision(2) << next.second << ") ";
+        }
         std::cout << "}" << std::endl;
     }
-}
\ No newline at end of file
+}
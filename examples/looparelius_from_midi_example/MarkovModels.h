@@ -1,29 +1,123 @@
 #ifndef MARKOV_MODELS_H
 #define MARKOV_MODELS_H
 
-#include "CustomMidiEvent.h" 
+#include "CustomMidiEvent.h"
+#include <cstdint>
+#include <utility>
 #include <vector>
-#include <map>
-#include <random> 
-#include <cmath>  
+#include <random>
 
-class MarkovModels {
+// Dictionary of the distinct values of a continuous quantity (IOI, duration), so they can be used as Markov states.
+// Values are quantized to milliseconds and kept sorted, a bin index is the position of its value.
+class ValueBins {
+public:
+    void build(const std::vector<double>& values);
+    void clear();
+
+    int size() const;
+    // Index of the bin closest to value, or -1 when there are no bins.
+    int findNearest(double value) const;
+    double getValue(int bin) const;
+
+private:
+    std::vector<int32_t> milliseconds;
+};
+
+// Transition table over the symbols 0..numSymbols-1, using contexts of up to kMaxOrder previous symbols.
+// First order states are indexed directly by symbol, longer contexts are looked up in a hashed flat map.
+// Each state stores an alias table of its successors, so sampling takes constant time.
+class MarkovChain {
 public:
-    std::map<int, std::vector<int>> pitchModel;
-    std::map<double, std::vector<double>> rhythmModel;
-    std::map<double, std::vector<double>> durationModel;
+    static constexpr int kMaxOrder = 3;
+
+    // With closeLoop the sequence is cyclic, its last symbols lead back to the first ones.
+    void build(const std::vector<int>& sequence, int numSymbols, int order, bool closeLoop);
+    void clear();
+
+    // history holds the previous symbols, the most recent one last.
+    // Uses the longest context seen during build(), backing off to shorter ones.
+    // Returns false when not even the last symbol has known successors.
+    bool sample(const int* history, int historyLength, std::mt19937& rng, int& outSymbol) const;
+
+    int getNumSymbols() const;
+    // First order successors of symbol with their probabilities, for debugging.
+    void getSuccessors(int symbol, std::vector<std::pair<int, float>>& outSuccessors) const;
+
+private:
+    struct State {
+        uint32_t first; // index of the first successor in the alias arrays
+        uint32_t count;
+    };
+
+    struct Transition {
+        uint64_t context;
+        uint32_t next;
+        bool operator<(const Transition& other) const {
+            return context != other.context ? context < other.context : next < other.next;
+        }
+    };
+
+    static uint64_t makeContextKey(const int* symbols, int order);
+    void addState(uint64_t context, const Transition* transitions, uint32_t count);
+    void insertContext(uint64_t context, uint32_t stateIndex);
+    const State* findContext(uint64_t context) const;
 
-    std::mt19937 rng; // Non-const for non-const generateVariation
+    int numSymbols = 0;
+    int maxOrder = 1;
 
+    // The first numSymbols states are the first order ones, higher order states follow.
+    std::vector<State> states;
+
+    // Open addressing with linear probing, capacity is a power of two.
+    std::vector<uint64_t> contextKeys;
+    std::vector<uint32_t> contextStates;
+    uint32_t contextMask = 0;
+
+    // Alias tables of all states, one entry per (state, successor).
+    std::vector<uint32_t> outcomes;
+    std::vector<uint32_t> thresholds; // keep the entry when the coin is below, fixed point 0.32
+    std::vector<uint32_t> aliases;
+    std::vector<float> weights;
+
+    // Scratch space kept between builds.
+    std::vector<Transition> transitions;
+    std::vector<uint32_t> rowStarts;
+    std::vector<uint32_t> rowFill;
+    std::vector<double> scaled;
+    std::vector<uint32_t> smaller;
+    std::vector<uint32_t> larger;
+};
+
+class MarkovModels {
+public:
     MarkovModels();
 
+    // Number of previous notes the next one depends on, from 1 to MarkovChain::kMaxOrder.
+    // Takes effect on the next buildModels().
+    void setOrder(int order);
+    int getOrder() const;
+
     void buildModels(const std::vector<LoopareliusUtils::CustomMidiEvent>& loop);
     void clearModels();
-    void printModels() const; 
-    
+    void printModels() const;
+
     std::vector<LoopareliusUtils::CustomMidiEvent> generateVariation(
-        const std::vector<LoopareliusUtils::CustomMidiEvent>& seedLoop, 
-        size_t numNotesToGenerate); 
+        const std::vector<LoopareliusUtils::CustomMidiEvent>& seedLoop,
+        size_t numNotesToGenerate);
+
+private:
+    MarkovChain pitchModel;    // over MIDI note numbers
+    MarkovChain rhythmModel;   // over rhythmBins
+    MarkovChain durationModel; // over durationBins
+    ValueBins rhythmBins;
+    ValueBins durationBins;
+    int order;
+
+    std::mt19937 rng;
+
+    // Scratch space kept between builds.
+    std::vector<int> symbols;
+    std::vector<double> values;
 };
 
-#endif // MARKOV_MODELS_H
\ No newline at end of file
+#endif // MARKOV_MODELS_H
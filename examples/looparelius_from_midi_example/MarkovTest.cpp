@@ -0,0 +1,92 @@
+// MarkovTest.cpp
+// Checks that longer Markov contexts are used when they were seen, and that sampling backs off to shorter ones.
+// Build and run with `make test`.
+#include "MarkovModels.h"
+
+#include <iostream>
+
+namespace {
+    const int kNumDraws = 2000;
+
+    bool gFailed = false;
+
+    void check(bool condition, const char* message) {
+        if (!condition) {
+            std::cout << "[MarkovTest] Test condition failed: " << message << std::endl;
+            gFailed = true;
+        }
+    }
+
+    // Counts how often each symbol follows the given history.
+    std::vector<int> countSamples(const MarkovChain& chain, const std::vector<int>& history, std::mt19937& rng) {
+        std::vector<int> counts(chain.getNumSymbols(), 0);
+        for (int i = 0; i < kNumDraws; ++i) {
+            int symbol = -1;
+            if (chain.sample(history.data(), static_cast<int>(history.size()), rng, symbol)) {
+                ++counts[symbol];
+            }
+        }
+        return counts;
+    }
+}
+
+int main() {
+    std::mt19937 rng(1234);
+    MarkovChain chain;
+
+    // 1 is followed by 2 after 0, and by 4 after 3: ambiguous at order 1, deterministic at order 2.
+    const std::vector<int> sequence = { 0, 1, 2, 3, 1, 4 };
+
+    chain.build(sequence, 5, 2, false);
+    check(countSamples(chain, { 0, 1 }, rng)[2] == kNumDraws, "order 2 context (0, 1) always leads to 2");
+    check(countSamples(chain, { 3, 1 }, rng)[4] == kNumDraws, "order 2 context (3, 1) always leads to 4");
+
+    // Unseen context (2, 1) backs off to order 1, where 2 and 4 are equally likely
+    std::vector<int> counts = countSamples(chain, { 2, 1 }, rng);
+    check(counts[2] + counts[4] == kNumDraws, "backing off to order 1 only gives seen successors");
+    check(counts[2] > kNumDraws / 3 && counts[4] > kNumDraws / 3, "backing off to order 1 keeps its probabilities");
+
+    // Same history at order 1 ignores the older symbol
+    chain.build(sequence, 5, 1, false);
+    counts = countSamples(chain, { 0, 1 }, rng);
+    check(counts[2] > kNumDraws / 3 && counts[4] > kNumDraws / 3, "order 1 only looks at the last symbol");
+
+    // (1, 2) is ambiguous at order 2, the symbol before it decides at order 3
+    const std::vector<int> longSequence = { 0, 1, 2, 3, 4, 1, 2, 5 };
+    chain.build(longSequence, 6, 3, false);
+    check(countSamples(chain, { 0, 1, 2 }, rng)[3] == kNumDraws, "order 3 context (0, 1, 2) always leads to 3");
+    check(countSamples(chain, { 4, 1, 2 }, rng)[5] == kNumDraws, "order 3 context (4, 1, 2) always leads to 5");
+
+    // Closed loops wrap contexts around, the last symbols lead back to the first one
+    chain.build(sequence, 5, 2, true);
+    check(countSamples(chain, { 1, 4 }, rng)[0] == kNumDraws, "order 2 context (1, 4) wraps around to 0");
+
+    // No context at all
+    int symbol = -1;
+    check(!chain.sample(nullptr, 0, rng, symbol), "sampling without history fails");
+
+    // Generated variations follow the order 2 pitch model
+    std::vector<LoopareliusUtils::CustomMidiEvent> loop;
+    const int notes[] = { 60, 62, 64, 65, 62, 67 };
+    for (int i = 0; i < 6; ++i) {
+        loop.emplace_back(i * 0.25, notes[i], 100, 0.2, 0);
+    }
+
+    MarkovModels models;
+    models.setOrder(2);
+    models.buildModels(loop);
+    const std::vector<LoopareliusUtils::CustomMidiEvent> variation = models.generateVariation(loop, 3);
+    check(variation.size() == 3, "variation has the requested number of notes");
+    if (variation.size() == 3) {
+        check(variation[1].noteNumber == 62, "60 is always followed by 62");
+        check(variation[2].noteNumber == 64, "60, 62 is always followed by 64 at order 2");
+    }
+
+    if (gFailed) {
+        std::cout << "[MarkovTest] FAILED" << std::endl;
+        return 1;
+    }
+
+    std::cout << "[MarkovTest] OK" << std::endl;
+    return 0;
+}
@@ -1,60 +1,147 @@
 #include "RetrospectiveMidiBuffer.h"
-#include <iostream> 
+#include <algorithm>
+#include <cmath>
 
-RetrospectiveMidiBuffer::RetrospectiveMidiBuffer(double maxBufferTimeSeconds)
-    : maxBufferTime(maxBufferTimeSeconds) {}
+namespace {
+    uint32_t nextPowerOfTwo(uint32_t value) {
+        uint32_t size = 1;
+        while (size < value) {
+            size <<= 1;
+        }
+        return size;
+    }
 
-void RetrospectiveMidiBuffer::addEvent(const LoopareliusUtils::CustomMidiEvent& event) {
-    buffer.push_back(event);
-    pruneBuffer();
+    bool isEarlier(const LoopareliusUtils::CustomMidiEvent& a, const LoopareliusUtils::CustomMidiEvent& b) {
+        return a.timestamp < b.timestamp;
+    }
 }
 
-std::vector<LoopareliusUtils::CustomMidiEvent> RetrospectiveMidiBuffer::getNormalizedBufferedEvents() const {
-    std::vector<LoopareliusUtils::CustomMidiEvent> normalizedEvents;
-    if (buffer.empty()) {
-        return normalizedEvents;
-    }
+RetrospectiveMidiBuffer::RetrospectiveMidiBuffer(double maxBufferTimeSeconds, double maxNotesPerSecond)
+    : records(nullptr),
+      mask(0),
+      maxBufferTime(maxBufferTimeSeconds),
+      writeIndex(0),
+      readIndex(0)
+{
+    const double maxNotes = std::ceil(std::max(1.0, maxBufferTimeSeconds) * std::max(1.0, maxNotesPerSecond));
+    const uint32_t size = nextPowerOfTwo(static_cast<uint32_t>(std::min(maxNotes, 1048576.0)));
 
-    double firstEventTimestamp = buffer.front().timestamp;
-    for (const auto& event : buffer) {
-        normalizedEvents.emplace_back(
-            event.timestamp - firstEventTimestamp,
-            event.noteNumber,
-            event.velocity,
-            event.duration,
-            event.channel
-        );
+    records = new NoteRecord[size];
+    for (uint32_t i = 0; i < size; ++i) {
+        records[i].timestamp.store(0.0, std::memory_order_relaxed);
+        records[i].duration.store(0.0, std::memory_order_relaxed);
+        records[i].noteVelocityChannel.store(0, std::memory_order_relaxed);
     }
-    return normalizedEvents;
+    mask = size - 1;
 }
 
-const std::deque<LoopareliusUtils::CustomMidiEvent>& RetrospectiveMidiBuffer::getRawBuffer() const {
-    return buffer;
+RetrospectiveMidiBuffer::~RetrospectiveMidiBuffer() {
+    delete[] records;
 }
 
-void RetrospectiveMidiBuffer::clear() {
-    buffer.clear();
-}
+void RetrospectiveMidiBuffer::addEvent(const LoopareliusUtils::CustomMidiEvent& event) {
+    const uint32_t write = writeIndex.load(std::memory_order_relaxed);
+    uint32_t read = readIndex.load(std::memory_order_relaxed);
 
-size_t RetrospectiveMidiBuffer::size() const {
-    return buffer.size();
+    // Ring is full, drop the oldest note.
+    // Readers must see the new readIndex before the slot gets overwritten.
+    if (write - read > mask) {
+        read = write - mask;
+        readIndex.store(read, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    NoteRecord& record = records[write & mask];
+    record.timestamp.store(event.timestamp, std::memory_order_relaxed);
+    record.duration.store(event.duration, std::memory_order_relaxed);
+    record.noteVelocityChannel.store(static_cast<uint32_t>(event.noteNumber & 0x7F)
+                                     | static_cast<uint32_t>(event.velocity & 0x7F) << 8
+                                     | static_cast<uint32_t>(event.channel & 0x0F) << 16,
+                                     std::memory_order_relaxed);
+
+    writeIndex.store(write + 1, std::memory_order_release);
+
+    // Prune by time, always keeping the newest note.
+    const uint32_t newest = write;
+    const uint32_t oldRead = read;
+    while (read != newest && event.timestamp - records[read & mask].timestamp.load(std::memory_order_relaxed) > maxBufferTime) {
+        ++read;
+    }
+    if (read != oldRead) {
+        readIndex.store(read, std::memory_order_release);
+    }
 }
 
-bool RetrospectiveMidiBuffer::isEmpty() const {
-    return buffer.empty();
+void RetrospectiveMidiBuffer::clear() {
+    readIndex.store(writeIndex.load(std::memory_order_relaxed), std::memory_order_release);
 }
 
-void RetrospectiveMidiBuffer::pruneBuffer() {
-    if (buffer.size() < 2) {
-        return;
+size_t RetrospectiveMidiBuffer::copyNormalizedEvents(std::vector<LoopareliusUtils::CustomMidiEvent>& outEvents) const {
+    outEvents.clear();
+
+    uint32_t read = readIndex.load(std::memory_order_acquire);
+    const uint32_t write = writeIndex.load(std::memory_order_acquire);
+
+    // Many notes might have arrived between both loads, only the newest ones can still be in the ring.
+    if (write - read > mask + 1) {
+        read = write - (mask + 1);
     }
 
-    double currentTimeSpan = buffer.back().timestamp - buffer.front().timestamp;
-    while (currentTimeSpan > maxBufferTime && !buffer.empty()) {
-        buffer.pop_front();
-        if (buffer.size() < 2) {
-            break;
-        }
-        currentTimeSpan = buffer.back().timestamp - buffer.front().timestamp;
+    const uint32_t count = write - read;
+    if (count == 0) {
+        return 0;
     }
-}
\ No newline at end of file
+
+    outEvents.reserve(count);
+    for (uint32_t i = read; i != write; ++i) {
+        const NoteRecord& record = records[i & mask];
+        const uint32_t packed = record.noteVelocityChannel.load(std::memory_order_relaxed);
+        outEvents.emplace_back(record.timestamp.load(std::memory_order_relaxed),
+                               static_cast<int>(packed & 0x7F),
+                               static_cast<int>((packed >> 8) & 0x7F),
+                               record.duration.load(std::memory_order_relaxed),
+                               static_cast<int>((packed >> 16) & 0x0F));
+    }
+
+    // The audio thread may have overwritten the oldest slots while we were copying.
+    // It moves readIndex past a slot before reusing it, so anything below the current readIndex is discarded.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint32_t overwritten = readIndex.load(std::memory_order_relaxed) - read;
+
+    if (overwritten >= count) {
+        outEvents.clear();
+        return 0;
+    }
+    if (overwritten > 0) {
+        outEvents.erase(outEvents.begin(), outEvents.begin() + overwritten);
+    }
+
+    // Notes are stored when released, so sort them by their start time.
+    std::stable_sort(outEvents.begin(), outEvents.end(), isEarlier);
+
+    const double firstEventTimestamp = outEvents.front().timestamp;
+    for (auto& event : outEvents) {
+        event.timestamp -= firstEventTimestamp;
+    }
+    return outEvents.size();
+}
+
+std::vector<LoopareliusUtils::CustomMidiEvent> RetrospectiveMidiBuffer::getNormalizedBufferedEvents() const {
+    std::vector<LoopareliusUtils::CustomMidiEvent> normalizedEvents;
+    copyNormalizedEvents(normalizedEvents);
+    return normalizedEvents;
+}
+
+size_t RetrospectiveMidiBuffer::size() const {
+    const uint32_t read = readIndex.load(std::memory_order_acquire);
+    const uint32_t write = writeIndex.load(std::memory_order_acquire);
+    return std::min<uint32_t>(write - read, mask + 1);
+}
+
+size_t RetrospectiveMidiBuffer::capacity() const {
+    return mask + 1;
+}
+
+bool RetrospectiveMidiBuffer::isEmpty() const {
+    return size() == 0;
+}
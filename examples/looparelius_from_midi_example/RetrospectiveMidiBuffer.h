@@ -2,26 +2,57 @@
 #define RETROSPECTIVE_MIDI_BUFFER_H
 
 #include "CustomMidiEvent.h"
-#include <deque>
+#include <atomic>
+#include <cstdint>
 #include <vector>
-#include <algorithm> 
 
+// Fixed-capacity ring holding the notes played during the last maxBufferTime seconds.
+// addEvent() runs on the audio thread and never allocates or locks.
+// Snapshots are copied out lock-free from any other thread.
 class RetrospectiveMidiBuffer {
 public:
-    RetrospectiveMidiBuffer(double maxBufferTimeSeconds = 10.0);
+    // Fixed-size note record stored in the ring.
+    // Fields are relaxed atomics so that a snapshot racing with the audio thread reusing a slot stays well defined,
+    // such torn records are then discarded through readIndex.
+    struct NoteRecord {
+        std::atomic<double> timestamp;
+        std::atomic<double> duration;
+        std::atomic<uint32_t> noteVelocityChannel;
+    };
 
+    // The ring is sized to hold maxNotesPerSecond notes over the whole window, rounded up to a power of two.
+    // When playing faster than that, the oldest notes are dropped early.
+    RetrospectiveMidiBuffer(double maxBufferTimeSeconds = 10.0, double maxNotesPerSecond = 50.0);
+    ~RetrospectiveMidiBuffer();
+
+    // Audio thread only.
     void addEvent(const LoopareliusUtils::CustomMidiEvent& event);
-    std::vector<LoopareliusUtils::CustomMidiEvent> getNormalizedBufferedEvents() const;
-    const std::deque<LoopareliusUtils::CustomMidiEvent>& getRawBuffer() const;
+
+    // Must not run concurrently with addEvent(), e.g. call it from activate().
     void clear();
+
+    // Copy the buffered notes into outEvents, sorted by time and normalized so the first one starts at 0.
+    // outEvents keeps its capacity between calls. Safe to call from any non real-time thread.
+    size_t copyNormalizedEvents(std::vector<LoopareliusUtils::CustomMidiEvent>& outEvents) const;
+    std::vector<LoopareliusUtils::CustomMidiEvent> getNormalizedBufferedEvents() const;
+
     size_t size() const;
+    size_t capacity() const;
     bool isEmpty() const;
 
 private:
-    void pruneBuffer();
+    RetrospectiveMidiBuffer(const RetrospectiveMidiBuffer&) = delete;
+    RetrospectiveMidiBuffer& operator=(const RetrospectiveMidiBuffer&) = delete;
+
+    NoteRecord* records;
+    uint32_t mask;
+    double maxBufferTime;
 
-    std::deque<LoopareliusUtils::CustomMidiEvent> buffer;
-    double maxBufferTime; 
+    // Monotonic record counters, the ring slot is counter & mask.
+    // Only the audio thread writes them: writeIndex after storing a record,
+    // readIndex when pruning old notes or before overwriting the oldest slot.
+    std::atomic<uint32_t> writeIndex;
+    std::atomic<uint32_t> readIndex;
 };
 
-#endif // RETROSPECTIVE_MIDI_BUFFER_H
\ No newline at end of file
+#endif // RETROSPECTIVE_MIDI_BUFFER_H
@@ -0,0 +1,128 @@
+// SchedulerTest.cpp
+// Plays a single-note capture through the plugin and checks the MIDI output around variation switches.
+// The note ends exactly where the next variation plays it again, its note-off must never cut the new note.
+// With several voices the same note is played by all of them at once, the key must only be released once.
+// Build and run with `make test`.
+#include "DistrhoPlugin.cpp"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+USE_NAMESPACE_DISTRHO
+
+namespace {
+    struct OutputStats {
+        uint64_t blockStartFrame = 0;
+        uint64_t lastNoteOnFrame = 0;
+        bool sounding = false;
+        int noteOns = 0;
+        int retriggeredWhileSounding = 0;
+        int noteOffsWithoutNoteOn = 0;
+        int noteOffsCuttingNewNote = 0;
+    };
+
+    OutputStats gStats;
+
+    bool writeMidi(void*, const MidiEvent& event) {
+        const uint8_t status = event.data[0] & 0xF0;
+        const uint64_t frame = gStats.blockStartFrame + event.frame;
+
+        if (status == 0x90 && event.data[2] > 0) {
+            if (gStats.sounding) {
+                ++gStats.retriggeredWhileSounding;
+            }
+            gStats.sounding = true;
+            ++gStats.noteOns;
+            gStats.lastNoteOnFrame = frame;
+        } else if (status == 0x80 || status == 0x90) {
+            if (!gStats.sounding) {
+                ++gStats.noteOffsWithoutNoteOn;
+            } else if (frame == gStats.lastNoteOnFrame) {
+                ++gStats.noteOffsCuttingNewNote;
+            }
+            gStats.sounding = false;
+        }
+        return true;
+    }
+
+    MidiEvent makeEvent(uint32_t frame, uint8_t status, uint8_t note, uint8_t velocity) {
+        MidiEvent event = {};
+        event.frame = frame;
+        event.size = 3;
+        event.data[0] = status;
+        event.data[1] = note;
+        event.data[2] = velocity;
+        return event;
+    }
+
+    // The captured note lasts noteFrames, the same length as every variation made from it.
+    bool runScheduler(uint32_t bufferSize, uint32_t noteFrames, int voices) {
+        const double sampleRate = 48000.0;
+        gStats = OutputStats();
+
+        d_nextBufferSize = bufferSize;
+        d_nextSampleRate = sampleRate;
+        PluginExporter plugin(nullptr, writeMidi, nullptr, nullptr);
+        plugin.setParameterValue(paramVoices, static_cast<float>(voices));
+        plugin.activate();
+
+        const uint64_t totalFrames = static_cast<uint64_t>(sampleRate * 2);
+        const uint64_t captureFrame = noteFrames + bufferSize;
+        bool captured = false;
+
+        for (uint64_t frame = 0; frame < totalFrames; frame += bufferSize) {
+            MidiEvent input[2];
+            uint32_t inputCount = 0;
+
+            if (frame == 0) {
+                input[inputCount++] = makeEvent(0, 0x90, 60, 100);
+            }
+            if (noteFrames >= frame && noteFrames < frame + bufferSize) {
+                input[inputCount++] = makeEvent(static_cast<uint32_t>(noteFrames - frame), 0x80, 60, 0);
+            }
+            if (!captured && frame >= captureFrame) {
+                plugin.setParameterValue(paramCaptureLoop, 1.0f);
+                captured = true;
+            }
+
+            gStats.blockStartFrame = frame;
+            plugin.run(nullptr, nullptr, bufferSize, input, inputCount);
+
+            // Give the variation worker some time, this test does not need to run in real-time
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        plugin.deactivate();
+
+        std::cout << "[SchedulerTest] buffer size " << bufferSize << ", " << voices << " voices: "
+                  << gStats.noteOns << " note-ons, "
+                  << gStats.retriggeredWhileSounding << " retriggered, "
+                  << gStats.noteOffsCuttingNewNote << " cut, "
+                  << gStats.noteOffsWithoutNoteOn << " unmatched note-offs" << std::endl;
+
+        // Two seconds of 100ms variations per voice, allowing for the capture and worker start-up.
+        // Voices playing the same note together retrigger it, a single voice never does.
+        return gStats.noteOns >= 10 * voices
+            && (voices > 1 || gStats.retriggeredWhileSounding == 0)
+            && gStats.noteOffsCuttingNewNote == 0
+            && gStats.noteOffsWithoutNoteOn == 0;
+    }
+}
+
+int main() {
+    // Variation boundary in the middle of a block
+    const bool withinBlock = runScheduler(256, 4800, 1);
+    // Variation boundary on a block edge
+    const bool onBlockEdge = runScheduler(480, 4800, 1);
+    // Several variations playing at once
+    const bool severalVoices = runScheduler(256, 4800, 3);
+
+    if (!withinBlock || !onBlockEdge || !severalVoices) {
+        std::cout << "[SchedulerTest] FAILED" << std::endl;
+        return 1;
+    }
+
+    std::cout << "[SchedulerTest] OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include "VariationWorker.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Note-offs go before note-ons on the same frame, so a repeated note is not cut short.
+    bool isScheduledBefore(const DISTRHO::ScheduledEvent& a, const DISTRHO::ScheduledEvent& b) {
+        if (a.frame != b.frame) {
+            return a.frame < b.frame;
+        }
+        return (a.status & 0xF0) < (b.status & 0xF0);
+    }
+}
+
+START_NAMESPACE_DISTRHO
+
+VariationWorker::VariationWorker(RetrospectiveMidiBuffer& buffer)
+    : Runner("LoopareliusWorker"),
+      retrospectiveBuffer(buffer),
+      sampleRate(44100.0),
+      captureRequested(false),
+      markovOrder(1),
+      numVoices(1)
+{
+    for (int i = 0; i < kNumSlots; ++i) {
+        slotBusy[i].store(false, std::memory_order_relaxed);
+    }
+    for (int voice = 0; voice < kMaxVoices; ++voice) {
+        readySlots[voice].store(-1, std::memory_order_relaxed);
+    }
+}
+
+VariationWorker::~VariationWorker() {
+    stop();
+}
+
+void VariationWorker::reset(double newSampleRate) {
+    sampleRate = newSampleRate;
+    markovModels.clearModels();
+    capturedLoop.clear();
+
+    for (int i = 0; i < kNumSlots; ++i) {
+        slots[i].events.clear();
+        slots[i].schedule.clear();
+        slots[i].totalFrames = 0;
+        slotBusy[i].store(false, std::memory_order_relaxed);
+    }
+
+    for (int voice = 0; voice < kMaxVoices; ++voice) {
+        readySlots[voice].store(-1, std::memory_order_relaxed);
+    }
+    captureRequested.store(false, std::memory_order_relaxed);
+}
+
+void VariationWorker::start() {
+    // Variations last seconds, polling every few milliseconds keeps one ready well in time.
+    startRunner(5);
+}
+
+void VariationWorker::stop() {
+    if (isRunnerActive()) {
+        stopRunner();
+    }
+}
+
+void VariationWorker::requestCapture() {
+    captureRequested.store(true, std::memory_order_release);
+}
+
+void VariationWorker::setMarkovOrder(int order) {
+    markovOrder.store(order, std::memory_order_relaxed);
+}
+
+void VariationWorker::setNumVoices(int voices) {
+    if (voices < 1) {
+        voices = 1;
+    } else if (voices > kMaxVoices) {
+        voices = kMaxVoices;
+    }
+    numVoices.store(voices, std::memory_order_relaxed);
+}
+
+const Variation* VariationWorker::takeNextVariation(int voice, bool currentFinished) {
+    std::atomic<int>& readySlot = readySlots[voice];
+    int ready = readySlot.load(std::memory_order_acquire);
+
+    if (ready < 0) {
+        return nullptr;
+    }
+    if (!currentFinished && (ready & kImmediateFlag) == 0) {
+        return nullptr;
+    }
+
+    // The worker may have taken it back meanwhile to replace it with a new capture, try again next block then.
+    if (!readySlot.compare_exchange_strong(ready, -1, std::memory_order_acq_rel)) {
+        return nullptr;
+    }
+
+    return &slots[ready & kSlotMask];
+}
+
+void VariationWorker::releaseVariation(const Variation* variation) {
+    const long slot = variation - slots;
+
+    if (slot >= 0 && slot < kNumSlots) {
+        slotBusy[slot].store(false, std::memory_order_release);
+    }
+}
+
+bool VariationWorker::run() {
+    if (captureRequested.exchange(false, std::memory_order_acquire)) {
+        handleCapture();
+    }
+
+    const int voices = numVoices.load(std::memory_order_relaxed);
+
+    for (int voice = 0; voice < kMaxVoices; ++voice) {
+        if (voice >= voices) {
+            // Voices turned off stop after their current variation, nothing needs to wait for them.
+            reclaimReadyVariation(voice);
+        } else if (!capturedLoop.empty() && readySlots[voice].load(std::memory_order_acquire) < 0) {
+            publishVariation(voice, false);
+        }
+    }
+
+    return true;
+}
+
+void VariationWorker::handleCapture() {
+    std::cout << "[LoopareliusCpp] Handling capture action..." << std::endl;
+    retrospectiveBuffer.copyNormalizedEvents(capturedLoop);
+
+    if (capturedLoop.empty()) {
+        std::cout << "[LoopareliusCpp] Captured loop is empty." << std::endl;
+        markovModels.clearModels();
+    } else {
+        std::cout << "[LoopareliusCpp] Captured " << capturedLoop.size() << " events for model." << std::endl;
+        markovModels.setOrder(markovOrder.load(std::memory_order_relaxed));
+        markovModels.buildModels(capturedLoop);
+    }
+
+    // The variations waiting in line belong to the previous capture, replace them.
+    // An empty capture publishes empty variations, which stop playback.
+    const int voices = numVoices.load(std::memory_order_relaxed);
+
+    for (int voice = 0; voice < kMaxVoices; ++voice) {
+        reclaimReadyVariation(voice);
+        if (voice < voices) {
+            publishVariation(voice, true);
+        }
+    }
+}
+
+void VariationWorker::publishVariation(int voice, bool immediate) {
+    int slot = -1;
+    for (int i = 0; i < kNumSlots; ++i) {
+        if (!slotBusy[i].load(std::memory_order_acquire)) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return;
+    }
+
+    Variation& variation = slots[slot];
+    variation.totalFrames = 0;
+
+    if (capturedLoop.empty()) {
+        variation.events.clear();
+    } else {
+        variation.events = markovModels.generateVariation(capturedLoop, capturedLoop.size());
+    }
+
+    if (!variation.events.empty()) {
+        const LoopareliusUtils::CustomMidiEvent& lastEvent = variation.events.back();
+        variation.totalFrames = static_cast<uint32_t>((lastEvent.timestamp + lastEvent.duration) * sampleRate);
+        if (variation.totalFrames == 0) {
+            variation.totalFrames = static_cast<uint32_t>(variation.events.front().duration * sampleRate);
+        }
+        // playback needs every variation to move time forward
+        variation.totalFrames = std::max(1u, variation.totalFrames);
+        std::cout << "[LoopareliusCpp] Generated new variation with " << variation.events.size()
+                  << " events, " << variation.totalFrames << " frames." << std::endl;
+    }
+
+    buildSchedule(variation);
+
+    slotBusy[slot].store(true, std::memory_order_relaxed);
+    readySlots[voice].store(slot | (immediate ? kImmediateFlag : 0), std::memory_order_release);
+}
+
+void VariationWorker::buildSchedule(Variation& variation) const {
+    variation.schedule.clear();
+    variation.schedule.reserve(variation.events.size() * 2);
+
+    for (const LoopareliusUtils::CustomMidiEvent& event : variation.events) {
+        const uint32_t channel = static_cast<uint32_t>(event.channel) & 0x0F;
+        const uint32_t noteOnFrame = static_cast<uint32_t>(event.timestamp * sampleRate);
+        const uint32_t noteOffFrame = noteOnFrame + static_cast<uint32_t>(event.duration * sampleRate);
+
+        ScheduledEvent noteOn;
+        noteOn.frame = noteOnFrame;
+        noteOn.noteOnFrame = noteOnFrame;
+        noteOn.status = static_cast<uint8_t>(0x90 | channel);
+        noteOn.note = static_cast<uint8_t>(event.noteNumber & 0x7F);
+        noteOn.velocity = static_cast<uint8_t>(event.velocity & 0x7F);
+        variation.schedule.push_back(noteOn);
+
+        ScheduledEvent noteOff = noteOn;
+        noteOff.frame = noteOffFrame;
+        noteOff.status = static_cast<uint8_t>(0x80 | channel);
+        noteOff.velocity = 0;
+        variation.schedule.push_back(noteOff);
+    }
+
+    std::stable_sort(variation.schedule.begin(), variation.schedule.end(), isScheduledBefore);
+}
+
+void VariationWorker::reclaimReadyVariation(int voice) {
+    const int ready = readySlots[voice].exchange(-1, std::memory_order_acq_rel);
+
+    if (ready >= 0) {
+        slotBusy[ready & kSlotMask].store(false, std::memory_order_release);
+    }
+}
+
+END_NAMESPACE_DISTRHO
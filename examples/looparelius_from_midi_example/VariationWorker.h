@@ -0,0 +1,102 @@
+#ifndef VARIATION_WORKER_H
+#define VARIATION_WORKER_H
+
+#include "extra/Runner.hpp"
+#include "CustomMidiEvent.h"
+#include "RetrospectiveMidiBuffer.h"
+#include "MarkovModels.h"
+
+#include <atomic>
+#include <vector>
+
+START_NAMESPACE_DISTRHO
+
+// Note-on or note-off of a variation, at a frame offset from the start of the variation.
+struct ScheduledEvent {
+    uint32_t frame;
+    uint32_t noteOnFrame; // for note-offs, frame of the matching note-on
+    uint8_t status;
+    uint8_t note;
+    uint8_t velocity;
+};
+
+// A generated variation, ready to be played by the audio thread.
+// The schedule is sorted by frame, so playback only needs to move a cursor forward.
+struct Variation {
+    std::vector<LoopareliusUtils::CustomMidiEvent> events;
+    std::vector<ScheduledEvent> schedule;
+    uint32_t totalFrames = 0;
+};
+
+// Background worker that builds the Markov models and generates variations away from the audio thread.
+// Variations are played by up to kMaxVoices voices at once, each one playing its own sequence of variations.
+// For every active voice it keeps one variation ready ahead of the one being played.
+// Finished variations are handed over through a small fixed pool of slots, so taking one is wait-free.
+class VariationWorker : public Runner {
+public:
+    static constexpr int kMaxVoices = 4;
+
+    explicit VariationWorker(RetrospectiveMidiBuffer& buffer);
+    ~VariationWorker() override;
+
+    // Non real-time, only while the worker and the audio thread are stopped.
+    void reset(double sampleRate);
+    void start();
+    void stop();
+
+    // Real-time safe, from any thread.
+    // Asks the worker to capture the buffered notes and generate a new first variation from them.
+    void requestCapture();
+
+    // Real-time safe, from any thread.
+    // Markov order used for the models of the following captures.
+    void setMarkovOrder(int order);
+
+    // Real-time safe, from any thread.
+    // Number of voices to generate variations for, from 1 to kMaxVoices.
+    void setNumVoices(int voices);
+
+    // Audio thread only.
+    // Returns the next variation for a voice to play, or null if there is none to switch to yet.
+    // Variations from a new capture are returned right away, others only once the current one has finished.
+    const Variation* takeNextVariation(int voice, bool currentFinished);
+
+    // Audio thread only.
+    // Gives a variation returned by takeNextVariation() back to the worker, it must not be used afterwards.
+    void releaseVariation(const Variation* variation);
+
+protected:
+    bool run() override;
+
+private:
+    static constexpr int kNumSlots = 3 * kMaxVoices;
+    static constexpr int kSlotMask = 0x0F;
+    static constexpr int kImmediateFlag = 0x10;
+
+    void handleCapture();
+    void publishVariation(int voice, bool immediate);
+    void buildSchedule(Variation& variation) const;
+    void reclaimReadyVariation(int voice);
+
+    RetrospectiveMidiBuffer& retrospectiveBuffer;
+    MarkovModels markovModels;
+    std::vector<LoopareliusUtils::CustomMidiEvent> capturedLoop;
+    double sampleRate;
+
+    // Slot pool: per voice one playing, at most one ready, at least one free for the worker to fill.
+    // While switching variations the audio thread holds two, until it releases the old one.
+    Variation slots[kNumSlots];
+    std::atomic<bool> slotBusy[kNumSlots];
+
+    // Per voice, index of the ready slot plus kImmediateFlag, or -1 when empty.
+    std::atomic<int> readySlots[kMaxVoices];
+    std::atomic<bool> captureRequested;
+    std::atomic<int> markovOrder;
+    std::atomic<int> numVoices;
+
+    DISTRHO_DECLARE_NON_COPYABLE(VariationWorker)
+};
+
+END_NAMESPACE_DISTRHO
+
+#endif // VARIATION_WORKER_H
@@ -0,0 +1,251 @@
+/*
+ * DISTRHO Plugin Framework (DPF)
+ * Copyright (C) 2012-2024 Filipe Coelho <falktx@falktx.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any purpose with
+ * or without fee is hereby granted, provided that the above copyright notice and this
+ * permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+ * NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+ * IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "tests.hpp"
+
+#include "distrho/extra/AtomicSwap.hpp"
+#include "distrho/extra/Time.hpp"
+
+#include <thread>
+
+// --------------------------------------------------------------------------------------------------------------------
+
+START_NAMESPACE_DISTRHO
+
+static std::atomic<int> gLiveTables(0);
+
+struct Table {
+    static const uint32_t kSize = 256;
+    static const uint32_t kDeadValue = 0xdeadbeef;
+
+    uint32_t generation;
+    uint32_t values[kSize];
+
+    Table(const uint32_t g)
+        : generation(g)
+    {
+        for (uint32_t i=0; i < kSize; ++i)
+            values[i] = g;
+
+        ++gLiveTables;
+    }
+
+    ~Table()
+    {
+        // poison contents so that a reader touching a deleted table fails the consistency check
+        generation = kDeadValue;
+        for (uint32_t i=0; i < kSize; ++i)
+            values[i] = kDeadValue;
+
+        --gLiveTables;
+    }
+};
+
+// NOTE: plain std::thread is used here instead of DPF's Thread, so that TSAN only reports on AtomicSwap itself
+struct TableReader {
+    AtomicSwap<Table>& swap;
+    const uint32_t readerIndex;
+    std::atomic<bool> shouldExit;
+    uint32_t numReads;
+    uint32_t numErrors;
+    std::thread thread;
+
+    TableReader(AtomicSwap<Table>& s, const uint32_t i)
+        : swap(s),
+          readerIndex(i),
+          shouldExit(false),
+          numReads(0),
+          numErrors(0),
+          thread(&TableReader::run, this) {}
+
+    void stop()
+    {
+        shouldExit = true;
+        thread.join();
+    }
+
+    void run()
+    {
+        uint32_t lastGeneration = 0;
+
+        while (! shouldExit)
+        {
+            const AtomicSwap<Table>::ScopedReader reader(swap, readerIndex);
+            const Table* const table = reader.get();
+
+            if (table == nullptr)
+                continue;
+
+            const uint32_t generation = table->generation;
+
+            // objects are published in order, a reader must never go back in time
+            if (generation < lastGeneration || generation == Table::kDeadValue)
+                ++numErrors;
+
+            for (uint32_t i=0; i < Table::kSize; ++i)
+            {
+                if (table->values[i] != generation)
+                {
+                    ++numErrors;
+                    break;
+                }
+            }
+
+            lastGeneration = generation;
+            ++numReads;
+        }
+    }
+};
+
+END_NAMESPACE_DISTRHO
+
+// --------------------------------------------------------------------------------------------------------------------
+
+int main()
+{
+    USE_NAMESPACE_DISTRHO;
+
+    // basic usage, single reader
+    {
+        AtomicSwap<Table> swap;
+        DISTRHO_ASSERT_EQUAL(swap.acquire(), nullptr, "starts empty");
+        swap.release();
+
+        swap.publish(new Table(1));
+        DISTRHO_ASSERT_EQUAL(swap.hasPendingReclaim(), false, "replacing null does not queue anything");
+
+        Table* const first = swap.acquire();
+        DISTRHO_ASSERT_NOT_EQUAL(first, nullptr, "published object is visible");
+        DISTRHO_ASSERT_EQUAL(first->generation, 1U, "published object has the right contents");
+
+        // publish while the reader still holds the first object
+        swap.publish(new Table(2));
+        DISTRHO_ASSERT_EQUAL(swap.hasPendingReclaim(), true, "replaced object is queued");
+        DISTRHO_ASSERT_EQUAL(swap.collect(), 0U, "held object is not deleted");
+        DISTRHO_ASSERT_EQUAL(first->generation, 1U, "held object stays valid");
+        swap.release();
+
+        DISTRHO_ASSERT_EQUAL(swap.collect(), 1U, "released object is deleted");
+        DISTRHO_ASSERT_EQUAL(swap.hasPendingReclaim(), false, "queue is empty after collect");
+        DISTRHO_ASSERT_EQUAL(gLiveTables.load(), 1, "only the current object is alive");
+
+        {
+            const AtomicSwap<Table>::ScopedReader reader(swap);
+            DISTRHO_ASSERT_EQUAL(reader->generation, 2U, "new object is visible");
+        }
+
+        swap.publish(nullptr);
+        DISTRHO_ASSERT_EQUAL(swap.acquire(), nullptr, "can publish null");
+        swap.release();
+        DISTRHO_ASSERT_EQUAL(swap.collect(), 1U, "object replaced by null is deleted");
+        DISTRHO_ASSERT_EQUAL(gLiveTables.load(), 0, "nothing is alive");
+    }
+
+    // multiple readers, reclaim waits for the slowest one
+    {
+        AtomicSwap<Table> swap(2, new Table(1));
+
+        const Table* const fromReader0 = swap.acquire(0);
+        swap.publish(new Table(2));
+        const Table* const fromReader1 = swap.acquire(1);
+        DISTRHO_ASSERT_EQUAL(fromReader0->generation, 1U, "reader 0 holds the old object");
+        DISTRHO_ASSERT_EQUAL(fromReader1->generation, 2U, "reader 1 holds the new object");
+
+        swap.publish(new Table(3));
+        DISTRHO_ASSERT_EQUAL(swap.collect(), 0U, "reader 0 blocks reclaim of everything after its epoch");
+
+        swap.release(0);
+        DISTRHO_ASSERT_EQUAL(swap.collect(), 1U, "first object is deleted once reader 0 releases");
+        DISTRHO_ASSERT_EQUAL(fromReader1->generation, 2U, "reader 1 object stays valid");
+
+        swap.release(1);
+        DISTRHO_ASSERT_EQUAL(swap.collect(), 1U, "second object is deleted once reader 1 releases");
+    }
+    DISTRHO_ASSERT_EQUAL(gLiveTables.load(), 0, "destructor deletes the current object");
+
+    // destructor deletes pending objects too
+    {
+        AtomicSwap<Table> swap;
+        swap.publish(new Table(1));
+        swap.acquire();
+        swap.publish(new Table(2));
+        swap.release();
+    }
+    DISTRHO_ASSERT_EQUAL(gLiveTables.load(), 0, "destructor deletes queued objects");
+
+    // stress test, writer on this thread and several concurrent readers
+    // build with TSAN=true to have this run under the thread sanitizer
+    {
+        static const uint32_t kNumReaders = 3;
+        static const uint32_t kNumPublishes = 20000;
+
+        AtomicSwap<Table> swap(kNumReaders);
+        TableReader* readers[kNumReaders];
+
+        for (uint32_t i=0; i < kNumReaders; ++i)
+            readers[i] = new TableReader(swap, i);
+
+        for (uint32_t i=1; i <= kNumPublishes; ++i)
+        {
+            swap.publish(new Table(i));
+
+            if (i % 8 == 0)
+                swap.collect();
+        }
+
+        uint32_t numReads = 0, numErrors = 0;
+
+        for (uint32_t i=0; i < kNumReaders; ++i)
+        {
+            readers[i]->stop();
+            numReads += readers[i]->numReads;
+            numErrors += readers[i]->numErrors;
+            delete readers[i];
+        }
+
+        swap.collect();
+
+        d_stdout("Stress test: %u publishes, %u reads", kNumPublishes, numReads);
+        DISTRHO_ASSERT_EQUAL(numErrors, 0U, "readers never see a deleted or partially written object");
+        DISTRHO_ASSERT_EQUAL(swap.hasPendingReclaim(), false, "everything is reclaimed once readers stop");
+        DISTRHO_ASSERT_EQUAL(gLiveTables.load(), 1, "only the current object is alive after stress test");
+    }
+
+    // micro benchmark for the reader side
+    {
+        static const uint32_t kNumIterations = 10000000;
+
+        AtomicSwap<Table> swap(1, new Table(1));
+        uint64_t sum = 0;
+
+        const uint64_t start = d_gettime_ns();
+
+        for (uint32_t i=0; i < kNumIterations; ++i)
+        {
+            sum += swap.acquire()->generation;
+            swap.release();
+        }
+
+        const uint64_t elapsed = d_gettime_ns() - start;
+
+        DISTRHO_ASSERT_EQUAL(sum, static_cast<uint64_t>(kNumIterations), "benchmark loop read the object");
+        d_stdout("Benchmark: acquire + release takes %.2f ns", static_cast<double>(elapsed) / kNumIterations);
+    }
+
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
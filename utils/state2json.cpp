@@ -1,5 +1,6 @@
 #include "extra/Base64.hpp"
 #include "extra/String.hpp"
+#include "src/DistrhoPluginStateChunk.hpp"
 
 int main(int argc, char* argv[])
 {
@@ -17,6 +18,50 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    if (d_isBinaryStateChunk(data.data(), data.size()))
+    {
+        StateChunkReader chunk(data.data(), data.size());
+        DISTRHO_SAFE_ASSERT_RETURN(chunk.isValid(), 1);
+
+        bool first = true;
+        printf("{");
+
+        if (chunk.getProgram() >= 0)
+        {
+            printf("\n  \"program\": %d", chunk.getProgram());
+            first = false;
+        }
+
+        if (chunk.getStateCount() != 0)
+        {
+            printf("%s\n  \"states\": {", first ? "" : ",");
+            first = true;
+
+            for (const char *key, *value; chunk.readNextState(key, value); first = false)
+                // TODO safely encode value as json compatible string
+                printf("%s\n    \"%s\": %s", first ? "" : ",", key, value);
+
+            printf("\n  }");
+            first = false;
+        }
+
+        if (chunk.getParameterCount() != 0)
+        {
+            printf("%s\n  \"parameters\": {", first ? "" : ",");
+            first = true;
+
+            // binary chunks only store a hash of the parameter symbol
+            uint32_t symbolHash;
+            for (float value; chunk.readNextParameter(symbolHash, value); first = false)
+                printf("%s\n    \"#%08x\": %f", first ? "" : ",", symbolHash, value);
+
+            printf("\n  }");
+        }
+
+        printf("\n}\n");
+        return 0;
+    }
+
     String key, value;
     bool firstValue = true;
     bool hasValue = false;